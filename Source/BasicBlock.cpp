@@ -3,6 +3,9 @@
 #include "offsetof_def.h"
 #include "MipsJitter.h"
 #include "Jitter_CodeGenFactory.h"
+#include "BlockCache.h"
+#include "MipsGprState.h"
+#include <zlib.h>
 
 #if defined(AOT_BUILD_CACHE) || defined(AOT_USE_CACHE)
 #define AOT_ENABLED
@@ -10,7 +13,6 @@
 
 #ifdef AOT_ENABLED
 
-#include <zlib.h>
 #include "StdStream.h"
 #include "StdStreamUtils.h"
 
@@ -60,6 +62,14 @@ CBasicBlock::CBasicBlock(CMIPS& context, uint32 begin, uint32 end)
 	}
 }
 
+CBasicBlock::~CBasicBlock()
+{
+	if(m_profilerSlot != CBlockProfiler::INVALID_SLOT)
+	{
+		m_context.m_blockProfiler->UnregisterBlock(m_profilerSlot);
+	}
+}
+
 #ifdef AOT_BUILD_CACHE
 
 Framework::CStdStream* CBasicBlock::m_aotBlockOutputStream(nullptr);
@@ -75,36 +85,111 @@ void CBasicBlock::SetAotBlockOutputStream(Framework::CStdStream* outputStream)
 
 void CBasicBlock::Compile()
 {
+	//Pages with code checks can be protected again later, remember what the block was compiled from
+	if((m_context.m_codeCheckPages != nullptr) && !IsEmpty())
+	{
+		m_codeChecksum = ComputeChecksum();
+	}
+
 #ifndef AOT_USE_CACHE
 
-	Framework::CMemStream stream;
-	{
-		static
-#ifdef AOT_BUILD_CACHE
-		    __declspec(thread)
+	auto blockCache = m_context.m_blockCache;
+	//Profiled blocks depend on the counter table being present, don't mix them with cached code
+	bool useBlockCache = (blockCache != nullptr) && !IsEmpty() && (m_context.m_blockProfileCounterPages == nullptr);
+	//Same goes for code checks, cached code might have been compiled without them
+	useBlockCache = useBlockCache && (m_context.m_codeCheckPages == nullptr);
+	//Blocks are registered with the profiler when compiled, cached code wouldn't update counters
+	useBlockCache = useBlockCache && (m_context.m_blockProfiler == nullptr);
+	//Specializations share the key of the block they were made from
+	useBlockCache = useBlockCache && !IsSpecialization();
+#ifdef DEBUGGER_INCLUDED
+	useBlockCache = useBlockCache && !HasBreakpoint();
 #endif
-		        CMipsJitter* jitter = nullptr;
-		if(jitter == nullptr)
+
+	AOT_BLOCK_KEY blockKey = {};
+	if(useBlockCache)
+	{
+		//Settings changing the generated code are part of the key, other ones keep the block out of the cache
+		uint32 compileSettings = m_context.m_idleLoopDetectionEnabled ? 1 : 0;
+		blockKey.crc = crc32(ComputeChecksum(), reinterpret_cast<const Bytef*>(&compileSettings), sizeof(compileSettings));
+		blockKey.begin = m_begin;
+		blockKey.end = m_end;
+	}
+
+	if(!useBlockCache || !CompileFromCache(*blockCache, blockKey))
+	{
+		Framework::CMemStream stream;
+		CBlockCache::FixupArray fixups;
+		bool relocatable = true;
+
+		auto blockProfiler = m_context.m_blockProfiler;
+		auto compileStartTime = std::chrono::high_resolution_clock::now();
+		//Blocks compiled again keep their slot
+		if((blockProfiler != nullptr) && !IsEmpty() && (m_profilerSlot == CBlockProfiler::INVALID_SLOT))
 		{
-			Jitter::CCodeGen* codeGen = Jitter::CreateCodeGen();
-			jitter = new CMipsJitter(codeGen);
+			m_profilerSlot = blockProfiler->RegisterBlock(m_begin, m_end);
+		}
+
+		const auto symbolReferencedHandler =
+		    [&](uintptr_t symbol, uint32 offset, Jitter::CCodeGen::SYMBOL_REF_TYPE refType) {
+			    HandleExternalFunctionReference(symbol, offset, refType);
+			    if(!useBlockCache) return;
+			    if((refType != Jitter::CCodeGen::SYMBOL_REF_TYPE::NATIVE_POINTER) || !CBlockCache::IsSymbolRelocatable(symbol))
+			    {
+				    relocatable = false;
+				    return;
+			    }
+			    CBlockCache::FIXUP fixup;
+			    fixup.offset = offset;
+			    fixup.refType = static_cast<uint32>(refType);
+			    fixup.symbolDelta = CBlockCache::GetSymbolDelta(symbol);
+			    fixups.push_back(fixup);
+		    };
 
-			for(unsigned int i = 0; i < 4; i++)
+		{
+			//Blocks can be compiled from multiple threads, each of them gets its own jitter, freed when the thread exits
+			static thread_local std::unique_ptr<CMipsJitter> jitter;
+			if(!jitter)
 			{
-				jitter->SetVariableAsConstant(
-				    offsetof(CMIPS, m_State.nGPR[CMIPS::R0].nV[i]),
-				    0);
+				Jitter::CCodeGen* codeGen = Jitter::CreateCodeGen();
+				jitter = std::make_unique<CMipsJitter>(codeGen);
+
+				for(unsigned int i = 0; i < 4; i++)
+				{
+					jitter->SetVariableAsConstant(
+					    offsetof(CMIPS, m_State.nGPR[CMIPS::R0].nV[i]),
+					    0);
+				}
 			}
+
+			jitter->GetCodeGen()->SetExternalSymbolReferencedHandler(symbolReferencedHandler);
+			jitter->SetStream(&stream);
+			jitter->Begin();
+			CompileRange(jitter.get());
+			jitter->End();
 		}
 
-		jitter->GetCodeGen()->SetExternalSymbolReferencedHandler([&](auto symbol, auto offset, auto refType) { this->HandleExternalFunctionReference(symbol, offset, refType); });
-		jitter->SetStream(&stream);
-		jitter->Begin();
-		CompileRange(jitter);
-		jitter->End();
-	}
+		m_function = CMemoryFunction(stream.GetBuffer(), stream.GetSize());
+
+		if(m_profilerSlot != CBlockProfiler::INVALID_SLOT)
+		{
+			auto compileTime = std::chrono::high_resolution_clock::now() - compileStartTime;
+			blockProfiler->NotifyBlockCompiled(m_profilerSlot, m_function.GetCode(), static_cast<uint32>(m_function.GetSize()),
+			                                   std::chrono::duration_cast<std::chrono::nanoseconds>(compileTime));
+		}
 
-	m_function = CMemoryFunction(stream.GetBuffer(), stream.GetSize());
+		if(useBlockCache)
+		{
+			if(relocatable)
+			{
+				blockCache->Insert(blockKey, stream.GetBuffer(), stream.GetSize(), fixups);
+			}
+			else
+			{
+				blockCache->Reject();
+			}
+		}
+	}
 
 #ifdef VTUNE_ENABLED
 	if(iJIT_IsProfilingActive() == iJIT_SAMPLING_ON)
@@ -199,17 +284,40 @@ void CBasicBlock::CompileRange(CMipsJitter* jitter)
 	}
 
 	CompileProlog(jitter);
+	CompileCodeCheck(jitter, m_begin, m_end);
+	CompileProfileCounter(jitter);
+
+	m_isIdleLoop = m_context.m_idleLoopDetectionEnabled && CMIPSAnalysis::IsIdleLoop(&m_context, m_begin, m_end);
+
+	//Nothing but R0 is known when entering a block, unless it's a specialization
+	CMipsGprState gprState(m_context);
+	if(m_entryGprState)
+	{
+		gprState.SetState(*m_entryGprState);
+	}
+	auto deadInstructions = CMipsGprState::FindDeadInstructions(m_context, m_begin, m_end);
 
 	for(uint32 address = m_begin; address <= m_end; address += 4)
 	{
-		m_context.m_pArch->CompileInstruction(
-		    address,
-		    jitter,
-		    &m_context);
+		if(deadInstructions[(address - m_begin) / 4])
+		{
+			gprState.InvalidateInstructionResult(address);
+			continue;
+		}
+		gprState.CompileInstruction(jitter, address);
 		//Sanity check
 		assert(jitter->IsStackEmpty());
 	}
 
+#ifndef AOT_BUILD_CACHE
+	//Delay slot of a likely branch might have been skipped
+	gprState.InvalidateInstructionResult(m_end);
+	if(!IsSpecialization())
+	{
+		SetExitGprState(gprState.GetState());
+	}
+#endif
+
 	jitter->MarkFinalBlockLabel();
 	CompileEpilog(jitter);
 }
@@ -230,13 +338,136 @@ void CBasicBlock::CompileProlog(CMipsJitter* jitter)
 		jitter->EndIf();
 	}
 #endif
+	CompileProfilerCounterUpdate(jitter, CBlockProfiler::COUNTER_EXECUTIONS, 1);
+}
+
+void CBasicBlock::CompileProfileCounter(CMipsJitter* jitter)
+{
+	if(m_context.m_blockProfileCounterPages == nullptr) return;
+
+	//Executor allocates the counter table of the page before compiling the block
+	uint32 page = m_begin / PROFILE_COUNTER_PAGE_SIZE;
+	assert(m_context.m_blockProfileCounterPages[page] != nullptr);
+
+	uint32 pageOffset = page * jitter->GetCodeGen()->GetPointerSize();
+	uint32 counterOffset = ((m_begin % PROFILE_COUNTER_PAGE_SIZE) / 4) * sizeof(uint32);
+	const auto pushCounterRef =
+	    [&]() {
+		    jitter->PushRelRef(offsetof(CMIPS, m_blockProfileCounterPages));
+		    jitter->PushCst(pageOffset);
+		    jitter->AddRef();
+		    jitter->LoadRefFromRef();
+		    jitter->PushCst(counterOffset);
+		    jitter->AddRef();
+	    };
+
+	pushCounterRef();
+
+	pushCounterRef();
+	jitter->LoadFromRef();
+	jitter->PushCst(1);
+	jitter->Add();
+	jitter->StoreAtRef();
+
+	//Executor resets the counter when it queues the block, it won't be notified again until it's hot again
+	pushCounterRef();
+	jitter->LoadFromRef();
+	jitter->PushCst(HOT_BLOCK_THRESHOLD - 1);
+	jitter->BeginIf(Jitter::CONDITION_AB);
+	{
+		jitter->PushCtx();
+		jitter->Call(reinterpret_cast<void*>(&HotBlockHandler), 1, Jitter::CJitter::RETURN_VALUE_NONE);
+	}
+	jitter->EndIf();
+}
+
+void CBasicBlock::CompileProfilerCounterUpdate(CMipsJitter* jitter, CBlockProfiler::COUNTER counter, uint32 value)
+{
+	if(m_profilerSlot == CBlockProfiler::INVALID_SLOT) return;
+
+	uint32 counterOffset = ((m_profilerSlot * CBlockProfiler::COUNTER_MAX) + counter) * sizeof(uint64);
+
+	jitter->PushRelRef(offsetof(CMIPS, m_blockProfilerCounters));
+	jitter->PushCst(counterOffset);
+	jitter->AddRef();
+
+	jitter->PushRelRef(offsetof(CMIPS, m_blockProfilerCounters));
+	jitter->PushCst(counterOffset);
+	jitter->AddRef();
+	jitter->Load64FromRef();
+	jitter->PushCst64(value);
+	jitter->Add64();
+	jitter->Store64AtRef();
+}
+
+void CBasicBlock::CompileCodeCheck(CMipsJitter* jitter, uint32 begin, uint32 end)
+{
+	if(m_context.m_codeCheckPages == nullptr) return;
+
+	uint32 firstPage = begin / MIPS_PAGE_SIZE;
+	uint32 lastPage = end / MIPS_PAGE_SIZE;
+	if(lastPage >= m_context.m_codeCheckPageCount) return;
+
+	assert(m_context.m_pageLookup != nullptr);
+	uint32 pointerSize = jitter->GetCodeGen()->GetPointerSize();
+
+	//Only pay for the comparison if something was written in the pages spanned by the block
+	for(uint32 page = firstPage; page <= lastPage; page++)
+	{
+		jitter->PushRelRef(offsetof(CMIPS, m_codeCheckPages));
+		jitter->PushCst(page * sizeof(uint32));
+		jitter->AddRef();
+		jitter->LoadFromRef();
+		if(page != firstPage)
+		{
+			jitter->Or();
+		}
+	}
+
+	jitter->PushCst(0);
+	jitter->BeginIf(Jitter::CONDITION_NE);
+	{
+		for(uint32 address = begin; address <= end; address += 4)
+		{
+			uint32 opcode = m_context.m_pMemoryMap->GetInstruction(address);
+
+			jitter->PushRelRef(offsetof(CMIPS, m_pageLookup));
+			jitter->PushCst((address / MIPS_PAGE_SIZE) * pointerSize);
+			jitter->AddRef();
+			jitter->LoadRefFromRef();
+			jitter->PushCst(address & (MIPS_PAGE_SIZE - 1));
+			jitter->AddRef();
+			jitter->LoadFromRef();
+
+			jitter->PushCst(opcode);
+			jitter->Xor();
+			if(address != begin)
+			{
+				jitter->Or();
+			}
+		}
+
+		jitter->PushCst(0);
+		jitter->BeginIf(Jitter::CONDITION_NE);
+		{
+			jitter->JumpTo(reinterpret_cast<void*>(&CodeChangedHandler));
+		}
+		jitter->EndIf();
+	}
+	jitter->EndIf();
 }
 
 void CBasicBlock::CompileEpilog(CMipsJitter* jitter)
 {
-	//Update cycle quota
+	CompileEpilog(jitter, m_begin, m_end);
+}
+
+void CBasicBlock::CompileCycleQuotaUpdate(CMipsJitter* jitter, uint32 begin, uint32 end)
+{
+	CompileProfilerCounterUpdate(jitter, CBlockProfiler::COUNTER_CYCLES, ((end - begin) / 4) + 1);
+
 	jitter->PushRel(offsetof(CMIPS, m_State.cycleQuota));
-	jitter->PushCst(((m_end - m_begin) / 4) + 1);
+	jitter->PushCst(((end - begin) / 4) + 1);
 	jitter->Sub();
 	jitter->PullRel(offsetof(CMIPS, m_State.cycleQuota));
 
@@ -250,6 +481,12 @@ void CBasicBlock::CompileEpilog(CMipsJitter* jitter)
 		jitter->PullRel(offsetof(CMIPS, m_State.nHasException));
 	}
 	jitter->EndIf();
+}
+
+void CBasicBlock::CompileEpilog(CMipsJitter* jitter, uint32 begin, uint32 end)
+{
+	//Update cycle quota
+	CompileCycleQuotaUpdate(jitter, begin, end);
 
 	//We probably don't need to pay for this since we know in advance if there's a branch
 	jitter->PushCst(MIPS_INVALID_PC);
@@ -262,6 +499,11 @@ void CBasicBlock::CompileEpilog(CMipsJitter* jitter)
 		jitter->PushCst(MIPS_INVALID_PC);
 		jitter->PullRel(offsetof(CMIPS, m_State.nDelayedJumpAddr));
 
+		if(m_isIdleLoop)
+		{
+			CompileIdleLoopExit(jitter);
+		}
+
 #ifndef AOT_BUILD_CACHE
 		jitter->PushRel(offsetof(CMIPS, m_State.nHasException));
 		jitter->PushCst(0);
@@ -274,7 +516,7 @@ void CBasicBlock::CompileEpilog(CMipsJitter* jitter)
 	}
 	jitter->Else();
 	{
-		jitter->PushCst(m_end + 4);
+		jitter->PushCst(end + 4);
 		jitter->PullRel(offsetof(CMIPS, m_State.nPC));
 
 #ifndef AOT_BUILD_CACHE
@@ -290,6 +532,63 @@ void CBasicBlock::CompileEpilog(CMipsJitter* jitter)
 	jitter->EndIf();
 }
 
+void CBasicBlock::CompileIdleLoopExit(CMipsJitter* jitter)
+{
+	//Branch was taken, the loop would keep spinning without anything changing as long as
+	//it only loads from RAM or scratchpad (hardware registers can change on their own).
+	//Only RAM and scratchpad are mapped in the page table.
+	auto arch = m_context.GetCompileArchitecture();
+	uint32 pointerMultiplyShift = __builtin_ctz(jitter->GetCodeGen()->GetPointerSize());
+	unsigned int loadCount = 0;
+	for(uint32 address = m_begin; address <= m_end; address += 4)
+	{
+		uint32 opcode = m_context.m_pMemoryMap->GetInstruction(address);
+		MIPS_GPR_USAGE usage;
+		if(!arch->GetInstructionGprUsage(&m_context, address, opcode, usage)) continue;
+		if(usage.pure || (usage.writeRegister == CMIPS::R0)) continue;
+
+		//Nothing can be told about where the load goes without a page table
+		if(m_context.m_pageLookup == nullptr)
+		{
+			assert(loadCount == 0);
+			return;
+		}
+
+		//Base register still holds the value it had when the load was executed
+		uint32 baseRegister = (opcode >> 21) & 0x1F;
+		int16 offset = static_cast<int16>(opcode & 0xFFFF);
+		jitter->PushRelRef(offsetof(CMIPS, m_pageLookup));
+		jitter->PushRel(offsetof(CMIPS, m_State.nGPR[baseRegister].nV[0]));
+		jitter->PushCst(static_cast<int32>(offset));
+		jitter->Add();
+		jitter->Srl(12);                   //Divide by MIPS_PAGE_SIZE
+		jitter->Shl(pointerMultiplyShift); //Multiply by sizeof(void*)
+		jitter->AddRef();
+		jitter->LoadRefFromRef();
+		jitter->PushCst(0);
+		jitter->BeginIf(Jitter::CONDITION_NE);
+		loadCount++;
+	}
+
+	jitter->PushRel(offsetof(CMIPS, m_State.nHasException));
+	jitter->PushCst(~MIPS_EXECUTION_STATUS_QUOTADONE);
+	jitter->And();
+	jitter->PushCst(MIPS_EXCEPTION_NONE);
+	jitter->BeginIf(Jitter::CONDITION_EQ);
+	{
+		jitter->PushRel(offsetof(CMIPS, m_State.nHasException));
+		jitter->PushCst(MIPS_EXCEPTION_IDLE);
+		jitter->Or();
+		jitter->PullRel(offsetof(CMIPS, m_State.nHasException));
+	}
+	jitter->EndIf();
+
+	for(unsigned int i = 0; i < loadCount; i++)
+	{
+		jitter->EndIf();
+	}
+}
+
 void CBasicBlock::Execute()
 {
 	m_function(&m_context);
@@ -380,6 +679,57 @@ void CBasicBlock::UnlinkBlock(LINK_SLOT linkSlot)
 #endif //!AOT_ENABLED
 }
 
+void CBasicBlock::SetEntryGprState(const CMipsGprState::STATE& state)
+{
+	assert(!IsCompiled());
+	m_entryGprState = std::make_unique<CMipsGprState::STATE>(state);
+}
+
+bool CBasicBlock::IsSpecialization() const
+{
+	return (m_entryGprState != nullptr);
+}
+
+CBasicBlock* CBasicBlock::FindSpecialization(const CMipsGprState::STATE& state) const
+{
+	for(const auto& specialization : m_specializations)
+	{
+		if(*specialization->m_entryGprState == state)
+		{
+			return specialization.get();
+		}
+	}
+	return nullptr;
+}
+
+const std::vector<std::shared_ptr<CBasicBlock>>& CBasicBlock::GetSpecializations() const
+{
+	return m_specializations;
+}
+
+void CBasicBlock::AddSpecialization(std::shared_ptr<CBasicBlock> specialization)
+{
+	assert(specialization->IsSpecialization());
+	assert(specialization->GetBeginAddress() == m_begin);
+	assert(specialization->GetEndAddress() == m_end);
+	m_specializations.push_back(std::move(specialization));
+}
+
+const CMipsGprState::STATE* CBasicBlock::GetExitGprState() const
+{
+	return m_exitGprState.get();
+}
+
+void CBasicBlock::SetExitGprState(const CMipsGprState::STATE& state)
+{
+	if(state == CMipsGprState::STATE())
+	{
+		m_exitGprState.reset();
+		return;
+	}
+	m_exitGprState = std::make_unique<CMipsGprState::STATE>(state);
+}
+
 void CBasicBlock::HandleExternalFunctionReference(uintptr_t symbol, uint32 offset, Jitter::CCodeGen::SYMBOL_REF_TYPE refType)
 {
 	if(symbol == reinterpret_cast<uintptr_t>(&NextBlockTrampoline))
@@ -396,6 +746,58 @@ void CBasicBlock::HandleExternalFunctionReference(uintptr_t symbol, uint32 offse
 	}
 }
 
+void CBasicBlock::CodeChangedHandler(CMIPS* context)
+{
+	context->m_codeChangedHandler(context);
+}
+
+void CBasicBlock::HotBlockHandler(CMIPS* context)
+{
+	context->m_hotBlockHandler(context);
+}
+
+uint32 CBasicBlock::ComputeChecksum() const
+{
+	uint32 blockSize = ((m_end - m_begin) / 4) + 1;
+	std::vector<uint32> blockData(blockSize);
+	for(uint32 i = 0; i < blockSize; i++)
+	{
+		blockData[i] = m_context.m_pMemoryMap->GetInstruction(m_begin + (i * 4));
+	}
+	return crc32(0, reinterpret_cast<const Bytef*>(blockData.data()), blockSize * 4);
+}
+
+bool CBasicBlock::HasCodeChanged() const
+{
+	assert(m_context.m_codeCheckPages != nullptr);
+	return ComputeChecksum() != m_codeChecksum;
+}
+
+#ifndef AOT_USE_CACHE
+
+bool CBasicBlock::CompileFromCache(CBlockCache& blockCache, const AOT_BLOCK_KEY& blockKey)
+{
+	CBlockCache::ENTRY entry;
+	if(!blockCache.Find(blockKey, entry)) return false;
+
+	auto& code = entry.code;
+	for(const auto& fixup : entry.fixups)
+	{
+		auto symbol = CBlockCache::GetSymbolFromDelta(fixup.symbolDelta);
+		*reinterpret_cast<uintptr_t*>(code.data() + fixup.offset) = symbol;
+		HandleExternalFunctionReference(symbol, fixup.offset, static_cast<Jitter::CCodeGen::SYMBOL_REF_TYPE>(fixup.refType));
+	}
+
+	m_function = CMemoryFunction(code.data(), code.size());
+
+	//Same as what CompileRange would have found
+	SetExitGprState(CMipsGprState::ComputeExitState(m_context, m_begin, m_end));
+
+	return true;
+}
+
+#endif
+
 #ifdef DEBUGGER_INCLUDED
 
 bool CBasicBlock::HasBreakpoint() const
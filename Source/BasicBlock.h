@@ -2,6 +2,8 @@
 
 #include "MIPS.h"
 #include "MemoryFunction.h"
+#include "BlockProfiler.h"
+#include "MipsGprState.h"
 #ifdef AOT_BUILD_CACHE
 #include "StdStream.h"
 #include <mutex>
@@ -40,6 +42,8 @@ namespace Jitter
 	class CJitter;
 };
 
+class CBlockCache;
+
 extern "C"
 {
 	void EmptyBlockHandler(CMIPS*);
@@ -56,8 +60,14 @@ public:
 		LINK_SLOT_MAX,
 	};
 
+	enum
+	{
+		PROFILE_COUNTER_PAGE_SIZE = 0x1000,
+		HOT_BLOCK_THRESHOLD = 0x400,
+	};
+
 	CBasicBlock(CMIPS&, uint32 = MIPS_INVALID_PC, uint32 = MIPS_INVALID_PC);
-	virtual ~CBasicBlock() = default;
+	virtual ~CBasicBlock();
 	void Execute();
 	void Compile();
 	virtual void CompileRange(CMipsJitter*);
@@ -67,11 +77,25 @@ public:
 	bool IsCompiled() const;
 	bool IsEmpty() const;
 
+	virtual uint32 ComputeChecksum() const;
+	bool HasCodeChanged() const;
+
 	uint32 GetLinkTargetAddress(LINK_SLOT);
 	void SetLinkTargetAddress(LINK_SLOT, uint32);
 	void LinkBlock(LINK_SLOT, CBasicBlock*);
 	void UnlinkBlock(LINK_SLOT);
 
+	//Specializations are copies of the block compiled knowing the values of some registers on entry,
+	//they live as long as the block they were made from and are only reached through link edges
+	void SetEntryGprState(const CMipsGprState::STATE&);
+	bool IsSpecialization() const;
+	CBasicBlock* FindSpecialization(const CMipsGprState::STATE&) const;
+	const std::vector<std::shared_ptr<CBasicBlock>>& GetSpecializations() const;
+	void AddSpecialization(std::shared_ptr<CBasicBlock>);
+	//Values known when leaving through a link slot, null if nothing but R0 is known
+	const CMipsGprState::STATE* GetExitGprState() const;
+
+
 #ifdef AOT_BUILD_CACHE
 	static void SetAotBlockOutputStream(Framework::CStdStream*);
 #endif
@@ -83,9 +107,22 @@ protected:
 
 	void CompileProlog(CMipsJitter*);
 	void CompileEpilog(CMipsJitter*);
+	void CompileEpilog(CMipsJitter*, uint32, uint32);
+	void CompileCycleQuotaUpdate(CMipsJitter*, uint32, uint32);
+	void CompileCodeCheck(CMipsJitter*, uint32, uint32);
 
 private:
 	void HandleExternalFunctionReference(uintptr_t, uint32, Jitter::CCodeGen::SYMBOL_REF_TYPE);
+	void CompileProfileCounter(CMipsJitter*);
+	void CompileProfilerCounterUpdate(CMipsJitter*, CBlockProfiler::COUNTER, uint32);
+	void CompileIdleLoopExit(CMipsJitter*);
+	void SetExitGprState(const CMipsGprState::STATE&);
+	static void HotBlockHandler(CMIPS*);
+	static void CodeChangedHandler(CMIPS*);
+
+#ifndef AOT_USE_CACHE
+	bool CompileFromCache(CBlockCache&, const AOT_BLOCK_KEY&);
+#endif
 
 #ifdef DEBUGGER_INCLUDED
 	bool HasBreakpoint() const;
@@ -103,6 +140,12 @@ private:
 #else
 	void (*m_function)(void*);
 #endif
+	uint32 m_profilerSlot = CBlockProfiler::INVALID_SLOT;
+	bool m_isIdleLoop = false;
+	uint32 m_codeChecksum = 0;
+	std::unique_ptr<CMipsGprState::STATE> m_entryGprState;
+	std::unique_ptr<CMipsGprState::STATE> m_exitGprState;
+	std::vector<std::shared_ptr<CBasicBlock>> m_specializations;
 	uint32 m_linkTargetAddress[LINK_SLOT_MAX];
 	uint32 m_linkBlockTrampolineOffset[LINK_SLOT_MAX];
 #ifdef _DEBUG
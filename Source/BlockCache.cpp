@@ -0,0 +1,241 @@
+#include <zlib.h>
+#include "BlockCache.h"
+#include "MemoryUtils.h"
+#include "StdStream.h"
+#include "StdStreamUtils.h"
+#include "Log.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#elif defined(__unix__) || defined(__ANDROID__) || defined(__APPLE__)
+#include <dlfcn.h>
+#define HAS_DLADDR
+#endif
+
+#define LOG_NAME ("blockcache")
+
+static uintptr_t GetAnchorSymbol()
+{
+	return reinterpret_cast<uintptr_t>(&EmptyBlockHandler);
+}
+
+static const void* GetSymbolModule(uintptr_t symbol)
+{
+#if defined(_WIN32)
+	HMODULE module = NULL;
+	BOOL result = GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+	                                 reinterpret_cast<LPCSTR>(symbol), &module);
+	return result ? module : nullptr;
+#elif defined(HAS_DLADDR)
+	Dl_info info = {};
+	int result = dladdr(reinterpret_cast<void*>(symbol), &info);
+	return result ? info.dli_fbase : nullptr;
+#else
+	return nullptr;
+#endif
+}
+
+void CBlockCache::Load(const fs::path& path)
+{
+	//Entries are read without holding the lock, threads compiling blocks only see the whole cache being replaced at once
+	EntryMap entries;
+	if(fs::exists(path))
+	{
+		try
+		{
+			ReadEntries(path, entries);
+		}
+		catch(const std::exception& exception)
+		{
+			CLog::GetInstance().Warn(LOG_NAME, "Failed to load block cache '%s': %s\r\n", path.string().c_str(), exception.what());
+			entries.clear();
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_entries = std::move(entries);
+	m_dirty = false;
+}
+
+void CBlockCache::ReadEntries(const fs::path& path, EntryMap& entries)
+{
+	auto stream = Framework::CreateInputStdStream(path.native());
+	uint32 magic = stream.Read32();
+	uint32 version = stream.Read32();
+	uint32 fingerprint = stream.Read32();
+	if((magic != FILE_MAGIC) || (version != FILE_VERSION) || (fingerprint != GetBuildFingerprint()))
+	{
+		CLog::GetInstance().Print(LOG_NAME, "Discarding stale block cache '%s'.\r\n", path.string().c_str());
+		return;
+	}
+
+	uint32 entryCount = stream.Read32();
+	for(uint32 i = 0; i < entryCount; i++)
+	{
+		AOT_BLOCK_KEY key = {};
+		key.crc = stream.Read32();
+		key.begin = stream.Read32();
+		key.end = stream.Read32();
+
+		uint32 codeSize = stream.Read32();
+		uint32 fixupCount = stream.Read32();
+
+		ENTRY entry;
+		entry.fixups.resize(fixupCount);
+		for(auto& fixup : entry.fixups)
+		{
+			fixup.offset = stream.Read32();
+			fixup.refType = stream.Read32();
+			uint32 deltaLo = stream.Read32();
+			uint32 deltaHi = stream.Read32();
+			fixup.symbolDelta = static_cast<int64>(static_cast<uint64>(deltaLo) | (static_cast<uint64>(deltaHi) << 32));
+			if((fixup.offset + sizeof(uintptr_t)) > codeSize)
+			{
+				throw std::runtime_error("Invalid fixup offset.");
+			}
+		}
+
+		entry.code.resize(codeSize);
+		stream.Read(entry.code.data(), codeSize);
+		entries.emplace(key, std::move(entry));
+	}
+}
+
+void CBlockCache::Save(const fs::path& path)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(!m_dirty) return;
+
+	try
+	{
+		auto stream = Framework::CreateOutputStdStream(path.native());
+		stream.Write32(FILE_MAGIC);
+		stream.Write32(FILE_VERSION);
+		stream.Write32(GetBuildFingerprint());
+		stream.Write32(static_cast<uint32>(m_entries.size()));
+		for(const auto& entryPair : m_entries)
+		{
+			const auto& key = entryPair.first;
+			const auto& entry = entryPair.second;
+
+			stream.Write32(key.crc);
+			stream.Write32(key.begin);
+			stream.Write32(key.end);
+
+			stream.Write32(static_cast<uint32>(entry.code.size()));
+			stream.Write32(static_cast<uint32>(entry.fixups.size()));
+			for(const auto& fixup : entry.fixups)
+			{
+				uint64 delta = static_cast<uint64>(fixup.symbolDelta);
+				stream.Write32(fixup.offset);
+				stream.Write32(fixup.refType);
+				stream.Write32(static_cast<uint32>(delta));
+				stream.Write32(static_cast<uint32>(delta >> 32));
+			}
+
+			stream.Write(entry.code.data(), entry.code.size());
+		}
+	}
+	catch(const std::exception& exception)
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Failed to save block cache '%s': %s\r\n", path.string().c_str(), exception.what());
+		return;
+	}
+
+	m_dirty = false;
+}
+
+void CBlockCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_entries.clear();
+	m_dirty = false;
+}
+
+bool CBlockCache::Find(const AOT_BLOCK_KEY& key, ENTRY& result)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto entryIterator = m_entries.find(key);
+	if(entryIterator == std::end(m_entries))
+	{
+		m_stats.misses++;
+		return false;
+	}
+	result = entryIterator->second;
+	m_stats.hits++;
+	m_stats.bytesLoaded += result.code.size();
+	return true;
+}
+
+void CBlockCache::Insert(const AOT_BLOCK_KEY& key, const void* code, size_t codeSize, const FixupArray& fixups)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	ENTRY entry;
+	entry.code = CodeArray(reinterpret_cast<const uint8*>(code), reinterpret_cast<const uint8*>(code) + codeSize);
+	entry.fixups = fixups;
+	m_entries[key] = std::move(entry);
+	m_dirty = true;
+}
+
+void CBlockCache::Reject()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.rejects++;
+}
+
+size_t CBlockCache::GetEntryCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries.size();
+}
+
+CBlockCache::STATS CBlockCache::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+void CBlockCache::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats = STATS();
+}
+
+bool CBlockCache::IsSymbolRelocatable(uintptr_t symbol)
+{
+	//Only symbols living in the same image as the anchor keep a constant distance to it
+	static const void* anchorModule = GetSymbolModule(GetAnchorSymbol());
+	if(anchorModule == nullptr) return false;
+	return GetSymbolModule(symbol) == anchorModule;
+}
+
+int64 CBlockCache::GetSymbolDelta(uintptr_t symbol)
+{
+	return static_cast<int64>(symbol - GetAnchorSymbol());
+}
+
+uintptr_t CBlockCache::GetSymbolFromDelta(int64 delta)
+{
+	return GetAnchorSymbol() + static_cast<uintptr_t>(delta);
+}
+
+uint32 CBlockCache::GetBuildFingerprint()
+{
+	//Any change to the state layout or to the relative position of
+	//commonly referenced functions invalidates previously saved code
+	const int64 fingerprintData[] =
+	    {
+	        static_cast<int64>(sizeof(MIPSSTATE)),
+	        static_cast<int64>(sizeof(uintptr_t)),
+	        GetSymbolDelta(reinterpret_cast<uintptr_t>(&NextBlockTrampoline)),
+	        GetSymbolDelta(reinterpret_cast<uintptr_t>(&MemoryUtils_GetWordProxy)),
+	        GetSymbolDelta(reinterpret_cast<uintptr_t>(&MemoryUtils_SetWordProxy)),
+	        GetSymbolDelta(reinterpret_cast<uintptr_t>(&MemoryUtils_GetQuadProxy)),
+	        GetSymbolDelta(reinterpret_cast<uintptr_t>(&MemoryUtils_SetQuadProxy)),
+	    };
+	uint32 fingerprint = crc32(0, reinterpret_cast<const Bytef*>(fingerprintData), sizeof(fingerprintData));
+#ifdef PLAY_VERSION
+	fingerprint = crc32(fingerprint, reinterpret_cast<const Bytef*>(PLAY_VERSION), sizeof(PLAY_VERSION) - 1);
+#endif
+	return fingerprint;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include "Types.h"
+#include "filesystem_def.h"
+#include "BasicBlock.h"
+
+//Persistent store of relocatable compiled block code, keyed on block checksum and range.
+//External symbol references are saved relative to an anchor function in the executable
+//image, which makes them valid across runs of the same build even when ASLR is active.
+class CBlockCache
+{
+public:
+	struct FIXUP
+	{
+		uint32 offset;
+		uint32 refType;
+		int64 symbolDelta;
+	};
+	typedef std::vector<FIXUP> FixupArray;
+	typedef std::vector<uint8> CodeArray;
+
+	struct ENTRY
+	{
+		CodeArray code;
+		FixupArray fixups;
+	};
+
+	struct STATS
+	{
+		uint32 hits = 0;
+		uint32 misses = 0;
+		uint32 rejects = 0;
+		uint64 bytesLoaded = 0;
+	};
+
+	void Load(const fs::path&);
+	void Save(const fs::path&);
+	void Clear();
+
+	bool Find(const AOT_BLOCK_KEY&, ENTRY&);
+	void Insert(const AOT_BLOCK_KEY&, const void*, size_t, const FixupArray&);
+	void Reject();
+
+	size_t GetEntryCount() const;
+	STATS GetStats() const;
+	void ResetStats();
+
+	static bool IsSymbolRelocatable(uintptr_t);
+	static int64 GetSymbolDelta(uintptr_t);
+	static uintptr_t GetSymbolFromDelta(int64);
+
+private:
+	typedef std::map<AOT_BLOCK_KEY, ENTRY> EntryMap;
+
+	enum
+	{
+		FILE_MAGIC = 0x434B4C42, //'BLKC'
+		FILE_VERSION = 6,
+	};
+
+	static void ReadEntries(const fs::path&, EntryMap&);
+	static uint32 GetBuildFingerprint();
+
+	mutable std::mutex m_mutex;
+	EntryMap m_entries;
+	STATS m_stats;
+	bool m_dirty = false;
+};
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include "BlockCompiler.h"
+#include "BasicBlock.h"
+
+CBlockCompiler::CBlockCompiler(CMIPS& context, const BlockFactoryFunction& blockFactory)
+    : m_context(context)
+    , m_blockFactory(blockFactory)
+    , m_compileArchitecture(context.CloneCompileArchitecture())
+    , m_currentAddress(MIPS_INVALID_PC)
+{
+	m_workerThread = std::thread([this]() { WorkerThreadProc(); });
+}
+
+CBlockCompiler::~CBlockCompiler()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+	m_queueCondition.notify_one();
+	m_workerThread.join();
+}
+
+void CBlockCompiler::Enqueue(uint32 begin, uint32 end)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(m_queue.size() >= MAX_QUEUE_SIZE) return;
+		if(m_results.size() >= MAX_RESULT_COUNT) return;
+		if(m_currentAddress == begin) return;
+		if(m_results.find(begin) != std::end(m_results)) return;
+		if(IsQueued(begin)) return;
+	}
+
+	//Guest code is only modified by the emulation thread, copy it now so the worker doesn't read it while it changes
+	JOB job;
+	job.end = end;
+	job.code.address = begin;
+	job.code.opcodes.resize(((end - begin) / 4) + 1);
+	for(uint32 i = 0; i < job.code.opcodes.size(); i++)
+	{
+		job.code.opcodes[i] = m_context.m_pMemoryMap->GetInstruction(begin + (i * 4));
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(std::move(job));
+		m_stats.queued++;
+	}
+	m_queueCondition.notify_one();
+}
+
+CBlockCompiler::BasicBlockPtr CBlockCompiler::Take(uint32 address)
+{
+	RESULT result;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		//If the worker didn't pick it up yet, it's faster to let the caller compile it
+		auto queueIterator = std::find_if(std::begin(m_queue), std::end(m_queue),
+		                                  [&](const JOB& job) { return job.code.address == address; });
+		if(queueIterator != std::end(m_queue))
+		{
+			m_queue.erase(queueIterator);
+			return BasicBlockPtr();
+		}
+
+		//Don't wait for a compilation in progress, the caller compiles it and the worker's result is dropped
+		if(m_currentAddress == address)
+		{
+			m_currentCancelled = true;
+			return BasicBlockPtr();
+		}
+
+		auto resultIterator = m_results.find(address);
+		if(resultIterator == std::end(m_results))
+		{
+			return BasicBlockPtr();
+		}
+
+		result = std::move(resultIterator->second);
+		m_results.erase(resultIterator);
+	}
+
+	//Make sure the code didn't change since it was copied
+	if(result.block->ComputeChecksum() != result.checksum)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stats.discarded++;
+		return BasicBlockPtr();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stats.adopted++;
+	}
+	return result.block;
+}
+
+void CBlockCompiler::Cancel(uint32 start, uint32 end)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_queue.erase(
+	    std::remove_if(std::begin(m_queue), std::end(m_queue),
+	                   [&](const JOB& job) { return (job.code.address < end) && (start <= job.end); }),
+	    std::end(m_queue));
+	for(auto resultIterator = std::begin(m_results); resultIterator != std::end(m_results);)
+	{
+		const auto& block = resultIterator->second.block;
+		if((block->GetBeginAddress() < end) && (start <= block->GetEndAddress()))
+		{
+			resultIterator = m_results.erase(resultIterator);
+			m_stats.discarded++;
+		}
+		else
+		{
+			resultIterator++;
+		}
+	}
+	if((m_currentAddress != MIPS_INVALID_PC) && (m_currentAddress < end) && (start <= m_currentEnd))
+	{
+		m_currentCancelled = true;
+	}
+}
+
+void CBlockCompiler::Reset()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_queue.clear();
+	m_currentCancelled = true;
+	m_doneCondition.wait(lock, [&]() { return m_currentAddress == MIPS_INVALID_PC; });
+	m_results.clear();
+}
+
+CBlockCompiler::STATS CBlockCompiler::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+bool CBlockCompiler::IsQueued(uint32 address) const
+{
+	return std::find_if(std::begin(m_queue), std::end(m_queue),
+	                    [&](const JOB& job) { return job.code.address == address; }) != std::end(m_queue);
+}
+
+void CBlockCompiler::WorkerThreadProc()
+{
+	m_context.SetThreadCompileArchitecture(m_compileArchitecture.get());
+
+	while(1)
+	{
+		JOB job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_queueCondition.wait(lock, [&]() { return !m_running || !m_queue.empty(); });
+			if(!m_running) break;
+			job = std::move(m_queue.front());
+			m_queue.pop_front();
+			m_currentAddress = job.code.address;
+			m_currentEnd = job.end;
+			m_currentCancelled = false;
+		}
+
+		//Instructions inside the block's range are read from the copy while compiling
+		m_context.m_pMemoryMap->SetThreadInstructionSnapshot(&job.code);
+		RESULT result;
+		result.block = m_blockFactory(job.code.address, job.end);
+		result.checksum = result.block->ComputeChecksum();
+		result.block->Compile();
+		m_context.m_pMemoryMap->SetThreadInstructionSnapshot(nullptr);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(!m_currentCancelled)
+			{
+				m_results[job.code.address] = std::move(result);
+			}
+			else
+			{
+				m_stats.discarded++;
+			}
+			m_currentAddress = MIPS_INVALID_PC;
+		}
+		m_doneCondition.notify_all();
+	}
+
+	m_context.SetThreadCompileArchitecture(nullptr);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include "Types.h"
+#include "MIPS.h"
+
+class CBasicBlock;
+
+//Compiles blocks ahead of time on a worker thread. Blocks are requested speculatively
+//(ie.: for link targets that don't exist yet) and are adopted by the executor only
+//if the guest code they were compiled from is still unchanged when they are needed.
+//The worker compiles from a copy of the guest code taken at enqueue time, using its
+//own copies of the architecture objects, it never waits on the emulation thread.
+class CBlockCompiler
+{
+public:
+	typedef std::shared_ptr<CBasicBlock> BasicBlockPtr;
+	typedef std::function<BasicBlockPtr(uint32, uint32)> BlockFactoryFunction;
+
+	struct STATS
+	{
+		uint32 queued = 0;
+		uint32 adopted = 0;
+		uint32 discarded = 0;
+	};
+
+	CBlockCompiler(CMIPS&, const BlockFactoryFunction&);
+	~CBlockCompiler();
+
+	void Enqueue(uint32, uint32);
+	BasicBlockPtr Take(uint32);
+	void Cancel(uint32, uint32);
+	void Reset();
+
+	STATS GetStats() const;
+
+private:
+	enum
+	{
+		MAX_QUEUE_SIZE = 64,
+		MAX_RESULT_COUNT = 1024,
+	};
+
+	struct JOB
+	{
+		uint32 end = 0;
+		CMemoryMap::INSTRUCTION_SNAPSHOT code;
+	};
+
+	struct RESULT
+	{
+		BasicBlockPtr block;
+		uint32 checksum = 0;
+	};
+
+	typedef std::deque<JOB> JobQueue;
+	typedef std::unordered_map<uint32, RESULT> ResultMap;
+
+	void WorkerThreadProc();
+	bool IsQueued(uint32) const;
+
+	CMIPS& m_context;
+	BlockFactoryFunction m_blockFactory;
+	CMIPS::CompileArchitecturePtr m_compileArchitecture;
+	std::thread m_workerThread;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_queueCondition;
+	std::condition_variable m_doneCondition;
+	JobQueue m_queue;
+	ResultMap m_results;
+	uint32 m_currentAddress;
+	uint32 m_currentEnd = 0;
+	bool m_currentCancelled = false;
+	bool m_running = true;
+	STATS m_stats;
+};
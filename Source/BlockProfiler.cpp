@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cstdio>
+#include <cinttypes>
+#include <cassert>
+#include "BlockProfiler.h"
+#include "string_format.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#define HAS_PERF_MAP
+#endif
+
+static std::mutex g_perfMapMutex;
+static FILE* g_perfMapFile = nullptr;
+
+CBlockProfiler::CBlockProfiler(const char* name)
+    : m_name(name)
+    , m_counters(new uint64[MAX_BLOCK_COUNT * COUNTER_MAX])
+{
+	std::fill(m_counters.get(), m_counters.get() + (MAX_BLOCK_COUNT * COUNTER_MAX), 0);
+}
+
+const char* CBlockProfiler::GetName() const
+{
+	return m_name.c_str();
+}
+
+uint64* CBlockProfiler::GetCounters() const
+{
+	return m_counters.get();
+}
+
+uint32 CBlockProfiler::RegisterBlock(uint32 begin, uint32 end)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	uint32 slot = INVALID_SLOT;
+	if(!m_freeSlots.empty())
+	{
+		slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else if(m_blocks.size() != MAX_BLOCK_COUNT)
+	{
+		slot = static_cast<uint32>(m_blocks.size());
+		m_blocks.emplace_back();
+	}
+	else
+	{
+		m_overflowCount++;
+		return INVALID_SLOT;
+	}
+	auto& block = m_blocks[slot];
+	block = BLOCK();
+	block.begin = begin;
+	block.end = end;
+	block.used = true;
+	m_compiledCount++;
+	return slot;
+}
+
+void CBlockProfiler::UnregisterBlock(uint32 slot)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	assert(slot < m_blocks.size());
+	auto& block = m_blocks[slot];
+	assert(block.used);
+	auto counters = m_counters.get() + (slot * COUNTER_MAX);
+	if(counters[COUNTER_EXECUTIONS] != 0)
+	{
+		auto& info = m_retiredBlocks[MakeRangeKey(block.begin, block.end)];
+		info.begin = block.begin;
+		info.end = block.end;
+		info.hostCodeSize = block.hostCodeSize;
+		info.compileTime = block.compileTime;
+		info.executionCount += counters[COUNTER_EXECUTIONS];
+		info.cycleCount += counters[COUNTER_CYCLES];
+	}
+	//Code of the next block using this slot expects counters to start from 0
+	std::fill(counters, counters + COUNTER_MAX, 0);
+	block.used = false;
+	m_freeSlots.push_back(slot);
+}
+
+void CBlockProfiler::NotifyBlockCompiled(uint32 slot, const void* code, uint32 codeSize, std::chrono::nanoseconds compileTime)
+{
+	uint32 begin = 0;
+	uint32 end = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		assert(slot < m_blocks.size());
+		auto& block = m_blocks[slot];
+		block.hostCodeSize = codeSize;
+		block.compileTime = static_cast<uint32>(std::chrono::duration_cast<std::chrono::microseconds>(compileTime).count());
+		begin = block.begin;
+		end = block.end;
+	}
+	WritePerfMapEntry(code, codeSize, string_format("%s_0x%08X_0x%08X", m_name.c_str(), begin, end));
+}
+
+CBlockProfiler::BlockInfoArray CBlockProfiler::GetTopBlocks(size_t count) const
+{
+	BlockInfoArray result;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto blockInfos = m_retiredBlocks;
+		for(uint32 slot = 0; slot < m_blocks.size(); slot++)
+		{
+			const auto& block = m_blocks[slot];
+			const auto counters = m_counters.get() + (slot * COUNTER_MAX);
+			if(!block.used || (counters[COUNTER_EXECUTIONS] == 0)) continue;
+			auto& info = blockInfos[MakeRangeKey(block.begin, block.end)];
+			info.begin = block.begin;
+			info.end = block.end;
+			info.hostCodeSize = block.hostCodeSize;
+			info.compileTime = block.compileTime;
+			info.executionCount += counters[COUNTER_EXECUTIONS];
+			info.cycleCount += counters[COUNTER_CYCLES];
+		}
+		result.reserve(blockInfos.size());
+		for(const auto& blockInfoPair : blockInfos)
+		{
+			result.push_back(blockInfoPair.second);
+		}
+	}
+	//Cycles spent are the best indication of where time goes, sort on that
+	count = std::min(count, result.size());
+	std::partial_sort(result.begin(), result.begin() + count, result.end(),
+	                  [](const BLOCK_INFO& info1, const BLOCK_INFO& info2) { return info1.cycleCount > info2.cycleCount; });
+	result.resize(count);
+	return result;
+}
+
+std::string CBlockProfiler::DumpTopBlocks(size_t count) const
+{
+	uint64 totalCycles = 0;
+	uint32 blockCount = 0;
+	uint32 overflowCount = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		//Counters of free slots are always 0
+		for(uint32 slot = 0; slot < m_blocks.size(); slot++)
+		{
+			totalCycles += m_counters[(slot * COUNTER_MAX) + COUNTER_CYCLES];
+		}
+		for(const auto& blockInfoPair : m_retiredBlocks)
+		{
+			totalCycles += blockInfoPair.second.cycleCount;
+		}
+		blockCount = m_compiledCount;
+		overflowCount = m_overflowCount;
+	}
+
+	std::string result;
+	result += string_format("%s: %d blocks compiled (%d not profiled), %" PRIu64 " cycles.\r\n",
+	                        m_name.c_str(), blockCount, overflowCount, totalCycles);
+	result += "  Begin      End        Executions   Cycles       Ratio   Size   Compile\r\n";
+	for(const auto& info : GetTopBlocks(count))
+	{
+		double ratio = (totalCycles != 0) ? static_cast<double>(info.cycleCount) / static_cast<double>(totalCycles) : 0;
+		result += string_format("  0x%08X 0x%08X %12" PRIu64 " %12" PRIu64 " %6.2f%% %6d %6dus\r\n",
+		                        info.begin, info.end, info.executionCount, info.cycleCount, ratio * 100.0,
+		                        info.hostCodeSize, info.compileTime);
+	}
+	return result;
+}
+
+void CBlockProfiler::ResetCounters()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::fill(m_counters.get(), m_counters.get() + (MAX_BLOCK_COUNT * COUNTER_MAX), 0);
+	m_retiredBlocks.clear();
+}
+
+uint64 CBlockProfiler::MakeRangeKey(uint32 begin, uint32 end)
+{
+	return (static_cast<uint64>(begin) << 32) | static_cast<uint64>(end);
+}
+
+void CBlockProfiler::SetPerfMapEnabled(bool enabled)
+{
+#ifdef HAS_PERF_MAP
+	std::lock_guard<std::mutex> lock(g_perfMapMutex);
+	if(enabled == (g_perfMapFile != nullptr)) return;
+	if(enabled)
+	{
+		//Format expected by 'perf' to symbolize code it doesn't know about
+		auto path = string_format("/tmp/perf-%d.map", static_cast<int>(getpid()));
+		g_perfMapFile = fopen(path.c_str(), "w");
+	}
+	else
+	{
+		fclose(g_perfMapFile);
+		g_perfMapFile = nullptr;
+	}
+#endif
+}
+
+void CBlockProfiler::WritePerfMapEntry(const void* code, uint32 codeSize, const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(g_perfMapMutex);
+	if(g_perfMapFile == nullptr) return;
+	fprintf(g_perfMapFile, "%" PRIxPTR " %x %s\n", reinterpret_cast<uintptr_t>(code), codeSize, name.c_str());
+	fflush(g_perfMapFile);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Types.h"
+
+//Gathers execution statistics about compiled blocks. Counters are updated by the
+//compiled code itself, everything else is recorded when a block gets compiled.
+//Slots of deleted blocks are recycled, their statistics are kept around and merged
+//with the ones of other blocks covering the same range.
+class CBlockProfiler
+{
+public:
+	enum
+	{
+		MAX_BLOCK_COUNT = 0x40000,
+		INVALID_SLOT = ~0U,
+	};
+
+	enum COUNTER
+	{
+		COUNTER_EXECUTIONS,
+		COUNTER_CYCLES,
+		COUNTER_MAX,
+	};
+
+	struct BLOCK_INFO
+	{
+		uint32 begin = 0;
+		uint32 end = 0;
+		uint32 hostCodeSize = 0;
+		uint32 compileTime = 0; //In microseconds
+		uint64 executionCount = 0;
+		uint64 cycleCount = 0;
+	};
+	typedef std::vector<BLOCK_INFO> BlockInfoArray;
+
+	CBlockProfiler(const char*);
+
+	const char* GetName() const;
+	uint64* GetCounters() const;
+
+	uint32 RegisterBlock(uint32, uint32);
+	void UnregisterBlock(uint32);
+	void NotifyBlockCompiled(uint32, const void*, uint32, std::chrono::nanoseconds);
+
+	BlockInfoArray GetTopBlocks(size_t) const;
+	std::string DumpTopBlocks(size_t) const;
+	void ResetCounters();
+
+	static void SetPerfMapEnabled(bool);
+
+private:
+	struct BLOCK
+	{
+		uint32 begin = 0;
+		uint32 end = 0;
+		uint32 hostCodeSize = 0;
+		uint32 compileTime = 0;
+		bool used = false;
+	};
+	typedef std::vector<BLOCK> BlockArray;
+	typedef std::vector<uint32> SlotArray;
+	typedef std::unordered_map<uint64, BLOCK_INFO> BlockInfoMap;
+
+	static uint64 MakeRangeKey(uint32, uint32);
+	static void WritePerfMapEntry(const void*, uint32, const std::string&);
+
+	std::string m_name;
+	std::unique_ptr<uint64[]> m_counters;
+
+	mutable std::mutex m_mutex;
+	BlockArray m_blocks;
+	SlotArray m_freeSlots;
+	BlockInfoMap m_retiredBlocks;
+	uint32 m_compiledCount = 0;
+	uint32 m_overflowCount = 0;
+};
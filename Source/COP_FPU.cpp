@@ -24,6 +24,11 @@ CCOP_FPU::CCOP_FPU(MIPS_REGSIZE regSize)
 	SetupReflectionTables();
 }
 
+std::unique_ptr<CMIPSCoprocessor> CCOP_FPU::Clone() const
+{
+	return std::make_unique<CCOP_FPU>(m_regSize);
+}
+
 void CCOP_FPU::CompileInstruction(uint32 address, CMipsJitter* codeGen, CMIPS* ctx)
 {
 	SetupQuickVariables(address, codeGen, ctx);
@@ -12,6 +12,7 @@ public:
 	void GetArguments(uint32, uint32, char*) override;
 	uint32 GetEffectiveAddress(uint32, uint32) override;
 	MIPS_BRANCH_TYPE IsBranch(uint32) override;
+	std::unique_ptr<CMIPSCoprocessor> Clone() const override;
 
 protected:
 	void SetupReflectionTables();
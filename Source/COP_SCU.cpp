@@ -52,6 +52,11 @@ CCOP_SCU::CCOP_SCU(MIPS_REGSIZE nRegSize)
 	SetupReflectionTables();
 }
 
+std::unique_ptr<CMIPSCoprocessor> CCOP_SCU::Clone() const
+{
+	return std::make_unique<CCOP_SCU>(m_regSize);
+}
+
 void CCOP_SCU::CompileInstruction(uint32 nAddress, CMipsJitter* codeGen, CMIPS* pCtx)
 {
 	SetupQuickVariables(nAddress, codeGen, pCtx);
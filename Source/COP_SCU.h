@@ -55,6 +55,7 @@ public:
 	virtual void GetArguments(uint32, uint32, char*) override;
 	virtual uint32 GetEffectiveAddress(uint32, uint32) override;
 	virtual MIPS_BRANCH_TYPE IsBranch(uint32) override;
+	virtual std::unique_ptr<CMIPSCoprocessor> Clone() const override;
 
 	static const char* m_sRegName[];
 
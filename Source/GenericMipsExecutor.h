@@ -1,8 +1,14 @@
 #pragma once
 
-#include <list>
+#include <algorithm>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
 #include "MIPS.h"
 #include "BasicBlock.h"
+#include "BlockCompiler.h"
+#include "TraceBlock.h"
 
 #include "BlockLookupOneWay.h"
 #include "BlockLookupTwoWay.h"
@@ -24,6 +30,9 @@ public:
 	enum
 	{
 		MAX_BLOCK_SIZE = 0x1000,
+		MAX_TRACE_SEGMENTS = 8,
+		MAX_PENDING_HOT_BLOCKS = 0x100,
+		MAX_BLOCK_SPECIALIZATIONS = 4,
 	};
 
 	CGenericMipsExecutor(CMIPS& context, uint32 maxAddress)
@@ -49,6 +58,10 @@ public:
 
 	int Execute(int cycles) override
 	{
+		if(m_traceFormationEnabled)
+		{
+			FormPendingTraces();
+		}
 		m_context.m_State.cycleQuota = cycles;
 #ifdef DEBUGGER_INCLUDED
 		m_mustBreak = false;
@@ -79,10 +92,22 @@ public:
 
 	void Reset() override
 	{
+		if(m_blockCompiler)
+		{
+			m_blockCompiler->Reset();
+		}
 		m_blockLookup.Clear();
 		m_blocks.clear();
+		m_blockPages.clear();
 		m_blockLinks.clear();
-		m_pendingBlockLinks.clear();
+		m_traces.clear();
+		m_traceDependents.clear();
+		m_retiredBlocks.clear();
+		m_hotBlocks.clear();
+		for(const auto& counters : m_blockProfileCounterStorage)
+		{
+			std::fill(counters.get(), counters.get() + PROFILE_COUNTERS_PER_PAGE, 0);
+		}
 	}
 
 	void ClearActiveBlocksInRange(uint32 start, uint32 end, bool executing) override
@@ -91,11 +116,67 @@ public:
 		if(executing)
 		{
 			currentBlock = FindBlockStartingAt(m_context.m_State.nPC);
-			assert(!currentBlock->IsEmpty());
+			//Invalidated traces run until their next segment exit, the block matching PC might be gone already
+			assert(!currentBlock->IsEmpty() || m_traceFormationEnabled);
 		}
 		ClearActiveBlocksInRangeInternal(start, end, currentBlock);
 	}
 
+	void SetBackgroundCompilationEnabled(bool enabled) override
+	{
+		if(!enabled)
+		{
+			m_blockCompiler.reset();
+			return;
+		}
+		if(m_blockCompiler) return;
+		m_blockCompiler = std::make_unique<CBlockCompiler>(
+		    m_context,
+		    [this](uint32 start, uint32 end) {
+			    PrepareProfileCounter(start);
+			    return std::make_shared<CBasicBlock>(m_context, start, end);
+		    });
+	}
+
+	void CancelBackgroundCompilation() override
+	{
+		if(!m_blockCompiler) return;
+		m_blockCompiler->Reset();
+	}
+
+	const CBlockCompiler* GetBlockCompiler() const
+	{
+		return m_blockCompiler.get();
+	}
+
+	void SetTraceFormationEnabled(bool enabled) override
+	{
+		if(m_traceFormationEnabled == enabled) return;
+		//Blocks compiled with and without profiling counters can't be mixed
+		Reset();
+		m_traceFormationEnabled = enabled;
+		if(enabled)
+		{
+			m_blockProfileCounterPages.resize((m_maxAddress + CBasicBlock::PROFILE_COUNTER_PAGE_SIZE - 1) / CBasicBlock::PROFILE_COUNTER_PAGE_SIZE);
+			m_context.m_blockProfileCounterPages = m_blockProfileCounterPages.data();
+			m_context.m_hotBlockHandler =
+			    [this](CMIPS* context) {
+				    uint32 address = context->m_State.nPC & m_addressMask;
+				    //Start counting again, if no trace can be formed, we'll try again once it's hot again
+				    GetProfileCounter(address) = 0;
+				    if(m_hotBlocks.size() == MAX_PENDING_HOT_BLOCKS) return;
+				    m_hotBlocks.push_back(address);
+			    };
+		}
+		else
+		{
+			m_context.m_blockProfileCounterPages = nullptr;
+			m_context.m_hotBlockHandler = nullptr;
+			m_blockProfileCounterPages.clear();
+			m_blockProfileCounterStorage.clear();
+		}
+	}
+
 #ifdef DEBUGGER_INCLUDED
 	bool MustBreak() const override
 	{
@@ -114,15 +195,42 @@ public:
 #endif
 
 protected:
-	//Outgoing block link
+	enum
+	{
+		BLOCK_PAGE_BITS = 12,
+	};
+
+	//Link slot of a block pointing to a target address, 'linked' is set when a block exists at that address
 	struct BLOCK_LINK
 	{
+		CBasicBlock* block;
 		CBasicBlock::LINK_SLOT slot;
-		uint32 address;
+		bool linked;
 	};
 
-	typedef std::list<BasicBlockPtr> BlockList;
-	typedef std::multimap<uint32, BLOCK_LINK> BlockLinkMap;
+	struct BLOCK_RANGE
+	{
+		uint32 end;
+		uint32 branchAddress;
+	};
+
+	typedef std::unordered_map<uint32, BasicBlockPtr> BlockMap;
+	typedef std::set<CBasicBlock*> BlockSet;
+	typedef std::vector<CBasicBlock*> BlockArray;
+	typedef std::unordered_map<uint32, BlockArray> BlockPageMap;
+	typedef std::vector<BLOCK_LINK> BlockLinkArray;
+	typedef std::unordered_map<uint32, BlockLinkArray> BlockLinkMap;
+	typedef std::unordered_map<uint32, CTraceBlock*> TraceMap;
+	typedef std::unordered_multimap<uint32, uint32> TraceDependencyMap;
+	typedef std::vector<BasicBlockPtr> RetiredBlockArray;
+	typedef std::vector<uint32> HotBlockArray;
+	typedef std::vector<uint32*> ProfileCounterPageArray;
+	typedef std::vector<std::unique_ptr<uint32[]>> ProfileCounterStorageArray;
+
+	enum
+	{
+		PROFILE_COUNTERS_PER_PAGE = CBasicBlock::PROFILE_COUNTER_PAGE_SIZE / 4,
+	};
 
 	bool HasBlockAt(uint32 address) const
 	{
@@ -134,71 +242,264 @@ protected:
 	{
 		assert(!HasBlockAt(start));
 		auto block = BlockFactory(m_context, start, end);
+		InsertBlock(std::move(block));
+	}
+
+	void InsertBlock(BasicBlockPtr block)
+	{
+		uint32 start = block->GetBeginAddress();
 		m_blockLookup.AddBlock(block.get());
-		m_blocks.push_back(std::move(block));
+		AddBlockToPages(block.get());
+		m_blocks[start] = std::move(block);
+	}
+
+	//Keeps track of every page a block spans, invalidation only needs to visit blocks living in the affected pages
+	void AddBlockToPages(CBasicBlock* block)
+	{
+		uint32 firstPage = block->GetBeginAddress() >> BLOCK_PAGE_BITS;
+		uint32 lastPage = block->GetEndAddress() >> BLOCK_PAGE_BITS;
+		for(uint32 page = firstPage; page <= lastPage; page++)
+		{
+			m_blockPages[page].push_back(block);
+		}
+	}
+
+	void RemoveBlockFromPages(CBasicBlock* block)
+	{
+		uint32 firstPage = block->GetBeginAddress() >> BLOCK_PAGE_BITS;
+		uint32 lastPage = block->GetEndAddress() >> BLOCK_PAGE_BITS;
+		for(uint32 page = firstPage; page <= lastPage; page++)
+		{
+			auto pageIterator = m_blockPages.find(page);
+			assert(pageIterator != std::end(m_blockPages));
+			auto& pageBlocks = pageIterator->second;
+			auto blockIterator = std::find(std::begin(pageBlocks), std::end(pageBlocks), block);
+			assert(blockIterator != std::end(pageBlocks));
+			*blockIterator = pageBlocks.back();
+			pageBlocks.pop_back();
+			if(pageBlocks.empty())
+			{
+				m_blockPages.erase(pageIterator);
+			}
+		}
 	}
 
 	virtual BasicBlockPtr BlockFactory(CMIPS& context, uint32 start, uint32 end)
 	{
+		if(m_blockCompiler)
+		{
+			auto result = m_blockCompiler->Take(start);
+			if(result && (result->GetEndAddress() == end))
+			{
+				return result;
+			}
+		}
+		PrepareProfileCounter(start);
 		auto result = std::make_shared<CBasicBlock>(context, start, end);
 		result->Compile();
 		return result;
 	}
 
-	void SetupBlockLinks(uint32 startAddress, uint32 endAddress, uint32 branchAddress)
+	virtual BasicBlockPtr TraceFactory(CMIPS& context, const CTraceBlock::SegmentArray& segments)
 	{
-		auto block = m_blockLookup.FindBlockAt(startAddress);
+		auto result = std::make_shared<CTraceBlock>(context, segments);
+		result->Compile();
+		return result;
+	}
+
+	//Blocks can be compiled on the background compiler's thread, counter tables are allocated under a lock
+	void PrepareProfileCounter(uint32 address)
+	{
+		if(!m_traceFormationEnabled) return;
+		std::lock_guard<std::mutex> lock(m_blockProfileCounterMutex);
+		auto& counters = m_blockProfileCounterPages[address / CBasicBlock::PROFILE_COUNTER_PAGE_SIZE];
+		if(counters != nullptr) return;
+		auto storage = std::make_unique<uint32[]>(PROFILE_COUNTERS_PER_PAGE);
+		std::fill(storage.get(), storage.get() + PROFILE_COUNTERS_PER_PAGE, 0);
+		counters = storage.get();
+		m_blockProfileCounterStorage.push_back(std::move(storage));
+	}
+
+	uint32& GetProfileCounter(uint32 address)
+	{
+		auto counters = m_blockProfileCounterPages[address / CBasicBlock::PROFILE_COUNTER_PAGE_SIZE];
+		assert(counters != nullptr);
+		return counters[(address % CBasicBlock::PROFILE_COUNTER_PAGE_SIZE) / 4];
+	}
 
+	//Called before running any code, blocks can be safely replaced or freed here
+	void FormPendingTraces()
+	{
+		m_retiredBlocks.clear();
+		for(auto address : m_hotBlocks)
 		{
-			uint32 nextBlockAddress = (endAddress + 4) & m_addressMask;
-			block->SetLinkTargetAddress(CBasicBlock::LINK_SLOT_NEXT, nextBlockAddress);
-			auto link = std::make_pair(nextBlockAddress, BLOCK_LINK{CBasicBlock::LINK_SLOT_NEXT, startAddress});
-			auto nextBlock = m_blockLookup.FindBlockAt(nextBlockAddress);
-			if(!nextBlock->IsEmpty())
-			{
-				block->LinkBlock(CBasicBlock::LINK_SLOT_NEXT, nextBlock);
-				m_blockLinks.insert(link);
-			}
-			else
-			{
-				m_pendingBlockLinks.insert(link);
-			}
+			FormTrace(address);
+		}
+		m_hotBlocks.clear();
+	}
+
+	//Follows the most executed successors of a hot block and replaces it with a trace covering all of them
+	void FormTrace(uint32 address)
+	{
+#ifdef DEBUGGER_INCLUDED
+		//Breakpoints are only checked when entering a block, don't hide code inside traces
+		if(!m_context.m_breakpoints.empty()) return;
+#endif
+		if(m_traces.find(address) != std::end(m_traces)) return;
+		auto headBlock = m_blockLookup.FindBlockAt(address);
+		if(headBlock->IsEmpty()) return;
+
+		CTraceBlock::SegmentArray segments;
+		auto lastBlock = headBlock;
+		while(1)
+		{
+			segments.push_back({lastBlock->GetBeginAddress(), lastBlock->GetEndAddress()});
+			if(segments.size() == MAX_TRACE_SEGMENTS) break;
+			auto nextBlock = FindTraceSuccessor(lastBlock);
+			if(nextBlock == nullptr) break;
+			uint32 nextAddress = nextBlock->GetBeginAddress();
+			auto segmentIterator = std::find_if(std::begin(segments), std::end(segments),
+			                                    [&](const CTraceBlock::SEGMENT& segment) { return segment.begin == nextAddress; });
+			if(segmentIterator != std::end(segments)) break;
+			lastBlock = nextBlock;
+		}
+		if(segments.size() < 2) return;
+
+		uint32 branchAddress = lastBlock->GetLinkTargetAddress(CBasicBlock::LINK_SLOT_BRANCH);
+		if(branchAddress == MIPS_INVALID_PC) branchAddress = 0;
+
+		auto trace = TraceFactory(m_context, segments);
+		RemoveBlocks({headBlock});
+		m_traces[address] = static_cast<CTraceBlock*>(trace.get());
+		for(uint32 i = 1; i < segments.size(); i++)
+		{
+			m_traceDependents.insert(std::make_pair(segments[i].begin, address));
+		}
+		InsertBlock(std::move(trace));
+		SetupBlockLinks(address, segments.back().end, branchAddress);
+	}
+
+	CBasicBlock* FindTraceSuccessor(CBasicBlock* block)
+	{
+		CBasicBlock* result = nullptr;
+		uint32 resultCount = CBasicBlock::HOT_BLOCK_THRESHOLD / 2;
+		for(uint32 i = 0; i < CBasicBlock::LINK_SLOT_MAX; i++)
+		{
+			uint32 targetAddress = block->GetLinkTargetAddress(static_cast<CBasicBlock::LINK_SLOT>(i));
+			if(targetAddress == MIPS_INVALID_PC) continue;
+			//Other traces are only entered from their beginning
+			if(m_traces.find(targetAddress) != std::end(m_traces)) continue;
+			auto targetBlock = m_blockLookup.FindBlockAt(targetAddress);
+			if(targetBlock->IsEmpty()) continue;
+			uint32 count = GetProfileCounter(targetAddress);
+			if(count < resultCount) continue;
+			result = targetBlock;
+			resultCount = count;
 		}
+		return result;
+	}
+
+	//Compiles blocks we're likely to jump to soon, so they're ready when we need them
+	void RequestBackgroundCompilation(uint32 address)
+	{
+		if(!m_blockCompiler) return;
+		auto range = ComputeBlockRange(address);
+		m_blockCompiler->Enqueue(address, range.end);
+	}
+
+	void SetupBlockLinks(uint32 startAddress, uint32 endAddress, uint32 branchAddress)
+	{
+		auto block = m_blockLookup.FindBlockAt(startAddress);
+
+		uint32 nextBlockAddress = (endAddress + 4) & m_addressMask;
+		AddBlockLink(block, CBasicBlock::LINK_SLOT_NEXT, nextBlockAddress);
 
 		if(branchAddress != 0)
 		{
-			branchAddress &= m_addressMask;
-			block->SetLinkTargetAddress(CBasicBlock::LINK_SLOT_BRANCH, branchAddress);
-			auto link = std::make_pair(branchAddress, BLOCK_LINK{CBasicBlock::LINK_SLOT_BRANCH, startAddress});
-			auto branchBlock = m_blockLookup.FindBlockAt(branchAddress);
-			if(!branchBlock->IsEmpty())
-			{
-				block->LinkBlock(CBasicBlock::LINK_SLOT_BRANCH, branchBlock);
-				m_blockLinks.insert(link);
-			}
-			else
-			{
-				m_pendingBlockLinks.insert(link);
-			}
+			AddBlockLink(block, CBasicBlock::LINK_SLOT_BRANCH, branchAddress & m_addressMask);
 		}
 
 		//Resolve any block links that could be valid now that block has been created
+		auto linksIterator = m_blockLinks.find(startAddress);
+		if(linksIterator != std::end(m_blockLinks))
 		{
-			auto lowerBound = m_pendingBlockLinks.lower_bound(startAddress);
-			auto upperBound = m_pendingBlockLinks.upper_bound(startAddress);
-			for(auto blockLinkIterator = lowerBound; blockLinkIterator != upperBound; blockLinkIterator++)
+			//Specializations made while linking add their own links, possibly to this very list
+			auto& links = linksIterator->second;
+			for(size_t i = 0; i < links.size(); i++)
 			{
-				const auto& blockLink = blockLinkIterator->second;
-				auto referringBlock = m_blockLookup.FindBlockAt(blockLink.address);
-				if(referringBlock->IsEmpty()) continue;
-				referringBlock->LinkBlock(blockLink.slot, block);
-				m_blockLinks.insert(*blockLinkIterator);
+				if(links[i].linked) continue;
+				auto linkBlock = links[i].block;
+				auto linkSlot = links[i].slot;
+				linkBlock->LinkBlock(linkSlot, GetLinkTargetBlock(linkBlock, block));
+				links[i].linked = true;
 			}
-			m_pendingBlockLinks.erase(lowerBound, upperBound);
 		}
 	}
 
-	virtual void PartitionFunction(uint32 startAddress)
+	void AddBlockLink(CBasicBlock* block, CBasicBlock::LINK_SLOT slot, uint32 targetAddress)
+	{
+		block->SetLinkTargetAddress(slot, targetAddress);
+		BLOCK_LINK link = {block, slot, false};
+		auto targetBlock = m_blockLookup.FindBlockAt(targetAddress);
+		if(!targetBlock->IsEmpty())
+		{
+			block->LinkBlock(slot, GetLinkTargetBlock(block, targetBlock));
+			link.linked = true;
+		}
+		else
+		{
+			RequestBackgroundCompilation(targetAddress);
+		}
+		m_blockLinks[targetAddress].push_back(link);
+	}
+
+	//Blocks leaving with known register values get linked to a copy of their target compiled knowing them
+	CBasicBlock* GetLinkTargetBlock(CBasicBlock* block, CBasicBlock* targetBlock)
+	{
+		auto exitState = block->GetExitGprState();
+		if(exitState == nullptr) return targetBlock;
+		//Specializations don't get specialized successors, this keeps their number in check
+		if(block->IsSpecialization()) return targetBlock;
+		uint32 targetAddress = targetBlock->GetBeginAddress();
+		//Traces keep what's known between their own segments
+		if(m_traces.find(targetAddress) != std::end(m_traces)) return targetBlock;
+
+		uint32 inputMask = CMipsGprState::FindInputRegisters(m_context, targetAddress, targetBlock->GetEndAddress());
+		CMipsGprState::STATE entryState;
+		for(unsigned int reg = 0; reg < CMipsGprState::GPR_COUNT; reg++)
+		{
+			uint32 regMask = (1 << reg);
+			if((exitState->knownMask & inputMask & regMask) == 0) continue;
+			entryState.knownMask |= regMask;
+			entryState.values[reg] = exitState->values[reg];
+		}
+		if(entryState == CMipsGprState::STATE()) return targetBlock;
+
+		if(auto specialization = targetBlock->FindSpecialization(entryState))
+		{
+			return specialization;
+		}
+		if(targetBlock->GetSpecializations().size() == MAX_BLOCK_SPECIALIZATIONS) return targetBlock;
+
+		auto specialization = std::make_shared<CBasicBlock>(m_context, targetAddress, targetBlock->GetEndAddress());
+		specialization->SetEntryGprState(entryState);
+		specialization->Compile();
+		auto result = specialization.get();
+		targetBlock->AddSpecialization(std::move(specialization));
+
+		//Leaves through the same link slots as the block it was made from
+		for(uint32 i = 0; i < CBasicBlock::LINK_SLOT_MAX; i++)
+		{
+			auto slot = static_cast<CBasicBlock::LINK_SLOT>(i);
+			uint32 slotTargetAddress = targetBlock->GetLinkTargetAddress(slot);
+			if(slotTargetAddress == MIPS_INVALID_PC) continue;
+			AddBlockLink(result, slot, slotTargetAddress);
+		}
+
+		return result;
+	}
+
+	BLOCK_RANGE ComputeBlockRange(uint32 startAddress) const
 	{
 		uint32 endAddress = startAddress + MAX_BLOCK_SIZE;
 		uint32 branchAddress = 0;
@@ -220,98 +521,191 @@ protected:
 		}
 		assert((endAddress - startAddress) <= MAX_BLOCK_SIZE);
 		assert(endAddress <= m_maxAddress);
-		CreateBlock(startAddress, endAddress);
-		SetupBlockLinks(startAddress, endAddress, branchAddress);
+		BLOCK_RANGE result;
+		result.end = endAddress;
+		result.branchAddress = branchAddress;
+		return result;
+	}
+
+	virtual void PartitionFunction(uint32 startAddress)
+	{
+		auto range = ComputeBlockRange(startAddress);
+		CreateBlock(startAddress, range.end);
+		SetupBlockLinks(startAddress, range.end, range.branchAddress);
 	}
 
 	//Unlink and removes block from all of our bookkeeping structures
 	void OrphanBlock(CBasicBlock* block)
 	{
-		auto orphanBlockLinkSlot =
-		    [&](CBasicBlock::LINK_SLOT linkSlot) {
-			    auto slotSearch =
-			        [&](const std::pair<uint32, BLOCK_LINK>& link) {
-				        return (link.second.address == block->GetBeginAddress()) &&
-				               (link.second.slot == linkSlot);
-			        };
-			    uint32 linkTargetAddress = block->GetLinkTargetAddress(linkSlot);
-			    //Check if block has this specific link slot
-			    if(linkTargetAddress != MIPS_INVALID_PC)
-			    {
-				    //If it has that link slot, it's either linked or pending to be linked
-				    auto slotIterator = std::find_if(m_blockLinks.begin(), m_blockLinks.end(), slotSearch);
-				    if(slotIterator != std::end(m_blockLinks))
-				    {
-					    block->UnlinkBlock(linkSlot);
-					    m_blockLinks.erase(slotIterator);
-				    }
-				    else
-				    {
-					    slotIterator = std::find_if(m_pendingBlockLinks.begin(), m_pendingBlockLinks.end(), slotSearch);
-					    assert(slotIterator != std::end(m_pendingBlockLinks));
-					    m_pendingBlockLinks.erase(slotIterator);
-				    }
-			    }
-		    };
-		orphanBlockLinkSlot(CBasicBlock::LINK_SLOT_NEXT);
-		orphanBlockLinkSlot(CBasicBlock::LINK_SLOT_BRANCH);
+		for(uint32 i = 0; i < CBasicBlock::LINK_SLOT_MAX; i++)
+		{
+			auto slot = static_cast<CBasicBlock::LINK_SLOT>(i);
+			uint32 targetAddress = block->GetLinkTargetAddress(slot);
+			//Check if block has this specific link slot
+			if(targetAddress == MIPS_INVALID_PC) continue;
+			auto linksIterator = m_blockLinks.find(targetAddress);
+			assert(linksIterator != std::end(m_blockLinks));
+			auto& links = linksIterator->second;
+			auto linkIterator = std::find_if(std::begin(links), std::end(links),
+			                                 [&](const BLOCK_LINK& link) { return (link.block == block) && (link.slot == slot); });
+			assert(linkIterator != std::end(links));
+			if(linkIterator->linked)
+			{
+				block->UnlinkBlock(slot);
+			}
+			*linkIterator = links.back();
+			links.pop_back();
+			if(links.empty())
+			{
+				m_blockLinks.erase(linksIterator);
+			}
+		}
 	}
 
 	void ClearActiveBlocksInRangeInternal(uint32 start, uint32 end, CBasicBlock* protectedBlock)
 	{
-		//Widen scan range since blocks starting before the range can end in the range
-		uint32 scanStart = static_cast<uint32>(std::max<int64>(0, static_cast<uint64>(start) - MAX_BLOCK_SIZE));
-		uint32 scanEnd = end;
-		assert(scanEnd > scanStart);
+		if(m_blockCompiler)
+		{
+			m_blockCompiler->Cancel(start, end);
+		}
 
-		std::set<CBasicBlock*> clearedBlocks;
-		for(uint32 address = scanStart; address < scanEnd; address += instructionSize)
+		//Blocks are registered in every page they span, so looking at pages touched by the range is enough
+		BlockSet clearedBlocks;
+		uint32 firstPage = start >> BLOCK_PAGE_BITS;
+		uint32 lastPage = end >> BLOCK_PAGE_BITS;
+		for(uint32 page = firstPage; page <= lastPage; page++)
+		{
+			auto pageIterator = m_blockPages.find(page);
+			if(pageIterator == std::end(m_blockPages)) continue;
+			for(const auto& block : pageIterator->second)
+			{
+				if(block == protectedBlock) continue;
+				if(block->GetBeginAddress() >= end) continue;
+				if(!RangesOverlap(block->GetBeginAddress(), block->GetEndAddress(), start, end)) continue;
+				clearedBlocks.insert(block);
+			}
+		}
+
+		if(clearedBlocks.empty()) return;
+
+		//Traces also contain the code of the blocks following their first segment
+		if(!m_traceDependents.empty())
+		{
+			std::vector<uint32> pendingAddresses;
+			for(const auto& block : clearedBlocks)
+			{
+				pendingAddresses.push_back(block->GetBeginAddress());
+			}
+			while(!pendingAddresses.empty())
+			{
+				uint32 address = pendingAddresses.back();
+				pendingAddresses.pop_back();
+				auto dependentRange = m_traceDependents.equal_range(address);
+				for(auto dependentIterator = dependentRange.first; dependentIterator != dependentRange.second; dependentIterator++)
+				{
+					uint32 traceAddress = dependentIterator->second;
+					auto trace = m_blockLookup.FindBlockAt(traceAddress);
+					assert(!trace->IsEmpty());
+					if(clearedBlocks.insert(trace).second)
+					{
+						pendingAddresses.push_back(traceAddress);
+					}
+				}
+			}
+		}
+
+		RemoveBlocks(clearedBlocks);
+
+		if((protectedBlock != nullptr) && !m_retiredBlocks.empty())
+		{
+			//A trace we're running might have been invalidated, go back to Execute as soon as possible
+			m_context.m_State.nHasException |= MIPS_EXECUTION_STATUS_QUOTADONE;
+		}
+	}
+
+	void RemoveBlocks(const BlockSet& blocks)
+	{
+		for(auto& block : blocks)
 		{
-			auto block = m_blockLookup.FindBlockAt(address);
-			if(block->IsEmpty()) continue;
-			if(block == protectedBlock) continue;
-			if(!RangesOverlap(block->GetBeginAddress(), block->GetEndAddress(), start, end)) continue;
-			clearedBlocks.insert(block);
 			m_blockLookup.DeleteBlock(block);
+			RemoveBlockFromPages(block);
 		}
 
-		//Remove pending block link entries for the blocks that are about to be cleared
-		for(auto& block : clearedBlocks)
+		//Remove outgoing block links for the blocks that are about to be cleared
+		for(auto& block : blocks)
 		{
 			OrphanBlock(block);
+			for(const auto& specialization : block->GetSpecializations())
+			{
+				OrphanBlock(specialization.get());
+			}
+		}
+
+		//Undo all stale links, they will be resolved again if a block gets created at the same address
+		for(auto& block : blocks)
+		{
+			auto linksIterator = m_blockLinks.find(block->GetBeginAddress());
+			if(linksIterator == std::end(m_blockLinks)) continue;
+			for(auto& link : linksIterator->second)
+			{
+				if(!link.linked) continue;
+				link.block->UnlinkBlock(link.slot);
+				link.linked = false;
+			}
 		}
 
-		//Undo all stale links
-		for(auto& block : clearedBlocks)
+		for(auto& block : blocks)
 		{
-			auto lowerBound = m_blockLinks.lower_bound(block->GetBeginAddress());
-			auto upperBound = m_blockLinks.upper_bound(block->GetBeginAddress());
-			for(auto blockLinkIterator = lowerBound; blockLinkIterator != upperBound; blockLinkIterator++)
+			uint32 address = block->GetBeginAddress();
+			auto traceIterator = m_traces.find(address);
+			if(traceIterator != std::end(m_traces))
 			{
-				const auto& blockLink = blockLinkIterator->second;
-				auto referringBlock = m_blockLookup.FindBlockAt(blockLink.address);
-				if(referringBlock->IsEmpty()) continue;
-				referringBlock->UnlinkBlock(blockLink.slot);
-				m_pendingBlockLinks.insert(*blockLinkIterator);
+				RemoveTraceDependencies(traceIterator->second);
+				m_traces.erase(traceIterator);
+				//Traces can be invalidated while running, keep them alive until we're back in Execute
+				m_retiredBlocks.push_back(std::move(m_blocks[address]));
 			}
-			m_blockLinks.erase(lowerBound, upperBound);
+			m_blocks.erase(address);
 		}
+	}
 
-		if(!clearedBlocks.empty())
+	void RemoveTraceDependencies(CTraceBlock* trace)
+	{
+		uint32 traceAddress = trace->GetBeginAddress();
+		const auto& segments = trace->GetSegments();
+		for(uint32 i = 1; i < segments.size(); i++)
 		{
-			m_blocks.remove_if([&](const BasicBlockPtr& block) { return clearedBlocks.find(block.get()) != std::end(clearedBlocks); });
+			auto dependentRange = m_traceDependents.equal_range(segments[i].begin);
+			for(auto dependentIterator = dependentRange.first; dependentIterator != dependentRange.second; dependentIterator++)
+			{
+				if(dependentIterator->second == traceAddress)
+				{
+					m_traceDependents.erase(dependentIterator);
+					break;
+				}
+			}
 		}
 	}
 
-	BlockList m_blocks;
+	BlockMap m_blocks;
+	BlockPageMap m_blockPages;
 	BasicBlockPtr m_emptyBlock;
 	BlockLinkMap m_blockLinks;
-	BlockLinkMap m_pendingBlockLinks;
 	CMIPS& m_context;
 	uint32 m_maxAddress = 0;
 	uint32 m_addressMask = 0;
 
 	BlockLookupType m_blockLookup;
+	std::unique_ptr<CBlockCompiler> m_blockCompiler;
+
+	bool m_traceFormationEnabled = false;
+	ProfileCounterPageArray m_blockProfileCounterPages;
+	ProfileCounterStorageArray m_blockProfileCounterStorage;
+	std::mutex m_blockProfileCounterMutex;
+	HotBlockArray m_hotBlocks;
+	TraceMap m_traces;
+	TraceDependencyMap m_traceDependents;
+	RetiredBlockArray m_retiredBlocks;
 
 #ifdef DEBUGGER_INCLUDED
 	bool m_mustBreak = false;
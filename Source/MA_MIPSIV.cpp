@@ -202,6 +202,18 @@ CMA_MIPSIV::CMA_MIPSIV(MIPS_REGSIZE nRegSize)
 	SetupReflectionTables();
 }
 
+void CMA_MIPSIV::SetInlineUnalignedAccesses(bool inlineUnalignedAccesses)
+{
+	m_inlineUnalignedAccesses = inlineUnalignedAccesses;
+}
+
+std::unique_ptr<CMIPSArchitecture> CMA_MIPSIV::Clone() const
+{
+	auto result = std::make_unique<CMA_MIPSIV>(m_regSize);
+	result->SetInlineUnalignedAccesses(m_inlineUnalignedAccesses);
+	return result;
+}
+
 void CMA_MIPSIV::SetupInstructionTables()
 {
 	for(unsigned int i = 0; i < MAX_GENERAL_OPS; i++)
@@ -435,7 +447,7 @@ void CMA_MIPSIV::COP0()
 {
 	if(m_pCtx->m_pCOP[0] != NULL)
 	{
-		m_pCtx->m_pCOP[0]->CompileInstruction(m_nAddress, m_codeGen, m_pCtx);
+		m_pCtx->GetCompileCoprocessor(0)->CompileInstruction(m_nAddress, m_codeGen, m_pCtx);
 	}
 	else
 	{
@@ -448,7 +460,7 @@ void CMA_MIPSIV::COP1()
 {
 	if(m_pCtx->m_pCOP[1] != NULL)
 	{
-		m_pCtx->m_pCOP[1]->CompileInstruction(m_nAddress, m_codeGen, m_pCtx);
+		m_pCtx->GetCompileCoprocessor(1)->CompileInstruction(m_nAddress, m_codeGen, m_pCtx);
 	}
 	else
 	{
@@ -461,7 +473,7 @@ void CMA_MIPSIV::COP2()
 {
 	if(m_pCtx->m_pCOP[2] != NULL)
 	{
-		m_pCtx->m_pCOP[2]->CompileInstruction(m_nAddress, m_codeGen, m_pCtx);
+		m_pCtx->GetCompileCoprocessor(2)->CompileInstruction(m_nAddress, m_codeGen, m_pCtx);
 	}
 	else
 	{
@@ -558,20 +570,7 @@ void CMA_MIPSIV::LH()
 //22
 void CMA_MIPSIV::LWL()
 {
-	if(m_nRT == 0) return;
-
-	ComputeMemAccessAddrNoXlat();
-	m_codeGen->PushRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[0]));
-	m_codeGen->PushCtx();
-	m_codeGen->Call(reinterpret_cast<void*>(&LWL_Proxy), 3, true);
-
-	if(m_regSize == MIPS_REGSIZE_64)
-	{
-		m_codeGen->PushTop();
-		m_codeGen->SignExt();
-		m_codeGen->PullRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[1]));
-	}
-	m_codeGen->PullRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[0]));
+	Template_LoadUnaligned32(true, reinterpret_cast<void*>(&LWL_Proxy));
 }
 
 //23
@@ -595,20 +594,7 @@ void CMA_MIPSIV::LHU()
 //26
 void CMA_MIPSIV::LWR()
 {
-	if(m_nRT == 0) return;
-
-	ComputeMemAccessAddrNoXlat();
-	m_codeGen->PushRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[0]));
-	m_codeGen->PushCtx();
-	m_codeGen->Call(reinterpret_cast<void*>(&LWR_Proxy), 3, true);
-
-	if(m_regSize == MIPS_REGSIZE_64)
-	{
-		m_codeGen->PushTop();
-		m_codeGen->SignExt();
-		m_codeGen->PullRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[1]));
-	}
-	m_codeGen->PullRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[0]));
+	Template_LoadUnaligned32(false, reinterpret_cast<void*>(&LWR_Proxy));
 }
 
 //27
@@ -616,17 +602,41 @@ void CMA_MIPSIV::LWU()
 {
 	if(m_nRT == 0) return;
 
-	ComputeMemAccessAddrNoXlat();
+	bool usePageLookup = (m_pCtx->m_pageLookup != nullptr) && m_inlineUnalignedAccesses;
 
-	m_codeGen->PushCtx();
-	m_codeGen->PushIdx(1);
-	m_codeGen->Call(reinterpret_cast<void*>(&MemoryUtils_GetWordProxy), 2, true);
-	m_codeGen->PullRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[0]));
+	if(usePageLookup)
+	{
+		ComputeMemAccessPageRef();
+
+		m_codeGen->PushCst(0);
+		m_codeGen->BeginIf(Jitter::CONDITION_NE);
+		{
+			ComputeMemAccessRef(4);
+			m_codeGen->LoadFromRef();
+			m_codeGen->PullRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[0]));
+		}
+		m_codeGen->Else();
+	}
+
+	//Standard memory access
+	{
+		ComputeMemAccessAddrNoXlat();
+
+		m_codeGen->PushCtx();
+		m_codeGen->PushIdx(1);
+		m_codeGen->Call(reinterpret_cast<void*>(&MemoryUtils_GetWordProxy), 2, true);
+		m_codeGen->PullRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[0]));
+
+		m_codeGen->PullTop();
+	}
+
+	if(usePageLookup)
+	{
+		m_codeGen->EndIf();
+	}
 
 	m_codeGen->PushCst(0);
 	m_codeGen->PullRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[1]));
-
-	m_codeGen->PullTop();
 }
 
 //28
@@ -644,10 +654,7 @@ void CMA_MIPSIV::SH()
 //2A
 void CMA_MIPSIV::SWL()
 {
-	ComputeMemAccessAddrNoXlat();
-	m_codeGen->PushRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[0]));
-	m_codeGen->PushCtx();
-	m_codeGen->Call(reinterpret_cast<void*>(&SWL_Proxy), 3, false);
+	Template_StoreUnaligned32(true, reinterpret_cast<void*>(&SWL_Proxy));
 }
 
 //2B
@@ -681,10 +688,7 @@ void CMA_MIPSIV::SDR()
 //2E
 void CMA_MIPSIV::SWR()
 {
-	ComputeMemAccessAddrNoXlat();
-	m_codeGen->PushRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[0]));
-	m_codeGen->PushCtx();
-	m_codeGen->Call(reinterpret_cast<void*>(&SWR_Proxy), 3, false);
+	Template_StoreUnaligned32(false, reinterpret_cast<void*>(&SWR_Proxy));
 }
 
 //2F
@@ -698,7 +702,7 @@ void CMA_MIPSIV::LWC1()
 {
 	if(m_pCtx->m_pCOP[1] != NULL)
 	{
-		m_pCtx->m_pCOP[1]->CompileInstruction(m_nAddress, m_codeGen, m_pCtx);
+		m_pCtx->GetCompileCoprocessor(1)->CompileInstruction(m_nAddress, m_codeGen, m_pCtx);
 	}
 	else
 	{
@@ -717,7 +721,7 @@ void CMA_MIPSIV::LDC2()
 {
 	if(m_pCtx->m_pCOP[2] != NULL)
 	{
-		m_pCtx->m_pCOP[2]->CompileInstruction(m_nAddress, m_codeGen, m_pCtx);
+		m_pCtx->GetCompileCoprocessor(2)->CompileInstruction(m_nAddress, m_codeGen, m_pCtx);
 	}
 	else
 	{
@@ -761,7 +765,7 @@ void CMA_MIPSIV::SWC1()
 {
 	if(m_pCtx->m_pCOP[1] != NULL)
 	{
-		m_pCtx->m_pCOP[1]->CompileInstruction(m_nAddress, m_codeGen, m_pCtx);
+		m_pCtx->GetCompileCoprocessor(1)->CompileInstruction(m_nAddress, m_codeGen, m_pCtx);
 	}
 	else
 	{
@@ -774,7 +778,7 @@ void CMA_MIPSIV::SDC2()
 {
 	if(m_pCtx->m_pCOP[2] != NULL)
 	{
-		m_pCtx->m_pCOP[2]->CompileInstruction(m_nAddress, m_codeGen, m_pCtx);
+		m_pCtx->GetCompileCoprocessor(2)->CompileInstruction(m_nAddress, m_codeGen, m_pCtx);
 	}
 	else
 	{
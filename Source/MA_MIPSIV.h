@@ -14,6 +14,12 @@ public:
 	void GetInstructionOperands(CMIPS*, uint32, uint32, char*, unsigned int) override;
 	MIPS_BRANCH_TYPE IsInstructionBranch(CMIPS*, uint32, uint32) override;
 	uint32 GetInstructionEffectiveAddress(CMIPS*, uint32, uint32) override;
+	bool GetInstructionGprUsage(CMIPS*, uint32, uint32, MIPS_GPR_USAGE&) override;
+	bool EvaluateInstructionGprResult(CMIPS*, uint32, uint32, const uint64*, uint64&) override;
+	std::unique_ptr<CMIPSArchitecture> Clone() const override;
+
+	//When disabled, LWU and unaligned loads/stores always go through the memory proxies
+	void SetInlineUnalignedAccesses(bool);
 
 protected:
 	enum
@@ -69,6 +75,8 @@ protected:
 	uint8 m_nSA;
 	uint16 m_nImmediate;
 
+	bool m_inlineUnalignedAccesses = true;
+
 protected:
 	struct MemoryAccessTraits
 	{
@@ -93,6 +101,9 @@ protected:
 	void Template_Sub64(bool);
 	void Template_Load32(const MemoryAccessTraits&);
 	void Template_Store32(const MemoryAccessTraits&);
+	void Template_LoadUnaligned32(bool, void*);
+	void Template_StoreUnaligned32(bool, void*);
+	void ComputeUnalignedShift(bool);
 	void Template_ShiftCst32(const TemplateParamedOperationFunctionType&);
 	void Template_ShiftVar32(const TemplateOperationFunctionType&);
 	void Template_Mult32(bool, unsigned int);
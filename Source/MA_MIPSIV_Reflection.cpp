@@ -505,3 +505,209 @@ uint32 CMA_MIPSIV::GetInstructionEffectiveAddress(CMIPS* pCtx, uint32 nAddress,
 	Instr.pSubTable = &m_ReflGeneralTable;
 	return Instr.pGetEffectiveAddress(&Instr, pCtx, nAddress, nOpcode);
 }
+
+bool CMA_MIPSIV::GetInstructionGprUsage(CMIPS* pCtx, uint32 nAddress, uint32 nOpcode, MIPS_GPR_USAGE& usage)
+{
+	//Only covers opcodes that none of the derived architectures remap
+	uint8 nRS = (uint8)((nOpcode >> 21) & 0x001F);
+	uint8 nRT = (uint8)((nOpcode >> 16) & 0x001F);
+	uint8 nRD = (uint8)((nOpcode >> 11) & 0x001F);
+	bool is64 = (m_regSize == MIPS_REGSIZE_64);
+
+	usage = MIPS_GPR_USAGE();
+
+	switch(nOpcode >> 26)
+	{
+	case 0x00:
+		//SPECIAL
+		switch(nOpcode & 0x3F)
+		{
+		case 0x00: //SLL
+		case 0x02: //SRL
+		case 0x03: //SRA
+			usage.readMask = (1 << nRT);
+			usage.writeRegister = nRD;
+			usage.pure = true;
+			return true;
+		case 0x38: //DSLL
+		case 0x3A: //DSRL
+		case 0x3B: //DSRA
+		case 0x3C: //DSLL32
+		case 0x3E: //DSRL32
+		case 0x3F: //DSRA32
+			if(!is64) return false;
+			usage.readMask = (1 << nRT);
+			usage.writeRegister = nRD;
+			usage.pure = true;
+			return true;
+		case 0x10: //MFHI
+		case 0x12: //MFLO
+			usage.writeRegister = nRD;
+			usage.pure = true;
+			return true;
+		case 0x04: //SLLV
+		case 0x06: //SRLV
+		case 0x07: //SRAV
+		case 0x20: //ADD
+		case 0x21: //ADDU
+		case 0x22: //SUB
+		case 0x23: //SUBU
+		case 0x24: //AND
+		case 0x25: //OR
+		case 0x26: //XOR
+		case 0x27: //NOR
+		case 0x2A: //SLT
+		case 0x2B: //SLTU
+			usage.readMask = (1 << nRS) | (1 << nRT);
+			usage.writeRegister = nRD;
+			usage.pure = true;
+			return true;
+		case 0x14: //DSLLV
+		case 0x16: //DSRLV
+		case 0x17: //DSRAV
+		case 0x2C: //DADD
+		case 0x2D: //DADDU
+		case 0x2E: //DSUB
+		case 0x2F: //DSUBU
+			if(!is64) return false;
+			usage.readMask = (1 << nRS) | (1 << nRT);
+			usage.writeRegister = nRD;
+			usage.pure = true;
+			return true;
+		}
+		break;
+	case 0x01:
+		//REGIMM, only BLTZ, BGEZ and their likely versions (others link)
+		if(nRT > 0x03) return false;
+		usage.readMask = (1 << nRS);
+		return true;
+	case 0x02: //J
+		return true;
+	case 0x04: //BEQ
+	case 0x05: //BNE
+	case 0x14: //BEQL
+	case 0x15: //BNEL
+		usage.readMask = (1 << nRS) | (1 << nRT);
+		return true;
+	case 0x06: //BLEZ
+	case 0x07: //BGTZ
+	case 0x16: //BLEZL
+	case 0x17: //BGTZL
+		usage.readMask = (1 << nRS);
+		return true;
+	case 0x08: //ADDI
+	case 0x09: //ADDIU
+	case 0x0A: //SLTI
+	case 0x0B: //SLTIU
+	case 0x0C: //ANDI
+	case 0x0D: //ORI
+	case 0x0E: //XORI
+		//ADDIU R0, R0, $x is used to trigger dynamic linking on the IOP
+		if((nRS == 0) && (nRT == 0)) return false;
+		usage.readMask = (1 << nRS);
+		usage.writeRegister = nRT;
+		usage.pure = true;
+		return true;
+	case 0x18: //DADDI
+	case 0x19: //DADDIU
+		if(!is64) return false;
+		usage.readMask = (1 << nRS);
+		usage.writeRegister = nRT;
+		usage.pure = true;
+		return true;
+	case 0x0F: //LUI
+		usage.writeRegister = nRT;
+		usage.pure = true;
+		return true;
+	case 0x20: //LB
+	case 0x21: //LH
+	case 0x23: //LW
+	case 0x24: //LBU
+	case 0x25: //LHU
+		usage.readMask = (1 << nRS);
+		usage.writeRegister = nRT;
+		return true;
+	case 0x27: //LWU
+	case 0x37: //LD
+		if(!is64) return false;
+		usage.readMask = (1 << nRS);
+		usage.writeRegister = nRT;
+		return true;
+	case 0x28: //SB
+	case 0x29: //SH
+	case 0x2B: //SW
+		usage.readMask = (1 << nRS) | (1 << nRT);
+		return true;
+	case 0x3F: //SD
+		if(!is64) return false;
+		usage.readMask = (1 << nRS) | (1 << nRT);
+		return true;
+	}
+
+	return false;
+}
+
+bool CMA_MIPSIV::EvaluateInstructionGprResult(CMIPS* pCtx, uint32 nAddress, uint32 nOpcode, const uint64* gprValues, uint64& result)
+{
+	uint8 nRS = (uint8)((nOpcode >> 21) & 0x001F);
+	uint8 nRT = (uint8)((nOpcode >> 16) & 0x001F);
+	uint8 nSA = (uint8)((nOpcode >> 6) & 0x001F);
+	uint16 nImm = (uint16)((nOpcode >> 0) & 0xFFFF);
+
+	uint64 rs = gprValues[nRS];
+	uint64 rt = gprValues[nRT];
+
+	switch(nOpcode >> 26)
+	{
+	case 0x00:
+		//SPECIAL
+		switch(nOpcode & 0x3F)
+		{
+		case 0x00: //SLL
+			result = static_cast<int32>(static_cast<uint32>(rt) << nSA);
+			return true;
+		case 0x20: //ADD
+		case 0x21: //ADDU
+			result = static_cast<int32>(static_cast<uint32>(rs) + static_cast<uint32>(rt));
+			return true;
+		case 0x22: //SUB
+		case 0x23: //SUBU
+			result = static_cast<int32>(static_cast<uint32>(rs) - static_cast<uint32>(rt));
+			return true;
+		case 0x24: //AND
+			result = rs & rt;
+			return true;
+		case 0x25: //OR
+			result = rs | rt;
+			return true;
+		case 0x26: //XOR
+			result = rs ^ rt;
+			return true;
+		case 0x27: //NOR
+			result = ~(rs | rt);
+			return true;
+		}
+		break;
+	case 0x08: //ADDI
+	case 0x09: //ADDIU
+		result = static_cast<int32>(static_cast<uint32>(rs) + static_cast<int16>(nImm));
+		return true;
+	case 0x0C: //ANDI
+		result = rs & nImm;
+		return true;
+	case 0x0D: //ORI
+		result = rs | nImm;
+		return true;
+	case 0x0E: //XORI
+		result = rs ^ nImm;
+		return true;
+	case 0x0F: //LUI
+		result = static_cast<int32>(static_cast<uint32>(nImm) << 16);
+		return true;
+	case 0x19: //DADDIU
+		result = rs + static_cast<int16>(nImm);
+		return true;
+	}
+
+	return false;
+}
@@ -159,6 +159,138 @@ void CMA_MIPSIV::Template_Store32(const MemoryAccessTraits& traits)
 	}
 }
 
+//Shift amount (in bits) between a register and the word holding its unaligned part in memory
+void CMA_MIPSIV::ComputeUnalignedShift(bool isLeft)
+{
+	ComputeMemAccessAddrNoXlat();
+	if(isLeft)
+	{
+		//3 - (address & 3)
+		m_codeGen->Not();
+	}
+	m_codeGen->PushCst(3);
+	m_codeGen->And();
+	m_codeGen->Shl(3);
+}
+
+void CMA_MIPSIV::Template_LoadUnaligned32(bool isLeft, void* proxyFunction)
+{
+	if(m_nRT == 0) return;
+
+	const auto finishLoad =
+	    [&]() {
+		    if(m_regSize == MIPS_REGSIZE_64)
+		    {
+			    m_codeGen->PushTop();
+			    m_codeGen->SignExt();
+			    m_codeGen->PullRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[1]));
+		    }
+		    m_codeGen->PullRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[0]));
+	    };
+
+	void (Jitter::CJitter::*shiftFunction)() = isLeft ? &Jitter::CJitter::Shl : &Jitter::CJitter::Srl;
+	bool usePageLookup = (m_pCtx->m_pageLookup != nullptr) && m_inlineUnalignedAccesses;
+
+	if(usePageLookup)
+	{
+		ComputeMemAccessPageRef();
+
+		m_codeGen->PushCst(0);
+		m_codeGen->BeginIf(Jitter::CONDITION_NE);
+		{
+			//LWL: (rt & ~(~0 << shift)) | (memory << shift)
+			//LWR: (rt & ~(~0 >> shift)) | (memory >> shift)
+			ComputeUnalignedShift(isLeft);
+
+			ComputeMemAccessRef(4);
+			m_codeGen->LoadFromRef();
+			m_codeGen->PushIdx(1);
+			((m_codeGen)->*(shiftFunction))();
+
+			m_codeGen->PushCst(~0U);
+			m_codeGen->PushIdx(2);
+			((m_codeGen)->*(shiftFunction))();
+			m_codeGen->Not();
+			m_codeGen->PushRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[0]));
+			m_codeGen->And();
+
+			m_codeGen->Or();
+			finishLoad();
+
+			m_codeGen->PullTop();
+		}
+		m_codeGen->Else();
+	}
+
+	//Standard memory access
+	{
+		ComputeMemAccessAddrNoXlat();
+		m_codeGen->PushRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[0]));
+		m_codeGen->PushCtx();
+		m_codeGen->Call(proxyFunction, 3, true);
+
+		finishLoad();
+	}
+
+	if(usePageLookup)
+	{
+		m_codeGen->EndIf();
+	}
+}
+
+void CMA_MIPSIV::Template_StoreUnaligned32(bool isLeft, void* proxyFunction)
+{
+	//Register is shifted the opposite way of loads
+	void (Jitter::CJitter::*shiftFunction)() = isLeft ? &Jitter::CJitter::Srl : &Jitter::CJitter::Shl;
+	bool usePageLookup = (m_pCtx->m_pageLookup != nullptr) && m_inlineUnalignedAccesses;
+
+	if(usePageLookup)
+	{
+		ComputeMemAccessPageRef();
+
+		m_codeGen->PushCst(0);
+		m_codeGen->BeginIf(Jitter::CONDITION_NE);
+		{
+			//SWL: (memory & ~(~0 >> shift)) | (rt >> shift)
+			//SWR: (memory & ~(~0 << shift)) | (rt << shift)
+			ComputeUnalignedShift(isLeft);
+
+			ComputeMemAccessRef(4);
+
+			ComputeMemAccessRef(4);
+			m_codeGen->LoadFromRef();
+			m_codeGen->PushCst(~0U);
+			m_codeGen->PushIdx(3);
+			((m_codeGen)->*(shiftFunction))();
+			m_codeGen->Not();
+			m_codeGen->And();
+
+			m_codeGen->PushRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[0]));
+			m_codeGen->PushIdx(3);
+			((m_codeGen)->*(shiftFunction))();
+
+			m_codeGen->Or();
+			m_codeGen->StoreAtRef();
+
+			m_codeGen->PullTop();
+		}
+		m_codeGen->Else();
+	}
+
+	//Standard memory access
+	{
+		ComputeMemAccessAddrNoXlat();
+		m_codeGen->PushRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[0]));
+		m_codeGen->PushCtx();
+		m_codeGen->Call(proxyFunction, 3, false);
+	}
+
+	if(usePageLookup)
+	{
+		m_codeGen->EndIf();
+	}
+}
+
 void CMA_MIPSIV::Template_ShiftCst32(const TemplateParamedOperationFunctionType& Function)
 {
 	if(m_nRD == 0) return;
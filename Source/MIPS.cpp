@@ -13,6 +13,10 @@ const char* CMIPS::m_sGPRName[] =
 };
 // clang-format on
 
+//Architecture copies installed on the current thread and the context they were made for
+static thread_local const CMIPS* g_compileArchitectureContext = nullptr;
+static thread_local const CMIPS::COMPILE_ARCHITECTURE* g_compileArchitecture = nullptr;
+
 CMIPS::CMIPS(MEMORYMAP_ENDIANESS endianess, bool usePageTable)
 {
 	m_analysis = new CMIPSAnalysis(this);
@@ -151,3 +155,43 @@ void CMIPS::MapPages(uint32 vAddress, uint32 size, uint8* memory)
 		m_pageLookup[pageBase + pageIndex] = memory + (MIPS_PAGE_SIZE * pageIndex);
 	}
 }
+
+CMIPS::CompileArchitecturePtr CMIPS::CloneCompileArchitecture() const
+{
+	auto result = std::make_unique<COMPILE_ARCHITECTURE>();
+	assert(m_pArch);
+	result->arch = m_pArch->Clone();
+	assert(result->arch);
+	for(unsigned int i = 0; i < 4; i++)
+	{
+		if(m_pCOP[i] == nullptr) continue;
+		result->cop[i] = m_pCOP[i]->Clone();
+		assert(result->cop[i]);
+	}
+	return result;
+}
+
+void CMIPS::SetThreadCompileArchitecture(const COMPILE_ARCHITECTURE* compileArchitecture)
+{
+	g_compileArchitectureContext = compileArchitecture ? this : nullptr;
+	g_compileArchitecture = compileArchitecture;
+}
+
+CMIPSArchitecture* CMIPS::GetCompileArchitecture() const
+{
+	if(g_compileArchitectureContext == this)
+	{
+		return g_compileArchitecture->arch.get();
+	}
+	return m_pArch;
+}
+
+CMIPSCoprocessor* CMIPS::GetCompileCoprocessor(unsigned int index) const
+{
+	assert(index < 4);
+	if(g_compileArchitectureContext == this)
+	{
+		return g_compileArchitecture->cop[index].get();
+	}
+	return m_pCOP[index];
+}
@@ -120,12 +120,33 @@ struct MIPSSTATE
 #define MIPS_INVALID_PC (0x00000001)
 #define MIPS_PAGE_SIZE (0x1000)
 
+#ifdef PROFILE
+//Memory accesses that went through the proxy functions instead of being done inline by compiled code
+struct MIPS_MEMORY_PROXY_STATS
+{
+	uint32 reads = 0;
+	uint32 writes = 0;
+};
+#endif
+
+class CBlockCache;
+class CBlockProfiler;
+
 class CMIPS
 {
 public:
 	typedef uint32 (*AddressTranslator)(CMIPS*, uint32);
 	typedef std::set<uint32> BreakpointSet;
 
+	//Architecture objects keep decoding state while compiling an instruction, threads
+	//other than the emulation thread need their own copies to compile blocks
+	struct COMPILE_ARCHITECTURE
+	{
+		std::unique_ptr<CMIPSArchitecture> arch;
+		std::unique_ptr<CMIPSCoprocessor> cop[4];
+	};
+	typedef std::unique_ptr<COMPILE_ARCHITECTURE> CompileArchitecturePtr;
+
 	CMIPS(MEMORYMAP_ENDIANESS, bool usePageTable = false);
 	~CMIPS();
 	void ToggleBreakpoint(uint32);
@@ -141,17 +162,39 @@ public:
 
 	void MapPages(uint32, uint32, uint8*);
 
+	CompileArchitecturePtr CloneCompileArchitecture() const;
+	void SetThreadCompileArchitecture(const COMPILE_ARCHITECTURE*);
+	CMIPSArchitecture* GetCompileArchitecture() const;
+	CMIPSCoprocessor* GetCompileCoprocessor(unsigned int) const;
+
 	MIPSSTATE m_State;
 
 	void* m_vuMem = nullptr;
 	void** m_pageLookup = nullptr;
+#ifdef PROFILE
+	MIPS_MEMORY_PROXY_STATS m_memoryProxyStats;
+#endif
 
 	std::function<void(CMIPS*)> m_emptyBlockHandler;
+	std::function<void(CMIPS*)> m_hotBlockHandler;
+	//Execution counters of blocks, one table of CBasicBlock::PROFILE_COUNTER_PAGE_SIZE / 4 counters per page of code
+	uint32** m_blockProfileCounterPages = nullptr;
+
+	//Blocks living in pages flagged in this table make sure their code didn't change before running
+	std::function<void(CMIPS*)> m_codeChangedHandler;
+	uint32* m_codeCheckPages = nullptr;
+	uint32 m_codeCheckPageCount = 0;
+
+	//Polling loops stop execution with MIPS_EXCEPTION_IDLE instead of spinning until the quota is exhausted
+	bool m_idleLoopDetectionEnabled = false;
 
 	CMIPSArchitecture* m_pArch = nullptr;
 	CMIPSCoprocessor* m_pCOP[4];
 	CMemoryMap* m_pMemoryMap = nullptr;
 	std::unique_ptr<CMipsExecutor> m_executor;
+	CBlockCache* m_blockCache = nullptr;
+	CBlockProfiler* m_blockProfiler = nullptr;
+	uint64* m_blockProfilerCounters = nullptr;
 	BreakpointSet m_breakpoints;
 
 	CMIPSAnalysis* m_analysis = nullptr;
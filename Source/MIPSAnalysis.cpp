@@ -456,3 +456,68 @@ CMIPSAnalysis::CallStackItemArray CMIPSAnalysis::GetCallStack(CMIPS* context, ui
 
 	return result;
 }
+
+//Polling loops are blocks branching back to themselves, where every iteration only
+//depends on memory and on registers the loop doesn't modify. Since they don't have
+//side effects, they will spin without changing anything until memory gets modified
+//from outside of the CPU.
+bool CMIPSAnalysis::IsIdleLoop(CMIPS* context, uint32 begin, uint32 end)
+{
+	if(end < (begin + 4)) return false;
+
+	//Called while compiling blocks, possibly from a background compiler
+	auto arch = context->GetCompileArchitecture();
+
+	uint32 branchAddress = end - 4;
+	uint32 branchOpcode = context->m_pMemoryMap->GetInstruction(branchAddress);
+	if(arch->IsInstructionBranch(context, branchAddress, branchOpcode) != MIPS_BRANCH_NORMAL) return false;
+	if(arch->GetInstructionEffectiveAddress(context, branchAddress, branchOpcode) != begin) return false;
+
+	//Only branches that don't link are known
+	MIPS_GPR_USAGE branchUsage;
+	if(!arch->GetInstructionGprUsage(context, branchAddress, branchOpcode, branchUsage)) return false;
+
+	uint32 instructionCount = ((end - begin) / 4) + 1;
+	std::vector<MIPS_GPR_USAGE> usages(instructionCount);
+	uint32 loopWriteMask = 0;
+	for(uint32 i = 0; i < instructionCount; i++)
+	{
+		uint32 address = begin + (i * 4);
+		auto& usage = usages[i];
+		if(address == branchAddress)
+		{
+			usage.readMask = branchUsage.readMask;
+			continue;
+		}
+		uint32 opcode = context->m_pMemoryMap->GetInstruction(address);
+		if(arch->IsInstructionBranch(context, address, opcode) != MIPS_BRANCH_NONE) return false;
+		if(!arch->GetInstructionGprUsage(context, address, opcode, usage)) return false;
+		//Only loads are allowed to have effects other than writing to their destination (stores don't have one)
+		if(!usage.pure && (usage.writeRegister == CMIPS::R0)) return false;
+		loopWriteMask |= (1 << usage.writeRegister);
+	}
+	loopWriteMask &= ~(1 << CMIPS::R0);
+
+	//Values coming from a previous iteration would make iterations differ
+	uint32 iterationWriteMask = 0;
+	for(const auto& usage : usages)
+	{
+		uint32 carriedMask = usage.readMask & ~iterationWriteMask;
+		if(carriedMask & loopWriteMask) return false;
+		iterationWriteMask |= (1 << usage.writeRegister);
+	}
+
+	//Addresses of loads are checked when the back branch is taken, their base register can't change after them
+	for(uint32 i = 0; i < instructionCount; i++)
+	{
+		const auto& usage = usages[i];
+		if(usage.pure || (usage.writeRegister == CMIPS::R0)) continue;
+		uint32 baseMask = usage.readMask & ~(1 << CMIPS::R0);
+		for(uint32 j = i; j < instructionCount; j++)
+		{
+			if(baseMask & (1 << usages[j].writeRegister)) return false;
+		}
+	}
+
+	return true;
+}
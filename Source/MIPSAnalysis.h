@@ -33,6 +33,7 @@ public:
 	void ChangeSubroutineEnd(uint32, uint32);
 
 	static CallStackItemArray GetCallStack(CMIPS*, uint32 pc, uint32 sp, uint32 ra);
+	static bool IsIdleLoop(CMIPS*, uint32, uint32);
 
 private:
 	typedef std::map<uint32, SUBROUTINE, std::greater<uint32>> SubroutineList;
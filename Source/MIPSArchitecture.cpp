@@ -4,3 +4,18 @@ CMIPSArchitecture::CMIPSArchitecture(MIPS_REGSIZE regSize)
     : CMIPSInstructionFactory(regSize)
 {
 }
+
+std::unique_ptr<CMIPSArchitecture> CMIPSArchitecture::Clone() const
+{
+	return std::unique_ptr<CMIPSArchitecture>();
+}
+
+bool CMIPSArchitecture::GetInstructionGprUsage(CMIPS*, uint32, uint32, MIPS_GPR_USAGE&)
+{
+	return false;
+}
+
+bool CMIPSArchitecture::EvaluateInstructionGprResult(CMIPS*, uint32, uint32, const uint64*, uint64&)
+{
+	return false;
+}
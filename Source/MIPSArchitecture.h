@@ -1,7 +1,17 @@
 #pragma once
 
+#include <memory>
 #include "MIPSInstructionFactory.h"
 
+//General purpose registers used by an instruction
+struct MIPS_GPR_USAGE
+{
+	uint32 readMask = 0;
+	unsigned int writeRegister = 0;
+	//Writing to the destination register is the only effect of the instruction
+	bool pure = false;
+};
+
 class CMIPSArchitecture : public CMIPSInstructionFactory
 {
 public:
@@ -11,4 +21,12 @@ public:
 	virtual void GetInstructionOperands(CMIPS*, uint32, uint32, char*, unsigned int) = 0;
 	virtual MIPS_BRANCH_TYPE IsInstructionBranch(CMIPS*, uint32, uint32) = 0;
 	virtual uint32 GetInstructionEffectiveAddress(CMIPS*, uint32, uint32) = 0;
+
+	//Creates an architecture with the same settings, for compiling on another thread. Returns nullptr if not supported.
+	virtual std::unique_ptr<CMIPSArchitecture> Clone() const;
+
+	//Returns false if the way the instruction uses registers can't be described
+	virtual bool GetInstructionGprUsage(CMIPS*, uint32, uint32, MIPS_GPR_USAGE&);
+	//Computes the result of a pure instruction from the values of the registers it reads
+	virtual bool EvaluateInstructionGprResult(CMIPS*, uint32, uint32, const uint64*, uint64&);
 };
@@ -8,3 +8,8 @@ CMIPSCoprocessor::CMIPSCoprocessor(MIPS_REGSIZE nRegSize)
 CMIPSCoprocessor::~CMIPSCoprocessor()
 {
 }
+
+std::unique_ptr<CMIPSCoprocessor> CMIPSCoprocessor::Clone() const
+{
+	return std::unique_ptr<CMIPSCoprocessor>();
+}
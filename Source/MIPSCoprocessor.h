@@ -1,6 +1,7 @@
 #ifndef _MIPSCOPROCESSOR_H_
 #define _MIPSCOPROCESSOR_H_
 
+#include <memory>
 #include "MIPSInstructionFactory.h"
 
 class CMIPSCoprocessor : public CMIPSInstructionFactory
@@ -12,6 +13,9 @@ public:
 	virtual void GetArguments(uint32, uint32, char*) = 0;
 	virtual uint32 GetEffectiveAddress(uint32, uint32) = 0;
 	virtual MIPS_BRANCH_TYPE IsBranch(uint32) = 0;
+
+	//Creates a coprocessor with the same settings, for compiling on another thread. Returns nullptr if not supported.
+	virtual std::unique_ptr<CMIPSCoprocessor> Clone() const;
 };
 
 #endif
@@ -4,6 +4,9 @@
 
 #define LOG_NAME "MemoryMap"
 
+static thread_local const CMemoryMap* g_instructionSnapshotMap = nullptr;
+static thread_local const CMemoryMap::INSTRUCTION_SNAPSHOT* g_instructionSnapshot = nullptr;
+
 void CMemoryMap::InsertReadMap(uint32 start, uint32 end, void* pointer, unsigned char key)
 {
 	assert(GetReadMap(start) == nullptr);
@@ -28,6 +31,18 @@ void CMemoryMap::InsertWriteMap(uint32 start, uint32 end, const MemoryMapHandler
 	InsertMap(m_writeMap, start, end, handler, key);
 }
 
+void CMemoryMap::InsertSizedReadMap(uint32 start, uint32 end, const SizedMemoryMapHandlerType& handler, unsigned char key)
+{
+	assert(GetReadMap(start) == nullptr);
+	InsertMap(m_readMap, start, end, handler, key);
+}
+
+void CMemoryMap::InsertSizedWriteMap(uint32 start, uint32 end, const SizedMemoryMapHandlerType& handler, unsigned char key)
+{
+	assert(GetWriteMap(start) == nullptr);
+	InsertMap(m_writeMap, start, end, handler, key);
+}
+
 void CMemoryMap::InsertInstructionMap(uint32 start, uint32 end, void* pointer, unsigned char key)
 {
 	assert(GetMap(m_instructionMap, start) == nullptr);
@@ -44,6 +59,21 @@ const CMemoryMap::MEMORYMAPELEMENT* CMemoryMap::GetWriteMap(uint32 address) cons
 	return GetMap(m_writeMap, address);
 }
 
+void CMemoryMap::SetThreadInstructionSnapshot(const INSTRUCTION_SNAPSHOT* snapshot)
+{
+	g_instructionSnapshotMap = snapshot ? this : nullptr;
+	g_instructionSnapshot = snapshot;
+}
+
+bool CMemoryMap::GetSnapshotInstruction(uint32 address, uint32& opcode) const
+{
+	if(g_instructionSnapshotMap != this) return false;
+	uint32 index = (address - g_instructionSnapshot->address) / 4;
+	if((address < g_instructionSnapshot->address) || (index >= g_instructionSnapshot->opcodes.size())) return false;
+	opcode = g_instructionSnapshot->opcodes[index];
+	return true;
+}
+
 void CMemoryMap::InsertMap(MemoryMapListType& memoryMap, uint32 start, uint32 end, void* pointer, unsigned char key)
 {
 	MEMORYMAPELEMENT element;
@@ -65,6 +95,17 @@ void CMemoryMap::InsertMap(MemoryMapListType& memoryMap, uint32 start, uint32 en
 	memoryMap.push_back(element);
 }
 
+void CMemoryMap::InsertMap(MemoryMapListType& memoryMap, uint32 start, uint32 end, const SizedMemoryMapHandlerType& handler, unsigned char key)
+{
+	MEMORYMAPELEMENT element;
+	element.nStart = start;
+	element.nEnd = end;
+	element.sizedHandler = handler;
+	element.pPointer = nullptr;
+	element.nType = MEMORYMAP_TYPE_SIZEDFUNCTION;
+	memoryMap.push_back(element);
+}
+
 const CMemoryMap::MEMORYMAPELEMENT* CMemoryMap::GetMap(const MemoryMapListType& memoryMap, uint32 nAddress)
 {
 	for(const auto& mapElement : memoryMap)
@@ -94,6 +135,9 @@ uint8 CMemoryMap::GetByte(uint32 nAddress)
 	case MEMORYMAP_TYPE_FUNCTION:
 		return static_cast<uint8>(e->handler(nAddress, 0));
 		break;
+	case MEMORYMAP_TYPE_SIZEDFUNCTION:
+		return static_cast<uint8>(e->sizedHandler(nAddress, 0, 1));
+		break;
 	default:
 		assert(0);
 		return 0xCC;
@@ -117,6 +161,9 @@ void CMemoryMap::SetByte(uint32 nAddress, uint8 nValue)
 	case MEMORYMAP_TYPE_FUNCTION:
 		e->handler(nAddress, nValue);
 		break;
+	case MEMORYMAP_TYPE_SIZEDFUNCTION:
+		e->sizedHandler(nAddress, nValue, 1);
+		break;
 	default:
 		assert(0);
 		break;
@@ -141,6 +188,9 @@ uint16 CMemoryMap_LSBF::GetHalf(uint32 nAddress)
 	case MEMORYMAP_TYPE_MEMORY:
 		return *(uint16*)&((uint8*)e->pPointer)[nAddress - e->nStart];
 		break;
+	case MEMORYMAP_TYPE_SIZEDFUNCTION:
+		return static_cast<uint16>(e->sizedHandler(nAddress, 0, 2));
+		break;
 	default:
 		return static_cast<uint16>(e->handler(nAddress, 0));
 		break;
@@ -164,6 +214,9 @@ uint32 CMemoryMap_LSBF::GetWord(uint32 nAddress)
 	case MEMORYMAP_TYPE_FUNCTION:
 		return e->handler(nAddress, 0);
 		break;
+	case MEMORYMAP_TYPE_SIZEDFUNCTION:
+		return e->sizedHandler(nAddress, 0, 4);
+		break;
 	default:
 		assert(0);
 		return 0xCCCCCCCC;
@@ -174,6 +227,11 @@ uint32 CMemoryMap_LSBF::GetWord(uint32 nAddress)
 uint32 CMemoryMap_LSBF::GetInstruction(uint32 address)
 {
 	assert((address & 0x03) == 0);
+	uint32 snapshotOpcode = 0;
+	if(GetSnapshotInstruction(address, snapshotOpcode))
+	{
+		return snapshotOpcode;
+	}
 	const auto e = GetMap(m_instructionMap, address);
 	if(!e) return 0xCCCCCCCC;
 	switch(e->nType)
@@ -205,6 +263,9 @@ void CMemoryMap_LSBF::SetHalf(uint32 nAddress, uint16 nValue)
 	case MEMORYMAP_TYPE_FUNCTION:
 		e->handler(nAddress, nValue);
 		break;
+	case MEMORYMAP_TYPE_SIZEDFUNCTION:
+		e->sizedHandler(nAddress, nValue, 2);
+		break;
 	default:
 		assert(0);
 		break;
@@ -228,6 +289,9 @@ void CMemoryMap_LSBF::SetWord(uint32 nAddress, uint32 nValue)
 	case MEMORYMAP_TYPE_FUNCTION:
 		e->handler(nAddress, nValue);
 		break;
+	case MEMORYMAP_TYPE_SIZEDFUNCTION:
+		e->sizedHandler(nAddress, nValue, 4);
+		break;
 	default:
 		assert(0);
 		break;
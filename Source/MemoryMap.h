@@ -15,11 +15,21 @@ class CMemoryMap
 {
 public:
 	typedef std::function<uint32(uint32, uint32)> MemoryMapHandlerType;
+	//Also receives the size of the access in bytes
+	typedef std::function<uint32(uint32, uint32, unsigned int)> SizedMemoryMapHandlerType;
+
+	//Copy of guest code taken on another thread
+	struct INSTRUCTION_SNAPSHOT
+	{
+		uint32 address = 0;
+		std::vector<uint32> opcodes;
+	};
 
 	enum MEMORYMAP_TYPE
 	{
 		MEMORYMAP_TYPE_MEMORY,
-		MEMORYMAP_TYPE_FUNCTION
+		MEMORYMAP_TYPE_FUNCTION,
+		MEMORYMAP_TYPE_SIZEDFUNCTION,
 	};
 
 	struct MEMORYMAPELEMENT
@@ -28,6 +38,7 @@ public:
 		uint32 nEnd;
 		void* pPointer;
 		MemoryMapHandlerType handler;
+		SizedMemoryMapHandlerType sizedHandler;
 		MEMORYMAP_TYPE nType;
 	};
 
@@ -43,14 +54,20 @@ public:
 	void InsertReadMap(uint32, uint32, const MemoryMapHandlerType&, unsigned char);
 	void InsertWriteMap(uint32, uint32, void*, unsigned char);
 	void InsertWriteMap(uint32, uint32, const MemoryMapHandlerType&, unsigned char);
+	void InsertSizedReadMap(uint32, uint32, const SizedMemoryMapHandlerType&, unsigned char);
+	void InsertSizedWriteMap(uint32, uint32, const SizedMemoryMapHandlerType&, unsigned char);
 	void InsertInstructionMap(uint32, uint32, void*, unsigned char);
 	const MEMORYMAPELEMENT* GetReadMap(uint32) const;
 	const MEMORYMAPELEMENT* GetWriteMap(uint32) const;
 
+	//While set, GetInstruction reads the snapshot's range from it on the calling thread
+	void SetThreadInstructionSnapshot(const INSTRUCTION_SNAPSHOT*);
+
 protected:
 	typedef std::vector<MEMORYMAPELEMENT> MemoryMapListType;
 
 	static const MEMORYMAPELEMENT* GetMap(const MemoryMapListType&, uint32);
+	bool GetSnapshotInstruction(uint32, uint32&) const;
 
 	MemoryMapListType m_instructionMap;
 	MemoryMapListType m_readMap;
@@ -59,6 +76,7 @@ protected:
 private:
 	static void InsertMap(MemoryMapListType&, uint32, uint32, void*, unsigned char);
 	static void InsertMap(MemoryMapListType&, uint32, uint32, const MemoryMapHandlerType&, unsigned char);
+	static void InsertMap(MemoryMapListType&, uint32, uint32, const SizedMemoryMapHandlerType&, unsigned char);
 };
 
 class CMemoryMap_LSBF : public CMemoryMap
@@ -6,24 +6,36 @@
 
 uint32 MemoryUtils_GetByteProxy(CMIPS* context, uint32 vAddress)
 {
+#ifdef PROFILE
+	context->m_memoryProxyStats.reads++;
+#endif
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	return static_cast<uint32>(context->m_pMemoryMap->GetByte(address));
 }
 
 uint32 MemoryUtils_GetHalfProxy(CMIPS* context, uint32 vAddress)
 {
+#ifdef PROFILE
+	context->m_memoryProxyStats.reads++;
+#endif
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	return static_cast<uint32>(context->m_pMemoryMap->GetHalf(address));
 }
 
 uint32 MemoryUtils_GetWordProxy(CMIPS* context, uint32 vAddress)
 {
+#ifdef PROFILE
+	context->m_memoryProxyStats.reads++;
+#endif
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	return context->m_pMemoryMap->GetWord(address);
 }
 
 uint64 MemoryUtils_GetDoubleProxy(CMIPS* context, uint32 vAddress)
 {
+#ifdef PROFILE
+	context->m_memoryProxyStats.reads++;
+#endif
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	assert((address & 0x07) == 0);
 	auto e = context->m_pMemoryMap->GetReadMap(address);
@@ -44,6 +56,12 @@ uint64 MemoryUtils_GetDoubleProxy(CMIPS* context, uint32 vAddress)
 				result.d[i] = e->handler(address + (i * 4), 0);
 			}
 			break;
+		case CMemoryMap::MEMORYMAP_TYPE_SIZEDFUNCTION:
+			for(unsigned int i = 0; i < 2; i++)
+			{
+				result.d[i] = e->sizedHandler(address + (i * 4), 0, 4);
+			}
+			break;
 		default:
 			assert(0);
 			break;
@@ -54,6 +72,9 @@ uint64 MemoryUtils_GetDoubleProxy(CMIPS* context, uint32 vAddress)
 
 uint128 MemoryUtils_GetQuadProxy(CMIPS* context, uint32 vAddress)
 {
+#ifdef PROFILE
+	context->m_memoryProxyStats.reads++;
+#endif
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	address &= ~0x0F;
 	auto e = context->m_pMemoryMap->GetReadMap(address);
@@ -74,6 +95,12 @@ uint128 MemoryUtils_GetQuadProxy(CMIPS* context, uint32 vAddress)
 				result.nV[i] = e->handler(address + (i * 4), 0);
 			}
 			break;
+		case CMemoryMap::MEMORYMAP_TYPE_SIZEDFUNCTION:
+			for(unsigned int i = 0; i < 4; i++)
+			{
+				result.nV[i] = e->sizedHandler(address + (i * 4), 0, 4);
+			}
+			break;
 		default:
 			assert(0);
 			break;
@@ -84,24 +111,36 @@ uint128 MemoryUtils_GetQuadProxy(CMIPS* context, uint32 vAddress)
 
 void MemoryUtils_SetByteProxy(CMIPS* context, uint32 value, uint32 vAddress)
 {
+#ifdef PROFILE
+	context->m_memoryProxyStats.writes++;
+#endif
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	context->m_pMemoryMap->SetByte(address, static_cast<uint8>(value));
 }
 
 void MemoryUtils_SetHalfProxy(CMIPS* context, uint32 value, uint32 vAddress)
 {
+#ifdef PROFILE
+	context->m_memoryProxyStats.writes++;
+#endif
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	context->m_pMemoryMap->SetHalf(address, static_cast<uint16>(value));
 }
 
 void MemoryUtils_SetWordProxy(CMIPS* context, uint32 value, uint32 vAddress)
 {
+#ifdef PROFILE
+	context->m_memoryProxyStats.writes++;
+#endif
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	context->m_pMemoryMap->SetWord(address, value);
 }
 
 void MemoryUtils_SetDoubleProxy(CMIPS* context, uint64 value64, uint32 vAddress)
 {
+#ifdef PROFILE
+	context->m_memoryProxyStats.writes++;
+#endif
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	assert((address & 0x07) == 0);
 	INTEGER64 value;
@@ -124,6 +163,12 @@ void MemoryUtils_SetDoubleProxy(CMIPS* context, uint64 value64, uint32 vAddress)
 			e->handler(address + (i * 4), value.d[i]);
 		}
 		break;
+	case CMemoryMap::MEMORYMAP_TYPE_SIZEDFUNCTION:
+		for(unsigned int i = 0; i < 2; i++)
+		{
+			e->sizedHandler(address + (i * 4), value.d[i], 4);
+		}
+		break;
 	default:
 		assert(0);
 		break;
@@ -132,6 +177,9 @@ void MemoryUtils_SetDoubleProxy(CMIPS* context, uint64 value64, uint32 vAddress)
 
 void MemoryUtils_SetQuadProxy(CMIPS* context, const uint128& value, uint32 vAddress)
 {
+#ifdef PROFILE
+	context->m_memoryProxyStats.writes++;
+#endif
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	address &= ~0x0F;
 	auto e = context->m_pMemoryMap->GetWriteMap(address);
@@ -152,6 +200,12 @@ void MemoryUtils_SetQuadProxy(CMIPS* context, const uint128& value, uint32 vAddr
 			e->handler(address + (i * 4), value.nV[i]);
 		}
 		break;
+	case CMemoryMap::MEMORYMAP_TYPE_SIZEDFUNCTION:
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			e->sizedHandler(address + (i * 4), value.nV[i], 4);
+		}
+		break;
 	default:
 		assert(0);
 		break;
@@ -9,6 +9,10 @@ public:
 	virtual void Reset() = 0;
 	virtual int Execute(int) = 0;
 	virtual void ClearActiveBlocksInRange(uint32 start, uint32 end, bool executing) = 0;
+	virtual void SetBackgroundCompilationEnabled(bool) = 0;
+	//Drops pending background compilations and waits for the one in progress to be done
+	virtual void CancelBackgroundCompilation() = 0;
+	virtual void SetTraceFormationEnabled(bool) = 0;
 
 #ifdef DEBUGGER_INCLUDED
 	virtual bool MustBreak() const = 0;
@@ -0,0 +1,232 @@
+#include <cassert>
+#include "MipsGprState.h"
+#include "MIPS.h"
+#include "MipsJitter.h"
+#include "offsetof_def.h"
+
+bool CMipsGprState::STATE::operator==(const STATE& rhs) const
+{
+	if(knownMask != rhs.knownMask) return false;
+	for(unsigned int reg = 0; reg < GPR_COUNT; reg++)
+	{
+		if((knownMask & (1 << reg)) == 0) continue;
+		if(values[reg] != rhs.values[reg]) return false;
+	}
+	return true;
+}
+
+CMipsGprState::CMipsGprState(CMIPS& context)
+    : m_context(context)
+{
+	Reset();
+}
+
+void CMipsGprState::Reset()
+{
+	m_state = STATE();
+}
+
+bool CMipsGprState::IsKnown(unsigned int reg) const
+{
+	assert(reg < GPR_COUNT);
+	return (m_state.knownMask & (1 << reg)) != 0;
+}
+
+uint64 CMipsGprState::GetValue(unsigned int reg) const
+{
+	assert(IsKnown(reg));
+	return m_state.values[reg];
+}
+
+const CMipsGprState::STATE& CMipsGprState::GetState() const
+{
+	return m_state;
+}
+
+void CMipsGprState::SetState(const STATE& state)
+{
+	assert(state.knownMask & (1 << CMIPS::R0));
+	assert(state.values[CMIPS::R0] == 0);
+	m_state = state;
+}
+
+void CMipsGprState::CompileInstruction(CMipsJitter* jitter, uint32 address)
+{
+	uint32 opcode = m_context.m_pMemoryMap->GetInstruction(address);
+
+	MIPS_GPR_USAGE usage;
+	if(!GetInstructionUsage(m_context, address, opcode, usage))
+	{
+		m_context.GetCompileArchitecture()->CompileInstruction(address, jitter, &m_context);
+		Reset();
+		return;
+	}
+
+	uint32 substituteMask = GetSubstituteMask(m_context, address, opcode, usage) & m_state.knownMask;
+	unsigned int partCount = (m_context.GetCompileArchitecture()->GetRegSize() == MIPS_REGSIZE_64) ? 2 : 1;
+
+	for(unsigned int reg = 0; reg < GPR_COUNT; reg++)
+	{
+		if((substituteMask & (1 << reg)) == 0) continue;
+		for(unsigned int i = 0; i < partCount; i++)
+		{
+			jitter->SetVariableAsConstant(offsetof(CMIPS, m_State.nGPR[reg].nV[i]),
+			                              static_cast<uint32>(m_state.values[reg] >> (i * 32)));
+		}
+	}
+
+	m_context.GetCompileArchitecture()->CompileInstruction(address, jitter, &m_context);
+
+	for(unsigned int reg = 0; reg < GPR_COUNT; reg++)
+	{
+		if((substituteMask & (1 << reg)) == 0) continue;
+		for(unsigned int i = 0; i < partCount; i++)
+		{
+			jitter->ResetVariableStatus(offsetof(CMIPS, m_State.nGPR[reg].nV[i]));
+		}
+	}
+
+	UpdateInstructionResult(address, opcode, usage);
+}
+
+void CMipsGprState::InvalidateInstructionResult(uint32 address)
+{
+	uint32 opcode = m_context.m_pMemoryMap->GetInstruction(address);
+
+	MIPS_GPR_USAGE usage;
+	if(!GetInstructionUsage(m_context, address, opcode, usage))
+	{
+		Reset();
+		return;
+	}
+	if(usage.writeRegister == CMIPS::R0) return;
+	Invalidate(usage.writeRegister);
+}
+
+CMipsGprState::InstructionMask CMipsGprState::FindDeadInstructions(CMIPS& context, uint32 begin, uint32 end)
+{
+	assert(end >= begin);
+	uint32 instructionCount = ((end - begin) / 4) + 1;
+	InstructionMask result(instructionCount, false);
+
+	//Everything is live when leaving the range, or when an instruction we know
+	//nothing about (or that can leave the block early) is executed
+	static const uint32 allRegisters = ~0U;
+	uint32 liveMask = allRegisters;
+	auto arch = context.GetCompileArchitecture();
+
+	for(uint32 i = instructionCount; i-- > 0;)
+	{
+		uint32 address = begin + (i * 4);
+		uint32 opcode = context.m_pMemoryMap->GetInstruction(address);
+
+		MIPS_GPR_USAGE usage;
+		bool knownUsage = (arch->IsInstructionBranch(&context, address, opcode) == MIPS_BRANCH_NONE) &&
+		                  arch->GetInstructionGprUsage(&context, address, opcode, usage);
+		if(!knownUsage || !usage.pure)
+		{
+			liveMask = allRegisters;
+			continue;
+		}
+
+		if(usage.writeRegister != CMIPS::R0)
+		{
+			uint32 writeMask = (1 << usage.writeRegister);
+			if((liveMask & writeMask) == 0)
+			{
+				result[i] = true;
+				continue;
+			}
+			liveMask &= ~writeMask;
+		}
+		liveMask |= usage.readMask;
+	}
+
+	return result;
+}
+
+CMipsGprState::STATE CMipsGprState::ComputeExitState(CMIPS& context, uint32 begin, uint32 end)
+{
+	//Must follow what CompileInstruction and InvalidateInstructionResult do to the state
+	CMipsGprState gprState(context);
+	auto deadInstructions = FindDeadInstructions(context, begin, end);
+
+	for(uint32 address = begin; address <= end; address += 4)
+	{
+		if(deadInstructions[(address - begin) / 4])
+		{
+			gprState.InvalidateInstructionResult(address);
+			continue;
+		}
+		uint32 opcode = context.m_pMemoryMap->GetInstruction(address);
+		MIPS_GPR_USAGE usage;
+		if(!GetInstructionUsage(context, address, opcode, usage))
+		{
+			gprState.Reset();
+			continue;
+		}
+		gprState.UpdateInstructionResult(address, opcode, usage);
+	}
+
+	//Delay slot of a likely branch might have been skipped
+	gprState.InvalidateInstructionResult(end);
+
+	return gprState.GetState();
+}
+
+uint32 CMipsGprState::FindInputRegisters(CMIPS& context, uint32 begin, uint32 end)
+{
+	auto deadInstructions = FindDeadInstructions(context, begin, end);
+
+	uint32 inputMask = 0;
+	uint32 writeMask = 0;
+	for(uint32 address = begin; address <= end; address += 4)
+	{
+		if(deadInstructions[(address - begin) / 4]) continue;
+		uint32 opcode = context.m_pMemoryMap->GetInstruction(address);
+		MIPS_GPR_USAGE usage;
+		//Everything is forgotten after an instruction we know nothing about
+		if(!GetInstructionUsage(context, address, opcode, usage)) break;
+		//Values are also carried through pure instructions writing to one of their sources
+		inputMask |= (GetSubstituteMask(context, address, opcode, usage) | (usage.pure ? usage.readMask : 0)) & ~writeMask;
+		writeMask |= (1 << usage.writeRegister);
+	}
+
+	return inputMask & ~(1 << CMIPS::R0);
+}
+
+bool CMipsGprState::GetInstructionUsage(CMIPS& context, uint32 address, uint32 opcode, MIPS_GPR_USAGE& usage)
+{
+	return context.GetCompileArchitecture()->GetInstructionGprUsage(&context, address, opcode, usage);
+}
+
+uint32 CMipsGprState::GetSubstituteMask(CMIPS& context, uint32 address, uint32 opcode, const MIPS_GPR_USAGE& usage)
+{
+	//Branch conditions are compiled as they are, the known values are only kept going through them
+	if(context.GetCompileArchitecture()->IsInstructionBranch(&context, address, opcode) != MIPS_BRANCH_NONE) return 0;
+	//R0 is always constant for the jitter. Destination is left alone in case the
+	//instruction reads back a part of it after having written to it.
+	return usage.readMask & ~(1 << CMIPS::R0) & ~(1 << usage.writeRegister);
+}
+
+void CMipsGprState::UpdateInstructionResult(uint32 address, uint32 opcode, const MIPS_GPR_USAGE& usage)
+{
+	if(usage.writeRegister == CMIPS::R0) return;
+
+	uint64 result = 0;
+	if(usage.pure && ((usage.readMask & m_state.knownMask) == usage.readMask) &&
+	   m_context.GetCompileArchitecture()->EvaluateInstructionGprResult(&m_context, address, opcode, m_state.values, result))
+	{
+		m_state.values[usage.writeRegister] = result;
+		m_state.knownMask |= (1 << usage.writeRegister);
+	}
+	else
+	{
+		Invalidate(usage.writeRegister);
+	}
+}
+
+void CMipsGprState::Invalidate(unsigned int reg)
+{
+	m_state.knownMask &= ~(1 << reg);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include "Types.h"
+#include "MIPSArchitecture.h"
+
+class CMIPS;
+class CMipsJitter;
+
+//Values of general purpose registers known while a block is being compiled. Blocks
+//keep the following contract on their link edges: every register is written back to
+//the context before exiting. Linked blocks can thus jump into each other without
+//reconciling any state. A block is compiled knowing only R0, unless it's a copy
+//specialized for the values known when leaving one of its predecessors, in which case
+//it's only entered through the link edges of predecessors leaving with those values.
+//Segments of a trace aren't connected through link edges and keep what is known from
+//one segment to the next.
+class CMipsGprState
+{
+public:
+	enum
+	{
+		GPR_COUNT = 32,
+	};
+
+	struct STATE
+	{
+		//R0 is always known
+		uint32 knownMask = 1;
+		uint64 values[GPR_COUNT] = {};
+
+		bool operator==(const STATE&) const;
+	};
+
+	typedef std::vector<bool> InstructionMask;
+
+	CMipsGprState(CMIPS&);
+
+	void Reset();
+	bool IsKnown(unsigned int) const;
+	uint64 GetValue(unsigned int) const;
+
+	const STATE& GetState() const;
+	void SetState(const STATE&);
+
+	void CompileInstruction(CMipsJitter*, uint32);
+	void InvalidateInstructionResult(uint32);
+
+	//Finds instructions whose result is overwritten before being read or before leaving the range
+	static InstructionMask FindDeadInstructions(CMIPS&, uint32, uint32);
+
+	//Values known when leaving the range through one of its link edges, if it's entered knowing only R0
+	static STATE ComputeExitState(CMIPS&, uint32, uint32);
+
+	//Registers read before being written in the range that can be replaced by their known value
+	static uint32 FindInputRegisters(CMIPS&, uint32, uint32);
+
+private:
+	static bool GetInstructionUsage(CMIPS&, uint32, uint32, MIPS_GPR_USAGE&);
+	static uint32 GetSubstituteMask(CMIPS&, uint32, uint32, const MIPS_GPR_USAGE&);
+	void UpdateInstructionResult(uint32, uint32, const MIPS_GPR_USAGE&);
+	void Invalidate(unsigned int);
+
+	CMIPS& m_context;
+	STATE m_state;
+};
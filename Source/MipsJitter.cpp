@@ -70,6 +70,8 @@ void CMipsJitter::MarkFinalBlockLabel()
 	if(m_lastBlockLabel != -1)
 	{
 		MarkLabel(m_lastBlockLabel);
+		//Code compiled after this point gets its own final label (ie.: next segment of a trace)
+		m_lastBlockLabel = -1;
 	}
 }
 
@@ -81,6 +83,11 @@ void CMipsJitter::SetVariableAsConstant(size_t variableId, uint32 value)
 	SetVariableStatus(variableId, status);
 }
 
+void CMipsJitter::ResetVariableStatus(size_t variableId)
+{
+	m_variableStatus.erase(variableId);
+}
+
 CMipsJitter::VARIABLESTATUS* CMipsJitter::GetVariableStatus(size_t variableId)
 {
 	auto statusIterator(m_variableStatus.find(variableId));
@@ -14,6 +14,7 @@ public:
 	void PushRel64(size_t) override;
 
 	void SetVariableAsConstant(size_t, uint32);
+	void ResetVariableStatus(size_t);
 
 	LABEL GetFinalBlockLabel();
 	void MarkFinalBlockLabel();
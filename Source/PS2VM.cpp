@@ -8,6 +8,7 @@
 #include "PS2VM_Preferences.h"
 #include "ee/PS2OS.h"
 #include "ee/EeExecutor.h"
+#include "ee/VuExecutor.h"
 #include "Ps2Const.h"
 #include "iop/Iop_SifManPs2.h"
 #include "StdStream.h"
@@ -34,6 +35,8 @@
 #define PREF_PS2_MC0_DIRECTORY_DEFAULT ("vfs/mc0")
 #define PREF_PS2_MC1_DIRECTORY_DEFAULT ("vfs/mc1")
 
+#define BLOCKCACHE_PATH ("blockcache/")
+
 #define FRAME_TICKS (PS2::EE_CLOCK_FREQ / 60)
 #define ONSCREEN_TICKS (FRAME_TICKS * 9 / 10)
 #define VBLANK_TICKS (FRAME_TICKS / 10)
@@ -87,11 +90,83 @@ CPS2VM::CPS2VM()
 	m_iop = std::make_unique<Iop::CSubSystem>(true);
 	auto iopOs = dynamic_cast<CIopBios*>(m_iop->m_bios.get());
 
-	m_ee = std::make_unique<Ee::CSubSystem>(m_iop->m_ram, *iopOs);
+	//Decides how the EE memory map is setup, needs to be known before creating the subsystem
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_VU1THREAD_ENABLED, false);
+	bool vu1Threaded = CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_VU1THREAD_ENABLED);
+#ifdef PROFILE
+	//Profiler zones can only be entered from the emulator thread
+	vu1Threaded = false;
+#endif
+
+	m_ee = std::make_unique<Ee::CSubSystem>(m_iop->m_ram, *iopOs, vu1Threaded);
+
+	//Both subsystems handle MIPS_EXCEPTION_IDLE by skipping the rest of their time slice
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_IDLELOOPDETECTION_ENABLED, false);
+	if(CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_IDLELOOPDETECTION_ENABLED))
+	{
+		m_ee->m_EE.m_idleLoopDetectionEnabled = true;
+		m_iop->m_cpu.m_idleLoopDetectionEnabled = true;
+	}
 	m_OnRequestLoadExecutableConnection = m_ee->m_os->OnRequestLoadExecutable.Connect(std::bind(&CPS2VM::ReloadExecutable, this, std::placeholders::_1, std::placeholders::_2));
 
 	CAppConfig::GetInstance().RegisterPreferenceInteger(PREF_AUDIO_SPUBLOCKCOUNT, 100);
 	m_spuBlockCount = CAppConfig::GetInstance().GetPreferenceInteger(PREF_AUDIO_SPUBLOCKCOUNT);
+
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_BLOCKCACHE_ENABLED, false);
+	m_blockCacheEnabled = CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_BLOCKCACHE_ENABLED);
+	if(m_blockCacheEnabled)
+	{
+		m_ee->m_EE.m_blockCache = &m_blockCaches[BLOCKCACHE_EE];
+		m_iop->m_cpu.m_blockCache = &m_blockCaches[BLOCKCACHE_IOP];
+		m_ee->m_VU0.m_blockCache = &m_blockCaches[BLOCKCACHE_VU0];
+		m_ee->m_VU1.m_blockCache = &m_blockCaches[BLOCKCACHE_VU1];
+		m_OnExecutableChangeConnection = m_ee->m_os->OnExecutableChange.Connect([this]() { LoadBlockCaches(); });
+		m_OnExecutableUnloadingConnection = m_ee->m_os->OnExecutableUnloading.Connect([this]() { SaveBlockCaches(); });
+	}
+
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_BACKGROUNDCOMPILE_ENABLED, false);
+	if(CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_BACKGROUNDCOMPILE_ENABLED))
+	{
+		m_ee->m_EE.m_executor->SetBackgroundCompilationEnabled(true);
+		m_iop->m_cpu.m_executor->SetBackgroundCompilationEnabled(true);
+	}
+
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_TRACEFORMATION_ENABLED, false);
+	if(CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_TRACEFORMATION_ENABLED))
+	{
+		m_ee->m_EE.m_executor->SetTraceFormationEnabled(true);
+		m_iop->m_cpu.m_executor->SetTraceFormationEnabled(true);
+	}
+
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_FINEGRAINEDSMC_ENABLED, false);
+	if(CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_FINEGRAINEDSMC_ENABLED))
+	{
+		static_cast<CEeExecutor*>(m_ee->m_EE.m_executor.get())->SetFineGrainedSmcDetectionEnabled(true);
+	}
+
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_BLOCKPROFILER_ENABLED, false);
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_PERFMAP_ENABLED, false);
+	bool perfMapEnabled = CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_PERFMAP_ENABLED);
+	//Perf map entries are written by the profiler when blocks get compiled
+	if(CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_BLOCKPROFILER_ENABLED) || perfMapEnabled)
+	{
+		CBlockProfiler::SetPerfMapEnabled(perfMapEnabled);
+		static const char* profilerNames[BLOCKCACHE_MAX] = {"EE", "IOP", "VU0", "VU1"};
+		CMIPS* contexts[BLOCKCACHE_MAX] = {&m_ee->m_EE, &m_iop->m_cpu, &m_ee->m_VU0, &m_ee->m_VU1};
+		for(unsigned int i = 0; i < BLOCKCACHE_MAX; i++)
+		{
+			m_blockProfilers[i] = std::make_unique<CBlockProfiler>(profilerNames[i]);
+			contexts[i]->m_blockProfiler = m_blockProfilers[i].get();
+			contexts[i]->m_blockProfilerCounters = m_blockProfilers[i]->GetCounters();
+		}
+	}
+}
+
+CPS2VM::~CPS2VM()
+{
+	//Blocks unregister from block profilers when they get deleted, get rid of them first
+	m_iop.reset();
+	m_ee.reset();
 }
 
 //////////////////////////////////////////////////
@@ -288,6 +363,60 @@ CPS2VM::CPU_UTILISATION_INFO CPS2VM::GetCpuUtilisationInfo() const
 	return m_cpuUtilisation;
 }
 
+CBlockCache::STATS CPS2VM::GetBlockCacheStats() const
+{
+	CBlockCache::STATS result;
+	for(const auto& blockCache : m_blockCaches)
+	{
+		auto stats = blockCache.GetStats();
+		result.hits += stats.hits;
+		result.misses += stats.misses;
+		result.rejects += stats.rejects;
+		result.bytesLoaded += stats.bytesLoaded;
+	}
+	return result;
+}
+
+CGSHandler::READBACK_STATS CPS2VM::GetGsReadbackStats() const
+{
+	if(!m_ee->m_gs) return CGSHandler::READBACK_STATS();
+	return m_ee->m_gs->GetReadbackStats();
+}
+
+std::string CPS2VM::DumpHotBlocks(size_t count) const
+{
+	std::string result;
+	for(const auto& blockProfiler : m_blockProfilers)
+	{
+		if(!blockProfiler) continue;
+		result += blockProfiler->DumpTopBlocks(count);
+	}
+	return result;
+}
+
+CPS2VM::SMC_INFO CPS2VM::GetEeSmcInfo() const
+{
+	auto stats = static_cast<CEeExecutor*>(m_ee->m_EE.m_executor.get())->GetSmcStats();
+	SMC_INFO result;
+	result.faults = stats.faults;
+	result.invalidations = stats.invalidations;
+	result.revalidations = stats.revalidations;
+	result.reprotections = stats.reprotections;
+	return result;
+}
+
+CPS2VM::VU_PROGRAM_CACHE_INFO CPS2VM::GetVuProgramCacheInfo(unsigned int vuUnit) const
+{
+	assert(vuUnit < 2);
+	auto& vuContext = (vuUnit == 0) ? m_ee->m_VU0 : m_ee->m_VU1;
+	auto stats = static_cast<CVuExecutor*>(vuContext.m_executor.get())->GetProgramCacheStats();
+	VU_PROGRAM_CACHE_INFO result;
+	result.programSwitches = stats.programSwitches;
+	result.cacheHits = stats.cacheHits;
+	result.partitionTime = stats.partitionTime;
+	return result;
+}
+
 #ifdef DEBUGGER_INCLUDED
 
 #define TAGS_SECTION_TAGS ("tags")
@@ -375,7 +504,10 @@ void CPS2VM::CreateVM()
 
 void CPS2VM::ResetVM()
 {
-	m_ee->Reset();
+	{
+		CVpu::CThreadLock vu1ThreadLock(*m_ee->m_vpu1);
+		m_ee->Reset();
+	}
 	m_iop->Reset();
 
 	//LoadBIOS();
@@ -432,6 +564,9 @@ bool CPS2VM::SaveVMState(const fs::path& statePath)
 		auto stateStream = Framework::CreateOutputStdStream(statePath.native());
 		Framework::CZipArchiveWriter archive;
 
+		//State files are only copied when the archive is written, keep VU1 stopped until then
+		CVpu::CThreadLock vu1ThreadLock(*m_ee->m_vpu1);
+
 		m_ee->SaveState(archive);
 		m_iop->SaveState(archive);
 		m_ee->m_gs->SaveState(archive);
@@ -461,6 +596,7 @@ bool CPS2VM::LoadVMState(const fs::path& statePath)
 
 		try
 		{
+			CVpu::CThreadLock vu1ThreadLock(*m_ee->m_vpu1);
 			m_ee->LoadState(archive);
 			m_iop->LoadState(archive);
 			m_ee->m_gs->LoadState(archive);
@@ -499,6 +635,7 @@ void CPS2VM::ResumeImpl()
 
 void CPS2VM::DestroyImpl()
 {
+	SaveBlockCaches();
 	DestroyGsHandlerImpl();
 	DestroyPadHandlerImpl();
 	DestroySoundHandlerImpl();
@@ -569,6 +706,46 @@ void CPS2VM::OnGsNewFrame()
 #endif
 }
 
+fs::path CPS2VM::GetBlockCachePath(unsigned int cacheIndex) const
+{
+	static const char* cacheNames[BLOCKCACHE_MAX] =
+	    {
+	        "ee",
+	        "iop",
+	        "vu0",
+	        "vu1",
+	    };
+	assert(cacheIndex < BLOCKCACHE_MAX);
+	auto cacheFileName = string_format("%s.%s.blockcache", m_ee->m_os->GetExecutableName(), cacheNames[cacheIndex]);
+	return CAppConfig::GetBasePath() / fs::path(BLOCKCACHE_PATH) / fs::path(cacheFileName);
+}
+
+void CPS2VM::LoadBlockCaches()
+{
+	if(!m_blockCacheEnabled) return;
+	//Background compilers look blocks up in the caches, make sure they're idle while caches get replaced
+	m_ee->m_EE.m_executor->CancelBackgroundCompilation();
+	m_iop->m_cpu.m_executor->CancelBackgroundCompilation();
+	Framework::PathUtils::EnsurePathExists(CAppConfig::GetBasePath() / fs::path(BLOCKCACHE_PATH));
+	for(unsigned int i = 0; i < BLOCKCACHE_MAX; i++)
+	{
+		m_blockCaches[i].Load(GetBlockCachePath(i));
+		CLog::GetInstance().Print(LOG_NAME, "Loaded %d cached blocks from '%s'.\r\n",
+		                          static_cast<int>(m_blockCaches[i].GetEntryCount()), GetBlockCachePath(i).string().c_str());
+	}
+}
+
+void CPS2VM::SaveBlockCaches()
+{
+	if(!m_blockCacheEnabled) return;
+	if(strlen(m_ee->m_os->GetExecutableName()) == 0) return;
+	Framework::PathUtils::EnsurePathExists(CAppConfig::GetBasePath() / fs::path(BLOCKCACHE_PATH));
+	for(unsigned int i = 0; i < BLOCKCACHE_MAX; i++)
+	{
+		m_blockCaches[i].Save(GetBlockCachePath(i));
+	}
+}
+
 void CPS2VM::UpdateEe()
 {
 #ifdef PROFILE
@@ -789,6 +966,10 @@ void CPS2VM::EmuThread()
 						}
 
 						m_cpuUtilisation = CPU_UTILISATION_INFO();
+						if(m_ee->m_gs != NULL)
+						{
+							m_ee->m_gs->ResetReadbackStats();
+						}
 #endif
 					}
 					else
@@ -15,6 +15,8 @@
 #include "../tools/PsfPlayer/Source/SoundHandler.h"
 #include "FrameDump.h"
 #include "Profiler.h"
+#include "BlockCache.h"
+#include "BlockProfiler.h"
 
 class CPS2VM : public CVirtualMachine
 {
@@ -28,13 +30,28 @@ public:
 		int32 iopIdleTicks = 0;
 	};
 
+	struct SMC_INFO
+	{
+		uint32 faults = 0;
+		uint32 invalidations = 0;
+		uint32 revalidations = 0;
+		uint32 reprotections = 0;
+	};
+
+	struct VU_PROGRAM_CACHE_INFO
+	{
+		uint32 programSwitches = 0;
+		uint32 cacheHits = 0;
+		uint64 partitionTime = 0; //In microseconds
+	};
+
 	typedef std::unique_ptr<Ee::CSubSystem> EeSubSystemPtr;
 	typedef std::unique_ptr<Iop::CSubSystem> IopSubSystemPtr;
 	typedef std::function<void(const CFrameDump&)> FrameDumpCallback;
 	typedef Framework::CSignal<void(const CProfiler::ZoneArray&)> ProfileFrameDoneSignal;
 
 	CPS2VM();
-	virtual ~CPS2VM() = default;
+	virtual ~CPS2VM();
 
 	void Initialize();
 	void Destroy();
@@ -74,6 +91,11 @@ public:
 	void TriggerFrameDump(const FrameDumpCallback&);
 
 	CPU_UTILISATION_INFO GetCpuUtilisationInfo() const;
+	CBlockCache::STATS GetBlockCacheStats() const;
+	CGSHandler::READBACK_STATS GetGsReadbackStats() const;
+	SMC_INFO GetEeSmcInfo() const;
+	VU_PROGRAM_CACHE_INFO GetVuProgramCacheInfo(unsigned int) const;
+	std::string DumpHotBlocks(size_t) const;
 
 #ifdef DEBUGGER_INCLUDED
 	std::string MakeDebugTagsPackagePath(const char*);
@@ -118,6 +140,10 @@ private:
 
 	void OnGsNewFrame();
 
+	fs::path GetBlockCachePath(unsigned int) const;
+	void LoadBlockCaches();
+	void SaveBlockCaches();
+
 	void CDROM0_SyncPath();
 	void CDROM0_Reset();
 	void SetIopOpticalMedia(COpticalMedia*);
@@ -151,6 +177,21 @@ private:
 
 	OpticalMediaPtr m_cdrom0;
 
+	enum BLOCKCACHE
+	{
+		BLOCKCACHE_EE,
+		BLOCKCACHE_IOP,
+		BLOCKCACHE_VU0,
+		BLOCKCACHE_VU1,
+		BLOCKCACHE_MAX,
+	};
+
+	CBlockCache m_blockCaches[BLOCKCACHE_MAX];
+	bool m_blockCacheEnabled = false;
+
+	//Only allocated when block profiling is enabled, indexed like block caches
+	std::unique_ptr<CBlockProfiler> m_blockProfilers[BLOCKCACHE_MAX];
+
 	//SPU update parameters
 	enum
 	{
@@ -174,5 +215,7 @@ private:
 	CProfiler::ZoneHandle m_otherProfilerZone = 0;
 
 	CPS2OS::RequestLoadExecutableEvent::Connection m_OnRequestLoadExecutableConnection;
+	Framework::CSignal<void()>::Connection m_OnExecutableChangeConnection;
+	Framework::CSignal<void()>::Connection m_OnExecutableUnloadingConnection;
 	Framework::CSignal<void(uint32)>::Connection m_OnNewFrameConnection;
 };
@@ -7,3 +7,12 @@
 #define PREF_PS2_MC1_DIRECTORY ("ps2.mc1.directory.v2")
 
 #define PREF_AUDIO_SPUBLOCKCOUNT ("audio.spublockcount")
+
+#define PREF_PS2_BLOCKCACHE_ENABLED ("ps2.blockcache.enabled")
+#define PREF_PS2_BACKGROUNDCOMPILE_ENABLED ("ps2.backgroundcompile.enabled")
+#define PREF_PS2_TRACEFORMATION_ENABLED ("ps2.traceformation.enabled")
+#define PREF_PS2_FINEGRAINEDSMC_ENABLED ("ps2.finegrainedsmc.enabled")
+#define PREF_PS2_BLOCKPROFILER_ENABLED ("ps2.blockprofiler.enabled")
+#define PREF_PS2_PERFMAP_ENABLED ("ps2.perfmap.enabled")
+#define PREF_PS2_VU1THREAD_ENABLED ("ps2.vu1thread.enabled")
+#define PREF_PS2_IDLELOOPDETECTION_ENABLED ("ps2.idleloopdetection.enabled")
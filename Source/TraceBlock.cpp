@@ -0,0 +1,105 @@
+#include "TraceBlock.h"
+#include "MipsJitter.h"
+#include "MipsGprState.h"
+#include "offsetof_def.h"
+
+CTraceBlock::CTraceBlock(CMIPS& context, const SegmentArray& segments)
+    : CBasicBlock(context, segments.front().begin, segments.front().end)
+    , m_segments(segments)
+{
+	assert(m_segments.size() > 1);
+}
+
+const CTraceBlock::SegmentArray& CTraceBlock::GetSegments() const
+{
+	return m_segments;
+}
+
+void CTraceBlock::CompileRange(CMipsJitter* jitter)
+{
+	CompileProlog(jitter);
+
+	//Code of every segment is part of the trace
+	for(const auto& segment : m_segments)
+	{
+		CompileCodeCheck(jitter, segment.begin, segment.end);
+	}
+
+	auto exitLabel = jitter->CreateLabel();
+
+	CMipsGprState gprState(m_context);
+
+	for(size_t i = 0; i < m_segments.size(); i++)
+	{
+		const auto& segment = m_segments[i];
+		auto deadInstructions = CMipsGprState::FindDeadInstructions(m_context, segment.begin, segment.end);
+		for(uint32 address = segment.begin; address <= segment.end; address += 4)
+		{
+			if(deadInstructions[(address - segment.begin) / 4])
+			{
+				gprState.InvalidateInstructionResult(address);
+				continue;
+			}
+			gprState.CompileInstruction(jitter, address);
+			//Sanity check
+			assert(jitter->IsStackEmpty());
+		}
+
+		//Delay slot of a likely branch might have been skipped
+		gprState.InvalidateInstructionResult(segment.end);
+
+		jitter->MarkFinalBlockLabel();
+
+		if((i + 1) == m_segments.size())
+		{
+			//Last segment exits like a regular block and can be linked to other blocks
+			CompileEpilog(jitter, segment.begin, segment.end);
+		}
+		else
+		{
+			CompileSegmentExit(jitter, segment, m_segments[i + 1].begin, exitLabel);
+		}
+	}
+
+	jitter->MarkLabel(exitLabel);
+}
+
+void CTraceBlock::CompileSegmentExit(CMipsJitter* jitter, const SEGMENT& segment, uint32 nextSegmentAddress, Jitter::CJitter::LABEL exitLabel)
+{
+	CompileCycleQuotaUpdate(jitter, segment.begin, segment.end);
+
+	//Same state as a block would leave behind, next segment sees the same PC it would see if it was run on its own
+	jitter->PushCst(MIPS_INVALID_PC);
+	jitter->PushRel(offsetof(CMIPS, m_State.nDelayedJumpAddr));
+	jitter->BeginIf(Jitter::CONDITION_NE);
+	{
+		jitter->PushRel(offsetof(CMIPS, m_State.nDelayedJumpAddr));
+		jitter->PullRel(offsetof(CMIPS, m_State.nPC));
+
+		jitter->PushCst(MIPS_INVALID_PC);
+		jitter->PullRel(offsetof(CMIPS, m_State.nDelayedJumpAddr));
+	}
+	jitter->Else();
+	{
+		jitter->PushCst(segment.end + 4);
+		jitter->PullRel(offsetof(CMIPS, m_State.nPC));
+	}
+	jitter->EndIf();
+
+	//Side exit, let the executor pick the block that handles the other path
+	jitter->PushRel(offsetof(CMIPS, m_State.nHasException));
+	jitter->PushCst(0);
+	jitter->BeginIf(Jitter::CONDITION_NE);
+	{
+		jitter->Goto(exitLabel);
+	}
+	jitter->EndIf();
+
+	jitter->PushRel(offsetof(CMIPS, m_State.nPC));
+	jitter->PushCst(nextSegmentAddress);
+	jitter->BeginIf(Jitter::CONDITION_NE);
+	{
+		jitter->Goto(exitLabel);
+	}
+	jitter->EndIf();
+}
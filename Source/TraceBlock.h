@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+#include "BasicBlock.h"
+
+//Chain of basic blocks compiled as a single function. Execution falls through from one
+//segment to the next as long as control flow follows the recorded path, and leaves the
+//trace as soon as it doesn't. The block range only covers the first segment.
+class CTraceBlock : public CBasicBlock
+{
+public:
+	struct SEGMENT
+	{
+		uint32 begin;
+		uint32 end;
+	};
+	typedef std::vector<SEGMENT> SegmentArray;
+
+	CTraceBlock(CMIPS&, const SegmentArray&);
+	virtual ~CTraceBlock() = default;
+
+	const SegmentArray& GetSegments() const;
+
+protected:
+	void CompileRange(CMipsJitter*) override;
+
+private:
+	void CompileSegmentExit(CMipsJitter*, const SEGMENT&, uint32, Jitter::CJitter::LABEL);
+
+	SegmentArray m_segments;
+};
@@ -30,6 +30,11 @@ CCOP_VU::CCOP_VU(MIPS_REGSIZE nRegSize)
 	SetupReflectionTables();
 }
 
+std::unique_ptr<CMIPSCoprocessor> CCOP_VU::Clone() const
+{
+	return std::make_unique<CCOP_VU>(m_regSize);
+}
+
 void CCOP_VU::CompileInstruction(uint32 nAddress, CMipsJitter* codeGen, CMIPS* pCtx)
 {
 	SetupQuickVariables(nAddress, codeGen, pCtx);
@@ -14,6 +14,7 @@ public:
 	void GetArguments(uint32, uint32, char*) override;
 	uint32 GetEffectiveAddress(uint32, uint32) override;
 	MIPS_BRANCH_TYPE IsBranch(uint32) override;
+	std::unique_ptr<CMIPSCoprocessor> Clone() const override;
 
 protected:
 	typedef void (CCOP_VU::*InstructionFuncConstant)();
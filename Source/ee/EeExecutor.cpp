@@ -35,6 +35,10 @@ static CEeExecutor* g_eeExecutor = nullptr;
 CEeExecutor::CEeExecutor(CMIPS& context, uint8* ram)
     : CGenericMipsExecutor(context, 0x20000000)
     , m_ram(ram)
+    , m_smcFaults(0)
+    , m_smcInvalidations(0)
+    , m_smcRevalidations(0)
+    , m_smcReprotections(0)
 {
 	m_pageSize = framework_getpagesize();
 }
@@ -93,9 +97,61 @@ void CEeExecutor::RemoveExceptionHandler()
 	g_eeExecutor = nullptr;
 }
 
+void CEeExecutor::SetFineGrainedSmcDetectionEnabled(bool enabled)
+{
+	//Blocks compiled with and without code checks can't be mixed
+	Reset();
+	if(enabled)
+	{
+		m_codeCheckPages.resize(PS2::EE_RAM_SIZE / MIPS_PAGE_SIZE);
+		ResetCodeCheckPages();
+		m_context.m_codeCheckPages = m_codeCheckPages.data();
+		m_context.m_codeCheckPageCount = static_cast<uint32>(m_codeCheckPages.size());
+		m_context.m_codeChangedHandler =
+		    [this](CMIPS* context) {
+			    m_changedBlocks.push_back(context->m_State.nPC & m_addressMask);
+			    //Block can't be freed while it's running, get rid of it once we're back in Execute
+			    context->m_State.nHasException |= MIPS_EXECUTION_STATUS_QUOTADONE;
+		    };
+	}
+	else
+	{
+		m_context.m_codeCheckPages = nullptr;
+		m_context.m_codeCheckPageCount = 0;
+		m_context.m_codeChangedHandler = nullptr;
+		m_codeCheckPages.clear();
+	}
+}
+
+CEeExecutor::SMC_STATS CEeExecutor::GetSmcStats() const
+{
+	SMC_STATS result;
+	result.faults = m_smcFaults;
+	result.invalidations = m_smcInvalidations;
+	result.revalidations = m_smcRevalidations;
+	result.reprotections = m_smcReprotections;
+	return result;
+}
+
+int CEeExecutor::Execute(int cycles)
+{
+	if(!m_changedBlocks.empty())
+	{
+		InvalidateChangedBlocks();
+	}
+	if(!m_writtenPages.empty())
+	{
+		ReprotectWrittenPages();
+	}
+	return CGenericMipsExecutor::Execute(cycles);
+}
+
 void CEeExecutor::Reset()
 {
 	SetMemoryProtected(m_ram, PS2::EE_RAM_SIZE, false);
+	ResetCodeCheckPages();
+	m_changedBlocks.clear();
+	m_writtenPages.clear();
 	CGenericMipsExecutor::Reset();
 }
 
@@ -108,14 +164,120 @@ void CEeExecutor::ClearActiveBlocksInRange(uint32 start, uint32 end, bool execut
 
 BasicBlockPtr CEeExecutor::BlockFactory(CMIPS& context, uint32 start, uint32 end)
 {
-	//Kernel area is below 0x100000 and isn't protected. Some games will write code in there
-	//but it is safe to assume that it won't change (code writes some data just besides itself
-	//so it keeps generating exceptions, making the game slower)
-	if(start >= 0x100000 && start < PS2::EE_RAM_SIZE)
+	ProtectBlockMemory(start, end);
+	return CGenericMipsExecutor::BlockFactory(context, start, end);
+}
+
+BasicBlockPtr CEeExecutor::TraceFactory(CMIPS& context, const CTraceBlock::SegmentArray& segments)
+{
+	for(const auto& segment : segments)
 	{
-		SetMemoryProtected(m_ram + start, end - start + 4, true);
+		ProtectBlockMemory(segment.begin, segment.end);
+	}
+	return CGenericMipsExecutor::TraceFactory(context, segments);
+}
+
+void CEeExecutor::ResetCodeCheckPages()
+{
+	if(m_codeCheckPages.empty()) return;
+	std::fill(std::begin(m_codeCheckPages), std::end(m_codeCheckPages), 0);
+	//Kernel area is never protected, code living there is always checked
+	std::fill(std::begin(m_codeCheckPages), std::begin(m_codeCheckPages) + (KERNEL_AREA_SIZE / MIPS_PAGE_SIZE), 1);
+}
+
+void CEeExecutor::InvalidateChangedBlocks()
+{
+	for(auto address : m_changedBlocks)
+	{
+		//Code is still being modified in this page, keep it unprotected for now
+		auto pageIterator = m_writtenPages.find(address & ~(m_pageSize - 1));
+		if(pageIterator != std::end(m_writtenPages))
+		{
+			pageIterator->second = 0;
+		}
+		auto block = FindBlockStartingAt(address);
+		if(block->IsEmpty()) continue;
+		ClearActiveBlocksInRangeInternal(block->GetBeginAddress(), block->GetEndAddress() + 4, nullptr);
+		m_smcInvalidations++;
+	}
+	m_changedBlocks.clear();
+}
+
+void CEeExecutor::ReprotectWrittenPages()
+{
+	for(auto pageIterator = std::begin(m_writtenPages); pageIterator != std::end(m_writtenPages);)
+	{
+		if(++pageIterator->second < REPROTECT_CLEAN_SLICE_COUNT)
+		{
+			pageIterator++;
+			continue;
+		}
+		ReprotectPage(pageIterator->first);
+		pageIterator = m_writtenPages.erase(pageIterator);
+	}
+}
+
+void CEeExecutor::ReprotectPage(uint32 pageAddress)
+{
+	//Blocks in this page won't check their code anymore, drop the ones that don't match memory.
+	//Traces are formed later than the blocks they contain and are dropped as well.
+	std::vector<std::pair<uint32, uint32>> clearedRanges;
+	for(uint32 address = pageAddress; address < (pageAddress + m_pageSize); address += (1 << BLOCK_PAGE_BITS))
+	{
+		auto pageIterator = m_blockPages.find(address >> BLOCK_PAGE_BITS);
+		if(pageIterator == std::end(m_blockPages)) continue;
+		for(const auto& block : pageIterator->second)
+		{
+			bool isTrace = (m_traces.find(block->GetBeginAddress()) != std::end(m_traces));
+			if(isTrace || block->HasCodeChanged())
+			{
+				clearedRanges.push_back(std::make_pair(block->GetBeginAddress(), block->GetEndAddress() + 4));
+			}
+		}
+	}
+	for(const auto& range : clearedRanges)
+	{
+		ClearActiveBlocksInRangeInternal(range.first, range.second, nullptr);
+		m_smcInvalidations++;
+	}
+
+	for(uint32 address = pageAddress; address < (pageAddress + m_pageSize); address += MIPS_PAGE_SIZE)
+	{
+		m_codeCheckPages[address / MIPS_PAGE_SIZE] = 0;
+	}
+	SetMemoryProtected(m_ram + pageAddress, m_pageSize, true);
+	m_smcReprotections++;
+}
+
+bool CEeExecutor::IsCodeCheckEnabled(uint32 address) const
+{
+	if(m_codeCheckPages.empty()) return false;
+	return m_codeCheckPages[address / MIPS_PAGE_SIZE] != 0;
+}
+
+void CEeExecutor::ProtectBlockMemory(uint32 start, uint32 end)
+{
+	if(start >= PS2::EE_RAM_SIZE) return;
+
+	if(m_codeCheckPages.empty())
+	{
+		//Kernel area is below 0x100000 and isn't protected. Some games will write code in there
+		//but it is safe to assume that it won't change (code writes some data just besides itself
+		//so it keeps generating exceptions, making the game slower)
+		if(start >= KERNEL_AREA_SIZE)
+		{
+			SetMemoryProtected(m_ram + start, end - start + 4, true);
+		}
+		return;
+	}
+
+	//Pages that were written to stay writable, blocks living in them check their code instead
+	uint32 lastAddress = std::min<uint32>(end, PS2::EE_RAM_SIZE - 1);
+	for(uint32 pageAddress = start & ~(m_pageSize - 1); pageAddress <= lastAddress; pageAddress += m_pageSize)
+	{
+		if(IsCodeCheckEnabled(pageAddress)) continue;
+		SetMemoryProtected(m_ram + pageAddress, m_pageSize, true);
 	}
-	return CGenericMipsExecutor::BlockFactory(context, start, end);
 }
 
 bool CEeExecutor::HandleAccessFault(intptr_t ptr)
@@ -124,7 +286,28 @@ bool CEeExecutor::HandleAccessFault(intptr_t ptr)
 	if(addr >= 0 && addr < PS2::EE_RAM_SIZE)
 	{
 		addr &= ~(m_pageSize - 1);
-		ClearActiveBlocksInRange(addr, addr + m_pageSize, true);
+		m_smcFaults++;
+		if(m_codeCheckPages.empty())
+		{
+			m_smcInvalidations++;
+			ClearActiveBlocksInRange(addr, addr + m_pageSize, true);
+		}
+		else
+		{
+			//Writes to this page won't fault anymore, blocks living here are kept and will check their code when they run
+			SetMemoryProtected(m_ram + addr, m_pageSize, false);
+			m_writtenPages[addr] = 0;
+			for(uint32 pageAddress = addr; pageAddress < (addr + m_pageSize); pageAddress += MIPS_PAGE_SIZE)
+			{
+				m_codeCheckPages[pageAddress / MIPS_PAGE_SIZE] = 1;
+			}
+			for(uint32 pageAddress = addr; pageAddress < (addr + m_pageSize); pageAddress += (1 << BLOCK_PAGE_BITS))
+			{
+				auto pageIterator = m_blockPages.find(pageAddress >> BLOCK_PAGE_BITS);
+				if(pageIterator == std::end(m_blockPages)) continue;
+				m_smcRevalidations += static_cast<uint32>(pageIterator->second.size());
+			}
+		}
 		return true;
 	}
 	return false;
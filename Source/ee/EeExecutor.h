@@ -9,26 +9,70 @@
 #include <signal.h>
 #endif
 
+#include <atomic>
+#include <map>
 #include "../GenericMipsExecutor.h"
 
 class CEeExecutor : public CGenericMipsExecutor<BlockLookupTwoWay>
 {
 public:
+	struct SMC_STATS
+	{
+		uint32 faults = 0;
+		uint32 invalidations = 0;
+		uint32 revalidations = 0;
+		uint32 reprotections = 0;
+	};
+
 	CEeExecutor(CMIPS&, uint8*);
 	virtual ~CEeExecutor() = default;
 
 	void AddExceptionHandler();
 	void RemoveExceptionHandler();
 
+	void SetFineGrainedSmcDetectionEnabled(bool);
+	SMC_STATS GetSmcStats() const;
+
+	int Execute(int) override;
 	void Reset() override;
 	void ClearActiveBlocksInRange(uint32, uint32, bool) override;
 
 	BasicBlockPtr BlockFactory(CMIPS&, uint32, uint32) override;
+	BasicBlockPtr TraceFactory(CMIPS&, const CTraceBlock::SegmentArray&) override;
 
 private:
+	enum
+	{
+		KERNEL_AREA_SIZE = 0x100000,
+		//Number of Execute calls without code changes before a written page gets protected again
+		REPROTECT_CLEAN_SLICE_COUNT = 0x100,
+	};
+
+	typedef std::vector<uint32> CodeCheckPageArray;
+	typedef std::vector<uint32> AddressArray;
+	typedef std::map<uint32, uint32> WrittenPageMap;
+
 	uint8* m_ram = nullptr;
 	size_t m_pageSize = 0;
 
+	//Fine grained SMC detection: pages that were written to aren't protected anymore
+	//and blocks living in them compare their code against what they were compiled from
+	CodeCheckPageArray m_codeCheckPages;
+	AddressArray m_changedBlocks;
+	//Host page address -> number of Execute calls since code last changed in that page
+	WrittenPageMap m_writtenPages;
+
+	std::atomic<uint32> m_smcFaults;
+	std::atomic<uint32> m_smcInvalidations;
+	std::atomic<uint32> m_smcRevalidations;
+	std::atomic<uint32> m_smcReprotections;
+
+	void ResetCodeCheckPages();
+	void InvalidateChangedBlocks();
+	void ReprotectWrittenPages();
+	void ReprotectPage(uint32);
+	bool IsCodeCheckEnabled(uint32) const;
+	void ProtectBlockMemory(uint32, uint32);
 	bool HandleAccessFault(intptr_t);
 	void SetMemoryProtected(void*, size_t, bool);
 
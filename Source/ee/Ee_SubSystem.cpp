@@ -24,7 +24,7 @@ using namespace Ee;
 
 #define FAKE_IOP_RAM_SIZE (0x1000)
 
-CSubSystem::CSubSystem(uint8* iopRam, CIopBios& iopBios)
+CSubSystem::CSubSystem(uint8* iopRam, CIopBios& iopBios, bool vu1Threaded)
     : m_ram(reinterpret_cast<uint8*>(framework_aligned_alloc(PS2::EE_RAM_SIZE, framework_getpagesize())))
     , m_bios(new uint8[PS2::EE_BIOS_SIZE])
     , m_spr(reinterpret_cast<uint8*>(framework_aligned_alloc(PS2::EE_SPR_SIZE, 0x10)))
@@ -59,6 +59,7 @@ CSubSystem::CSubSystem(uint8* iopRam, CIopBios& iopBios)
 
 	m_vpu0 = std::make_shared<CVpu>(0, CVpu::VPUINIT(m_microMem0, m_vuMem0, &m_VU0), m_gif, m_intc, m_ram, m_spr);
 	m_vpu1 = std::make_shared<CVpu>(1, CVpu::VPUINIT(m_microMem1, m_vuMem1, &m_VU1), m_gif, m_intc, m_ram, m_spr);
+	m_vpu1->SetThreaded(vu1Threaded);
 
 	//Setup link between EE's VU context and VU0's VU context
 	m_vu0StateChangedConnection = m_vpu0->VuStateChanged.Connect([this](bool running) { Vu0StateChanged(running); });
@@ -74,7 +75,15 @@ CSubSystem::CSubSystem(uint8* iopRam, CIopBios& iopBios)
 		m_EE.m_pMemoryMap->InsertReadMap(PS2::MICROMEM0ADDR, PS2::MICROMEM0ADDR + PS2::MICROMEM0SIZE - 1, m_microMem0, 0x03);
 		m_EE.m_pMemoryMap->InsertReadMap(PS2::VUMEM0ADDR, PS2::VUMEM0ADDR + PS2::VUMEM0SIZE - 1, m_vuMem0, 0x04);
 		m_EE.m_pMemoryMap->InsertReadMap(PS2::MICROMEM1ADDR, PS2::MICROMEM1ADDR + PS2::MICROMEM1SIZE - 1, m_microMem1, 0x05);
-		m_EE.m_pMemoryMap->InsertReadMap(PS2::VUMEM1ADDR, PS2::VUMEM1ADDR + PS2::VUMEM1SIZE - 1, m_vuMem1, 0x06);
+		if(vu1Threaded)
+		{
+			//Accesses need to be synchronized with the VU thread
+			m_EE.m_pMemoryMap->InsertSizedReadMap(PS2::VUMEM1ADDR, PS2::VUMEM1ADDR + PS2::VUMEM1SIZE - 1, std::bind(&CSubSystem::Vu1MemReadHandler, this, PLACEHOLDER_1, PLACEHOLDER_3), 0x06);
+		}
+		else
+		{
+			m_EE.m_pMemoryMap->InsertReadMap(PS2::VUMEM1ADDR, PS2::VUMEM1ADDR + PS2::VUMEM1SIZE - 1, m_vuMem1, 0x06);
+		}
 		m_EE.m_pMemoryMap->InsertReadMap(0x12000000, 0x12FFFFFF, std::bind(&CSubSystem::IOPortReadHandler, this, PLACEHOLDER_1), 0x07);
 		m_EE.m_pMemoryMap->InsertReadMap(0x1C000000, 0x1C001000, m_fakeIopRam, 0x08);
 		m_EE.m_pMemoryMap->InsertReadMap(0x1FC00000, 0x1FFFFFFF, m_bios, 0x09);
@@ -86,7 +95,14 @@ CSubSystem::CSubSystem(uint8* iopRam, CIopBios& iopBios)
 		m_EE.m_pMemoryMap->InsertWriteMap(PS2::MICROMEM0ADDR, PS2::MICROMEM0ADDR + PS2::MICROMEM0SIZE - 1, std::bind(&CSubSystem::Vu0MicroMemWriteHandler, this, PLACEHOLDER_1, PLACEHOLDER_2), 0x03);
 		m_EE.m_pMemoryMap->InsertWriteMap(PS2::VUMEM0ADDR, PS2::VUMEM0ADDR + PS2::VUMEM0SIZE - 1, m_vuMem0, 0x04);
 		m_EE.m_pMemoryMap->InsertWriteMap(PS2::MICROMEM1ADDR, PS2::MICROMEM1ADDR + PS2::MICROMEM1SIZE - 1, std::bind(&CSubSystem::Vu1MicroMemWriteHandler, this, PLACEHOLDER_1, PLACEHOLDER_2), 0x05);
-		m_EE.m_pMemoryMap->InsertWriteMap(PS2::VUMEM1ADDR, PS2::VUMEM1ADDR + PS2::VUMEM1SIZE - 1, m_vuMem1, 0x06);
+		if(vu1Threaded)
+		{
+			m_EE.m_pMemoryMap->InsertSizedWriteMap(PS2::VUMEM1ADDR, PS2::VUMEM1ADDR + PS2::VUMEM1SIZE - 1, std::bind(&CSubSystem::Vu1MemWriteHandler, this, PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3), 0x06);
+		}
+		else
+		{
+			m_EE.m_pMemoryMap->InsertWriteMap(PS2::VUMEM1ADDR, PS2::VUMEM1ADDR + PS2::VUMEM1SIZE - 1, m_vuMem1, 0x06);
+		}
 		m_EE.m_pMemoryMap->InsertWriteMap(0x12000000, 0x12FFFFFF, std::bind(&CSubSystem::IOPortWriteHandler, this, PLACEHOLDER_1, PLACEHOLDER_2), 0x07);
 
 		//Instruction map
@@ -144,7 +160,7 @@ CSubSystem::CSubSystem(uint8* iopRam, CIopBios& iopBios)
 	m_VU1.m_vuMem = m_vuMem1;
 
 	m_dmac.SetChannelTransferFunction(CDMAC::CHANNEL_ID_VIF0, std::bind(&CVif::ReceiveDMA, &m_vpu0->GetVif(), PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3, PLACEHOLDER_4));
-	m_dmac.SetChannelTransferFunction(CDMAC::CHANNEL_ID_VIF1, std::bind(&CVif::ReceiveDMA, &m_vpu1->GetVif(), PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3, PLACEHOLDER_4));
+	m_dmac.SetChannelTransferFunction(CDMAC::CHANNEL_ID_VIF1, std::bind(&CSubSystem::Vif1ReceiveDmaHandler, this, PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3, PLACEHOLDER_4));
 	m_dmac.SetChannelTransferFunction(CDMAC::CHANNEL_ID_GIF, std::bind(&CGIF::ReceiveDMA, &m_gif, PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3, PLACEHOLDER_4));
 	m_dmac.SetChannelTransferFunction(CDMAC::CHANNEL_ID_TO_IPU, std::bind(&CIPU::ReceiveDMA4, &m_ipu, PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_4, m_ram));
 	m_dmac.SetChannelTransferFunction(CDMAC::CHANNEL_ID_SIF0, std::bind(&CSIF::ReceiveDMA5, &m_sif, PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3, PLACEHOLDER_4));
@@ -160,6 +176,8 @@ CSubSystem::CSubSystem(uint8* iopRam, CIopBios& iopBios)
 
 CSubSystem::~CSubSystem()
 {
+	//VU thread must be stopped before freeing anything it might be using
+	m_vpu1->SetThreaded(false);
 	m_EE.m_executor->Reset();
 	delete m_os;
 	framework_aligned_free(m_ram);
@@ -423,6 +441,7 @@ uint32 CSubSystem::IOPortReadHandler(uint32 nAddress)
 	}
 	else if(nAddress >= CVif::REGS1_START && nAddress < CVif::REGS1_END)
 	{
+		CVpu::CThreadLock vu1ThreadLock(*m_vpu1);
 		nReturn = m_vpu1->GetVif().GetRegister(nAddress);
 	}
 	else if(nAddress >= 0x10008000 && nAddress <= 0x1000EFFC)
@@ -485,6 +504,7 @@ uint32 CSubSystem::IOPortWriteHandler(uint32 nAddress, uint32 nData)
 	}
 	else if(nAddress >= CVif::REGS1_START && nAddress < CVif::REGS1_END)
 	{
+		CVpu::CThreadLock vu1ThreadLock(*m_vpu1);
 		m_vpu1->GetVif().SetRegister(nAddress, nData);
 	}
 	else if(nAddress >= CVif::VIF0_FIFO_START && nAddress < CVif::VIF0_FIFO_END)
@@ -493,6 +513,7 @@ uint32 CSubSystem::IOPortWriteHandler(uint32 nAddress, uint32 nData)
 	}
 	else if(nAddress >= CVif::VIF1_FIFO_START && nAddress < CVif::VIF1_FIFO_END)
 	{
+		CVpu::CThreadLock vu1ThreadLock(*m_vpu1);
 		m_vpu1->GetVif().SetRegister(nAddress, nData);
 	}
 	else if(nAddress >= 0x10007000 && nAddress <= 0x1000702F)
@@ -521,6 +542,7 @@ uint32 CSubSystem::IOPortWriteHandler(uint32 nAddress, uint32 nData)
 	else if(nAddress == CVpu::VU_CMSAR1)
 	{
 		bool validAddress = (nData & 0x7) == 0;
+		CVpu::CThreadLock vu1ThreadLock(*m_vpu1);
 		if(!m_vpu1->IsVuRunning() && validAddress)
 		{
 			m_vpu1->ExecuteMicroProgram(nData);
@@ -600,11 +622,55 @@ void CSubSystem::Vu0StateChanged(bool running)
 uint32 CSubSystem::Vu1MicroMemWriteHandler(uint32 address, uint32 value)
 {
 	uint32 baseAddress = address - PS2::MICROMEM1ADDR;
+	CVpu::CThreadLock vu1ThreadLock(*m_vpu1);
 	*reinterpret_cast<uint32*>(m_microMem1 + baseAddress) = value;
 	m_vpu1->InvalidateMicroProgram(baseAddress, baseAddress + 4);
 	return 0;
 }
 
+uint32 CSubSystem::Vu1MemReadHandler(uint32 address, unsigned int size)
+{
+	uint32 baseAddress = address - PS2::VUMEM1ADDR;
+	CVpu::CThreadLock vu1ThreadLock(*m_vpu1);
+	switch(size)
+	{
+	case 1:
+		return m_vuMem1[baseAddress];
+	case 2:
+		return *reinterpret_cast<uint16*>(m_vuMem1 + baseAddress);
+	default:
+		assert(size == 4);
+		return *reinterpret_cast<uint32*>(m_vuMem1 + baseAddress);
+	}
+}
+
+uint32 CSubSystem::Vu1MemWriteHandler(uint32 address, uint32 value, unsigned int size)
+{
+	uint32 baseAddress = address - PS2::VUMEM1ADDR;
+	CVpu::CThreadLock vu1ThreadLock(*m_vpu1);
+	switch(size)
+	{
+	case 1:
+		m_vuMem1[baseAddress] = static_cast<uint8>(value);
+		break;
+	case 2:
+		*reinterpret_cast<uint16*>(m_vuMem1 + baseAddress) = static_cast<uint16>(value);
+		break;
+	default:
+		assert(size == 4);
+		*reinterpret_cast<uint32*>(m_vuMem1 + baseAddress) = value;
+		break;
+	}
+	return 0;
+}
+
+uint32 CSubSystem::Vif1ReceiveDmaHandler(uint32 address, uint32 qwc, uint32 direction, bool tagIncluded)
+{
+	//UNPACK and MPG write to VU1 memory, VU thread can't run while VIF1 processes data
+	CVpu::CThreadLock vu1ThreadLock(*m_vpu1);
+	return m_vpu1->GetVif().ReceiveDMA(address, qwc, direction, tagIncluded);
+}
+
 uint32 CSubSystem::Vu1IoPortReadHandler(uint32 address)
 {
 	uint32 result = 0xCCCCCCCC;
@@ -24,7 +24,7 @@ namespace Ee
 	class CSubSystem
 	{
 	public:
-		CSubSystem(uint8*, CIopBios&);
+		CSubSystem(uint8*, CIopBios&, bool = false);
 		virtual ~CSubSystem();
 
 		void Reset();
@@ -93,6 +93,9 @@ namespace Ee
 		void Vu0StateChanged(bool);
 
 		uint32 Vu1MicroMemWriteHandler(uint32, uint32);
+		uint32 Vu1MemReadHandler(uint32, unsigned int);
+		uint32 Vu1MemWriteHandler(uint32, uint32, unsigned int);
+		uint32 Vif1ReceiveDmaHandler(uint32, uint32, uint32, bool);
 
 		uint32 Vu1IoPortReadHandler(uint32);
 		uint32 Vu1IoPortWriteHandler(uint32, uint32);
@@ -9,6 +9,10 @@
 
 #define QTEMP_INIT (0x3F800000)
 
+//Smallest register write batch reserved in the GS command ring, avoids going back to
+//the ring for every small tag found in a packet
+#define MIN_WRITE_BATCH_CAPACITY (0x40)
+
 #define LOG_NAME ("ee_gif")
 
 #define STATE_REGS_XML ("gif/regs.xml")
@@ -74,15 +78,159 @@ void CGIF::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(registerFile);
 }
 
-uint32 CGIF::ProcessPacked(CGSHandler::RegisterWriteList& writeList, const uint8* memory, uint32 address, uint32 end)
+static uint64 PackRGBAQ(const uint128& packet, uint32 q)
+{
+	uint64 result = (packet.nV[0] & 0xFF);
+	result |= (packet.nV[1] & 0xFF) << 8;
+	result |= (packet.nV[2] & 0xFF) << 16;
+	result |= (packet.nV[3] & 0xFF) << 24;
+	result |= static_cast<uint64>(q) << 32;
+	return result;
+}
+
+static uint64 PackUV(const uint128& packet)
+{
+	uint64 result = (packet.nV[0] & 0x7FFF);
+	result |= (packet.nV[1] & 0x7FFF) << 16;
+	return result;
+}
+
+static uint64 PackXYZF(const uint128& packet)
+{
+	uint64 result = (packet.nV[0] & 0xFFFF);
+	result |= (packet.nV[1] & 0xFFFF) << 16;
+	result |= static_cast<uint64>(packet.nV[2] & 0x0FFFFFF0) << 28;
+	result |= static_cast<uint64>(packet.nV[3] & 0x00000FF0) << 52;
+	return result;
+}
+
+static uint64 PackXYZ(const uint128& packet)
+{
+	uint64 result = (packet.nV[0] & 0xFFFF);
+	result |= (packet.nV[1] & 0xFFFF) << 16;
+	result |= static_cast<uint64>(packet.nV[2]) << 32;
+	return result;
+}
+
+//XYZF2/XYZ2 become XYZF3/XYZ3 when ADC bit is set
+static uint8 GetXyzKickRegister(const uint128& packet, uint8 kickRegister)
+{
+	return (packet.nV[3] & 0x8000) ? (kickRegister + (GS_REG_XYZ3 - GS_REG_XYZ2)) : kickRegister;
+}
+
+//Register lists made only of vertex attributes and kicks don't need any special handling
+//(no A+D, signals or NOPs), whole loops can be converted at once
+static bool IsVertexRegList(uint64 regList, uint32 regs)
+{
+	for(uint32 i = 0; i < regs; i++)
+	{
+		uint32 regDesc = static_cast<uint32>((regList >> (i * 4)) & 0x0F);
+		if(regDesc > 0x05) return false;
+	}
+	return true;
+}
+
+void CGIF::ReserveRegisterWrites(uint32 count)
+{
+	if((m_writeBatchCapacity - m_writeBatchCount) >= count) return;
+	FlushRegisterWrites();
+	m_writeBatchCapacity = std::min<uint32>(std::max<uint32>(count, MIN_WRITE_BATCH_CAPACITY), m_gs->GetMaxRegisterWriteCount());
+	m_writeBatch = m_gs->BeginRegisterWrites(m_writeBatchCapacity, m_writeBatchMetadata);
+	m_writeBatchCount = 0;
+}
+
+void CGIF::FlushRegisterWrites()
+{
+	if(m_writeBatch == nullptr) return;
+	m_gs->EndRegisterWrites(m_writeBatchCount);
+	m_writeBatch = nullptr;
+	m_writeBatchCount = 0;
+	m_writeBatchCapacity = 0;
+}
+
+void CGIF::PushRegisterWrite(uint8 registerId, uint64 value)
+{
+	if(m_writeBatchCount == m_writeBatchCapacity)
+	{
+		ReserveRegisterWrites(1);
+	}
+	m_writeBatch[m_writeBatchCount++] = CGSHandler::RegisterWrite(registerId, value);
+}
+
+uint32 CGIF::ProcessPackedVertices(const uint8* memory, uint32 address, uint32 loops)
+{
+	uint8 regDescs[0x10];
+	for(uint32 i = 0; i < m_regs; i++)
+	{
+		regDescs[i] = static_cast<uint8>((m_regList >> (i * 4)) & 0x0F);
+	}
+
+	uint32 writeCount = loops * m_regs;
+	ReserveRegisterWrites(writeCount);
+	auto writes = m_writeBatch + m_writeBatchCount;
+	auto packets = reinterpret_cast<const uint128*>(memory + address);
+	uint32 q = m_qtemp;
+	for(uint32 loop = 0; loop < loops; loop++)
+	{
+		for(uint32 i = 0; i < m_regs; i++)
+		{
+			const auto& packet = *(packets++);
+			auto& write = *(writes++);
+			switch(regDescs[i])
+			{
+			case 0x00:
+				write = CGSHandler::RegisterWrite(GS_REG_PRIM, packet.nV0);
+				break;
+			case 0x01:
+				write = CGSHandler::RegisterWrite(GS_REG_RGBAQ, PackRGBAQ(packet, q));
+				break;
+			case 0x02:
+				q = packet.nV2;
+				write = CGSHandler::RegisterWrite(GS_REG_ST, packet.nD0);
+				break;
+			case 0x03:
+				write = CGSHandler::RegisterWrite(GS_REG_UV, PackUV(packet));
+				break;
+			case 0x04:
+				write = CGSHandler::RegisterWrite(GetXyzKickRegister(packet, GS_REG_XYZF2), PackXYZF(packet));
+				break;
+			case 0x05:
+				write = CGSHandler::RegisterWrite(GetXyzKickRegister(packet, GS_REG_XYZ2), PackXYZ(packet));
+				break;
+			}
+		}
+	}
+	m_qtemp = q;
+	m_writeBatchCount += writeCount;
+	m_loops -= loops;
+	return writeCount * 0x10;
+}
+
+uint32 CGIF::ProcessPacked(const uint8* memory, uint32 address, uint32 end)
 {
 	uint32 start = address;
 
+	if((m_regsTemp == m_regs) && IsVertexRegList(m_regList, m_regs))
+	{
+		uint32 loops = std::min<uint32>(m_loops, (end - address) / (m_regs * 0x10));
+		loops = std::min<uint32>(loops, m_gs->GetMaxRegisterWriteCount() / m_regs);
+		if(loops != 0)
+		{
+			address += ProcessPackedVertices(memory, address, loops);
+		}
+	}
+
+	//Reserve for what's left of the packet (NLOOP x NREG) or what's available
+	if(m_loops != 0)
+	{
+		uint32 remainingRegs = ((m_loops - 1) * m_regs) + m_regsTemp;
+		ReserveRegisterWrites(std::min<uint32>(remainingRegs, (end - address) / 0x10));
+	}
+
 	while((m_loops != 0) && (address < end))
 	{
 		while((m_regsTemp != 0) && (address < end))
 		{
-			uint64 temp = 0;
 			uint32 regDesc = (uint32)((m_regList >> ((m_regs - m_regsTemp) * 4)) & 0x0F);
 
 			uint128 packet = *reinterpret_cast<const uint128*>(memory + address);
@@ -91,80 +239,52 @@ uint32 CGIF::ProcessPacked(CGSHandler::RegisterWriteList& writeList, const uint8
 			{
 			case 0x00:
 				//PRIM
-				writeList.push_back(CGSHandler::RegisterWrite(GS_REG_PRIM, packet.nV0));
+				PushRegisterWrite(GS_REG_PRIM, packet.nV0);
 				break;
 			case 0x01:
 				//RGBA
-				temp = (packet.nV[0] & 0xFF);
-				temp |= (packet.nV[1] & 0xFF) << 8;
-				temp |= (packet.nV[2] & 0xFF) << 16;
-				temp |= (packet.nV[3] & 0xFF) << 24;
-				temp |= ((uint64)m_qtemp << 32);
-				writeList.push_back(CGSHandler::RegisterWrite(GS_REG_RGBAQ, temp));
+				PushRegisterWrite(GS_REG_RGBAQ, PackRGBAQ(packet, m_qtemp));
 				break;
 			case 0x02:
 				//ST
 				m_qtemp = packet.nV2;
-				writeList.push_back(CGSHandler::RegisterWrite(GS_REG_ST, packet.nD0));
+				PushRegisterWrite(GS_REG_ST, packet.nD0);
 				break;
 			case 0x03:
 				//UV
-				temp = (packet.nV[0] & 0x7FFF);
-				temp |= (packet.nV[1] & 0x7FFF) << 16;
-				writeList.push_back(CGSHandler::RegisterWrite(GS_REG_UV, temp));
+				PushRegisterWrite(GS_REG_UV, PackUV(packet));
 				break;
 			case 0x04:
 				//XYZF2
-				temp = (packet.nV[0] & 0xFFFF);
-				temp |= (packet.nV[1] & 0xFFFF) << 16;
-				temp |= (uint64)(packet.nV[2] & 0x0FFFFFF0) << 28;
-				temp |= (uint64)(packet.nV[3] & 0x00000FF0) << 52;
-				if(packet.nV[3] & 0x8000)
-				{
-					writeList.push_back(CGSHandler::RegisterWrite(GS_REG_XYZF3, temp));
-				}
-				else
-				{
-					writeList.push_back(CGSHandler::RegisterWrite(GS_REG_XYZF2, temp));
-				}
+				PushRegisterWrite(GetXyzKickRegister(packet, GS_REG_XYZF2), PackXYZF(packet));
 				break;
 			case 0x05:
 				//XYZ2
-				temp = (packet.nV[0] & 0xFFFF);
-				temp |= (packet.nV[1] & 0xFFFF) << 16;
-				temp |= (uint64)(packet.nV[2] & 0xFFFFFFFF) << 32;
-				if(packet.nV[3] & 0x8000)
-				{
-					writeList.push_back(CGSHandler::RegisterWrite(GS_REG_XYZ3, temp));
-				}
-				else
-				{
-					writeList.push_back(CGSHandler::RegisterWrite(GS_REG_XYZ2, temp));
-				}
+				PushRegisterWrite(GetXyzKickRegister(packet, GS_REG_XYZ2), PackXYZ(packet));
 				break;
 			case 0x06:
 				//TEX0_1
-				writeList.push_back(CGSHandler::RegisterWrite(GS_REG_TEX0_1, packet.nD0));
+				PushRegisterWrite(GS_REG_TEX0_1, packet.nD0);
 				break;
 			case 0x07:
 				//TEX0_2
-				writeList.push_back(CGSHandler::RegisterWrite(GS_REG_TEX0_2, packet.nD0));
+				PushRegisterWrite(GS_REG_TEX0_2, packet.nD0);
 				break;
 			case 0x08:
 				//CLAMP_1
-				writeList.push_back(CGSHandler::RegisterWrite(GS_REG_CLAMP_1, packet.nD0));
+				PushRegisterWrite(GS_REG_CLAMP_1, packet.nD0);
 				break;
 			case 0x09:
 				//CLAMP_2
-				writeList.push_back(CGSHandler::RegisterWrite(GS_REG_CLAMP_2, packet.nD0));
+				PushRegisterWrite(GS_REG_CLAMP_2, packet.nD0);
 				break;
 			case 0x0A:
 				//FOG
-				writeList.push_back(CGSHandler::RegisterWrite(GS_REG_FOG, (packet.nD1 >> 36) << 56));
+				PushRegisterWrite(GS_REG_FOG, (packet.nD1 >> 36) << 56);
 				break;
 			case 0x0D:
 				//XYZ3
-				writeList.push_back(CGSHandler::RegisterWrite(GS_REG_XYZ3, packet.nD0));
+				PushRegisterWrite(GS_REG_XYZ3, packet.nD0);
 				break;
 			case 0x0E:
 				//A + D
@@ -182,7 +302,7 @@ uint32 CGIF::ProcessPacked(CGSHandler::RegisterWriteList& writeList, const uint8
 						}
 						m_signalState = SIGNAL_STATE_ENCOUNTERED;
 					}
-					writeList.push_back(CGSHandler::RegisterWrite(reg, packet.nD0));
+					PushRegisterWrite(reg, packet.nD0);
 				}
 				break;
 			case 0x0F:
@@ -207,10 +327,12 @@ uint32 CGIF::ProcessPacked(CGSHandler::RegisterWriteList& writeList, const uint8
 	return address - start;
 }
 
-uint32 CGIF::ProcessRegList(CGSHandler::RegisterWriteList& writeList, const uint8* memory, uint32 address, uint32 end)
+uint32 CGIF::ProcessRegList(const uint8* memory, uint32 address, uint32 end)
 {
 	uint32 start = address;
 
+	ReserveRegisterWrites(std::min<uint32>(m_loops * m_regs, (end - address) / 0x08));
+
 	while(m_loops != 0)
 	{
 		if(address == end)
@@ -231,7 +353,7 @@ uint32 CGIF::ProcessRegList(CGSHandler::RegisterWriteList& writeList, const uint
 
 			if(nRegDesc == 0x0F) continue;
 
-			writeList.push_back(CGSHandler::RegisterWrite(static_cast<uint8>(nRegDesc), packet.nD0));
+			PushRegisterWrite(static_cast<uint8>(nRegDesc), packet.nD0);
 		}
 
 		m_loops--;
@@ -258,17 +380,6 @@ uint32 CGIF::ProcessImage(const uint8* memory, uint32 address, uint32 end)
 
 uint32 CGIF::ProcessSinglePacket(const uint8* memory, uint32 address, uint32 end, const CGsPacketMetadata& packetMetadata)
 {
-	static CGSHandler::RegisterWriteList writeList;
-	static const auto flushWriteList =
-	    [](CGSHandler* gs, const CGsPacketMetadata& packetMetadata) {
-		    if(!writeList.empty())
-		    {
-			    auto currentCapacity = writeList.capacity();
-			    gs->WriteRegisterMassively(std::move(writeList), &packetMetadata);
-			    writeList.reserve(currentCapacity);
-		    }
-	    };
-
 #ifdef PROFILE
 	CProfilerZone profilerZone(m_gifProfilerZone);
 #endif
@@ -280,7 +391,8 @@ uint32 CGIF::ProcessSinglePacket(const uint8* memory, uint32 address, uint32 end
 
 	assert((m_activePath == 0) || (m_activePath == packetMetadata.pathIndex));
 	m_signalState = SIGNAL_STATE_NONE;
-	writeList.clear();
+	//Writes go straight in the GS command ring, batches are committed at the end of the packet
+	m_writeBatchMetadata = &packetMetadata;
 
 	uint32 start = address;
 	while(address < end)
@@ -308,34 +420,44 @@ uint32 CGIF::ProcessSinglePacket(const uint8* memory, uint32 address, uint32 end
 			m_regList = tag.regs;
 			m_eop = (tag.eop != 0);
 			m_qtemp = QTEMP_INIT;
+			if(m_regs == 0) m_regs = 0x10;
+			m_regsTemp = m_regs;
+
+			//Reserve room for the whole tag (NLOOP x NREG) at once, bounded by what's available
+			if(m_cmd == 0)
+			{
+				ReserveRegisterWrites(1 + std::min<uint32>(m_loops * m_regs, (end - address) / 0x10));
+			}
+			else if(m_cmd == 1)
+			{
+				ReserveRegisterWrites(std::min<uint32>(m_loops * m_regs, (end - address) / 0x08));
+			}
 
 			if(m_cmd != 1)
 			{
 				if(tag.pre != 0)
 				{
-					writeList.push_back(CGSHandler::RegisterWrite(GS_REG_PRIM, static_cast<uint64>(tag.prim)));
+					PushRegisterWrite(GS_REG_PRIM, static_cast<uint64>(tag.prim));
 				}
 			}
 
-			if(m_regs == 0) m_regs = 0x10;
-			m_regsTemp = m_regs;
 			m_activePath = packetMetadata.pathIndex;
 			continue;
 		}
 		switch(m_cmd)
 		{
 		case 0x00:
-			address += ProcessPacked(writeList, memory, address, end);
+			address += ProcessPacked(memory, address, end);
 			break;
 		case 0x01:
-			address += ProcessRegList(writeList, memory, address, end);
+			address += ProcessRegList(memory, address, end);
 			break;
 		case 0x02:
 		case 0x03:
 			//We need to flush our list here because image data can be embedded in a GIF packet
 			//that specifies pixel transfer information in GS registers (and that has to be send first)
 			//This is done by FFX
-			flushWriteList(m_gs, packetMetadata);
+			FlushRegisterWrites();
 			address += ProcessImage(memory, address, end);
 			break;
 		}
@@ -355,7 +477,8 @@ uint32 CGIF::ProcessSinglePacket(const uint8* memory, uint32 address, uint32 end
 		}
 	}
 
-	flushWriteList(m_gs, packetMetadata);
+	FlushRegisterWrites();
+	m_writeBatchMetadata = nullptr;
 
 #ifdef _DEBUG
 	CLog::GetInstance().Print(LOG_NAME, "Processed 0x%08X bytes.\r\n", address - start);
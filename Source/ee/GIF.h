@@ -67,10 +67,15 @@ private:
 		SIGNAL_STATE_PENDING,
 	};
 
-	uint32 ProcessPacked(CGSHandler::RegisterWriteList&, const uint8*, uint32, uint32);
-	uint32 ProcessRegList(CGSHandler::RegisterWriteList&, const uint8*, uint32, uint32);
+	uint32 ProcessPacked(const uint8*, uint32, uint32);
+	uint32 ProcessPackedVertices(const uint8*, uint32, uint32);
+	uint32 ProcessRegList(const uint8*, uint32, uint32);
 	uint32 ProcessImage(const uint8*, uint32, uint32);
 
+	void ReserveRegisterWrites(uint32);
+	void FlushRegisterWrites();
+	void PushRegisterWrite(uint8, uint64);
+
 	void DisassembleGet(uint32);
 	void DisassembleSet(uint32, uint32);
 
@@ -89,5 +94,11 @@ private:
 	uint8* m_spr;
 	CGSHandler*& m_gs;
 
+	//Register writes batch being filled in the GS command ring
+	CGSHandler::RegisterWrite* m_writeBatch = nullptr;
+	uint32 m_writeBatchCount = 0;
+	uint32 m_writeBatchCapacity = 0;
+	const CGsPacketMetadata* m_writeBatchMetadata = nullptr;
+
 	CProfiler::ZoneHandle m_gifProfilerZone = 0;
 };
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <stdio.h>
@@ -10,6 +11,7 @@
 #include "IPU_MacroblockTypeBTable.h"
 #include "IPU_MotionCodeTable.h"
 #include "IPU_DmVectorTable.h"
+#include "IPU_Idct.h"
 #include "mpeg2/DcSizeLuminanceTable.h"
 #include "mpeg2/DcSizeChrominanceTable.h"
 #include "mpeg2/DctCoefficientTable0.h"
@@ -17,8 +19,6 @@
 #include "mpeg2/CodedBlockPatternTable.h"
 #include "mpeg2/QuantiserScaleTable.h"
 #include "mpeg2/InverseScanTable.h"
-#include "idct/TrivialC.h"
-#include "idct/IEEE1180.h"
 #include "../Log.h"
 #include "DMAC.h"
 #include "INTC.h"
@@ -436,77 +436,35 @@ void CIPU::DequantiseBlock(int16* pBlock, uint8 nMBI, uint8 nQSC, bool isLinearQ
 			break;
 		}
 
-		pBlock[0] = nIntraDcMult * pBlock[0];
+		int16 dcValue = nIntraDcMult * pBlock[0];
 
-		for(unsigned int i = 1; i < 64; i++)
+		for(unsigned int i = 0; i < 64; i++)
 		{
-			int16 nSign = 0;
-
-			if(pBlock[i] == 0)
-			{
-				nSign = 0;
-			}
-			else
-			{
-				nSign = (pBlock[i] > 0) ? 0x0001 : 0xFFFF;
-			}
-
-			pBlock[i] = (pBlock[i] * static_cast<int16>(intraIq[i]) * nQuantScale * 2) / 32;
-
-			if(nSign != 0)
-			{
-				if((pBlock[i] & 1) == 0)
-				{
-					pBlock[i] = (pBlock[i] - nSign) | 1;
-				}
-			}
+			int16 value = pBlock[i];
+			int16 sign = (value > 0) - (value < 0);
+			int16 result = (value * static_cast<int16>(intraIq[i]) * nQuantScale * 2) / 32;
+			bool mustAdjust = (sign != 0) && ((result & 1) == 0);
+			pBlock[i] = mustAdjust ? ((result - sign) | 1) : result;
 		}
+
+		pBlock[0] = dcValue;
 	}
 	else
 	{
 		for(unsigned int i = 0; i < 64; i++)
 		{
-			int16 nSign = 0;
-
-			if(pBlock[i] == 0)
-			{
-				nSign = 0;
-			}
-			else
-			{
-				nSign = (pBlock[i] > 0) ? 0x0001 : 0xFFFF;
-			}
-
-			pBlock[i] = (((pBlock[i] * 2) + nSign) * static_cast<int16>(nonIntraIq[i]) * nQuantScale) / 32;
-
-			if(nSign != 0)
-			{
-				if((pBlock[i] & 1) == 0)
-				{
-					pBlock[i] = (pBlock[i] - nSign) | 1;
-				}
-			}
+			int16 value = pBlock[i];
+			int16 sign = (value > 0) - (value < 0);
+			int16 result = (((value * 2) + sign) * static_cast<int16>(nonIntraIq[i]) * nQuantScale) / 32;
+			bool mustAdjust = (sign != 0) && ((result & 1) == 0);
+			pBlock[i] = mustAdjust ? ((result - sign) | 1) : result;
 		}
 	}
 
 	//Saturate
-	int16 nSum = 0;
-
 	for(unsigned int i = 0; i < 64; i++)
 	{
-		if(pBlock[i] > 2047)
-		{
-			pBlock[i] = 2047;
-		}
-		if(pBlock[i] < -2048)
-		{
-			pBlock[i] = -2048;
-		}
-		nSum += pBlock[i];
-	}
-
-	if(nSum & 1)
-	{
+		pBlock[i] = std::min<int16>(std::max<int16>(pBlock[i], -2048), 2047);
 	}
 }
 
@@ -840,6 +798,22 @@ void CIPU::CINFIFO::SetBitPosition(unsigned int position)
 	m_bitPosition = position;
 }
 
+//Bit position must be on a byte boundary, returns the number of bytes that could be read
+unsigned int CIPU::CINFIFO::ReadBytes(uint8* data, unsigned int size)
+{
+	assert((m_bitPosition & 0x07) == 0);
+	unsigned int readSize = std::min(size, GetAvailableBits() / 8);
+	memcpy(data, m_buffer + (m_bitPosition / 8), readSize);
+	//Advance discards consumed quadwords, keep steps small enough for it
+	for(unsigned int remainingSize = readSize; remainingSize != 0;)
+	{
+		unsigned int stepSize = std::min<unsigned int>(remainingSize, 0x10);
+		Advance(static_cast<uint8>(stepSize * 8));
+		remainingSize -= stepSize;
+	}
+	return readSize;
+}
+
 unsigned int CIPU::CINFIFO::GetSize() const
 {
 	return m_size;
@@ -1252,15 +1226,12 @@ bool CIPU::CBDECCommand::Execute()
 			}
 
 			BLOCKENTRY& blockInfo(m_blocks[m_currentBlockIndex]);
-			int16 blockTemp[0x40];
 
 			InverseScan(blockInfo.block, m_context.isZigZag);
 			DequantiseBlock(blockInfo.block, (m_command.mbi != 0), m_command.qsc,
 			                m_context.isLinearQScale, m_context.dcPrecision, m_context.intraIq, m_context.nonIntraIq);
 
-			memcpy(blockTemp, blockInfo.block, sizeof(int16) * 0x40);
-
-			IDCT::CIEEE1180::GetInstance()->Transform(blockTemp, blockInfo.block);
+			CIdct::Transform(blockInfo.block);
 
 			m_state = STATE_DECODEBLOCK_GOTONEXT;
 		}
@@ -1771,7 +1742,6 @@ bool CIPU::CSETVQCommand::Execute()
 
 CIPU::CCSCCommand::CCSCCommand()
 {
-	GenerateCbCrMap();
 }
 
 void CIPU::CCSCCommand::Initialize(CINFIFO* input, COUTFIFO* output, uint32 commandCode, uint16 TH0, uint16 TH1)
@@ -1817,91 +1787,33 @@ bool CIPU::CCSCCommand::Execute()
 			}
 			else
 			{
-				uint32 blockValue = 0;
-				if(!m_IN_FIFO->TryGetBits_MSBF(8, blockValue))
+				uint32 readSize = 0;
+				if((m_IN_FIFO->GetBitIndex() & 0x07) == 0)
+				{
+					readSize = m_IN_FIFO->ReadBytes(m_block + m_currentIndex, BLOCK_SIZE - m_currentIndex);
+				}
+				else
+				{
+					uint32 blockValue = 0;
+					if(m_IN_FIFO->TryGetBits_MSBF(8, blockValue))
+					{
+						m_block[m_currentIndex] = static_cast<uint8>(blockValue);
+						readSize = 1;
+					}
+				}
+				if(readSize == 0)
 				{
 					return false;
 				}
-				m_block[m_currentIndex] = static_cast<uint8>(blockValue);
-				m_currentIndex++;
+				m_currentIndex += readSize;
 			}
 		}
 		break;
 		case STATE_CONVERTBLOCK:
 		{
-			uint32 nPixel[0x100];
-
-			uint8* pY = m_block;
-			uint8* nBlockCb = m_block + 0x100;
-			uint8* nBlockCr = m_block + 0x140;
-
-			uint32* pPixel = nPixel;
-			unsigned int* pCbCrMap = m_nCbCrMap;
-
-			uint32 alphaTh0 = (m_TH0 & 0xFF) | ((m_TH0 & 0xFF) << 8) | ((m_TH0 & 0xFF) << 16);
-			uint32 alphaTh1 = (m_TH1 & 0xFF) | ((m_TH1 & 0xFF) << 8) | ((m_TH1 & 0xFF) << 16);
-
-			for(unsigned int i = 0; i < 16; i++)
-			{
-				for(unsigned int j = 0; j < 16; j++)
-				{
-					float nY = pY[j];
-					float nCb = nBlockCb[pCbCrMap[j]];
-					float nCr = nBlockCr[pCbCrMap[j]];
-
-					float nR = nY + 1.402f * (nCr - 128);
-					float nG = nY - 0.34414f * (nCb - 128) - 0.71414f * (nCr - 128);
-					float nB = nY + 1.772f * (nCb - 128);
-
-					if(nR < 0)
-					{
-						nR = 0;
-					}
-					if(nR > 255)
-					{
-						nR = 255;
-					}
-					if(nG < 0)
-					{
-						nG = 0;
-					}
-					if(nG > 255)
-					{
-						nG = 255;
-					}
-					if(nB < 0)
-					{
-						nB = 0;
-					}
-					if(nB > 255)
-					{
-						nB = 255;
-					}
-
-					uint8 a = 0;
-					uint32 rgb = (static_cast<uint8>(nB) << 16) | (static_cast<uint8>(nG) << 8) | (static_cast<uint8>(nR) << 0);
-					if(rgb < alphaTh0)
-					{
-						a = 0;
-					}
-					else if(rgb < alphaTh1)
-					{
-						a = 0x40;
-					}
-					else
-					{
-						a = 0x80;
-					}
-
-					pPixel[j] = (a << 24) | rgb;
-				}
-
-				pY += 0x10;
-				pCbCrMap += 0x10;
-				pPixel += 0x10;
-			}
-
-			m_OUT_FIFO->Write(nPixel, sizeof(uint32) * 0x100);
+			uint32 pixels[PIXEL_COUNT];
+			ConvertBlock(m_block, pixels, m_TH0, m_TH1);
+			m_OUT_FIFO->Write(pixels, sizeof(uint32) * PIXEL_COUNT);
 
 			m_mbCount--;
 			m_state = STATE_FLUSHBLOCK;
@@ -1924,21 +1836,52 @@ bool CIPU::CCSCCommand::Execute()
 	}
 }
 
-void CIPU::CCSCCommand::GenerateCbCrMap()
+void CIPU::CCSCCommand::ConvertBlock(const uint8* block, uint32* pixels, uint16 TH0, uint16 TH1)
 {
-	unsigned int* pCbCrMap = m_nCbCrMap;
-	for(unsigned int i = 0; i < 0x40; i += 0x8)
+	const uint8* blockY = block;
+	const uint8* blockCb = block + 0x100;
+	const uint8* blockCr = block + 0x140;
+
+	uint32 alphaTh0 = (TH0 & 0xFF) | ((TH0 & 0xFF) << 8) | ((TH0 & 0xFF) << 16);
+	uint32 alphaTh1 = (TH1 & 0xFF) | ((TH1 & 0xFF) << 8) | ((TH1 & 0xFF) << 16);
+
+	//Pixels are converted a row at a time, chroma samples of the row are expanded first
+	for(unsigned int y = 0; y < 16; y++)
 	{
-		for(unsigned int j = 0; j < 0x10; j += 2)
+		//Chroma is subsampled in both directions
+		const uint8* rowCb = blockCb + ((y / 2) * 8);
+		const uint8* rowCr = blockCr + ((y / 2) * 8);
+
+		float cb[16];
+		float cr[16];
+		for(unsigned int x = 0; x < 16; x++)
+		{
+			cb[x] = static_cast<float>(rowCb[x / 2]) - 128;
+			cr[x] = static_cast<float>(rowCr[x / 2]) - 128;
+		}
+
+		for(unsigned int x = 0; x < 16; x++)
 		{
-			pCbCrMap[j + 0x00] = (j / 2) + i;
-			pCbCrMap[j + 0x01] = (j / 2) + i;
+			float nY = blockY[x];
+
+			float nR = nY + 1.402f * cr[x];
+			float nG = nY - 0.34414f * cb[x] - 0.71414f * cr[x];
+			float nB = nY + 1.772f * cb[x];
+
+			nR = std::min(std::max(nR, 0.0f), 255.0f);
+			nG = std::min(std::max(nG, 0.0f), 255.0f);
+			nB = std::min(std::max(nB, 0.0f), 255.0f);
+
+			uint32 rgb = (static_cast<uint32>(static_cast<int32>(nB)) << 16) |
+			             (static_cast<uint32>(static_cast<int32>(nG)) << 8) |
+			             (static_cast<uint32>(static_cast<int32>(nR)) << 0);
+			uint32 a = (rgb < alphaTh0) ? 0 : ((rgb < alphaTh1) ? 0x40 : 0x80);
 
-			pCbCrMap[j + 0x10] = (j / 2) + i;
-			pCbCrMap[j + 0x11] = (j / 2) + i;
+			pixels[x] = (a << 24) | rgb;
 		}
 
-		pCbCrMap += 0x20;
+		blockY += 0x10;
+		pixels += 0x10;
 	}
 }
 
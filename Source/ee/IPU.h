@@ -161,6 +161,7 @@ private:
 		bool TryPeekBits_MSBF(uint8, uint32&) override;
 
 		void SetBitPosition(unsigned int);
+		unsigned int ReadBytes(uint8*, unsigned int);
 		unsigned int GetSize() const;
 		unsigned int GetAvailableBits() const;
 		void Reset();
@@ -467,6 +468,11 @@ private:
 		bool Execute() override;
 
 	private:
+		enum
+		{
+			PIXEL_COUNT = 0x100,
+		};
+
 		enum STATE
 		{
 			STATE_READBLOCKSTART,
@@ -476,7 +482,7 @@ private:
 			STATE_DONE,
 		};
 
-		void GenerateCbCrMap();
+		static void ConvertBlock(const uint8*, uint32*, uint16, uint16);
 
 		STATE m_state = STATE_DONE;
 		CMD_CSC m_command = make_convertible<CMD_CSC>(0);
@@ -489,8 +495,6 @@ private:
 		unsigned int m_currentIndex = 0;
 		unsigned int m_mbCount = 0;
 
-		unsigned int m_nCbCrMap[0x100];
-
 		uint8 m_block[BLOCK_SIZE];
 	};
 
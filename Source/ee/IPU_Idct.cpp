@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "IPU_Idct.h"
+
+using namespace IPU;
+
+namespace
+{
+	struct COSINE_TABLE
+	{
+		COSINE_TABLE()
+		{
+			const double pi = 3.14159265358979323846;
+			for(unsigned int freq = 0; freq < 8; freq++)
+			{
+				double scale = (freq == 0) ? sqrt(0.125) : 0.5;
+				for(unsigned int time = 0; time < 8; time++)
+				{
+					values[freq][time] = scale * cos((pi / 8.0) * freq * (time + 0.5));
+				}
+			}
+		}
+
+		double values[8][8];
+	};
+
+	const COSINE_TABLE g_cosineTable;
+}
+
+void CIdct::Transform(int16* block)
+{
+	const auto& c = g_cosineTable.values;
+
+	//Empty rows only add zeros to the sums, leaving them out doesn't change any result
+	uint32 rowMask = 0;
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		int16 rowBits = 0;
+		for(unsigned int k = 0; k < 8; k++)
+		{
+			rowBits |= block[(i * 8) + k];
+		}
+		if(rowBits != 0) rowMask |= (1 << i);
+	}
+
+	if(rowMask == 0) return;
+
+	//Only the DC coefficient, every output has the same value
+	if((rowMask == 1) && (std::count(block + 1, block + 8, 0) == 7))
+	{
+		double value = c[0][0] * (c[0][0] * block[0]);
+		int16 result = static_cast<int16>(std::min(std::max(static_cast<int>(floor(value + 0.5)), -256), 255));
+		std::fill(block, block + 64, result);
+		return;
+	}
+
+	double temp[8][8];
+	memset(temp, 0, sizeof(temp));
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		if((rowMask & (1 << i)) == 0) continue;
+		double* row = temp[i];
+		for(unsigned int k = 0; k < 8; k++)
+		{
+			int16 coefficient = block[(i * 8) + k];
+			if(coefficient == 0) continue;
+			for(unsigned int j = 0; j < 8; j++)
+			{
+				row[j] += c[k][j] * coefficient;
+			}
+		}
+	}
+
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		double sums[8] = {};
+		for(unsigned int k = 0; k < 8; k++)
+		{
+			if((rowMask & (1 << k)) == 0) continue;
+			double cosine = c[k][i];
+			for(unsigned int j = 0; j < 8; j++)
+			{
+				sums[j] += cosine * temp[k][j];
+			}
+		}
+		int16* output = block + (i * 8);
+		for(unsigned int j = 0; j < 8; j++)
+		{
+			int value = static_cast<int>(floor(sums[j] + 0.5));
+			output[j] = static_cast<int16>(std::min(std::max(value, -256), 255));
+		}
+	}
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Types.h"
+
+namespace IPU
+{
+	//Separable form of the IEEE 1180 reference IDCT. Sums are accumulated in the same order as the
+	//reference, results are identical, but rows are processed as vectors of 8 doubles and rows
+	//without coefficients are skipped (most blocks only have a few coefficients).
+	class CIdct
+	{
+	public:
+		static void Transform(int16*);
+	};
+}
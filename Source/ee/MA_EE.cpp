@@ -44,6 +44,13 @@ CMA_EE::CMA_EE()
 	SetupReflectionTables();
 }
 
+std::unique_ptr<CMIPSArchitecture> CMA_EE::Clone() const
+{
+	auto result = std::make_unique<CMA_EE>();
+	result->SetInlineUnalignedAccesses(m_inlineUnalignedAccesses);
+	return result;
+}
+
 void CMA_EE::PushVector(unsigned int nReg)
 {
 	m_codeGen->MD_PushRel(offsetof(CMIPS, m_State.nGPR[nReg]));
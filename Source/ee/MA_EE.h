@@ -8,6 +8,8 @@ public:
 	CMA_EE();
 	virtual ~CMA_EE() = default;
 
+	std::unique_ptr<CMIPSArchitecture> Clone() const override;
+
 protected:
 	typedef void (CMA_EE::*InstructionFuncConstant)();
 
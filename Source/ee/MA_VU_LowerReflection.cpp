@@ -1305,5 +1305,18 @@ VUShared::OPERANDSET CMA_VU::CLower::GetAffectedOperands(CMIPS* context, uint32
 	instr.pGetAffectedOperands = SubTableAffectedOperands;
 	instr.subTable = &m_VuReflGeneralTable;
 	instr.pGetAffectedOperands(&instr, context, address, opcode, result);
+
+	//FSAND, FSOR, FMEQ, FMAND and FMOR read MAC flags (status flags are derived from them)
+	switch(opcode >> 25)
+	{
+	case 0x16:
+	case 0x17:
+	case 0x18:
+	case 0x1A:
+	case 0x1B:
+		result.readMACflags = true;
+		break;
+	}
+
 	return result;
 }
@@ -610,6 +610,22 @@ uint32 CMA_VU::CUpper::GetInstructionEffectiveAddress(CMIPS* pCtx, uint32 nAddre
 	return Instr.pGetEffectiveAddress(&Instr, pCtx, nAddress, nOpcode);
 }
 
+//MAX/MINI, conversions, ABS, CLIP and NOP are the only instructions that don't update MAC flags.
+//OPMULA is also left out since VUShared::OPMULA doesn't update them, this must match the generated code.
+static bool WritesMacFlags(uint32 opcode)
+{
+	static const uint64 writeMaskV = 0x77FF5F00FFFFULL;
+	static const uint32 writeMaskVX[4] = {0xCCF, 0xF4F, 0x7CF, 0x34F};
+
+	uint32 index = opcode & 0x3F;
+	if(index < 0x3C)
+	{
+		return ((writeMaskV >> index) & 1) != 0;
+	}
+	uint32 subIndex = (opcode >> 6) & 0x1F;
+	return ((writeMaskVX[index - 0x3C] >> subIndex) & 1) != 0;
+}
+
 VUShared::OPERANDSET CMA_VU::CUpper::GetAffectedOperands(CMIPS* context, uint32 address, uint32 opcode)
 {
 	OPERANDSET result;
@@ -619,5 +635,6 @@ VUShared::OPERANDSET CMA_VU::CUpper::GetAffectedOperands(CMIPS* context, uint32
 	instr.pGetAffectedOperands = SubTableAffectedOperands;
 	instr.subTable = &m_VuReflVTable;
 	instr.pGetAffectedOperands(&instr, context, address, opcode, result);
+	result.writeMACflags = WritesMacFlags(opcode);
 	return result;
 }
@@ -40,6 +40,9 @@ const VUShared::FLAG_PIPEINFO VUShared::g_pipeInfoClip =
 
 using namespace VUShared;
 
+//Blocks can be compiled on more than one thread
+static thread_local bool g_macFlagPipelineEnabled = true;
+
 bool VUShared::DestinationHasElement(uint8 nDest, unsigned int nElement)
 {
 	return (nDest & (1 << (nElement ^ 0x03))) != 0;
@@ -182,7 +185,19 @@ void VUShared::TestSZFlags(CMipsJitter* codeGen, uint8 dest, size_t regOffset, u
 	codeGen->Or();
 	codeGen->PullRel(offsetof(CMIPS, m_State.nCOP2SF));
 
-	QueueInFlagPipeline(g_pipeInfoMac, codeGen, LATENCY_MAC, relativePipeTime);
+	if(g_macFlagPipelineEnabled)
+	{
+		QueueInFlagPipeline(g_pipeInfoMac, codeGen, LATENCY_MAC, relativePipeTime);
+	}
+	else
+	{
+		codeGen->PullTop();
+	}
+}
+
+void VUShared::SetMacFlagPipelineEnabled(bool enabled)
+{
+	g_macFlagPipelineEnabled = enabled;
 }
 
 void VUShared::GetStatus(CMipsJitter* codeGen, size_t dstOffset, uint32 relativePipeTime)
@@ -54,6 +54,8 @@ namespace VUShared
 		bool readQ;
 		bool syncP;
 		bool readP;
+		bool readMACflags;
+		bool writeMACflags;
 
 		//When set, means that a branch following the instruction will be
 		//able to use the integer value directly
@@ -95,6 +97,10 @@ namespace VUShared
 	void ClampVector(CMipsJitter*);
 	void TestSZFlags(CMipsJitter*, uint8, size_t, uint32);
 
+	//Lets block compilers skip MAC flag pipeline updates that no instruction will observe.
+	//Sticky flags are always updated.
+	void SetMacFlagPipelineEnabled(bool);
+
 	void GetStatus(CMipsJitter*, size_t, uint32);
 	void SetStatus(CMipsJitter*, size_t);
 
@@ -9,6 +9,7 @@
 #include "../states/MemoryStateFile.h"
 #include "Vpu.h"
 #include "Vif.h"
+#include "VifUnpack.h"
 #include "INTC.h"
 
 #define LOG_NAME ("ee_vif")
@@ -636,101 +637,46 @@ void CVif::Cmd_UNPACK(StreamType& stream, CODE nCommand, uint32 nDstAddr)
 	assert(nDstAddr < vuMemSize);
 	nDstAddr &= (vuMemSize - 1);
 
-	while(currentNum != 0)
-	{
-		bool mustWrite = false;
-		uint128 writeValue;
-		memset(&writeValue, 0, sizeof(writeValue));
-
-		if(cl >= wl)
+	uint32 format = nCommand.nCMD & 0x0F;
+	auto kernel = VifUnpack::GetKernel(format, useMask, m_MODE, usn, cl, wl);
+	if(kernel)
+	{
+		VifUnpack::STATE state;
+		state.cl = cl;
+		state.wl = wl;
+		state.mask = m_MASK;
+		state.readTick = m_readTick;
+		state.writeTick = m_writeTick;
+		memcpy(state.row, m_R, sizeof(m_R));
+		memcpy(state.col, m_C, sizeof(m_C));
+
+		uint32 elementSize = VifUnpack::GetElementSize(format);
+		uint32 readCount = std::min<uint32>(VifUnpack::GetReadCount(state, currentNum), stream.GetAvailableReadBytes() / elementSize);
+		uint32 readSize = readCount * elementSize;
+
+		//Decode straight from source memory when possible, copy otherwise
+		const uint8* src = nullptr;
+		alignas(16) uint8 readBuffer[VifUnpack::MAX_READ_SIZE];
+		if(stream.HasDirectPointer())
 		{
-			if(m_readTick < wl)
-			{
-				bool success = Unpack_ReadValue(nCommand, stream, writeValue, usn);
-				if(!success) break;
-				mustWrite = true;
-			}
+			src = stream.GetDirectPointer();
+			stream.Read(nullptr, readSize);
 		}
 		else
 		{
-			if(m_writeTick < cl)
-			{
-				bool success = Unpack_ReadValue(nCommand, stream, writeValue, usn);
-				if(!success) break;
-			}
-
-			mustWrite = true;
-		}
-
-		if(mustWrite)
-		{
-			auto dst = reinterpret_cast<uint128*>(vuMem + nDstAddr);
-
-			for(unsigned int i = 0; i < 4; i++)
-			{
-				uint32 maskOp = useMask ? GetMaskOp(i, m_writeTick) : MASK_DATA;
-
-				if(maskOp == MASK_DATA)
-				{
-					if(m_MODE == MODE_OFFSET)
-					{
-						writeValue.nV[i] += m_R[i];
-					}
-					else if(m_MODE == MODE_DIFFERENCE)
-					{
-						writeValue.nV[i] += m_R[i];
-						m_R[i] = writeValue.nV[i];
-					}
-
-					dst->nV[i] = writeValue.nV[i];
-				}
-				else if(maskOp == MASK_ROW)
-				{
-					dst->nV[i] = m_R[i];
-				}
-				else if(maskOp == MASK_COL)
-				{
-					int index = (m_writeTick > 3) ? 3 : m_writeTick;
-					dst->nV[i] = m_C[index];
-				}
-				else if(maskOp == MASK_MASK)
-				{
-					//Don't write anything
-				}
-				else
-				{
-					assert(0);
-				}
-			}
-
-			currentNum--;
-		}
-
-		if(cl >= wl)
-		{
-			m_writeTick = std::min<uint32>(m_writeTick + 1, wl);
-			m_readTick = std::min<uint32>(m_readTick + 1, cl);
-
-			if(m_readTick == cl)
-			{
-				m_writeTick = 0;
-				m_readTick = 0;
-			}
+			stream.Read(readBuffer, readSize);
+			src = readBuffer;
 		}
-		else
-		{
-			m_writeTick = std::min<uint32>(m_writeTick + 1, wl);
-			m_readTick = std::min<uint32>(m_readTick + 1, cl);
 
-			if(m_writeTick == wl)
-			{
-				m_writeTick = 0;
-				m_readTick = 0;
-			}
-		}
+		currentNum = kernel(state, src, readCount, vuMem, nDstAddr, vuMemSize - 1, currentNum);
 
-		nDstAddr += 0x10;
-		nDstAddr &= (vuMemSize - 1);
+		memcpy(m_R, state.row, sizeof(m_R));
+		m_readTick = state.readTick;
+		m_writeTick = state.writeTick;
+	}
+	else
+	{
+		assert(false);
 	}
 
 	if(currentNum != 0)
@@ -746,193 +692,6 @@ void CVif::Cmd_UNPACK(StreamType& stream, CODE nCommand, uint32 nDstAddr)
 	m_NUM = static_cast<uint8>(currentNum);
 }
 
-bool CVif::Unpack_ReadValue(const CODE& nCommand, StreamType& stream, uint128& writeValue, bool usn)
-{
-	bool success = false;
-	switch(nCommand.nCMD & 0x0F)
-	{
-	case 0x00:
-		//S-32
-		success = Unpack_S32(stream, writeValue);
-		break;
-	case 0x01:
-		//S-16
-		success = Unpack_S16(stream, writeValue, usn);
-		break;
-	case 0x02:
-		//S-8
-		success = Unpack_S8(stream, writeValue, usn);
-		break;
-	case 0x04:
-		//V2-32
-		success = Unpack_V32(stream, writeValue, 2);
-		break;
-	case 0x05:
-		//V2-16
-		success = Unpack_V16(stream, writeValue, 2, usn);
-		break;
-	case 0x06:
-		//V2-8
-		success = Unpack_V8(stream, writeValue, 2, usn);
-		break;
-	case 0x08:
-		//V3-32
-		success = Unpack_V32(stream, writeValue, 3);
-		break;
-	case 0x09:
-		//V3-16
-		success = Unpack_V16(stream, writeValue, 3, usn);
-		break;
-	case 0x0A:
-		//V3-8
-		success = Unpack_V8(stream, writeValue, 3, usn);
-		break;
-	case 0x0C:
-		//V4-32
-		success = Unpack_V32(stream, writeValue, 4);
-		break;
-	case 0x0D:
-		//V4-16
-		success = Unpack_V16(stream, writeValue, 4, usn);
-		break;
-	case 0x0E:
-		//V4-8
-		success = Unpack_V8(stream, writeValue, 4, usn);
-		break;
-	case 0x0F:
-		//V4-5
-		success = Unpack_V45(stream, writeValue);
-		break;
-	default:
-		assert(0);
-		break;
-	}
-	return success;
-}
-
-bool CVif::Unpack_S32(StreamType& stream, uint128& result)
-{
-	if(stream.GetAvailableReadBytes() < 4) return false;
-
-	uint32 word = 0;
-	stream.Read(&word, 4);
-
-	for(unsigned int i = 0; i < 4; i++)
-	{
-		result.nV[i] = word;
-	}
-
-	return true;
-}
-
-bool CVif::Unpack_S16(StreamType& stream, uint128& result, bool zeroExtend)
-{
-	if(stream.GetAvailableReadBytes() < 2) return false;
-
-	uint32 temp = 0;
-	stream.Read(&temp, 2);
-	if(!zeroExtend)
-	{
-		temp = static_cast<int16>(temp);
-	}
-
-	for(unsigned int i = 0; i < 4; i++)
-	{
-		result.nV[i] = temp;
-	}
-
-	return true;
-}
-
-bool CVif::Unpack_S8(StreamType& stream, uint128& result, bool zeroExtend)
-{
-	if(stream.GetAvailableReadBytes() < 1) return false;
-
-	uint32 temp = 0;
-	stream.Read(&temp, 1);
-	if(!zeroExtend)
-	{
-		temp = static_cast<int8>(temp);
-	}
-
-	for(unsigned int i = 0; i < 4; i++)
-	{
-		result.nV[i] = temp;
-	}
-
-	return true;
-}
-
-bool CVif::Unpack_V8(StreamType& stream, uint128& result, unsigned int fields, bool zeroExtend)
-{
-	if(stream.GetAvailableReadBytes() < (fields)) return false;
-
-	for(unsigned int i = 0; i < fields; i++)
-	{
-		uint32 temp = 0;
-		stream.Read(&temp, 1);
-		if(!zeroExtend)
-		{
-			temp = static_cast<int8>(temp);
-		}
-
-		result.nV[i] = temp;
-	}
-
-	return true;
-}
-
-bool CVif::Unpack_V16(StreamType& stream, uint128& result, unsigned int fields, bool zeroExtend)
-{
-	if(stream.GetAvailableReadBytes() < (fields * 2)) return false;
-
-	for(unsigned int i = 0; i < fields; i++)
-	{
-		uint32 temp = 0;
-		stream.Read(&temp, 2);
-		if(!zeroExtend)
-		{
-			temp = static_cast<int16>(temp);
-		}
-
-		result.nV[i] = temp;
-	}
-
-	return true;
-}
-
-bool CVif::Unpack_V32(StreamType& stream, uint128& result, unsigned int fields)
-{
-	if(stream.GetAvailableReadBytes() < (fields * 4)) return false;
-
-	stream.Read(&result, (fields * 4));
-
-	return true;
-}
-
-bool CVif::Unpack_V45(StreamType& stream, uint128& result)
-{
-	if(stream.GetAvailableReadBytes() < 2) return false;
-
-	uint16 nColor = 0;
-	stream.Read(&nColor, 2);
-
-	result.nV0 = ((nColor >> 0) & 0x1F) << 3;
-	result.nV1 = ((nColor >> 5) & 0x1F) << 3;
-	result.nV2 = ((nColor >> 10) & 0x1F) << 3;
-	result.nV3 = ((nColor >> 15) & 0x01) << 7;
-
-	return true;
-}
-
-uint32 CVif::GetMaskOp(unsigned int row, unsigned int col) const
-{
-	if(col > 3) col = 3;
-	assert(row < 4);
-	unsigned int index = (col * 4) + row;
-	return (m_MASK >> (index * 2)) & 0x03;
-}
-
 void CVif::PrepareMicroProgram()
 {
 	m_ITOP = m_ITOPS;
@@ -1255,6 +1014,15 @@ void CVif::CFifoStream::Align32()
 	assert((m_bufferPosition & 0x03) == 0);
 }
 
+//Remaining bytes are contiguous in source memory, unless a tag still needs to be
+//skipped or the buffer holds data left over from a previous transfer
+bool CVif::CFifoStream::HasDirectPointer() const
+{
+	if(m_tagIncluded) return false;
+	if(m_bufferPosition == BUFFERSIZE) return true;
+	return (m_nextAddress - m_startAddress) >= 0x10;
+}
+
 uint8* CVif::CFifoStream::GetDirectPointer() const
 {
 	assert(!m_tagIncluded);
@@ -107,6 +107,7 @@ protected:
 		void SetDmaParams(uint32, uint32, bool);
 		void SetFifoParams(uint8*, uint32);
 
+		bool HasDirectPointer() const;
 		uint8* GetDirectPointer() const;
 		void Advance(uint32);
 
@@ -169,21 +170,6 @@ protected:
 	};
 	static_assert(sizeof(CODE) == sizeof(uint32), "Size of CODE struct must be 4 bytes.");
 
-	enum ADDMODE
-	{
-		MODE_NORMAL = 0,
-		MODE_OFFSET = 1,
-		MODE_DIFFERENCE = 2
-	};
-
-	enum MASKOP
-	{
-		MASK_DATA = 0,
-		MASK_ROW = 1,
-		MASK_COL = 2,
-		MASK_MASK = 3
-	};
-
 	void ProcessFifoWrite(uint32, uint32);
 
 	void ProcessPacket(StreamType&);
@@ -195,17 +181,6 @@ protected:
 	void Cmd_STCOL(StreamType&, CODE);
 	void Cmd_STMASK(StreamType&, CODE);
 
-	bool Unpack_ReadValue(const CODE&, StreamType&, uint128&, bool);
-	bool Unpack_S32(StreamType&, uint128&);
-	bool Unpack_S16(StreamType&, uint128&, bool);
-	bool Unpack_S8(StreamType&, uint128&, bool);
-	bool Unpack_V16(StreamType&, uint128&, unsigned int, bool);
-	bool Unpack_V8(StreamType&, uint128&, unsigned int, bool);
-	bool Unpack_V32(StreamType&, uint128&, unsigned int);
-	bool Unpack_V45(StreamType&, uint128&);
-
-	uint32 GetMaskOp(unsigned int, unsigned int) const;
-
 	virtual void PrepareMicroProgram();
 	void StartMicroProgram(uint32);
 #ifdef DELAYED_MSCAL
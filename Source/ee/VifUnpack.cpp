@@ -0,0 +1,334 @@
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <array>
+#include <utility>
+#include "VifUnpack.h"
+
+using namespace VifUnpack;
+
+namespace
+{
+	constexpr bool IsValidFormat(uint32 format)
+	{
+		return ((format & 0x03) != 0x03) || (format == FORMAT_V4_5);
+	}
+
+	//Formats are encoded as (VN << 2) | VL, VN being the field count minus one
+	template <uint32 format>
+	struct FORMAT_TRAITS
+	{
+		enum : uint32
+		{
+			FIELD_COUNT = (format >> 2) + 1,
+			FIELD_SIZE = 4 >> (format & 0x03),
+			ELEMENT_SIZE = (format == FORMAT_V4_5) ? 2 : (FIELD_COUNT * FIELD_SIZE),
+		};
+	};
+
+	template <uint32 fieldSize, bool usn>
+	struct FIELD_TYPE;
+
+	template <bool usn>
+	struct FIELD_TYPE<4, usn>
+	{
+		typedef uint32 Type;
+	};
+
+	template <>
+	struct FIELD_TYPE<2, false>
+	{
+		typedef int16 Type;
+	};
+
+	template <>
+	struct FIELD_TYPE<2, true>
+	{
+		typedef uint16 Type;
+	};
+
+	template <>
+	struct FIELD_TYPE<1, false>
+	{
+		typedef int8 Type;
+	};
+
+	template <>
+	struct FIELD_TYPE<1, true>
+	{
+		typedef uint8 Type;
+	};
+
+	template <uint32 format, bool usn>
+	struct ELEMENT_DECODER
+	{
+		typedef FORMAT_TRAITS<format> Traits;
+		typedef typename FIELD_TYPE<Traits::FIELD_SIZE, usn>::Type FieldType;
+
+		//S formats are broadcast to all lanes and fields missing from V2 and V3 formats are cleared
+		static uint32 DecodeLane(const uint8* src, uint32 lane)
+		{
+			uint32 fieldIndex = (Traits::FIELD_COUNT == 1) ? 0 : lane;
+			if(fieldIndex >= Traits::FIELD_COUNT) return 0;
+			FieldType field = 0;
+			memcpy(&field, src + (fieldIndex * sizeof(FieldType)), sizeof(FieldType));
+			return static_cast<int32>(field);
+		}
+
+		//All lanes are decoded, writers always work on whole quadwords
+		static void Decode(const uint8* src, uint32* value)
+		{
+			value[0] = DecodeLane(src, 0);
+			value[1] = DecodeLane(src, 1);
+			value[2] = DecodeLane(src, 2);
+			value[3] = DecodeLane(src, 3);
+		}
+	};
+
+	template <bool usn>
+	struct ELEMENT_DECODER<FORMAT_V4_5, usn>
+	{
+		static void Decode(const uint8* src, uint32* value)
+		{
+			uint16 color = 0;
+			memcpy(&color, src, 2);
+			value[0] = ((color >> 0) & 0x1F) << 3;
+			value[1] = ((color >> 5) & 0x1F) << 3;
+			value[2] = ((color >> 10) & 0x1F) << 3;
+			value[3] = ((color >> 15) & 0x01) << 7;
+		}
+	};
+
+	//Keeps ROW and COL registers out of VU memory's way and expands the mask register
+	//into lane selectors once per transfer
+	template <bool useMask, uint32 mode>
+	class CVectorWriter
+	{
+	public:
+		CVectorWriter(const STATE& state)
+		{
+			memcpy(m_row, state.row, sizeof(m_row));
+			memcpy(m_col, state.col, sizeof(m_col));
+			if(!useMask) return;
+			for(uint32 column = 0; column < 4; column++)
+			{
+				for(uint32 lane = 0; lane < 4; lane++)
+				{
+					uint32 maskOp = (state.mask >> (((column * 4) + lane) * 2)) & 0x03;
+					m_dataSelect[column][lane] = (maskOp == MASK_DATA) ? ~0U : 0;
+					m_rowSelect[column][lane] = (maskOp == MASK_ROW) ? ~0U : 0;
+					m_colSelect[column][lane] = (maskOp == MASK_COL) ? ~0U : 0;
+					m_keepSelect[column][lane] = (maskOp == MASK_MASK) ? ~0U : 0;
+				}
+			}
+		}
+
+		void Write(uint32* dst, const uint32* value, uint32 writeTick)
+		{
+			uint32 column = std::min<uint32>(writeTick, 3);
+			for(uint32 i = 0; i < 4; i++)
+			{
+				uint32 data = (mode == MODE_NORMAL) ? value[i] : (value[i] + m_row[i]);
+				if(!useMask)
+				{
+					if(mode == MODE_DIFFERENCE) m_row[i] = data;
+					dst[i] = data;
+					continue;
+				}
+				uint32 dataSelect = m_dataSelect[column][i];
+				if(mode == MODE_DIFFERENCE)
+				{
+					m_row[i] = (data & dataSelect) | (m_row[i] & ~dataSelect);
+				}
+				dst[i] = (data & dataSelect) | (m_row[i] & m_rowSelect[column][i]) |
+				         (m_col[column] & m_colSelect[column][i]) | (dst[i] & m_keepSelect[column][i]);
+			}
+		}
+
+		void Store(STATE& state) const
+		{
+			memcpy(state.row, m_row, sizeof(m_row));
+		}
+
+	private:
+		uint32 m_row[4];
+		uint32 m_col[4];
+		uint32 m_dataSelect[4][4];
+		uint32 m_rowSelect[4][4];
+		uint32 m_colSelect[4][4];
+		uint32 m_keepSelect[4][4];
+	};
+
+	template <uint32 format, bool useMask, uint32 mode, bool usn, uint32 cycle>
+	uint32 Unpack(STATE& state, const uint8* src, uint32 srcCount, uint8* dst, uint32 dstAddr, uint32 dstMask, uint32 num)
+	{
+		typedef FORMAT_TRAITS<format> Traits;
+		typedef ELEMENT_DECODER<format, usn> Decoder;
+		CVectorWriter<useMask, mode> writer(state);
+
+		if(cycle == CYCLE_REGULAR)
+		{
+			//Every quadword consumes an element, ticks only matter for mask columns
+			uint32 count = std::min(num, srcCount);
+			uint32 tick = state.writeTick;
+			for(uint32 i = 0; i < count; i++)
+			{
+				uint32 value[4];
+				Decoder::Decode(src, value);
+				writer.Write(reinterpret_cast<uint32*>(dst + dstAddr), value, tick);
+				src += Traits::ELEMENT_SIZE;
+				dstAddr = (dstAddr + 0x10) & dstMask;
+				tick++;
+				if(tick == state.cl) tick = 0;
+			}
+			writer.Store(state);
+			state.readTick = tick;
+			state.writeTick = tick;
+			return num - count;
+		}
+
+		while(num != 0)
+		{
+			bool mustRead = (cycle == CYCLE_SKIPPING) ? (state.readTick < state.wl) : (state.writeTick < state.cl);
+			bool mustWrite = (cycle == CYCLE_SKIPPING) ? mustRead : true;
+			uint32 value[4] = {0, 0, 0, 0};
+
+			if(mustRead)
+			{
+				if(srcCount == 0) break;
+				Decoder::Decode(src, value);
+				src += Traits::ELEMENT_SIZE;
+				srcCount--;
+			}
+
+			if(mustWrite)
+			{
+				writer.Write(reinterpret_cast<uint32*>(dst + dstAddr), value, state.writeTick);
+				num--;
+			}
+
+			state.writeTick = std::min<uint32>(state.writeTick + 1, state.wl);
+			state.readTick = std::min<uint32>(state.readTick + 1, state.cl);
+
+			bool cycleDone = (cycle == CYCLE_SKIPPING) ? (state.readTick == state.cl) : (state.writeTick == state.wl);
+			if(cycleDone)
+			{
+				state.writeTick = 0;
+				state.readTick = 0;
+			}
+
+			dstAddr = (dstAddr + 0x10) & dstMask;
+		}
+
+		writer.Store(state);
+		return num;
+	}
+
+	enum
+	{
+		KERNEL_COUNT = FORMAT_COUNT * 2 * MODE_COUNT * 2 * CYCLE_KIND_COUNT,
+	};
+
+	constexpr uint32 GetKernelIndex(uint32 format, bool usn, uint32 mode, bool useMask, uint32 cycle)
+	{
+		return ((((((cycle * 2) + (useMask ? 1 : 0)) * MODE_COUNT) + mode) * 2 + (usn ? 1 : 0)) * FORMAT_COUNT) + format;
+	}
+
+	template <uint32 index, bool valid = IsValidFormat(index % FORMAT_COUNT)>
+	struct KERNEL_ENTRY
+	{
+		enum : uint32
+		{
+			FORMAT = index % FORMAT_COUNT,
+			USN = (index / FORMAT_COUNT) % 2,
+			MODE = (index / (FORMAT_COUNT * 2)) % MODE_COUNT,
+			USE_MASK = (index / (FORMAT_COUNT * 2 * MODE_COUNT)) % 2,
+			CYCLE = index / (FORMAT_COUNT * 2 * MODE_COUNT * 2),
+		};
+
+		static KernelFunction Get()
+		{
+			//Sign extension doesn't apply to 32-bit fields and V4-5, share kernels
+			const bool usn = USN && (FORMAT_TRAITS<FORMAT>::FIELD_SIZE != 4) && (FORMAT != static_cast<uint32>(FORMAT_V4_5));
+			return &Unpack<FORMAT, USE_MASK != 0, MODE, usn, CYCLE>;
+		}
+	};
+
+	template <uint32 index>
+	struct KERNEL_ENTRY<index, false>
+	{
+		static KernelFunction Get()
+		{
+			return nullptr;
+		}
+	};
+
+	typedef std::array<KernelFunction, KERNEL_COUNT> KernelTable;
+
+	template <uint32... indices>
+	KernelTable MakeKernelTable(std::integer_sequence<uint32, indices...>)
+	{
+		return {{KERNEL_ENTRY<indices>::Get()...}};
+	}
+
+	const KernelTable g_kernels = MakeKernelTable(std::make_integer_sequence<uint32, KERNEL_COUNT>());
+}
+
+KernelFunction VifUnpack::GetKernel(uint32 format, bool useMask, uint32 mode, bool usn, uint32 cl, uint32 wl)
+{
+	assert(format < FORMAT_COUNT);
+	//Mode 3 is undefined, behaves as if no addition was done
+	if(mode >= MODE_COUNT) mode = MODE_NORMAL;
+	uint32 cycle = (cl == wl) ? CYCLE_REGULAR : ((cl > wl) ? CYCLE_SKIPPING : CYCLE_FILLING);
+	return g_kernels[GetKernelIndex(format & (FORMAT_COUNT - 1), usn, mode, useMask, cycle)];
+}
+
+uint32 VifUnpack::GetElementSize(uint32 format)
+{
+	switch(format)
+	{
+	case FORMAT_S32:
+	case FORMAT_V2_16:
+	case FORMAT_V4_8:
+		return 4;
+	case FORMAT_S16:
+	case FORMAT_V2_8:
+	case FORMAT_V4_5:
+		return 2;
+	case FORMAT_S8:
+		return 1;
+	case FORMAT_V2_32:
+	case FORMAT_V4_16:
+		return 8;
+	case FORMAT_V3_32:
+		return 12;
+	case FORMAT_V3_16:
+		return 6;
+	case FORMAT_V3_8:
+		return 3;
+	case FORMAT_V4_32:
+		return 16;
+	default:
+		assert(false);
+		return 0;
+	}
+}
+
+uint32 VifUnpack::GetReadCount(const STATE& state, uint32 num)
+{
+	if(state.cl >= state.wl)
+	{
+		return num;
+	}
+
+	//Filling writes, only the first CL quadwords of each cycle are read
+	uint32 readCount = 0;
+	uint32 writeTick = state.writeTick;
+	for(uint32 i = 0; i < num; i++)
+	{
+		if(writeTick < state.cl) readCount++;
+		writeTick = std::min<uint32>(writeTick + 1, state.wl);
+		if(writeTick == state.wl) writeTick = 0;
+	}
+	return readCount;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Types.h"
+
+//Specialized UNPACK routines, one per format, mask, addition mode and write cycle combination.
+//Routines work on a span of packed elements and write decoded quadwords to VU memory.
+namespace VifUnpack
+{
+	enum FORMAT
+	{
+		FORMAT_S32 = 0x00,
+		FORMAT_S16 = 0x01,
+		FORMAT_S8 = 0x02,
+		FORMAT_V2_32 = 0x04,
+		FORMAT_V2_16 = 0x05,
+		FORMAT_V2_8 = 0x06,
+		FORMAT_V3_32 = 0x08,
+		FORMAT_V3_16 = 0x09,
+		FORMAT_V3_8 = 0x0A,
+		FORMAT_V4_32 = 0x0C,
+		FORMAT_V4_16 = 0x0D,
+		FORMAT_V4_8 = 0x0E,
+		FORMAT_V4_5 = 0x0F,
+		FORMAT_COUNT = 0x10,
+	};
+
+	enum ADDMODE
+	{
+		MODE_NORMAL = 0,
+		MODE_OFFSET = 1,
+		MODE_DIFFERENCE = 2,
+		MODE_COUNT = 3,
+	};
+
+	enum MASKOP
+	{
+		MASK_DATA = 0,
+		MASK_ROW = 1,
+		MASK_COL = 2,
+		MASK_MASK = 3
+	};
+
+	enum CYCLE_KIND
+	{
+		CYCLE_REGULAR, //CL == WL
+		CYCLE_SKIPPING, //CL > WL
+		CYCLE_FILLING, //CL < WL
+		CYCLE_KIND_COUNT,
+	};
+
+	enum
+	{
+		MAX_ELEMENT_SIZE = 0x10,
+		MAX_NUM = 0x100,
+		MAX_READ_SIZE = MAX_ELEMENT_SIZE * MAX_NUM,
+	};
+
+	struct STATE
+	{
+		uint32 cl = 1;
+		uint32 wl = 1;
+		uint32 mask = 0;
+		uint32 row[4] = {};
+		uint32 col[4] = {};
+		uint32 readTick = 0;
+		uint32 writeTick = 0;
+	};
+
+	//Returns the number of quadwords that are left to write when source elements run out
+	typedef uint32 (*KernelFunction)(STATE&, const uint8* src, uint32 srcCount, uint8* dst, uint32 dstAddr, uint32 dstMask, uint32 num);
+
+	KernelFunction GetKernel(uint32 format, bool useMask, uint32 mode, bool usn, uint32 cl, uint32 wl);
+	uint32 GetElementSize(uint32 format);
+
+	//Number of elements read from the stream while writing 'num' quadwords
+	uint32 GetReadCount(const STATE&, uint32 num);
+}
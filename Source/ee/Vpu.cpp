@@ -7,6 +7,7 @@
 #include "Vif1.h"
 #include "GIF.h"
 #include "Vpu.h"
+#include "VuBasicBlock.h"
 
 #define LOG_NAME ("ee_vpu")
 
@@ -30,6 +31,7 @@ CVpu::CVpu(unsigned int number, const VPUINIT& vpuInit, CGIF& gif, CINTC& intc,
 
 CVpu::~CVpu()
 {
+	SetThreaded(false);
 #ifdef DEBUGGER_INCLUDED
 	delete[] m_microMemMiniState;
 	delete[] m_vuMemMiniState;
@@ -38,18 +40,35 @@ CVpu::~CVpu()
 
 void CVpu::Execute(int32 quota)
 {
+	//When threaded, the VU thread advances on its own
+	if(m_threaded)
+	{
+		if(m_pendingXgKickAddress != INVALID_XGKICK_ADDRESS)
+		{
+			std::lock_guard<std::recursive_mutex> lock(m_threadMutex);
+			ProcessPendingXgKick();
+		}
+		return;
+	}
 	if(!m_running) return;
 
 #ifdef PROFILE
 	CProfilerZone profilerZone(m_vuProfilerZone);
 #endif
 
+	ExecuteImpl(quota);
+}
+
+void CVpu::ExecuteImpl(int32 quota)
+{
+	if(!m_running) return;
+
 	m_ctx->m_executor->Execute(quota);
 	if(m_ctx->m_State.nHasException)
 	{
 		//E bit encountered
 		m_running = false;
-		VuStateChanged(m_running);
+		VuStateChanged(false);
 	}
 }
 
@@ -93,11 +112,38 @@ uint32 CVpu::GetVuItopMiniState() const
 
 void CVpu::Reset()
 {
+	CThreadLock threadLock(*this);
 	m_running = false;
 	m_ctx->m_executor->Reset();
 	m_vif->Reset();
 }
 
+void CVpu::SetThreaded(bool threaded)
+{
+	if(m_threaded == threaded) return;
+	if(threaded)
+	{
+		m_threadDone = false;
+		m_threaded = true;
+		m_thread = std::thread([this]() { ThreadProc(); });
+	}
+	else
+	{
+		{
+			std::lock_guard<std::recursive_mutex> lock(m_threadMutex);
+			m_threadDone = true;
+		}
+		m_threadCondition.notify_all();
+		m_thread.join();
+		m_threaded = false;
+	}
+}
+
+bool CVpu::IsThreaded() const
+{
+	return m_threaded;
+}
+
 void CVpu::SaveState(Framework::CZipArchiveWriter& archive)
 {
 	m_vif->SaveState(archive);
@@ -142,6 +188,8 @@ void CVpu::ExecuteMicroProgram(uint32 nAddress)
 {
 	CLog::GetInstance().Print(LOG_NAME, "Starting microprogram execution at 0x%08X.\r\n", nAddress);
 
+	CThreadLock threadLock(*this);
+
 	m_ctx->m_State.nPC = nAddress;
 	m_ctx->m_State.pipeTime = 0;
 	m_ctx->m_State.nHasException = 0;
@@ -152,21 +200,30 @@ void CVpu::ExecuteMicroProgram(uint32 nAddress)
 
 	assert(!m_running);
 	m_running = true;
-	VuStateChanged(m_running);
+	VuStateChanged(true);
+	if(m_threaded)
+	{
+		//VU thread will pick it up as soon as the lock is released
+		return;
+	}
 	for(unsigned int i = 0; i < 100; i++)
 	{
-		Execute(5000);
+		Execute(EXECUTE_SLICE_QUOTA);
 		if(!m_running) break;
 	}
 }
 
 void CVpu::InvalidateMicroProgram()
 {
+	CThreadLock threadLock(*this);
 	m_ctx->m_executor->ClearActiveBlocksInRange(0, (m_number == 0) ? PS2::MICROMEM0SIZE : PS2::MICROMEM1SIZE, false);
 }
 
 void CVpu::InvalidateMicroProgram(uint32 start, uint32 end)
 {
+	//Blocks look at the code that follows them, those ending right before the range are affected too
+	start = (start > CVuBasicBlock::LOOKAHEAD_SIZE) ? (start - CVuBasicBlock::LOOKAHEAD_SIZE) : 0;
+	CThreadLock threadLock(*this);
 	m_ctx->m_executor->ClearActiveBlocksInRange(start, end, false);
 }
 
@@ -175,6 +232,21 @@ void CVpu::ProcessXgKick(uint32 address)
 	address &= 0x3FF;
 	address *= 0x10;
 
+	if(m_threaded && (std::this_thread::get_id() == m_thread.get_id()))
+	{
+		//Wait for the emulator thread to send the packet, the mutex is released while waiting
+		if(m_threadDone) return;
+		m_pendingXgKickAddress = address;
+		m_threadCondition.notify_all();
+		m_threadCondition.wait(m_threadMutex, [&]() { return m_threadDone || (m_pendingXgKickAddress == INVALID_XGKICK_ADDRESS); });
+		return;
+	}
+
+	ProcessXgKickImpl(address);
+}
+
+void CVpu::ProcessXgKickImpl(uint32 address)
+{
 	//	assert(nAddress < PS2::VUMEM1SIZE);
 
 	CGsPacketMetadata metadata;
@@ -194,3 +266,53 @@ void CVpu::ProcessXgKick(uint32 address)
 	SaveMiniState();
 #endif
 }
+
+void CVpu::ProcessPendingXgKick()
+{
+	uint32 address = m_pendingXgKickAddress;
+	if(address == INVALID_XGKICK_ADDRESS) return;
+	ProcessXgKickImpl(address);
+	m_pendingXgKickAddress = INVALID_XGKICK_ADDRESS;
+	m_threadCondition.notify_all();
+}
+
+void CVpu::ThreadProc()
+{
+	std::unique_lock<std::recursive_mutex> lock(m_threadMutex);
+	while(1)
+	{
+		m_threadCondition.wait(lock, [&]() { return m_threadDone || (m_running && (m_threadLockCount == 0)); });
+		if(m_threadDone) break;
+		m_threadSliceActive = true;
+		ExecuteImpl(EXECUTE_SLICE_QUOTA);
+		m_threadSliceActive = false;
+		m_threadCondition.notify_all();
+	}
+}
+
+CVpu::CThreadLock::CThreadLock(CVpu& vpu)
+    : m_vpu(vpu)
+{
+	if(!m_vpu.m_threaded) return;
+	//Raising the count first makes the VU thread yield between two execution slices
+	m_vpu.m_threadLockCount++;
+	m_vpu.m_threadMutex.lock();
+	m_locked = true;
+	//Only way to get the mutex in the middle of a slice is the VU thread waiting on an XGKICK,
+	//send the packet and let it run until the end of its slice
+	while(m_vpu.m_threadSliceActive)
+	{
+		m_vpu.ProcessPendingXgKick();
+		m_vpu.m_threadCondition.wait(m_vpu.m_threadMutex, [&]() {
+			return !m_vpu.m_threadSliceActive || (m_vpu.m_pendingXgKickAddress != INVALID_XGKICK_ADDRESS);
+		});
+	}
+}
+
+CVpu::CThreadLock::~CThreadLock()
+{
+	if(!m_locked) return;
+	m_vpu.m_threadMutex.unlock();
+	m_vpu.m_threadLockCount--;
+	m_vpu.m_threadCondition.notify_all();
+}
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include "Types.h"
 #include "../MIPS.h"
 #include "../Profiler.h"
@@ -38,11 +42,30 @@ public:
 
 	typedef Framework::CSignal<void(bool)> VuStateChangedEvent;
 
+	//Keeps the VU thread from running while alive. Must be held by the emulator thread
+	//when touching state shared with a running micro program. Does nothing if not threaded.
+	//The VU thread is always stopped between two execution slices once this is acquired.
+	class CThreadLock
+	{
+	public:
+		CThreadLock(CVpu&);
+		~CThreadLock();
+
+		CThreadLock(const CThreadLock&) = delete;
+		CThreadLock& operator=(const CThreadLock&) = delete;
+
+	private:
+		CVpu& m_vpu;
+		bool m_locked = false;
+	};
+
 	CVpu(unsigned int, const VPUINIT&, CGIF&, CINTC&, uint8*, uint8*);
 	virtual ~CVpu();
 
 	void Execute(int32);
 	void Reset();
+	void SetThreaded(bool);
+	bool IsThreaded() const;
 	void SaveState(Framework::CZipArchiveWriter&);
 	void LoadState(Framework::CZipArchiveReader&);
 
@@ -74,6 +97,21 @@ public:
 protected:
 	typedef std::unique_ptr<CVif> VifPtr;
 
+	enum
+	{
+		EXECUTE_SLICE_QUOTA = 5000,
+	};
+
+	enum : uint32
+	{
+		INVALID_XGKICK_ADDRESS = 0xFFFFFFFF,
+	};
+
+	void ExecuteImpl(int32);
+	void ProcessXgKickImpl(uint32);
+	void ProcessPendingXgKick();
+	void ThreadProc();
+
 	uint8* m_microMem = nullptr;
 	uint8* m_vuMem = nullptr;
 	uint32 m_vuMemSize = 0;
@@ -90,7 +128,17 @@ protected:
 #endif
 
 	unsigned int m_number = 0;
-	bool m_running = false;
+	std::atomic<bool> m_running = {false};
+
+	bool m_threaded = false;
+	bool m_threadDone = false;
+	bool m_threadSliceActive = false;
+	//XGKICKs issued on the VU thread are processed by the emulator thread, which owns the GIF and GS registers
+	std::atomic<uint32> m_pendingXgKickAddress = {INVALID_XGKICK_ADDRESS};
+	std::atomic<int> m_threadLockCount = {0};
+	std::recursive_mutex m_threadMutex;
+	std::condition_variable_any m_threadCondition;
+	std::thread m_thread;
 
 	CProfiler::ZoneHandle m_vuProfilerZone = 0;
 };
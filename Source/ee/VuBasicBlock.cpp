@@ -3,12 +3,28 @@
 #include "offsetof_def.h"
 #include "MemoryUtils.h"
 #include "Vpu.h"
+#include <zlib.h>
+
+#define VU_UPPEROP_BIT_E (0x40000000)
 
 CVuBasicBlock::CVuBasicBlock(CMIPS& context, uint32 begin, uint32 end)
     : CBasicBlock(context, begin, end)
 {
 }
 
+//Generated code depends on the code following the block, cached copies must not be shared
+//between blocks that have different successors
+uint32 CVuBasicBlock::ComputeChecksum() const
+{
+	uint32 checksum = CBasicBlock::ComputeChecksum();
+	uint32 lookahead[LOOKAHEAD_SIZE / 4];
+	for(uint32 index = 0; index < (LOOKAHEAD_SIZE / 4); index++)
+	{
+		lookahead[index] = m_context.m_pMemoryMap->GetInstruction(m_end + 4 + (index * 4));
+	}
+	return crc32(checksum, reinterpret_cast<const Bytef*>(lookahead), sizeof(lookahead));
+}
+
 void CVuBasicBlock::CompileRange(CMipsJitter* jitter)
 {
 	CompileProlog(jitter);
@@ -18,6 +34,7 @@ void CVuBasicBlock::CompileRange(CMipsJitter* jitter)
 	auto arch = static_cast<CMA_VU*>(m_context.m_pArch);
 
 	auto integerBranchDelayInfo = GetIntegerBranchDelayInfo();
+	auto macFlagsLiveness = GetMacFlagsLiveness();
 
 	bool hasPendingXgKick = false;
 	const auto clearPendingXgKick =
@@ -95,7 +112,9 @@ void CVuBasicBlock::CompileRange(CMipsJitter* jitter)
 		}
 
 		arch->SetRelativePipeTime(relativePipeTime);
+		VUShared::SetMacFlagPipelineEnabled(macFlagsLiveness[relativePipeTime]);
 		arch->CompileInstruction(addressHi, jitter, &m_context);
+		VUShared::SetMacFlagPipelineEnabled(true);
 
 		if(savedReg != 0)
 		{
@@ -225,6 +244,67 @@ CVuBasicBlock::INTEGER_BRANCH_DELAY_INFO CVuBasicBlock::GetIntegerBranchDelayInf
 	return result;
 }
 
+std::vector<bool> CVuBasicBlock::GetMacFlagsLiveness() const
+{
+	//MAC flags written by an upper instruction become visible LATENCY_MAC cycles later and stay
+	//visible until the next write lands. A write is dead if no FSAND/FSOR/FMEQ/FMAND/FMOR reads
+	//during that window. We look past the block's end when it falls through, but assume flags
+	//are live whenever the window reaches code we can't see (branch target, end of program).
+
+	auto arch = static_cast<CMA_VU*>(m_context.m_pArch);
+	uint32 pairCount = ((m_end - m_begin) / 8) + 1;
+	uint32 knownPairCount = pairCount + (LOOKAHEAD_SIZE / 8);
+
+	std::vector<bool> reads;
+	std::vector<bool> writes;
+	for(uint32 index = 0; index < knownPairCount; index++)
+	{
+		uint32 addressLo = m_begin + (index * 8);
+		uint32 addressHi = addressLo + 4;
+
+		uint32 opcodeLo = m_context.m_pMemoryMap->GetInstruction(addressLo);
+		uint32 opcodeHi = m_context.m_pMemoryMap->GetInstruction(addressHi);
+
+		auto loOps = arch->GetAffectedOperands(&m_context, addressLo, opcodeLo);
+		auto hiOps = arch->GetAffectedOperands(&m_context, addressHi, opcodeHi);
+
+		reads.push_back(loOps.readMACflags);
+		writes.push_back(hiOps.writeMACflags);
+
+		//Execution is sequential up to the delay slot following a branch or the end of the program
+		bool isBranch = arch->IsInstructionBranch(&m_context, addressLo, opcodeLo) != MIPS_BRANCH_NONE;
+		bool isEnd = (opcodeHi & VU_UPPEROP_BIT_E) != 0;
+		if(isBranch || isEnd)
+		{
+			knownPairCount = std::min(knownPairCount, index + 2);
+		}
+	}
+
+	//Backward pass, keeping track of the next write and of the first read happening late enough
+	//to observe the write being looked at
+	std::vector<bool> result(pairCount, true);
+	uint32 nextWriteTime = knownPairCount;
+	uint32 firstReadTime = knownPairCount;
+	for(uint32 index = knownPairCount; index-- > 0;)
+	{
+		uint32 visibleTime = index + VUShared::LATENCY_MAC;
+		if((visibleTime < knownPairCount) && reads[visibleTime])
+		{
+			firstReadTime = visibleTime;
+		}
+		if(!writes[index]) continue;
+		uint32 replacedTime = nextWriteTime + VUShared::LATENCY_MAC;
+		bool isDead = (replacedTime <= knownPairCount) && (firstReadTime >= replacedTime);
+		if(index < pairCount)
+		{
+			result[index] = !isDead;
+		}
+		nextWriteTime = index;
+	}
+
+	return result;
+}
+
 bool CVuBasicBlock::CheckIsSpecialIntegerLoop(unsigned int regI) const
 {
 	//This checks for a pattern where all instructions within a block
@@ -1,13 +1,22 @@
 #pragma once
 
+#include <vector>
 #include "../BasicBlock.h"
 
 class CVuBasicBlock : public CBasicBlock
 {
 public:
+	enum
+	{
+		//Size of the code following a block that is looked at to know if MAC flags are observed
+		LOOKAHEAD_SIZE = 0x40,
+	};
+
 	CVuBasicBlock(CMIPS&, uint32, uint32);
 	virtual ~CVuBasicBlock() = default;
 
+	uint32 ComputeChecksum() const override;
+
 protected:
 	void CompileRange(CMipsJitter*) override;
 
@@ -22,6 +31,7 @@ private:
 	static bool IsConditionalBranch(uint32);
 
 	INTEGER_BRANCH_DELAY_INFO GetIntegerBranchDelayInfo() const;
+	std::vector<bool> GetMacFlagsLiveness() const;
 	bool CheckIsSpecialIntegerLoop(unsigned int) const;
 	static void EmitXgKick(CMipsJitter*);
 };
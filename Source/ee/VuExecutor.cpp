@@ -1,16 +1,237 @@
 #include "VuExecutor.h"
 #include "VuBasicBlock.h"
+#include <chrono>
 #include <zlib.h>
 
 CVuExecutor::CVuExecutor(CMIPS& context, uint32 maxAddress)
     : CGenericMipsExecutor(context, maxAddress)
+    , m_programSwitches(0)
+    , m_programCacheHits(0)
+    , m_partitionTime(0)
 {
+	ResetProgramSnapshot();
+}
+
+CVuExecutor::PROGRAM_CACHE_STATS CVuExecutor::GetProgramCacheStats() const
+{
+	PROGRAM_CACHE_STATS result;
+	result.programSwitches = m_programSwitches;
+	result.cacheHits = m_programCacheHits;
+	result.partitionTime = m_partitionTime;
+	return result;
+}
+
+int CVuExecutor::Execute(int cycles)
+{
+	if(!m_programActive)
+	{
+		ActivateProgram();
+	}
+	return CGenericMipsExecutor::Execute(cycles);
 }
 
 void CVuExecutor::Reset()
 {
+	m_programs.clear();
+	m_programActive = false;
+	m_programCacheable = false;
 	m_cachedBlocks.clear();
 	CGenericMipsExecutor::Reset();
+	ResetProgramSnapshot();
+}
+
+void CVuExecutor::ClearActiveBlocksInRange(uint32 start, uint32 end, bool executing)
+{
+	end = std::min<uint32>(end, m_maxAddress);
+	if(start >= end) return;
+
+	//Snapshot is brought up to date when the next program gets activated
+	if(!m_programDirtyRanges.empty() && (start <= m_programDirtyRanges.back().end) && (m_programDirtyRanges.back().start <= end))
+	{
+		auto& lastRange = m_programDirtyRanges.back();
+		lastRange.start = std::min<uint32>(lastRange.start, start);
+		lastRange.end = std::max<uint32>(lastRange.end, end);
+	}
+	else
+	{
+		m_programDirtyRanges.push_back({start, end});
+	}
+
+	if(executing)
+	{
+		//Running blocks can't be put away, drop them as usual and forget about caching this program
+		m_programCacheable = false;
+		CGenericMipsExecutor::ClearActiveBlocksInRange(start, end, executing);
+		return;
+	}
+
+	//Micro memory is about to change, blocks are left alone until we know which program we end up with
+	m_programActive = false;
+}
+
+//Looks for a cached program matching micro memory contents and brings back its blocks and links. If there's
+//none, the current program is cached and only its blocks covering the modified ranges are dropped.
+void CVuExecutor::ActivateProgram()
+{
+	assert(!m_programActive);
+	m_programActive = true;
+
+	uint32 previousHash = m_programHash;
+	bool previousCacheable = m_programCacheable && !m_blocks.empty();
+	std::vector<uint32> previousMicroMemory;
+	if(previousCacheable)
+	{
+		previousMicroMemory = m_programMicroMemory;
+	}
+
+	auto dirtyRanges = std::move(m_programDirtyRanges);
+	m_programDirtyRanges.clear();
+	if(!UpdateProgramSnapshot(dirtyRanges)) return;
+
+	m_programCacheable = true;
+	m_programSwitches++;
+
+	auto programIterator = m_programs.find(m_programHash);
+	if((programIterator != std::end(m_programs)) && (programIterator->second.microMemory == m_programMicroMemory))
+	{
+		m_programCacheHits++;
+		auto program = std::move(programIterator->second);
+		m_programs.erase(programIterator);
+		UnloadProgram();
+		if(previousCacheable)
+		{
+			StoreProgram(previousHash, std::move(previousMicroMemory), std::move(m_blocks), std::move(m_blockLinks));
+		}
+		m_blocks.clear();
+		m_blockLinks.clear();
+		LoadProgram(program);
+		return;
+	}
+
+	if(previousCacheable)
+	{
+		//Blocks shared with the previous program stay linked, they are unlinked if this program is put away
+		StoreProgram(previousHash, std::move(previousMicroMemory), m_blocks, m_blockLinks);
+	}
+
+	for(const auto& range : dirtyRanges)
+	{
+		ClearActiveBlocksInRangeInternal(range.start, range.end, nullptr);
+	}
+}
+
+void CVuExecutor::LoadProgram(PROGRAM& program)
+{
+	assert(m_blocks.empty());
+
+	m_blocks = std::move(program.blocks);
+	m_blockLinks = std::move(program.blockLinks);
+
+	for(const auto& blockPair : m_blocks)
+	{
+		m_blockLookup.AddBlock(blockPair.second.get());
+		AddBlockToPages(blockPair.second.get());
+	}
+
+	for(const auto& linksPair : m_blockLinks)
+	{
+		auto targetBlock = m_blockLookup.FindBlockAt(linksPair.first);
+		for(const auto& link : linksPair.second)
+		{
+			if(!link.linked) continue;
+			assert(!targetBlock->IsEmpty());
+			link.block->LinkBlock(link.slot, targetBlock);
+		}
+	}
+}
+
+void CVuExecutor::UnloadProgram()
+{
+	//Blocks can be shared with other programs through the checksum cache, they can't keep pointing
+	//to this program's blocks. Link states are preserved to restore them if the program comes back.
+	for(const auto& linksPair : m_blockLinks)
+	{
+		for(const auto& link : linksPair.second)
+		{
+			if(!link.linked) continue;
+			link.block->UnlinkBlock(link.slot);
+		}
+	}
+
+	m_blockLookup.Clear();
+	m_blockPages.clear();
+}
+
+void CVuExecutor::StoreProgram(uint32 hash, std::vector<uint32> microMemory, BlockMap blocks, BlockLinkMap blockLinks)
+{
+	if((m_programs.size() >= MAX_CACHED_PROGRAMS) && (m_programs.find(hash) == std::end(m_programs)))
+	{
+		auto oldestIterator = std::min_element(std::begin(m_programs), std::end(m_programs),
+		                                       [](const ProgramMap::value_type& left, const ProgramMap::value_type& right) { return left.second.lastUse < right.second.lastUse; });
+		m_programs.erase(oldestIterator);
+	}
+	auto& program = m_programs[hash];
+	program.microMemory = std::move(microMemory);
+	program.blocks = std::move(blocks);
+	program.blockLinks = std::move(blockLinks);
+	program.lastUse = m_programUseCounter++;
+}
+
+void CVuExecutor::ResetProgramSnapshot()
+{
+	//Everything needs to be read again, but only pages that don't match the zeroed copy count as a change
+	uint32 pageCount = m_maxAddress / PROGRAM_PAGE_SIZE;
+	m_programMicroMemory.assign(m_maxAddress / 4, 0);
+	m_programPageHashes.assign(pageCount, crc32(0, reinterpret_cast<const Bytef*>(m_programMicroMemory.data()), PROGRAM_PAGE_SIZE));
+	m_programHash = crc32(0, reinterpret_cast<const Bytef*>(m_programPageHashes.data()), pageCount * 4);
+	m_programDirtyRanges.clear();
+	m_programDirtyRanges.push_back({0, m_maxAddress});
+}
+
+//Reads back pages touched by the ranges, returns true if any of them changed
+bool CVuExecutor::UpdateProgramSnapshot(const AddressRangeArray& ranges)
+{
+	uint32 pageCount = static_cast<uint32>(m_programPageHashes.size());
+	std::vector<bool> visitedPages(pageCount, false);
+	bool changed = false;
+	for(const auto& range : ranges)
+	{
+		uint32 lastPage = std::min<uint32>((range.end - 1) / PROGRAM_PAGE_SIZE, pageCount - 1);
+		for(uint32 page = range.start / PROGRAM_PAGE_SIZE; page <= lastPage; page++)
+		{
+			if(visitedPages[page]) continue;
+			visitedPages[page] = true;
+
+			uint32* pageWords = m_programMicroMemory.data() + ((page * PROGRAM_PAGE_SIZE) / 4);
+			bool pageChanged = false;
+			for(uint32 index = 0; index < (PROGRAM_PAGE_SIZE / 4); index++)
+			{
+				uint32 opcode = m_context.m_pMemoryMap->GetInstruction((page * PROGRAM_PAGE_SIZE) + (index * 4));
+				if(pageWords[index] == opcode) continue;
+				pageWords[index] = opcode;
+				pageChanged = true;
+			}
+			if(!pageChanged) continue;
+
+			m_programPageHashes[page] = crc32(0, reinterpret_cast<const Bytef*>(pageWords), PROGRAM_PAGE_SIZE);
+			changed = true;
+		}
+	}
+	if(changed)
+	{
+		m_programHash = crc32(0, reinterpret_cast<const Bytef*>(m_programPageHashes.data()), pageCount * 4);
+	}
+	return changed;
+}
+
+void CVuExecutor::SetBackgroundCompilationEnabled(bool)
+{
+	//Micro programs are small and blocks are already cached by checksum, nothing to gain here
+}
+
+void CVuExecutor::SetTraceFormationEnabled(bool)
+{
+	//VU blocks keep track of pipeline timings per block, they can't be chained in a trace as is
 }
 
 BasicBlockPtr CVuExecutor::BlockFactory(CMIPS& context, uint32 begin, uint32 end)
@@ -36,6 +257,14 @@ BasicBlockPtr CVuExecutor::BlockFactory(CMIPS& context, uint32 begin, uint32 end
 
 	uint32 checksum = crc32(0, reinterpret_cast<Bytef*>(blockMemory), blockSizeByte);
 
+	//Code following the block determines which flags it needs to compute
+	uint32 lookahead[CVuBasicBlock::LOOKAHEAD_SIZE / 4];
+	for(uint32 index = 0; index < (CVuBasicBlock::LOOKAHEAD_SIZE / 4); index++)
+	{
+		lookahead[index] = m_context.m_pMemoryMap->GetInstruction(end + 4 + (index * 4));
+	}
+	checksum = crc32(checksum, reinterpret_cast<Bytef*>(lookahead), sizeof(lookahead));
+
 	auto equalRange = m_cachedBlocks.equal_range(checksum);
 	for(; equalRange.first != equalRange.second; ++equalRange.first)
 	{
@@ -60,6 +289,7 @@ BasicBlockPtr CVuExecutor::BlockFactory(CMIPS& context, uint32 begin, uint32 end
 
 void CVuExecutor::PartitionFunction(uint32 startAddress)
 {
+	auto partitionStartTime = std::chrono::steady_clock::now();
 	uint32 endAddress = startAddress + MAX_BLOCK_SIZE - 4;
 	uint32 branchAddress = 0;
 	for(uint32 address = startAddress; address < endAddress; address += 8)
@@ -89,4 +319,6 @@ void CVuExecutor::PartitionFunction(uint32 startAddress)
 	assert((endAddress - startAddress) <= MAX_BLOCK_SIZE);
 	CreateBlock(startAddress, endAddress);
 	SetupBlockLinks(startAddress, endAddress, branchAddress);
+	auto partitionTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - partitionStartTime);
+	m_partitionTime += partitionTime.count();
 }
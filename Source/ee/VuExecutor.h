@@ -1,21 +1,81 @@
 #pragma once
 
+#include <atomic>
 #include <unordered_map>
+#include <vector>
 #include "../GenericMipsExecutor.h"
 
 class CVuExecutor : public CGenericMipsExecutor<BlockLookupOneWay, 8>
 {
 public:
+	struct PROGRAM_CACHE_STATS
+	{
+		uint32 programSwitches = 0;
+		uint32 cacheHits = 0;
+		uint64 partitionTime = 0; //In microseconds
+	};
+
 	CVuExecutor(CMIPS&, uint32);
 	virtual ~CVuExecutor() = default;
 
+	PROGRAM_CACHE_STATS GetProgramCacheStats() const;
+
+	int Execute(int) override;
 	void Reset() override;
+	void ClearActiveBlocksInRange(uint32, uint32, bool) override;
+	void SetBackgroundCompilationEnabled(bool) override;
+	void SetTraceFormationEnabled(bool) override;
 
 protected:
+	enum
+	{
+		MAX_CACHED_PROGRAMS = 32,
+		PROGRAM_PAGE_SIZE = 0x400,
+	};
+
+	struct ADDRESS_RANGE
+	{
+		uint32 start;
+		uint32 end;
+	};
+	typedef std::vector<ADDRESS_RANGE> AddressRangeArray;
+
+	//Blocks and links of a micro program that was replaced by another one
+	struct PROGRAM
+	{
+		std::vector<uint32> microMemory;
+		BlockMap blocks;
+		BlockLinkMap blockLinks;
+		uint32 lastUse = 0;
+	};
+
 	typedef std::unordered_multimap<uint32, BasicBlockPtr> CachedBlockMap;
+	typedef std::unordered_map<uint32, PROGRAM> ProgramMap;
 
 	BasicBlockPtr BlockFactory(CMIPS&, uint32, uint32) override;
 	void PartitionFunction(uint32) override;
 
+	void ActivateProgram();
+	void LoadProgram(PROGRAM&);
+	void UnloadProgram();
+	void StoreProgram(uint32, std::vector<uint32>, BlockMap, BlockLinkMap);
+	void ResetProgramSnapshot();
+	bool UpdateProgramSnapshot(const AddressRangeArray&);
+
 	CachedBlockMap m_cachedBlocks;
+
+	ProgramMap m_programs;
+	bool m_programActive = false;
+	bool m_programCacheable = false;
+	uint32 m_programHash = 0;
+	uint32 m_programUseCounter = 0;
+	//Copy of micro memory as it was when the current program was activated, hashed per page
+	std::vector<uint32> m_programMicroMemory;
+	std::vector<uint32> m_programPageHashes;
+	//Ranges modified since the current program was activated
+	AddressRangeArray m_programDirtyRanges;
+
+	std::atomic<uint32> m_programSwitches;
+	std::atomic<uint32> m_programCacheHits;
+	std::atomic<uint64> m_partitionTime;
 };
@@ -92,10 +92,9 @@ CGSH_Direct3D9::TEXTURE_INFO CGSH_Direct3D9::LoadTexture(const TEX0& tex0, uint3
 			TexturePtr textureHandle;
 			resultCode = m_device->CreateTexture(width, height, 1 + maxMip, D3DUSAGE_DYNAMIC, textureFormat, D3DPOOL_DEFAULT, &textureHandle, NULL);
 			assert(SUCCEEDED(resultCode));
-			m_textureCache.Insert(tex0, std::move(textureHandle));
+			texture = m_textureCache.Insert(tex0, std::move(textureHandle));
 		}
 
-		texture = m_textureCache.Search(tex0);
 		texture->m_cachedArea.Invalidate(0, RAMSIZE);
 	}
 
@@ -86,14 +86,27 @@ void CGSH_OpenGL::InitializeImpl()
 
 	m_renderState.isValid = false;
 	m_validGlState = 0;
+
+	m_shaderCacheEnabled = CAppConfig::GetInstance().GetPreferenceBoolean(PREF_CGSH_OPENGL_SHADERCACHE);
+	if(m_shaderCacheEnabled)
+	{
+		LoadShaderCache();
+		WarmUpShaderCache();
+	}
 }
 
 void CGSH_OpenGL::ReleaseImpl()
 {
 	ResetImpl();
 
+	if(m_shaderCacheEnabled)
+	{
+		SaveShaderCache();
+	}
+
 	m_paletteCache.clear();
 	m_shaders.clear();
+	m_shaderBinaries.clear();
 	m_presentProgram.reset();
 	m_presentVertexBuffer.Reset();
 	m_presentVertexArray.Reset();
@@ -292,7 +305,7 @@ void CGSH_OpenGL::FlipImpl()
 void CGSH_OpenGL::LoadState(Framework::CZipArchiveReader& archive)
 {
 	CGSHandler::LoadState(archive);
-	m_mailBox.SendCall(
+	SendGSCall(
 	    [this]() {
 		    m_textureCache.InvalidateRange(0, RAMSIZE);
 	    });
@@ -303,6 +316,7 @@ void CGSH_OpenGL::RegisterPreferences()
 	CGSHandler::RegisterPreferences();
 	CAppConfig::GetInstance().RegisterPreferenceInteger(PREF_CGSH_OPENGL_RESOLUTION_FACTOR, 1);
 	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_CGSH_OPENGL_FORCEBILINEARTEXTURES, false);
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_CGSH_OPENGL_SHADERCACHE, true);
 }
 
 void CGSH_OpenGL::NotifyPreferencesChangedImpl()
@@ -561,40 +575,50 @@ Framework::OpenGl::ProgramPtr CGSH_OpenGL::GetShaderFromCaps(const SHADERCAPS& s
 	if(shaderIterator == m_shaders.end())
 	{
 		auto shader = GenerateShader(shaderCaps);
+		m_shaderCacheStats.compiles++;
+		SetupShaderBindings(shader);
 
-		glUseProgram(*shader);
-		m_validGlState &= ~GLSTATE_PROGRAM;
-
-		auto textureUniform = glGetUniformLocation(*shader, "g_texture");
-		if(textureUniform != -1)
+		if(m_shaderCacheEnabled)
 		{
-			glUniform1i(textureUniform, 0);
+			StoreShaderBinary(static_cast<uint32>(shaderCaps), shader);
 		}
 
-		auto paletteUniform = glGetUniformLocation(*shader, "g_palette");
-		if(paletteUniform != -1)
-		{
-			glUniform1i(paletteUniform, 1);
-		}
+		m_shaders.insert(std::make_pair(static_cast<uint32>(shaderCaps), shader));
+		shaderIterator = m_shaders.find(static_cast<uint32>(shaderCaps));
+	}
+	return shaderIterator->second;
+}
 
-		auto vertexParamsUniformBlock = glGetUniformBlockIndex(*shader, "VertexParams");
-		if(vertexParamsUniformBlock != GL_INVALID_INDEX)
-		{
-			glUniformBlockBinding(*shader, vertexParamsUniformBlock, 0);
-		}
+void CGSH_OpenGL::SetupShaderBindings(const Framework::OpenGl::ProgramPtr& shader)
+{
+	glUseProgram(*shader);
+	m_validGlState &= ~GLSTATE_PROGRAM;
 
-		auto fragmentParamsUniformBlock = glGetUniformBlockIndex(*shader, "FragmentParams");
-		if(fragmentParamsUniformBlock != GL_INVALID_INDEX)
-		{
-			glUniformBlockBinding(*shader, fragmentParamsUniformBlock, 1);
-		}
+	auto textureUniform = glGetUniformLocation(*shader, "g_texture");
+	if(textureUniform != -1)
+	{
+		glUniform1i(textureUniform, 0);
+	}
 
-		CHECKGLERROR();
+	auto paletteUniform = glGetUniformLocation(*shader, "g_palette");
+	if(paletteUniform != -1)
+	{
+		glUniform1i(paletteUniform, 1);
+	}
 
-		m_shaders.insert(std::make_pair(static_cast<uint32>(shaderCaps), shader));
-		shaderIterator = m_shaders.find(static_cast<uint32>(shaderCaps));
+	auto vertexParamsUniformBlock = glGetUniformBlockIndex(*shader, "VertexParams");
+	if(vertexParamsUniformBlock != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(*shader, vertexParamsUniformBlock, 0);
 	}
-	return shaderIterator->second;
+
+	auto fragmentParamsUniformBlock = glGetUniformBlockIndex(*shader, "FragmentParams");
+	if(fragmentParamsUniformBlock != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(*shader, fragmentParamsUniformBlock, 1);
+	}
+
+	CHECKGLERROR();
 }
 
 void CGSH_OpenGL::SetRenderingContext(uint64 primReg)
@@ -1955,12 +1979,39 @@ void CGSH_OpenGL::WriteRegisterImpl(uint8 nRegister, uint64 nData)
 	case GS_REG_XYZ3:
 	case GS_REG_XYZF2:
 	case GS_REG_XYZF3:
-		VertexKick(nRegister, nData);
-		break;
+	{
+		bool renderingContextValid = false;
+		VertexKick(nRegister, nData, renderingContextValid);
+	}
+	break;
 	}
 }
 
-void CGSH_OpenGL::VertexKick(uint8 nRegister, uint64 nValue)
+void CGSH_OpenGL::ProcessVertexBatch(const RegisterWrite* writes, uint32 writeCount)
+{
+	//Drawing state doesn't change within a batch, rendering context only needs to be set once
+	bool renderingContextValid = false;
+	for(uint32 i = 0; i < writeCount; i++)
+	{
+		uint8 nRegister = writes[i].first;
+		uint64 nData = writes[i].second;
+		m_nReg[nRegister] = nData;
+#ifdef _DEBUG
+		LogWrite(nRegister, nData);
+#endif
+		switch(nRegister)
+		{
+		case GS_REG_XYZ2:
+		case GS_REG_XYZ3:
+		case GS_REG_XYZF2:
+		case GS_REG_XYZF3:
+			VertexKick(nRegister, nData, renderingContextValid);
+			break;
+		}
+	}
+}
+
+void CGSH_OpenGL::VertexKick(uint8 nRegister, uint64 nValue, bool& renderingContextValid)
 {
 	if(m_nVtxCount == 0) return;
 
@@ -2001,7 +2052,12 @@ void CGSH_OpenGL::VertexKick(uint8 nRegister, uint64 nValue)
 
 		if(nDrawingKick)
 		{
-			SetRenderingContext(m_PrimitiveMode);
+			//DrawToDepth invalidates the render state
+			if(!renderingContextValid || !m_renderState.isValid)
+			{
+				SetRenderingContext(m_PrimitiveMode);
+				renderingContextValid = true;
+			}
 		}
 
 		switch(m_primitiveType)
@@ -2328,19 +2384,19 @@ void CGSH_OpenGL::CommitFramebufferDirtyPages(const FramebufferPtr& framebuffer,
 	auto& cachedArea = framebuffer->m_cachedArea;
 
 	auto areaRect = cachedArea.GetAreaPageRect();
-	auto texturePageSize = CGsPixelFormats::GetPsmPageSize(framebuffer->m_psm);
 
 	CCopyToFbEnabler copyToFbEnabler;
 	while(cachedArea.HasDirtyPages())
 	{
 		auto dirtyRect = cachedArea.GetDirtyPageRect();
 		assert((dirtyRect.width != 0) && (dirtyRect.height != 0));
+		auto updateRect = cachedArea.GetDirtyPixelRect(dirtyRect);
 		cachedArea.ClearDirtyPages(dirtyRect);
 
-		uint32 texX = dirtyRect.x * texturePageSize.first;
-		uint32 texY = dirtyRect.y * texturePageSize.second;
-		uint32 texWidth = dirtyRect.width * texturePageSize.first;
-		uint32 texHeight = dirtyRect.height * texturePageSize.second;
+		uint32 texX = updateRect.x;
+		uint32 texY = updateRect.y;
+		uint32 texWidth = updateRect.width;
+		uint32 texHeight = updateRect.height;
 
 		if(texY >= maxY)
 		{
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <list>
+#include <map>
 #include <unordered_map>
+#include <vector>
 #include "../GSHandler.h"
 #include "../GsCachedArea.h"
 #include "../GsTextureCache.h"
@@ -12,6 +14,7 @@
 
 #define PREF_CGSH_OPENGL_RESOLUTION_FACTOR "renderer.opengl.resfactor"
 #define PREF_CGSH_OPENGL_FORCEBILINEARTEXTURES "renderer.opengl.forcebilineartextures"
+#define PREF_CGSH_OPENGL_SHADERCACHE "renderer.opengl.shadercache"
 
 #if !defined(GLES_COMPATIBILITY) && !defined(__APPLE__)
 //- Dual source blending is disabled on macOS because it seems to be problematic on
@@ -22,6 +25,14 @@
 class CGSH_OpenGL : public CGSHandler
 {
 public:
+	struct SHADERCACHE_STATS
+	{
+		uint32 binaryLoads = 0;
+		uint32 binaryRejects = 0;
+		uint32 compiles = 0;
+		uint32 warmedUp = 0;
+	};
+
 	CGSH_OpenGL();
 	virtual ~CGSH_OpenGL();
 
@@ -37,6 +48,8 @@ public:
 
 	Framework::CBitmap GetScreenshot() override;
 
+	SHADERCACHE_STATS GetShaderCacheStats() const;
+
 protected:
 	void PalCache_Flush();
 	void LoadPreferences();
@@ -190,25 +203,34 @@ private:
 
 	typedef std::unordered_map<uint32, Framework::OpenGl::ProgramPtr> ShaderMap;
 
+	struct PROGRAM_BINARY
+	{
+		uint32 sourceHash = 0;
+		uint32 format = 0;
+		std::vector<uint8> data;
+	};
+	typedef std::map<uint32, PROGRAM_BINARY> ProgramBinaryMap;
+
 	class CPalette
 	{
 	public:
 		CPalette();
 		~CPalette();
 
-		void Invalidate(uint32);
 		void Free();
 
-		bool m_live;
-
 		bool m_isIDTEX4;
 		uint32 m_cpsm;
 		uint32 m_csa;
+		uint64 m_hash;
 		GLuint m_texture;
 		uint32 m_contents[256];
 	};
 	typedef std::shared_ptr<CPalette> PalettePtr;
 	typedef std::list<PalettePtr> PaletteList;
+	//Palettes matching the current CLUT contents, by IDTEX4/CPSM/CSA
+	typedef std::unordered_map<uint32, PaletteList::iterator> PaletteKeyMap;
+	typedef std::unordered_multimap<uint64, PaletteList::iterator> PaletteHashMap;
 
 	class CFramebuffer
 	{
@@ -290,6 +312,7 @@ private:
 	typedef std::vector<PRIM_VERTEX> VertexBuffer;
 
 	void WriteRegisterImpl(uint8, uint64) override;
+	void ProcessVertexBatch(const RegisterWrite*, uint32) override;
 
 	void InitializeRC();
 	void SetupTextureUpdaters();
@@ -300,15 +323,26 @@ private:
 	TEXTURE_INFO SearchTextureFramebuffer(const TEX0&);
 	GLuint PreparePalette(const TEX0&);
 
-	void VertexKick(uint8, uint64);
+	void VertexKick(uint8, uint64, bool&);
 
 	Framework::OpenGl::ProgramPtr GetShaderFromCaps(const SHADERCAPS&);
+	void SetupShaderBindings(const Framework::OpenGl::ProgramPtr&);
 	Framework::OpenGl::ProgramPtr GenerateShader(const SHADERCAPS&);
 	Framework::OpenGl::CShader GenerateVertexShader(const SHADERCAPS&);
 	Framework::OpenGl::CShader GenerateFragmentShader(const SHADERCAPS&);
+	std::string GenerateVertexShaderSource(const SHADERCAPS&);
+	std::string GenerateFragmentShaderSource(const SHADERCAPS&);
 	std::string GenerateTexCoordClampingSection(TEXTURE_CLAMP_MODE, const char*);
 	std::string GenerateAlphaTestSection(ALPHA_TEST_METHOD);
 
+	void LoadShaderCache();
+	void SaveShaderCache();
+	void WarmUpShaderCache();
+	void StoreShaderBinary(uint32, const Framework::OpenGl::ProgramPtr&);
+	Framework::OpenGl::ProgramPtr LoadShaderBinary(const PROGRAM_BINARY&);
+	uint32 GetShaderCacheFingerprint() const;
+	uint32 GetShaderSourceHash(const SHADERCAPS&);
+
 	Framework::OpenGl::ProgramPtr GeneratePresentProgram();
 	Framework::OpenGl::CBuffer GeneratePresentVertexBuffer();
 	Framework::OpenGl::CVertexArray GeneratePresentVertexArray();
@@ -378,9 +412,12 @@ private:
 	uint8* m_pCvtBuffer;
 
 	GLuint PalCache_Search(const TEX0&);
-	GLuint PalCache_Search(unsigned int, const uint32*);
-	void PalCache_Insert(const TEX0&, const uint32*, GLuint);
+	GLuint PalCache_Search(const TEX0&, uint64, const uint32*);
+	void PalCache_Insert(const TEX0&, uint64, const uint32*, GLuint);
 	void PalCache_Invalidate(uint32);
+	void PalCache_MakeLive(const TEX0&, PaletteList::iterator);
+	static uint32 PalCache_GetKey(const TEX0&);
+	static uint64 PalCache_Hash(const uint32*, unsigned int);
 
 	void PopulateFramebuffer(const FramebufferPtr&);
 	void CommitFramebufferDirtyPages(const FramebufferPtr&, unsigned int, unsigned int);
@@ -401,6 +438,8 @@ private:
 
 	TextureCache m_textureCache;
 	PaletteList m_paletteCache;
+	PaletteKeyMap m_livePalettes;
+	PaletteHashMap m_paletteHashes;
 	FramebufferList m_framebuffers;
 	DepthbufferList m_depthbuffers;
 
@@ -436,6 +475,11 @@ private:
 	};
 
 	ShaderMap m_shaders;
+	ProgramBinaryMap m_shaderBinaries;
+	SHADERCACHE_STATS m_shaderCacheStats;
+	bool m_shaderCacheEnabled = false;
+	bool m_shaderCacheDirty = false;
+	bool m_programBinarySupported = false;
 	RENDERSTATE m_renderState;
 	uint32 m_validGlState = 0;
 	VERTEXPARAMS m_vertexParams;
@@ -75,6 +75,11 @@ Framework::OpenGl::ProgramPtr CGSH_OpenGL::GenerateShader(const SHADERCAPS& caps
 	glBindFragDataLocationIndexed(*result, 0, 1, "blendColor");
 #endif
 
+	if(m_programBinarySupported)
+	{
+		glProgramParameteri(*result, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
 	FRAMEWORK_MAYBE_UNUSED bool linkResult = result->Link();
 	assert(linkResult);
 
@@ -84,6 +89,20 @@ Framework::OpenGl::ProgramPtr CGSH_OpenGL::GenerateShader(const SHADERCAPS& caps
 }
 
 Framework::OpenGl::CShader CGSH_OpenGL::GenerateVertexShader(const SHADERCAPS& caps)
+{
+	auto shaderSource = GenerateVertexShaderSource(caps);
+
+	Framework::OpenGl::CShader result(GL_VERTEX_SHADER);
+	result.SetSource(shaderSource.c_str(), shaderSource.size());
+	FRAMEWORK_MAYBE_UNUSED bool compilationResult = result.Compile();
+	assert(compilationResult);
+
+	CHECKGLERROR();
+
+	return result;
+}
+
+std::string CGSH_OpenGL::GenerateVertexShaderSource(const SHADERCAPS& caps)
 {
 	std::stringstream shaderBuilder;
 	shaderBuilder << GLSL_VERSION << std::endl;
@@ -121,9 +140,14 @@ Framework::OpenGl::CShader CGSH_OpenGL::GenerateVertexShader(const SHADERCAPS& c
 	shaderBuilder << "	gl_Position = g_projMatrix * vec4(a_position, 0, 1);" << std::endl;
 	shaderBuilder << "}" << std::endl;
 
-	auto shaderSource = shaderBuilder.str();
+	return shaderBuilder.str();
+}
 
-	Framework::OpenGl::CShader result(GL_VERTEX_SHADER);
+Framework::OpenGl::CShader CGSH_OpenGL::GenerateFragmentShader(const SHADERCAPS& caps)
+{
+	auto shaderSource = GenerateFragmentShaderSource(caps);
+
+	Framework::OpenGl::CShader result(GL_FRAGMENT_SHADER);
 	result.SetSource(shaderSource.c_str(), shaderSource.size());
 	FRAMEWORK_MAYBE_UNUSED bool compilationResult = result.Compile();
 	assert(compilationResult);
@@ -133,7 +157,7 @@ Framework::OpenGl::CShader CGSH_OpenGL::GenerateVertexShader(const SHADERCAPS& c
 	return result;
 }
 
-Framework::OpenGl::CShader CGSH_OpenGL::GenerateFragmentShader(const SHADERCAPS& caps)
+std::string CGSH_OpenGL::GenerateFragmentShaderSource(const SHADERCAPS& caps)
 {
 	std::stringstream shaderBuilder;
 
@@ -344,16 +368,7 @@ Framework::OpenGl::CShader CGSH_OpenGL::GenerateFragmentShader(const SHADERCAPS&
 
 	shaderBuilder << "}" << std::endl;
 
-	auto shaderSource = shaderBuilder.str();
-
-	Framework::OpenGl::CShader result(GL_FRAGMENT_SHADER);
-	result.SetSource(shaderSource.c_str(), shaderSource.size());
-	FRAMEWORK_MAYBE_UNUSED bool compilationResult = result.Compile();
-	assert(compilationResult);
-
-	CHECKGLERROR();
-
-	return result;
+	return shaderBuilder.str();
 }
 
 std::string CGSH_OpenGL::GenerateTexCoordClampingSection(TEXTURE_CLAMP_MODE clampMode, const char* coordinate)
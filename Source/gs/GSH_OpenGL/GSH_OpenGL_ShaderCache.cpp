@@ -0,0 +1,240 @@
+#include "GSH_OpenGL.h"
+#include "../../AppConfig.h"
+#include "../../Log.h"
+#include "filesystem_def.h"
+#include "PathUtils.h"
+#include "StdStreamUtils.h"
+
+#define LOG_NAME ("gsh_opengl")
+
+#define SHADERCACHE_PATH ("shadercache")
+#define SHADERCACHE_FILENAME ("opengl.shadercache")
+
+enum
+{
+	SHADERCACHE_FILE_MAGIC = 0x43534C47, //'GLSC'
+	SHADERCACHE_FILE_VERSION = 2,
+	SHADERCACHE_MAX_BINARY_SIZE = 0x1000000,
+};
+
+static fs::path GetShaderCachePath()
+{
+	return CAppConfig::GetBasePath() / fs::path(SHADERCACHE_PATH) / fs::path(SHADERCACHE_FILENAME);
+}
+
+static uint32 HashString(uint32 hash, const char* string)
+{
+	//FNV-1a
+	if(!string) return hash;
+	for(; *string; string++)
+	{
+		hash ^= static_cast<uint8>(*string);
+		hash *= 0x01000193;
+	}
+	return hash;
+}
+
+CGSH_OpenGL::SHADERCACHE_STATS CGSH_OpenGL::GetShaderCacheStats() const
+{
+	return m_shaderCacheStats;
+}
+
+//Binaries are only valid for the driver and build that produced them, shader
+//capabilities are kept regardless to know which programs to warm up
+uint32 CGSH_OpenGL::GetShaderCacheFingerprint() const
+{
+	uint32 fingerprint = 0x811C9DC5;
+	fingerprint = HashString(fingerprint, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+	fingerprint = HashString(fingerprint, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	fingerprint = HashString(fingerprint, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+#ifdef PLAY_VERSION
+	fingerprint = HashString(fingerprint, PLAY_VERSION);
+#endif
+	return fingerprint;
+}
+
+//Binaries are also tied to the GLSL the generator produced for their capabilities
+uint32 CGSH_OpenGL::GetShaderSourceHash(const SHADERCAPS& caps)
+{
+	uint32 hash = 0x811C9DC5;
+	hash = HashString(hash, GenerateVertexShaderSource(caps).c_str());
+	hash = HashString(hash, GenerateFragmentShaderSource(caps).c_str());
+	return hash;
+}
+
+void CGSH_OpenGL::LoadShaderCache()
+{
+	GLint binaryFormatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormatCount);
+	m_programBinarySupported = (binaryFormatCount > 0);
+
+	m_shaderBinaries.clear();
+	m_shaderCacheDirty = false;
+
+	auto path = GetShaderCachePath();
+	if(!fs::exists(path)) return;
+
+	try
+	{
+		auto stream = Framework::CreateInputStdStream(path.native());
+		uint32 magic = stream.Read32();
+		uint32 version = stream.Read32();
+		uint32 fingerprint = stream.Read32();
+		if((magic != SHADERCACHE_FILE_MAGIC) || (version != SHADERCACHE_FILE_VERSION))
+		{
+			CLog::GetInstance().Print(LOG_NAME, "Discarding incompatible shader cache '%s'.\r\n", path.string().c_str());
+			return;
+		}
+
+		bool binariesValid = m_programBinarySupported && (fingerprint == GetShaderCacheFingerprint());
+		uint32 entryCount = stream.Read32();
+		for(uint32 i = 0; i < entryCount; i++)
+		{
+			uint32 caps = stream.Read32();
+			uint32 sourceHash = stream.Read32();
+			uint32 format = stream.Read32();
+			uint32 size = stream.Read32();
+			if(size > SHADERCACHE_MAX_BINARY_SIZE)
+			{
+				throw std::runtime_error("Invalid program binary size.");
+			}
+
+			auto& binary = m_shaderBinaries[caps];
+			if(binariesValid && (sourceHash == GetShaderSourceHash(make_convertible<SHADERCAPS>(caps))))
+			{
+				binary.sourceHash = sourceHash;
+				binary.format = format;
+				binary.data.resize(size);
+				stream.Read(binary.data.data(), size);
+			}
+			else
+			{
+				//Driver or shader generator changed, program will be compiled again during warm up
+				stream.Seek(size, Framework::STREAM_SEEK_CUR);
+				m_shaderCacheDirty = true;
+			}
+		}
+
+		if(!binariesValid)
+		{
+			CLog::GetInstance().Print(LOG_NAME, "Driver or build changed, shader cache programs will be recompiled.\r\n");
+			m_shaderCacheDirty = true;
+		}
+	}
+	catch(const std::exception& exception)
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Failed to load shader cache '%s': %s\r\n", path.string().c_str(), exception.what());
+		m_shaderBinaries.clear();
+		m_shaderCacheDirty = false;
+	}
+}
+
+void CGSH_OpenGL::SaveShaderCache()
+{
+	if(!m_shaderCacheDirty) return;
+
+	auto path = GetShaderCachePath();
+	try
+	{
+		Framework::PathUtils::EnsurePathExists(path.parent_path());
+		auto stream = Framework::CreateOutputStdStream(path.native());
+		stream.Write32(SHADERCACHE_FILE_MAGIC);
+		stream.Write32(SHADERCACHE_FILE_VERSION);
+		stream.Write32(GetShaderCacheFingerprint());
+		stream.Write32(static_cast<uint32>(m_shaderBinaries.size()));
+		for(const auto& binaryPair : m_shaderBinaries)
+		{
+			const auto& binary = binaryPair.second;
+			stream.Write32(binaryPair.first);
+			stream.Write32(binary.sourceHash);
+			stream.Write32(binary.format);
+			stream.Write32(static_cast<uint32>(binary.data.size()));
+			stream.Write(binary.data.data(), binary.data.size());
+		}
+	}
+	catch(const std::exception& exception)
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Failed to save shader cache '%s': %s\r\n", path.string().c_str(), exception.what());
+		return;
+	}
+
+	m_shaderCacheDirty = false;
+}
+
+//Creates programs for all shader capabilities seen in previous sessions before
+//emulation starts, avoiding compilation hitches the first time they're used
+void CGSH_OpenGL::WarmUpShaderCache()
+{
+	for(auto& binaryPair : m_shaderBinaries)
+	{
+		uint32 caps = binaryPair.first;
+		if(m_shaders.find(caps) != std::end(m_shaders)) continue;
+
+		Framework::OpenGl::ProgramPtr shader;
+		if(!binaryPair.second.data.empty())
+		{
+			shader = LoadShaderBinary(binaryPair.second);
+		}
+
+		if(shader)
+		{
+			m_shaderCacheStats.binaryLoads++;
+		}
+		else
+		{
+			shader = GenerateShader(make_convertible<SHADERCAPS>(caps));
+			m_shaderCacheStats.compiles++;
+			StoreShaderBinary(caps, shader);
+		}
+
+		SetupShaderBindings(shader);
+		m_shaders.insert(std::make_pair(caps, shader));
+		m_shaderCacheStats.warmedUp++;
+	}
+
+	CLog::GetInstance().Print(LOG_NAME, "Warmed up %d shaders (%d from program binaries).\r\n",
+	                          m_shaderCacheStats.warmedUp, m_shaderCacheStats.binaryLoads);
+}
+
+void CGSH_OpenGL::StoreShaderBinary(uint32 caps, const Framework::OpenGl::ProgramPtr& shader)
+{
+	//Capabilities are recorded even without a binary to be compiled during warm up
+	auto& binary = m_shaderBinaries[caps];
+	binary.sourceHash = GetShaderSourceHash(make_convertible<SHADERCAPS>(caps));
+	binary.format = 0;
+	binary.data.clear();
+	m_shaderCacheDirty = true;
+
+	if(!m_programBinarySupported) return;
+
+	GLint binaryLength = 0;
+	glGetProgramiv(*shader, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if(binaryLength <= 0) return;
+
+	GLsizei length = 0;
+	GLenum format = 0;
+	binary.data.resize(binaryLength);
+	glGetProgramBinary(*shader, binaryLength, &length, &format, binary.data.data());
+	binary.data.resize(length);
+	binary.format = format;
+
+	CHECKGLERROR();
+}
+
+Framework::OpenGl::ProgramPtr CGSH_OpenGL::LoadShaderBinary(const PROGRAM_BINARY& binary)
+{
+	auto shader = std::make_shared<Framework::OpenGl::CProgram>();
+	glProgramBinary(*shader, binary.format, binary.data.data(), static_cast<GLsizei>(binary.data.size()));
+
+	GLint linkStatus = GL_FALSE;
+	glGetProgramiv(*shader, GL_LINK_STATUS, &linkStatus);
+	if(linkStatus != GL_TRUE)
+	{
+		//Drivers are allowed to reject binaries at any time (ie.: after an update)
+		glGetError();
+		m_shaderCacheStats.binaryRejects++;
+		return Framework::OpenGl::ProgramPtr();
+	}
+
+	return shader;
+}
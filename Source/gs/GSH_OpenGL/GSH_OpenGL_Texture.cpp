@@ -3,6 +3,7 @@
 #include <sys/stat.h>
 #include <limits.h>
 #include <algorithm>
+#include <iterator>
 #include "GSH_OpenGL.h"
 #include "StdStream.h"
 #include "bitmap/BMP.h"
@@ -181,10 +182,9 @@ CGSH_OpenGL::TEXTURE_INFO CGSH_OpenGL::PrepareTexture(const TEX0& tex0)
 			glBindTexture(GL_TEXTURE_2D, textureHandle);
 			glTexStorage2D(GL_TEXTURE_2D, 1, texFormat.internalFormat, texWidth, texHeight);
 			CHECKGLERROR();
-			m_textureCache.Insert(tex0, std::move(textureHandle));
+			texture = m_textureCache.Insert(tex0, std::move(textureHandle));
 		}
 
-		texture = m_textureCache.Search(tex0);
 		texture->m_cachedArea.Invalidate(0, RAMSIZE);
 	}
 
@@ -192,19 +192,20 @@ CGSH_OpenGL::TEXTURE_INFO CGSH_OpenGL::PrepareTexture(const TEX0& tex0)
 
 	glBindTexture(GL_TEXTURE_2D, texture->m_textureHandle);
 	auto& cachedArea = texture->m_cachedArea;
-	auto texturePageSize = CGsPixelFormats::GetPsmPageSize(tex0.nPsm);
 	auto areaRect = cachedArea.GetAreaPageRect();
 
 	while(cachedArea.HasDirtyPages())
 	{
 		auto dirtyRect = cachedArea.GetDirtyPageRect();
 		assert((dirtyRect.width != 0) && (dirtyRect.height != 0));
+		//Only update blocks that were touched inside the dirty pages
+		auto updateRect = cachedArea.GetDirtyPixelRect(dirtyRect);
 		cachedArea.ClearDirtyPages(dirtyRect);
 
-		uint32 texX = dirtyRect.x * texturePageSize.first;
-		uint32 texY = dirtyRect.y * texturePageSize.second;
-		uint32 texWidth = dirtyRect.width * texturePageSize.first;
-		uint32 texHeight = dirtyRect.height * texturePageSize.second;
+		uint32 texX = updateRect.x;
+		uint32 texY = updateRect.y;
+		uint32 texWidth = updateRect.width;
+		uint32 texHeight = updateRect.height;
 		if(texX >= tex0.GetWidth()) continue;
 		if(texY >= tex0.GetHeight()) continue;
 		//assert(texX < tex0.GetWidth());
@@ -237,7 +238,8 @@ GLuint CGSH_OpenGL::PreparePalette(const TEX0& tex0)
 	MakeLinearCLUT(tex0, convertedClut);
 
 	unsigned int entryCount = CGsPixelFormats::IsPsmIDTEX4(tex0.nPsm) ? 16 : 256;
-	textureHandle = PalCache_Search(entryCount, convertedClut.data());
+	uint64 clutHash = PalCache_Hash(convertedClut.data(), entryCount);
+	textureHandle = PalCache_Search(tex0, clutHash, convertedClut.data());
 	if(textureHandle != 0)
 	{
 		return textureHandle;
@@ -247,7 +249,7 @@ GLuint CGSH_OpenGL::PreparePalette(const TEX0& tex0)
 	glBindTexture(GL_TEXTURE_2D, textureHandle);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, entryCount, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, convertedClut.data());
 
-	PalCache_Insert(tex0, convertedClut.data(), textureHandle);
+	PalCache_Insert(tex0, clutHash, convertedClut.data(), textureHandle);
 
 	return textureHandle;
 }
@@ -370,10 +372,10 @@ void CGSH_OpenGL::TexUpdater_Psm48H(uint32 bufPtr, uint32 bufWidth, unsigned int
 /////////////////////////////////////////////////////////////
 
 CGSH_OpenGL::CPalette::CPalette()
-    : m_live(false)
-    , m_isIDTEX4(false)
+    : m_isIDTEX4(false)
     , m_cpsm(0)
     , m_csa(0)
+    , m_hash(0)
     , m_texture(0)
 {
 }
@@ -389,89 +391,139 @@ void CGSH_OpenGL::CPalette::Free()
 	{
 		glDeleteTextures(1, &m_texture);
 		m_texture = 0;
-		m_live = false;
 	}
 }
 
-void CGSH_OpenGL::CPalette::Invalidate(uint32 csa)
-{
-	if(!m_live) return;
-
-	m_live = false;
-}
-
 /////////////////////////////////////////////////////////////
 // Palette Caching
 /////////////////////////////////////////////////////////////
 
-GLuint CGSH_OpenGL::PalCache_Search(const TEX0& tex0)
+uint32 CGSH_OpenGL::PalCache_GetKey(const TEX0& tex0)
 {
-	for(auto paletteIterator(m_paletteCache.begin());
-	    paletteIterator != m_paletteCache.end(); paletteIterator++)
+	uint32 isIDTEX4 = CGsPixelFormats::IsPsmIDTEX4(tex0.nPsm) ? 1 : 0;
+	return (isIDTEX4 << 16) | (tex0.nCPSM << 8) | tex0.nCSA;
+}
+
+//Palettes are compared entirely when searched, the hash only needs to spread them.
+//Lanes are kept 32-bit wide to fit in vector registers, there's enough of them
+//to hide the latency of vector multiplies.
+uint64 CGSH_OpenGL::PalCache_Hash(const uint32* contents, unsigned int entryCount)
+{
+	static const unsigned int laneCount = 8;
+	assert((entryCount % laneCount) == 0);
+	uint32 lanes[laneCount] = {0x9E3779B9, 0x85EBCA6B, 0xC2B2AE35, 0x27D4EB2F, 0x165667B1, 0xD3A2646C, 0xFD7046C5, 0xB55A4F09};
+	for(unsigned int i = 0; i < entryCount; i += laneCount)
 	{
-		auto palette = *paletteIterator;
-		if(!palette->m_live) continue;
-		if(CGsPixelFormats::IsPsmIDTEX4(tex0.nPsm) != palette->m_isIDTEX4) continue;
-		if(tex0.nCPSM != palette->m_cpsm) continue;
-		if(tex0.nCSA != palette->m_csa) continue;
-		m_paletteCache.erase(paletteIterator);
-		m_paletteCache.push_front(palette);
-		return palette->m_texture;
+		for(unsigned int lane = 0; lane < laneCount; lane++)
+		{
+			lanes[lane] = (lanes[lane] ^ contents[i + lane]) * 0x01000193;
+		}
 	}
-
-	return 0;
+	uint64 hash = entryCount;
+	for(unsigned int lane = 0; lane < laneCount; lane++)
+	{
+		hash = (hash ^ lanes[lane]) * 0x9E3779B97F4A7C15ULL;
+		hash ^= (hash >> 32);
+	}
+	return hash;
 }
 
-GLuint CGSH_OpenGL::PalCache_Search(unsigned int entryCount, const uint32* contents)
+GLuint CGSH_OpenGL::PalCache_Search(const TEX0& tex0)
 {
-	for(auto paletteIterator(m_paletteCache.begin());
-	    paletteIterator != m_paletteCache.end(); paletteIterator++)
+	auto liveIterator = m_livePalettes.find(PalCache_GetKey(tex0));
+	if(liveIterator == std::end(m_livePalettes))
 	{
-		auto palette = *paletteIterator;
+		return 0;
+	}
 
-		if(palette->m_texture == 0) continue;
+	auto paletteIterator = liveIterator->second;
+	m_paletteCache.splice(m_paletteCache.begin(), m_paletteCache, paletteIterator);
+	return (*paletteIterator)->m_texture;
+}
 
-		unsigned int palEntryCount = palette->m_isIDTEX4 ? 16 : 256;
-		if(palEntryCount != entryCount) continue;
+GLuint CGSH_OpenGL::PalCache_Search(const TEX0& tex0, uint64 hash, const uint32* contents)
+{
+	bool isIDTEX4 = CGsPixelFormats::IsPsmIDTEX4(tex0.nPsm);
+	unsigned int entryCount = isIDTEX4 ? 16 : 256;
 
-		if(memcmp(contents, palette->m_contents, sizeof(uint32) * entryCount) != 0) continue;
+	auto hashRange = m_paletteHashes.equal_range(hash);
+	for(auto hashIterator = hashRange.first; hashIterator != hashRange.second; hashIterator++)
+	{
+		auto paletteIterator = hashIterator->second;
+		const auto& palette = *paletteIterator;
 
-		palette->m_live = true;
+		assert(palette->m_texture != 0);
+		if(palette->m_isIDTEX4 != isIDTEX4) continue;
+		if(memcmp(contents, palette->m_contents, sizeof(uint32) * entryCount) != 0) continue;
 
-		m_paletteCache.erase(paletteIterator);
-		m_paletteCache.push_front(palette);
+		PalCache_MakeLive(tex0, paletteIterator);
+		m_paletteCache.splice(m_paletteCache.begin(), m_paletteCache, paletteIterator);
 		return palette->m_texture;
 	}
 
 	return 0;
 }
 
-void CGSH_OpenGL::PalCache_Insert(const TEX0& tex0, const uint32* contents, GLuint textureHandle)
+void CGSH_OpenGL::PalCache_Insert(const TEX0& tex0, uint64 hash, const uint32* contents, GLuint textureHandle)
 {
-	auto texture = *m_paletteCache.rbegin();
-	texture->Free();
+	auto paletteIterator = std::prev(m_paletteCache.end());
+	auto palette = *paletteIterator;
+
+	if(palette->m_texture != 0)
+	{
+		//Evicted palette can be live for more than one CLUT area
+		for(auto liveIterator = m_livePalettes.begin(); liveIterator != m_livePalettes.end();)
+		{
+			if(liveIterator->second == paletteIterator)
+			{
+				liveIterator = m_livePalettes.erase(liveIterator);
+			}
+			else
+			{
+				liveIterator++;
+			}
+		}
+
+		auto hashRange = m_paletteHashes.equal_range(palette->m_hash);
+		for(auto hashIterator = hashRange.first; hashIterator != hashRange.second; hashIterator++)
+		{
+			if(hashIterator->second == paletteIterator)
+			{
+				m_paletteHashes.erase(hashIterator);
+				break;
+			}
+		}
+	}
+	palette->Free();
 
 	unsigned int entryCount = CGsPixelFormats::IsPsmIDTEX4(tex0.nPsm) ? 16 : 256;
 
-	texture->m_isIDTEX4 = CGsPixelFormats::IsPsmIDTEX4(tex0.nPsm);
-	texture->m_cpsm = tex0.nCPSM;
-	texture->m_csa = tex0.nCSA;
-	texture->m_texture = textureHandle;
-	texture->m_live = true;
-	memcpy(texture->m_contents, contents, entryCount * sizeof(uint32));
+	palette->m_isIDTEX4 = CGsPixelFormats::IsPsmIDTEX4(tex0.nPsm);
+	palette->m_cpsm = tex0.nCPSM;
+	palette->m_csa = tex0.nCSA;
+	palette->m_hash = hash;
+	palette->m_texture = textureHandle;
+	memcpy(palette->m_contents, contents, entryCount * sizeof(uint32));
 
-	m_paletteCache.pop_back();
-	m_paletteCache.push_front(texture);
+	m_paletteCache.splice(m_paletteCache.begin(), m_paletteCache, paletteIterator);
+	m_paletteHashes.emplace(hash, paletteIterator);
+	PalCache_MakeLive(tex0, paletteIterator);
+}
+
+void CGSH_OpenGL::PalCache_MakeLive(const TEX0& tex0, PaletteList::iterator paletteIterator)
+{
+	m_livePalettes[PalCache_GetKey(tex0)] = paletteIterator;
 }
 
 void CGSH_OpenGL::PalCache_Invalidate(uint32 csa)
 {
-	std::for_each(std::begin(m_paletteCache), std::end(m_paletteCache),
-	              [csa](PalettePtr& palette) { palette->Invalidate(csa); });
+	m_livePalettes.clear();
 }
 
 void CGSH_OpenGL::PalCache_Flush()
 {
+	m_livePalettes.clear();
+	m_paletteHashes.clear();
 	std::for_each(std::begin(m_paletteCache), std::end(m_paletteCache),
 	              [](PalettePtr& palette) { palette->Free(); });
 }
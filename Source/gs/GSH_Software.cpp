@@ -0,0 +1,1401 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include "GsPixelFormats.h"
+#include "GSH_Software.h"
+
+static int64 EdgeFunction(int32 startX, int32 startY, int32 endX, int32 endY, int32 x, int32 y)
+{
+	return static_cast<int64>(endX - startX) * static_cast<int64>(y - startY) -
+	       static_cast<int64>(endY - startY) * static_cast<int64>(x - startX);
+}
+
+static int32 ClampColor(int32 value)
+{
+	return std::min<int32>(std::max<int32>(value, 0), 0xFF);
+}
+
+static int32 WrapCoordinate(int32 coord, int32 size, unsigned int mode, int32 minCoord, int32 maxCoord)
+{
+	switch(mode)
+	{
+	default:
+	case 0:
+		//REPEAT
+		return coord & (size - 1);
+	case 1:
+		//CLAMP
+		return std::min<int32>(std::max<int32>(coord, 0), size - 1);
+	case 2:
+		//REGION_CLAMP
+		return std::min<int32>(std::max<int32>(coord, minCoord), maxCoord);
+	case 3:
+		//REGION_REPEAT
+		return (coord & minCoord) | maxCoord;
+	}
+}
+
+static uint32 ExpandColor16(uint16 color, const CGSHandler::TEXA& texA)
+{
+	uint32 rgb = ((color & 0x7C00) << 9) | ((color & 0x03E0) << 6) | ((color & 0x001F) << 3);
+	uint32 alpha = (color & 0x8000) ? texA.nTA1 : texA.nTA0;
+	if(texA.nAEM && (color & 0x7FFF) == 0) alpha = 0;
+	return rgb | (alpha << 24);
+}
+
+static uint16 PackColor16(uint32 color)
+{
+	return static_cast<uint16>(
+	    ((color >> 3) & 0x001F) |
+	    ((color >> 6) & 0x03E0) |
+	    ((color >> 9) & 0x7C00) |
+	    ((color >> 16) & 0x8000));
+}
+
+static bool IsPsm16(unsigned int psm)
+{
+	return (psm == CGSHandler::PSMCT16) || (psm == CGSHandler::PSMCT16S) ||
+	       (psm == CGSHandler::PSMZ16) || (psm == CGSHandler::PSMZ16S);
+}
+
+template <typename Storage>
+CGSH_Software::SURFACE CGSH_Software::MakeSurface(uint32 pointer, uint32 width)
+{
+	SURFACE surface;
+	surface.pointer = pointer;
+	surface.width = width * 64;
+	while((1U << surface.pageWidthShift) < Storage::PAGEWIDTH) surface.pageWidthShift++;
+	while((1U << surface.pageHeightShift) < Storage::PAGEHEIGHT) surface.pageHeightShift++;
+	surface.pageOffsets = CGsPixelFormats::CPixelIndexor<Storage>::GetPageOffsetTable();
+	return surface;
+}
+
+CGSH_Software::SURFACE CGSH_Software::MakeSurface(unsigned int psm, uint32 pointer, uint32 width)
+{
+	switch(psm)
+	{
+	case PSMCT16:
+		return MakeSurface<CGsPixelFormats::STORAGEPSMCT16>(pointer, width);
+	case PSMCT16S:
+		return MakeSurface<CGsPixelFormats::STORAGEPSMCT16S>(pointer, width);
+	case PSMZ16:
+		return MakeSurface<CGsPixelFormats::STORAGEPSMZ16>(pointer, width);
+	case PSMZ16S:
+		return MakeSurface<CGsPixelFormats::STORAGEPSMZ16S>(pointer, width);
+	default:
+		if((psm & 0x30) == 0x30)
+		{
+			return MakeSurface<CGsPixelFormats::STORAGEPSMZ32>(pointer, width);
+		}
+		return MakeSurface<CGsPixelFormats::STORAGEPSMCT32>(pointer, width);
+	}
+}
+
+//Same as what CPixelIndexor::GetPixelAddress does, page dimensions are powers of 2
+template <typename PixelType>
+PixelType* CGSH_Software::GetSurfacePixelAddress(const SURFACE& surface, uint32 x, uint32 y) const
+{
+	uint32 pageWidthMask = (1 << surface.pageWidthShift) - 1;
+	uint32 pageHeightMask = (1 << surface.pageHeightShift) - 1;
+	uint32 pageNum = (x >> surface.pageWidthShift) + (((y >> surface.pageHeightShift) * surface.width) >> surface.pageWidthShift);
+	uint32 pageOffset = surface.pageOffsets[((y & pageHeightMask) << surface.pageWidthShift) + (x & pageWidthMask)];
+	auto pixelAddr = m_pRAM + ((surface.pointer + (pageNum * CGsPixelFormats::PAGESIZE) + pageOffset) & (RAMSIZE - 1));
+	return reinterpret_cast<PixelType*>(pixelAddr);
+}
+
+CGSH_Software::CGSH_Software()
+{
+	//Page offset tables are lazily built, make sure this is done before workers use them
+	CGsPixelFormats::CPixelIndexorPSMCT32::InitializePageOffsetTable();
+	CGsPixelFormats::CPixelIndexorPSMZ32::InitializePageOffsetTable();
+	CGsPixelFormats::CPixelIndexorPSMCT16::InitializePageOffsetTable();
+	CGsPixelFormats::CPixelIndexorPSMCT16S::InitializePageOffsetTable();
+	CGsPixelFormats::CPixelIndexorPSMZ16::InitializePageOffsetTable();
+	CGsPixelFormats::CPixelIndexorPSMZ16S::InitializePageOffsetTable();
+	CGsPixelFormats::CPixelIndexorPSMT8::InitializePageOffsetTable();
+	CGsPixelFormats::CPixelIndexorPSMT4::InitializePageOffsetTable();
+
+	m_primitives.reserve(MAX_BATCH_PRIMITIVES);
+}
+
+CGSH_Software::~CGSH_Software()
+{
+}
+
+void CGSH_Software::InitializeImpl()
+{
+	uint32 threadCount = std::max<uint32>(std::thread::hardware_concurrency(), 1);
+	threadCount = std::min<uint32>(threadCount, MAX_WORKER_COUNT);
+
+	//GS thread takes part in the work
+	m_workersDone = false;
+	for(uint32 i = 1; i < threadCount; i++)
+	{
+		m_workerThreads.emplace_back([this]() { WorkerThreadProc(); });
+	}
+}
+
+void CGSH_Software::ReleaseImpl()
+{
+	FlushBatch();
+	{
+		std::lock_guard<std::mutex> workerLock(m_workerMutex);
+		m_workersDone = true;
+	}
+	m_workerCondition.notify_all();
+	for(auto& workerThread : m_workerThreads)
+	{
+		workerThread.join();
+	}
+	m_workerThreads.clear();
+}
+
+void CGSH_Software::ResetImpl()
+{
+	//Local memory was cleared, whatever is pending is not relevant anymore
+	for(auto binIndex : m_activeBins)
+	{
+		m_binPrimitives[binIndex].clear();
+	}
+	m_activeBins.clear();
+	m_primitives.clear();
+	m_drawContexts.clear();
+	m_vtxCount = 0;
+	m_primitiveType = PRIM_INVALID;
+	{
+		std::lock_guard<std::mutex> presentLock(m_presentMutex);
+		m_presentBuffer.clear();
+		m_presentWidth = 0;
+		m_presentHeight = 0;
+	}
+}
+
+void CGSH_Software::SaveState(Framework::CZipArchiveWriter& archive)
+{
+	//Make sure everything that was drawn is in local memory before it gets saved
+	SendGSCall([this]() { FlushBatch(); }, true);
+	CGSHandler::SaveState(archive);
+}
+
+void CGSH_Software::FlipImpl()
+{
+	FlushBatch();
+	UpdatePresentBuffer();
+	CGSHandler::FlipImpl();
+}
+
+void CGSH_Software::WriteRegisterImpl(uint8 registerId, uint64 data)
+{
+	switch(registerId)
+	{
+	case GS_REG_TEX0_1:
+	case GS_REG_TEX0_2:
+	case GS_REG_TEX2_1:
+	case GS_REG_TEX2_2:
+		//CLUT loads read from local memory
+		if(make_convertible<TEX0>(data).nCLD != 0)
+		{
+			FlushBatch();
+		}
+		break;
+	case GS_REG_TRXDIR:
+		//Transfers access local memory
+		FlushBatch();
+		break;
+	}
+
+	CGSHandler::WriteRegisterImpl(registerId, data);
+
+	switch(registerId)
+	{
+	case GS_REG_PRIM:
+		m_primitiveType = static_cast<unsigned int>(data & 0x07);
+		switch(m_primitiveType)
+		{
+		case PRIM_POINT:
+			m_vtxCount = 1;
+			break;
+		case PRIM_LINE:
+		case PRIM_LINESTRIP:
+			m_vtxCount = 2;
+			break;
+		case PRIM_TRIANGLE:
+		case PRIM_TRIANGLESTRIP:
+		case PRIM_TRIANGLEFAN:
+			m_vtxCount = 3;
+			break;
+		case PRIM_SPRITE:
+			m_vtxCount = 2;
+			break;
+		default:
+			m_vtxCount = 0;
+			break;
+		}
+		break;
+
+	case GS_REG_XYZ2:
+	case GS_REG_XYZ3:
+	case GS_REG_XYZF2:
+	case GS_REG_XYZF3:
+		VertexKick(registerId, data);
+		break;
+	}
+}
+
+void CGSH_Software::ProcessVertexBatch(const RegisterWrite* writes, uint32 writeCount)
+{
+	m_vertexBatchActive = true;
+	m_vertexBatchContextIndex = INVALID_CONTEXT_INDEX;
+	for(uint32 i = 0; i < writeCount; i++)
+	{
+		uint8 registerId = writes[i].first;
+		uint64 data = writes[i].second;
+		m_nReg[registerId] = data;
+#ifdef _DEBUG
+		LogWrite(registerId, data);
+#endif
+		switch(registerId)
+		{
+		case GS_REG_XYZ2:
+		case GS_REG_XYZ3:
+		case GS_REG_XYZF2:
+		case GS_REG_XYZF3:
+			VertexKick(registerId, data);
+			break;
+		}
+	}
+	m_vertexBatchActive = false;
+	m_vertexBatchContextIndex = INVALID_CONTEXT_INDEX;
+}
+
+void CGSH_Software::VertexKick(uint8 registerId, uint64 value)
+{
+	if(m_vtxCount == 0) return;
+
+	bool drawingKick = (registerId == GS_REG_XYZ2) || (registerId == GS_REG_XYZF2);
+	bool fog = (registerId == GS_REG_XYZF2) || (registerId == GS_REG_XYZF3);
+
+	if(!m_drawEnabled) drawingKick = false;
+
+	auto& vertex = m_vtxBuffer[m_vtxCount - 1];
+	vertex.nPosition = fog ? (value & 0x00FFFFFFFFFFFFFFULL) : value;
+	vertex.nRGBAQ = m_nReg[GS_REG_RGBAQ];
+	vertex.nUV = m_nReg[GS_REG_UV];
+	vertex.nST = m_nReg[GS_REG_ST];
+	vertex.nFog = fog ? static_cast<uint8>(value >> 56) : static_cast<uint8>(m_nReg[GS_REG_FOG] >> 56);
+
+	m_vtxCount--;
+
+	if(m_vtxCount != 0) return;
+
+	if((m_nReg[GS_REG_PRMODECONT] & 1) != 0)
+	{
+		m_primitiveMode <<= m_nReg[GS_REG_PRIM];
+	}
+	else
+	{
+		m_primitiveMode <<= m_nReg[GS_REG_PRMODE];
+	}
+
+	switch(m_primitiveType)
+	{
+	case PRIM_POINT:
+		if(drawingKick) Prim_Point();
+		m_vtxCount = 1;
+		break;
+	case PRIM_LINE:
+		if(drawingKick) Prim_Line();
+		m_vtxCount = 2;
+		break;
+	case PRIM_LINESTRIP:
+		if(drawingKick) Prim_Line();
+		m_vtxBuffer[1] = m_vtxBuffer[0];
+		m_vtxCount = 1;
+		break;
+	case PRIM_TRIANGLE:
+		if(drawingKick) Prim_Triangle();
+		m_vtxCount = 3;
+		break;
+	case PRIM_TRIANGLESTRIP:
+		if(drawingKick) Prim_Triangle();
+		m_vtxBuffer[2] = m_vtxBuffer[1];
+		m_vtxBuffer[1] = m_vtxBuffer[0];
+		m_vtxCount = 1;
+		break;
+	case PRIM_TRIANGLEFAN:
+		if(drawingKick) Prim_Triangle();
+		m_vtxBuffer[1] = m_vtxBuffer[0];
+		m_vtxCount = 1;
+		break;
+	case PRIM_SPRITE:
+		if(drawingKick) Prim_Sprite();
+		m_vtxCount = 2;
+		break;
+	}
+}
+
+/////////////////////////////////////////////////////////////
+// Primitive setup
+/////////////////////////////////////////////////////////////
+
+CGSH_Software::RASTER_VERTEX CGSH_Software::MakeRasterVertex(const VERTEX& vertex, const XYOFFSET& offset, bool useUV) const
+{
+	auto xyz = make_convertible<XYZ>(vertex.nPosition);
+	auto rgbaq = make_convertible<RGBAQ>(vertex.nRGBAQ);
+
+	RASTER_VERTEX result;
+	result.x = static_cast<int32>(xyz.nX) - static_cast<int32>(offset.nOffsetX);
+	result.y = static_cast<int32>(xyz.nY) - static_cast<int32>(offset.nOffsetY);
+	result.z = static_cast<double>(xyz.nZ);
+	result.color[0] = rgbaq.nR;
+	result.color[1] = rgbaq.nG;
+	result.color[2] = rgbaq.nB;
+	result.color[3] = rgbaq.nA;
+	if(useUV)
+	{
+		auto uv = make_convertible<UV>(vertex.nUV);
+		result.s = uv.GetU();
+		result.t = uv.GetV();
+		result.q = 1;
+	}
+	else
+	{
+		auto st = make_convertible<ST>(vertex.nST);
+		result.s = st.nS;
+		result.t = st.nT;
+		result.q = rgbaq.nQ;
+	}
+	result.fog = vertex.nFog;
+	return result;
+}
+
+void CGSH_Software::SetupPrimitive(PRIMITIVE& primitive, unsigned int type)
+{
+	primitive.type = type;
+	primitive.contextIndex = 0;
+	primitive.gouraud = (m_primitiveMode.nShading != 0);
+	primitive.textured = (m_primitiveMode.nTexture != 0);
+	primitive.useUV = (m_primitiveMode.nUseUV != 0);
+	primitive.fog = (m_primitiveMode.nFog != 0);
+	primitive.alphaBlend = (m_primitiveMode.nAlpha != 0);
+}
+
+void CGSH_Software::Prim_Point()
+{
+	auto offset = make_convertible<XYOFFSET>(m_nReg[GS_REG_XYOFFSET_1 + m_primitiveMode.nContext]);
+
+	PRIMITIVE primitive;
+	SetupPrimitive(primitive, PRIM_POINT);
+	primitive.vertices[0] = MakeRasterVertex(m_vtxBuffer[0], offset, primitive.useUV);
+
+	const auto& vertex = primitive.vertices[0];
+	primitive.minX = primitive.maxX = (vertex.x + 8) >> 4;
+	primitive.minY = primitive.maxY = (vertex.y + 8) >> 4;
+
+	SubmitPrimitive(primitive);
+}
+
+void CGSH_Software::Prim_Line()
+{
+	auto offset = make_convertible<XYOFFSET>(m_nReg[GS_REG_XYOFFSET_1 + m_primitiveMode.nContext]);
+
+	PRIMITIVE primitive;
+	SetupPrimitive(primitive, PRIM_LINE);
+	primitive.vertices[0] = MakeRasterVertex(m_vtxBuffer[1], offset, primitive.useUV);
+	primitive.vertices[1] = MakeRasterVertex(m_vtxBuffer[0], offset, primitive.useUV);
+
+	auto& v0 = primitive.vertices[0];
+	auto& v1 = primitive.vertices[1];
+	if(!primitive.gouraud)
+	{
+		std::copy(std::begin(v1.color), std::end(v1.color), std::begin(v0.color));
+	}
+
+	primitive.minX = (std::min(v0.x, v1.x) + 8) >> 4;
+	primitive.minY = (std::min(v0.y, v1.y) + 8) >> 4;
+	primitive.maxX = (std::max(v0.x, v1.x) + 8) >> 4;
+	primitive.maxY = (std::max(v0.y, v1.y) + 8) >> 4;
+
+	SubmitPrimitive(primitive);
+}
+
+void CGSH_Software::Prim_Triangle()
+{
+	auto offset = make_convertible<XYOFFSET>(m_nReg[GS_REG_XYOFFSET_1 + m_primitiveMode.nContext]);
+
+	PRIMITIVE primitive;
+	SetupPrimitive(primitive, PRIM_TRIANGLE);
+	for(unsigned int i = 0; i < 3; i++)
+	{
+		primitive.vertices[i] = MakeRasterVertex(m_vtxBuffer[i], offset, primitive.useUV);
+	}
+
+	auto& v0 = primitive.vertices[0];
+	auto& v1 = primitive.vertices[1];
+	auto& v2 = primitive.vertices[2];
+
+	//Last vertex kicked (index 0) provides the color for flat shading
+	if(!primitive.gouraud)
+	{
+		std::copy(std::begin(v0.color), std::end(v0.color), std::begin(v1.color));
+		std::copy(std::begin(v0.color), std::end(v0.color), std::begin(v2.color));
+	}
+
+	//There's no culling on the GS, make sure all triangles have the same winding
+	int64 area = EdgeFunction(v0.x, v0.y, v1.x, v1.y, v2.x, v2.y);
+	if(area == 0) return;
+	if(area < 0)
+	{
+		std::swap(v1, v2);
+	}
+
+	primitive.minX = (std::min({v0.x, v1.x, v2.x}) + 15) >> 4;
+	primitive.minY = (std::min({v0.y, v1.y, v2.y}) + 15) >> 4;
+	primitive.maxX = std::max({v0.x, v1.x, v2.x}) >> 4;
+	primitive.maxY = std::max({v0.y, v1.y, v2.y}) >> 4;
+
+	SubmitPrimitive(primitive);
+}
+
+void CGSH_Software::Prim_Sprite()
+{
+	auto offset = make_convertible<XYOFFSET>(m_nReg[GS_REG_XYOFFSET_1 + m_primitiveMode.nContext]);
+
+	PRIMITIVE primitive;
+	SetupPrimitive(primitive, PRIM_SPRITE);
+	primitive.vertices[0] = MakeRasterVertex(m_vtxBuffer[1], offset, primitive.useUV);
+	primitive.vertices[1] = MakeRasterVertex(m_vtxBuffer[0], offset, primitive.useUV);
+
+	const auto& v0 = primitive.vertices[0];
+	const auto& v1 = primitive.vertices[1];
+
+	//Pixels are covered if their top left corner is inside the rectangle
+	primitive.minX = (std::min(v0.x, v1.x) + 15) >> 4;
+	primitive.minY = (std::min(v0.y, v1.y) + 15) >> 4;
+	primitive.maxX = ((std::max(v0.x, v1.x) + 15) >> 4) - 1;
+	primitive.maxY = ((std::max(v0.y, v1.y) + 15) >> 4) - 1;
+
+	SubmitPrimitive(primitive);
+}
+
+uint32 CGSH_Software::GetDrawContextIndex(unsigned int contextId)
+{
+	DRAW_CONTEXT context;
+	context.frameReg = m_nReg[GS_REG_FRAME_1 + contextId];
+	context.zbufReg = m_nReg[GS_REG_ZBUF_1 + contextId];
+	context.testReg = m_nReg[GS_REG_TEST_1 + contextId];
+	context.alphaReg = m_nReg[GS_REG_ALPHA_1 + contextId];
+	context.tex0Reg = m_nReg[GS_REG_TEX0_1 + contextId];
+	context.clampReg = m_nReg[GS_REG_CLAMP_1 + contextId];
+	context.scissorReg = m_nReg[GS_REG_SCISSOR_1 + contextId];
+	context.texAReg = m_nReg[GS_REG_TEXA];
+	context.fogColReg = m_nReg[GS_REG_FOGCOL];
+	context.pabeReg = m_nReg[GS_REG_PABE];
+	context.fbaReg = m_nReg[GS_REG_FBA_1 + contextId];
+	context.colClampReg = m_nReg[GS_REG_COLCLAMP];
+	context.clutVersion = m_clutVersion;
+
+	if(!m_drawContexts.empty())
+	{
+		const auto& lastContext = m_drawContexts.back();
+		if(memcmp(&lastContext, &context, offsetof(DRAW_CONTEXT, clut)) == 0)
+		{
+			return static_cast<uint32>(m_drawContexts.size() - 1);
+		}
+	}
+
+	auto frame = make_convertible<FRAME>(context.frameReg);
+	auto zbuf = make_convertible<ZBUF>(context.zbufReg);
+	auto tex0 = make_convertible<TEX0>(context.tex0Reg);
+	context.frameSurface = MakeSurface(frame.nPsm, frame.GetBasePtr(), frame.nWidth);
+	context.depthSurface = MakeSurface(zbuf.nPsm | 0x30, zbuf.GetBasePtr(), frame.nWidth);
+	switch(tex0.nPsm)
+	{
+	case PSMT8:
+		context.textureSurface = MakeSurface<CGsPixelFormats::STORAGEPSMT8>(tex0.GetBufPtr(), tex0.nBufWidth);
+		break;
+	case PSMT4:
+		//Nibbles don't have a page offset table, sampled through their indexor
+		break;
+	default:
+		context.textureSurface = MakeSurface(tex0.nPsm, tex0.GetBufPtr(), tex0.nBufWidth);
+		break;
+	}
+
+	if(CGsPixelFormats::IsPsmIDTEX(tex0.nPsm))
+	{
+		MakeLinearCLUT(tex0, context.clut);
+		if((tex0.nCPSM == PSMCT16) || (tex0.nCPSM == PSMCT16S))
+		{
+			//Linear CLUT only has fully opaque or transparent entries, apply TEXA on them
+			auto texA = make_convertible<TEXA>(context.texAReg);
+			for(auto& color : context.clut)
+			{
+				uint32 alpha = (color & 0x80000000) ? texA.nTA1 : texA.nTA0;
+				if(texA.nAEM && ((color & 0x00FFFFFF) == 0) && ((color & 0x80000000) == 0)) alpha = 0;
+				color = (color & 0x00FFFFFF) | (alpha << 24);
+			}
+		}
+	}
+
+	m_drawContexts.push_back(context);
+	return static_cast<uint32>(m_drawContexts.size() - 1);
+}
+
+void CGSH_Software::SubmitPrimitive(const PRIMITIVE& source)
+{
+	unsigned int contextId = m_primitiveMode.nContext;
+
+	//Batches only target a single frame and depth buffer, this keeps render to texture effects ordered
+	bool contextCached = (m_vertexBatchContextIndex != INVALID_CONTEXT_INDEX);
+	if(!contextCached && !m_primitives.empty())
+	{
+		const auto& batchContext = m_drawContexts[m_primitives[0].contextIndex];
+		if(
+		    (batchContext.frameReg != m_nReg[GS_REG_FRAME_1 + contextId]) ||
+		    (batchContext.zbufReg != m_nReg[GS_REG_ZBUF_1 + contextId]))
+		{
+			FlushBatch();
+		}
+	}
+	if(m_primitives.size() == MAX_BATCH_PRIMITIVES)
+	{
+		FlushBatch();
+		contextCached = false;
+	}
+
+	auto scissor = make_convertible<SCISSOR>(m_nReg[GS_REG_SCISSOR_1 + contextId]);
+
+	PRIMITIVE primitive = source;
+	primitive.minX = std::max<int32>(primitive.minX, scissor.scax0);
+	primitive.minY = std::max<int32>(primitive.minY, scissor.scay0);
+	primitive.maxX = std::min<int32>(primitive.maxX, scissor.scax1);
+	primitive.maxY = std::min<int32>(primitive.maxY, scissor.scay1);
+	if((primitive.minX > primitive.maxX) || (primitive.minY > primitive.maxY)) return;
+
+	if(contextCached)
+	{
+		primitive.contextIndex = m_vertexBatchContextIndex;
+	}
+	else
+	{
+		primitive.contextIndex = GetDrawContextIndex(contextId);
+		if(m_vertexBatchActive) m_vertexBatchContextIndex = primitive.contextIndex;
+	}
+
+	uint32 primitiveIndex = static_cast<uint32>(m_primitives.size());
+	m_primitives.push_back(primitive);
+
+	for(int32 binY = primitive.minY / BIN_SIZE; binY <= primitive.maxY / BIN_SIZE; binY++)
+	{
+		for(int32 binX = primitive.minX / BIN_SIZE; binX <= primitive.maxX / BIN_SIZE; binX++)
+		{
+			uint32 binIndex = binX + (binY * BIN_COUNT);
+			auto& binPrimitives = m_binPrimitives[binIndex];
+			if(binPrimitives.empty())
+			{
+				m_activeBins.push_back(binIndex);
+			}
+			binPrimitives.push_back(primitiveIndex);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////
+// Batch processing
+/////////////////////////////////////////////////////////////
+
+void CGSH_Software::FlushBatch()
+{
+	if(m_primitives.empty()) return;
+
+	m_nextBin = 0;
+	if(!m_workerThreads.empty())
+	{
+		{
+			std::lock_guard<std::mutex> workerLock(m_workerMutex);
+			m_busyWorkerCount = static_cast<uint32>(m_workerThreads.size());
+			m_workerGeneration++;
+		}
+		m_workerCondition.notify_all();
+	}
+
+	ProcessBins();
+
+	if(!m_workerThreads.empty())
+	{
+		std::unique_lock<std::mutex> workerLock(m_workerMutex);
+		m_workerDoneCondition.wait(workerLock, [this]() { return m_busyWorkerCount == 0; });
+	}
+
+	for(auto binIndex : m_activeBins)
+	{
+		m_binPrimitives[binIndex].clear();
+	}
+	m_activeBins.clear();
+	m_primitives.clear();
+	m_drawContexts.clear();
+	m_vertexBatchContextIndex = INVALID_CONTEXT_INDEX;
+	m_drawCallCount++;
+
+	//Primitives are rendered to local memory and might have overwritten CLUT data
+	InvalidateClutSource(0, RAMSIZE);
+}
+
+void CGSH_Software::ProcessBins()
+{
+	uint32 binCount = static_cast<uint32>(m_activeBins.size());
+	while(1)
+	{
+		uint32 binIndex = m_nextBin++;
+		if(binIndex >= binCount) break;
+		RasterizeBin(m_activeBins[binIndex]);
+	}
+}
+
+void CGSH_Software::WorkerThreadProc()
+{
+	uint32 generation = 0;
+	while(1)
+	{
+		{
+			std::unique_lock<std::mutex> workerLock(m_workerMutex);
+			m_workerCondition.wait(workerLock, [&]() { return m_workersDone || (m_workerGeneration != generation); });
+			if(m_workersDone) break;
+			generation = m_workerGeneration;
+		}
+		ProcessBins();
+		{
+			std::lock_guard<std::mutex> workerLock(m_workerMutex);
+			m_busyWorkerCount--;
+		}
+		m_workerDoneCondition.notify_one();
+	}
+}
+
+/////////////////////////////////////////////////////////////
+// Rasterization
+/////////////////////////////////////////////////////////////
+
+void CGSH_Software::RasterizeBin(uint32 binIndex)
+{
+	int32 binX = (binIndex % BIN_COUNT) * BIN_SIZE;
+	int32 binY = (binIndex / BIN_COUNT) * BIN_SIZE;
+
+	//Primitives are processed in submission order, which keeps blending and depth testing correct
+	for(auto primitiveIndex : m_binPrimitives[binIndex])
+	{
+		const auto& primitive = m_primitives[primitiveIndex];
+
+		BIN_RECT rect;
+		rect.minX = std::max<int32>(primitive.minX, binX);
+		rect.minY = std::max<int32>(primitive.minY, binY);
+		rect.maxX = std::min<int32>(primitive.maxX, binX + BIN_SIZE - 1);
+		rect.maxY = std::min<int32>(primitive.maxY, binY + BIN_SIZE - 1);
+
+		switch(primitive.type)
+		{
+		case PRIM_POINT:
+			RasterizePoint(primitive, rect);
+			break;
+		case PRIM_LINE:
+			RasterizeLine(primitive, rect);
+			break;
+		case PRIM_TRIANGLE:
+			RasterizeTriangle(primitive, rect);
+			break;
+		case PRIM_SPRITE:
+			RasterizeSprite(primitive, rect);
+			break;
+		}
+	}
+}
+
+void CGSH_Software::RasterizePoint(const PRIMITIVE& primitive, const BIN_RECT& rect)
+{
+	const auto& context = m_drawContexts[primitive.contextIndex];
+	const auto& vertex = primitive.vertices[0];
+
+	PIXEL pixel;
+	std::copy(std::begin(vertex.color), std::end(vertex.color), std::begin(pixel.color));
+	pixel.z = vertex.z;
+	pixel.s = vertex.s;
+	pixel.t = vertex.t;
+	pixel.q = vertex.q;
+	pixel.fog = vertex.fog;
+
+	ShadePixel(context, primitive, rect.minX, rect.minY, pixel);
+}
+
+void CGSH_Software::RasterizeLine(const PRIMITIVE& primitive, const BIN_RECT& rect)
+{
+	const auto& context = m_drawContexts[primitive.contextIndex];
+	const auto& v0 = primitive.vertices[0];
+	const auto& v1 = primitive.vertices[1];
+
+	int32 x0 = (v0.x + 8) >> 4;
+	int32 y0 = (v0.y + 8) >> 4;
+	int32 dx = ((v1.x + 8) >> 4) - x0;
+	int32 dy = ((v1.y + 8) >> 4) - y0;
+	int32 stepCount = std::max(std::abs(dx), std::abs(dy));
+
+	//Last pixel is left out to avoid drawing shared line strip vertices twice
+	for(int32 step = 0; step < std::max(stepCount, 1); step++)
+	{
+		float factor = (stepCount != 0) ? static_cast<float>(step) / static_cast<float>(stepCount) : 0;
+		int32 x = x0 + static_cast<int32>(std::lround(dx * factor));
+		int32 y = y0 + static_cast<int32>(std::lround(dy * factor));
+		if((x < rect.minX) || (x > rect.maxX) || (y < rect.minY) || (y > rect.maxY)) continue;
+
+		PIXEL pixel;
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			pixel.color[i] = v0.color[i] + (v1.color[i] - v0.color[i]) * factor;
+		}
+		pixel.z = v0.z + (v1.z - v0.z) * factor;
+		pixel.s = v0.s + (v1.s - v0.s) * factor;
+		pixel.t = v0.t + (v1.t - v0.t) * factor;
+		pixel.q = v0.q + (v1.q - v0.q) * factor;
+		pixel.fog = v0.fog + (v1.fog - v0.fog) * factor;
+
+		ShadePixel(context, primitive, x, y, pixel);
+	}
+}
+
+void CGSH_Software::RasterizeTriangle(const PRIMITIVE& primitive, const BIN_RECT& rect)
+{
+	const auto& context = m_drawContexts[primitive.contextIndex];
+	const auto& v0 = primitive.vertices[0];
+	const auto& v1 = primitive.vertices[1];
+	const auto& v2 = primitive.vertices[2];
+
+	//Edge i is the one facing vertex i
+	const RASTER_VERTEX* edgeStarts[3] = {&v1, &v2, &v0};
+	const RASTER_VERTEX* edgeEnds[3] = {&v2, &v0, &v1};
+
+	double invArea = 1.0 / static_cast<double>(EdgeFunction(v0.x, v0.y, v1.x, v1.y, v2.x, v2.y));
+
+	int64 stepX[3];
+	int64 stepY[3];
+	int64 bias[3];
+	int64 rowValues[3];
+	for(unsigned int i = 0; i < 3; i++)
+	{
+		const auto& start = *edgeStarts[i];
+		const auto& end = *edgeEnds[i];
+		int32 dx = end.x - start.x;
+		int32 dy = end.y - start.y;
+		stepX[i] = -static_cast<int64>(dy) * 16;
+		stepY[i] = static_cast<int64>(dx) * 16;
+		//Top-left fill convention, pixels on other edges belong to the neighbouring triangle
+		bias[i] = ((dy < 0) || ((dy == 0) && (dx > 0))) ? 0 : -1;
+		rowValues[i] = EdgeFunction(start.x, start.y, end.x, end.y, rect.minX * 16, rect.minY * 16);
+	}
+
+	for(int32 y = rect.minY; y <= rect.maxY; y++)
+	{
+		int64 spanValues[3] = {rowValues[0], rowValues[1], rowValues[2]};
+		for(int32 x = rect.minX; x <= rect.maxX; x += SPAN_WIDTH)
+		{
+			//Evaluate coverage for the whole span at once
+			int64 laneValues[3][SPAN_WIDTH];
+			for(unsigned int i = 0; i < 3; i++)
+			{
+				for(unsigned int lane = 0; lane < SPAN_WIDTH; lane++)
+				{
+					laneValues[i][lane] = spanValues[i] + stepX[i] * lane;
+				}
+			}
+			unsigned int coverageMask = 0;
+			for(unsigned int lane = 0; lane < SPAN_WIDTH; lane++)
+			{
+				bool covered =
+				    ((laneValues[0][lane] + bias[0]) >= 0) &&
+				    ((laneValues[1][lane] + bias[1]) >= 0) &&
+				    ((laneValues[2][lane] + bias[2]) >= 0);
+				coverageMask |= covered ? (1 << lane) : 0;
+			}
+			for(unsigned int i = 0; i < 3; i++)
+			{
+				spanValues[i] += stepX[i] * SPAN_WIDTH;
+			}
+			if(coverageMask == 0) continue;
+
+			for(unsigned int lane = 0; lane < SPAN_WIDTH; lane++)
+			{
+				if((coverageMask & (1 << lane)) == 0) continue;
+				if((x + static_cast<int32>(lane)) > rect.maxX) break;
+
+				double w0 = static_cast<double>(laneValues[0][lane]) * invArea;
+				double w1 = static_cast<double>(laneValues[1][lane]) * invArea;
+				double w2 = 1.0 - w0 - w1;
+				float fw0 = static_cast<float>(w0);
+				float fw1 = static_cast<float>(w1);
+				float fw2 = static_cast<float>(w2);
+
+				PIXEL pixel;
+				for(unsigned int i = 0; i < 4; i++)
+				{
+					pixel.color[i] = v0.color[i] * fw0 + v1.color[i] * fw1 + v2.color[i] * fw2;
+				}
+				pixel.z = v0.z * w0 + v1.z * w1 + v2.z * w2;
+				pixel.s = v0.s * fw0 + v1.s * fw1 + v2.s * fw2;
+				pixel.t = v0.t * fw0 + v1.t * fw1 + v2.t * fw2;
+				pixel.q = v0.q * fw0 + v1.q * fw1 + v2.q * fw2;
+				pixel.fog = v0.fog * fw0 + v1.fog * fw1 + v2.fog * fw2;
+
+				ShadePixel(context, primitive, x + lane, y, pixel);
+			}
+		}
+		for(unsigned int i = 0; i < 3; i++)
+		{
+			rowValues[i] += stepY[i];
+		}
+	}
+}
+
+void CGSH_Software::RasterizeSprite(const PRIMITIVE& primitive, const BIN_RECT& rect)
+{
+	const auto& context = m_drawContexts[primitive.contextIndex];
+	const auto& v0 = primitive.vertices[0];
+	const auto& v1 = primitive.vertices[1];
+
+	float sStep = (v1.x != v0.x) ? (v1.s - v0.s) / static_cast<float>(v1.x - v0.x) : 0;
+	float qStep = (v1.x != v0.x) ? (v1.q - v0.q) / static_cast<float>(v1.x - v0.x) : 0;
+	float tStep = (v1.y != v0.y) ? (v1.t - v0.t) / static_cast<float>(v1.y - v0.y) : 0;
+
+	//Sprites take all their other attributes from the second vertex
+	PIXEL pixel;
+	std::copy(std::begin(v1.color), std::end(v1.color), std::begin(pixel.color));
+	pixel.z = v1.z;
+	pixel.fog = v1.fog;
+
+	for(int32 y = rect.minY; y <= rect.maxY; y++)
+	{
+		pixel.t = v0.t + static_cast<float>((y * 16) - v0.y) * tStep;
+		for(int32 x = rect.minX; x <= rect.maxX; x++)
+		{
+			pixel.s = v0.s + static_cast<float>((x * 16) - v0.x) * sStep;
+			pixel.q = v0.q + static_cast<float>((x * 16) - v0.x) * qStep;
+			ShadePixel(context, primitive, x, y, pixel);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////
+// Pixel pipeline
+/////////////////////////////////////////////////////////////
+
+uint32 CGSH_Software::SampleTexture(const DRAW_CONTEXT& context, int32 u, int32 v)
+{
+	auto tex0 = make_convertible<TEX0>(context.tex0Reg);
+	auto clamp = make_convertible<CLAMP>(context.clampReg);
+	auto texA = make_convertible<TEXA>(context.texAReg);
+
+	u = WrapCoordinate(u, tex0.GetWidth(), clamp.nWMS, clamp.GetMinU(), clamp.GetMaxU());
+	v = WrapCoordinate(v, tex0.GetHeight(), clamp.nWMT, clamp.GetMinV(), clamp.GetMaxV());
+
+	const auto& surface = context.textureSurface;
+
+	switch(tex0.nPsm)
+	{
+	case PSMCT32:
+	case PSMZ32:
+		return *GetSurfacePixelAddress<uint32>(surface, u, v);
+	case PSMCT24:
+	case PSMZ24:
+	{
+		uint32 color = *GetSurfacePixelAddress<uint32>(surface, u, v) & 0x00FFFFFF;
+		uint32 alpha = (texA.nAEM && (color == 0)) ? 0 : texA.nTA0;
+		return color | (alpha << 24);
+	}
+	case PSMCT16:
+	case PSMCT16S:
+	case PSMZ16:
+	case PSMZ16S:
+		return ExpandColor16(*GetSurfacePixelAddress<uint16>(surface, u, v), texA);
+	case PSMT8:
+		return context.clut[*GetSurfacePixelAddress<uint8>(surface, u, v)];
+	case PSMT4:
+	{
+		CGsPixelFormats::CPixelIndexorPSMT4 indexor(m_pRAM, tex0.GetBufPtr(), tex0.nBufWidth);
+		return context.clut[indexor.GetPixel(u, v)];
+	}
+	case PSMT8H:
+		return context.clut[*GetSurfacePixelAddress<uint32>(surface, u, v) >> 24];
+	case PSMT4HL:
+		return context.clut[(*GetSurfacePixelAddress<uint32>(surface, u, v) >> 24) & 0x0F];
+	case PSMT4HH:
+		return context.clut[*GetSurfacePixelAddress<uint32>(surface, u, v) >> 28];
+	default:
+		return 0;
+	}
+}
+
+void CGSH_Software::ShadePixel(const DRAW_CONTEXT& context, const PRIMITIVE& primitive, int32 x, int32 y, const PIXEL& pixel)
+{
+	auto frame = make_convertible<FRAME>(context.frameReg);
+	auto zbuf = make_convertible<ZBUF>(context.zbufReg);
+	auto test = make_convertible<TEST>(context.testReg);
+
+	int32 color[4];
+	for(unsigned int i = 0; i < 4; i++)
+	{
+		color[i] = ClampColor(static_cast<int32>(pixel.color[i]));
+	}
+
+	if(primitive.textured)
+	{
+		auto tex0 = make_convertible<TEX0>(context.tex0Reg);
+		int32 u = 0;
+		int32 v = 0;
+		if(primitive.useUV)
+		{
+			u = static_cast<int32>(std::floor(pixel.s));
+			v = static_cast<int32>(std::floor(pixel.t));
+		}
+		else
+		{
+			float q = (pixel.q != 0) ? pixel.q : 1.0f;
+			u = static_cast<int32>(std::floor((pixel.s / q) * static_cast<float>(tex0.GetWidth())));
+			v = static_cast<int32>(std::floor((pixel.t / q) * static_cast<float>(tex0.GetHeight())));
+		}
+
+		uint32 texel = SampleTexture(context, u, v);
+		int32 texColor[4] =
+		    {
+		        static_cast<int32>((texel >> 0) & 0xFF),
+		        static_cast<int32>((texel >> 8) & 0xFF),
+		        static_cast<int32>((texel >> 16) & 0xFF),
+		        static_cast<int32>((texel >> 24) & 0xFF),
+		    };
+		bool useTexAlpha = (tex0.nColorComp != 0);
+
+		switch(tex0.nFunction)
+		{
+		case TEX0_FUNCTION_MODULATE:
+			for(unsigned int i = 0; i < 3; i++)
+			{
+				color[i] = ClampColor((texColor[i] * color[i]) >> 7);
+			}
+			if(useTexAlpha) color[3] = ClampColor((texColor[3] * color[3]) >> 7);
+			break;
+		case TEX0_FUNCTION_DECAL:
+			for(unsigned int i = 0; i < 3; i++)
+			{
+				color[i] = texColor[i];
+			}
+			if(useTexAlpha) color[3] = texColor[3];
+			break;
+		case TEX0_FUNCTION_HIGHLIGHT:
+			for(unsigned int i = 0; i < 3; i++)
+			{
+				color[i] = ClampColor(((texColor[i] * color[i]) >> 7) + color[3]);
+			}
+			if(useTexAlpha) color[3] = ClampColor(texColor[3] + color[3]);
+			break;
+		case TEX0_FUNCTION_HIGHLIGHT2:
+			for(unsigned int i = 0; i < 3; i++)
+			{
+				color[i] = ClampColor(((texColor[i] * color[i]) >> 7) + color[3]);
+			}
+			if(useTexAlpha) color[3] = texColor[3];
+			break;
+		}
+	}
+
+	if(primitive.fog)
+	{
+		auto fogCol = make_convertible<FOGCOL>(context.fogColReg);
+		int32 fogColor[3] = {static_cast<int32>(fogCol.nFCR), static_cast<int32>(fogCol.nFCG), static_cast<int32>(fogCol.nFCB)};
+		int32 fog = ClampColor(static_cast<int32>(pixel.fog));
+		for(unsigned int i = 0; i < 3; i++)
+		{
+			color[i] = ((fog * color[i]) + ((0xFF - fog) * fogColor[i])) >> 8;
+		}
+	}
+
+	//Alpha test
+	bool frameWrite = true;
+	bool alphaWrite = true;
+	bool depthWrite = (zbuf.nMask == 0);
+	if(test.nAlphaEnabled)
+	{
+		int32 alpha = color[3];
+		int32 alphaRef = test.nAlphaRef;
+		bool alphaPassed = true;
+		switch(test.nAlphaMethod)
+		{
+		case ALPHA_TEST_NEVER:
+			alphaPassed = false;
+			break;
+		case ALPHA_TEST_ALWAYS:
+			break;
+		case ALPHA_TEST_LESS:
+			alphaPassed = (alpha < alphaRef);
+			break;
+		case ALPHA_TEST_LEQUAL:
+			alphaPassed = (alpha <= alphaRef);
+			break;
+		case ALPHA_TEST_EQUAL:
+			alphaPassed = (alpha == alphaRef);
+			break;
+		case ALPHA_TEST_GEQUAL:
+			alphaPassed = (alpha >= alphaRef);
+			break;
+		case ALPHA_TEST_GREATER:
+			alphaPassed = (alpha > alphaRef);
+			break;
+		case ALPHA_TEST_NOTEQUAL:
+			alphaPassed = (alpha != alphaRef);
+			break;
+		}
+		if(!alphaPassed)
+		{
+			switch(test.nAlphaFail)
+			{
+			case ALPHA_TEST_FAIL_KEEP:
+				return;
+			case ALPHA_TEST_FAIL_FBONLY:
+				depthWrite = false;
+				break;
+			case ALPHA_TEST_FAIL_ZBONLY:
+				frameWrite = false;
+				break;
+			case ALPHA_TEST_FAIL_RGBONLY:
+				depthWrite = false;
+				alphaWrite = false;
+				break;
+			}
+		}
+	}
+
+	bool frame16 = IsPsm16(frame.nPsm);
+	bool frame24 = (frame.nPsm == PSMCT24) || (frame.nPsm == PSMZ24);
+	uint32* frame32Address = nullptr;
+	uint16* frame16Address = nullptr;
+	uint32 dstColor = 0;
+	if(frame16)
+	{
+		frame16Address = GetSurfacePixelAddress<uint16>(context.frameSurface, x, y);
+		dstColor = ExpandColor16(*frame16Address, make_convertible<TEXA>(0x80ULL << 32));
+	}
+	else
+	{
+		frame32Address = GetSurfacePixelAddress<uint32>(context.frameSurface, x, y);
+		dstColor = *frame32Address;
+		if(frame24) dstColor = (dstColor & 0x00FFFFFF) | 0x80000000;
+	}
+
+	//Destination alpha test
+	if(test.nDestAlphaEnabled)
+	{
+		uint32 dstAlphaBit = (dstColor >> 31) & 1;
+		if(dstAlphaBit != test.nDestAlphaMode) return;
+	}
+
+	//Depth test
+	uint32 depthPsm = zbuf.nPsm | 0x30;
+	bool depth16 = IsPsm16(depthPsm);
+	uint32 depthMax = (depthPsm == PSMZ32) ? 0xFFFFFFFF : ((depthPsm == PSMZ24) ? 0x00FFFFFF : 0xFFFF);
+	uint32 depth = (pixel.z >= depthMax) ? depthMax : ((pixel.z <= 0) ? 0 : static_cast<uint32>(pixel.z));
+	uint32* depth32Address = nullptr;
+	uint16* depth16Address = nullptr;
+	if(test.nDepthEnabled || depthWrite)
+	{
+		if(depth16)
+		{
+			depth16Address = GetSurfacePixelAddress<uint16>(context.depthSurface, x, y);
+		}
+		else
+		{
+			depth32Address = GetSurfacePixelAddress<uint32>(context.depthSurface, x, y);
+		}
+	}
+	if(test.nDepthEnabled)
+	{
+		uint32 dstDepth = depth16 ? *depth16Address : (*depth32Address & depthMax);
+		switch(test.nDepthMethod)
+		{
+		case DEPTH_TEST_NEVER:
+			return;
+		case DEPTH_TEST_ALWAYS:
+			break;
+		case DEPTH_TEST_GEQUAL:
+			if(depth < dstDepth) return;
+			break;
+		case DEPTH_TEST_GREATER:
+			if(depth <= dstDepth) return;
+			break;
+		}
+	}
+
+	if(frameWrite)
+	{
+		int32 srcAlpha = color[3];
+		bool pabe = (context.pabeReg & 1) != 0;
+		if(primitive.alphaBlend && (!pabe || (srcAlpha & 0x80)))
+		{
+			auto alpha = make_convertible<ALPHA>(context.alphaReg);
+			int32 dstAlpha = static_cast<int32>(dstColor >> 24);
+			int32 blendFactor = (alpha.nC == ALPHABLEND_C_AS) ? srcAlpha : ((alpha.nC == ALPHABLEND_C_AD) ? dstAlpha : static_cast<int32>(alpha.nFix));
+			for(unsigned int i = 0; i < 3; i++)
+			{
+				int32 srcValue = color[i];
+				int32 dstValue = static_cast<int32>((dstColor >> (i * 8)) & 0xFF);
+				int32 values[3] = {srcValue, dstValue, 0};
+				int32 a = values[std::min<unsigned int>(alpha.nA, 2)];
+				int32 b = values[std::min<unsigned int>(alpha.nB, 2)];
+				int32 d = values[std::min<unsigned int>(alpha.nD, 2)];
+				int32 result = (((a - b) * blendFactor) >> 7) + d;
+				color[i] = (context.colClampReg & 1) ? ClampColor(result) : (result & 0xFF);
+			}
+		}
+
+		uint32 fbaMask = (context.fbaReg & 1) ? 0x80 : 0;
+		uint32 srcColor =
+		    (static_cast<uint32>(color[0]) << 0) |
+		    (static_cast<uint32>(color[1]) << 8) |
+		    (static_cast<uint32>(color[2]) << 16) |
+		    ((static_cast<uint32>(srcAlpha) | fbaMask) << 24);
+
+		uint32 writeMask = frame.nMask;
+		if(!alphaWrite || frame24) writeMask |= 0xFF000000;
+		if(frame16)
+		{
+			uint16 writeMask16 = PackColor16(writeMask);
+			uint16 srcColor16 = PackColor16(srcColor);
+			*frame16Address = (*frame16Address & writeMask16) | (srcColor16 & ~writeMask16);
+		}
+		else
+		{
+			*frame32Address = (*frame32Address & writeMask) | (srcColor & ~writeMask);
+		}
+	}
+
+	if(depthWrite)
+	{
+		if(depth16)
+		{
+			*depth16Address = static_cast<uint16>(depth);
+		}
+		else
+		{
+			*depth32Address = (*depth32Address & ~depthMax) | depth;
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////
+// Transfers & Presentation
+/////////////////////////////////////////////////////////////
+
+void CGSH_Software::ProcessHostToLocalTransfer()
+{
+	FlushBatch();
+}
+
+void CGSH_Software::ProcessLocalToHostTransfer()
+{
+	FlushBatch();
+}
+
+void CGSH_Software::ProcessLocalToLocalTransfer()
+{
+	FlushBatch();
+
+	auto bltBuf = make_convertible<BITBLTBUF>(m_nReg[GS_REG_BITBLTBUF]);
+	if(bltBuf.nSrcPsm != bltBuf.nDstPsm) return;
+
+	switch(bltBuf.nSrcPsm)
+	{
+	case PSMCT32:
+		CopyLocalToLocal<CGsPixelFormats::STORAGEPSMCT32>(0xFFFFFFFF);
+		break;
+	case PSMCT24:
+		CopyLocalToLocal<CGsPixelFormats::STORAGEPSMCT32>(0x00FFFFFF);
+		break;
+	case PSMZ32:
+		CopyLocalToLocal<CGsPixelFormats::STORAGEPSMZ32>(0xFFFFFFFF);
+		break;
+	case PSMZ24:
+		CopyLocalToLocal<CGsPixelFormats::STORAGEPSMZ32>(0x00FFFFFF);
+		break;
+	case PSMCT16:
+		CopyLocalToLocal<CGsPixelFormats::STORAGEPSMCT16>(0xFFFF);
+		break;
+	case PSMCT16S:
+		CopyLocalToLocal<CGsPixelFormats::STORAGEPSMCT16S>(0xFFFF);
+		break;
+	case PSMZ16:
+		CopyLocalToLocal<CGsPixelFormats::STORAGEPSMZ16>(0xFFFF);
+		break;
+	case PSMZ16S:
+		CopyLocalToLocal<CGsPixelFormats::STORAGEPSMZ16S>(0xFFFF);
+		break;
+	case PSMT8:
+		CopyLocalToLocal<CGsPixelFormats::STORAGEPSMT8>(0xFF);
+		break;
+	case PSMT4:
+		CopyLocalToLocal<CGsPixelFormats::STORAGEPSMT4>(0x0F);
+		break;
+	case PSMT8H:
+		CopyLocalToLocal<CGsPixelFormats::STORAGEPSMCT32>(0xFF000000);
+		break;
+	case PSMT4HL:
+		CopyLocalToLocal<CGsPixelFormats::STORAGEPSMCT32>(0x0F000000);
+		break;
+	case PSMT4HH:
+		CopyLocalToLocal<CGsPixelFormats::STORAGEPSMCT32>(0xF0000000);
+		break;
+	}
+}
+
+template <typename Storage>
+void CGSH_Software::CopyLocalToLocal(uint32 mask)
+{
+	auto bltBuf = make_convertible<BITBLTBUF>(m_nReg[GS_REG_BITBLTBUF]);
+	auto trxPos = make_convertible<TRXPOS>(m_nReg[GS_REG_TRXPOS]);
+	auto trxReg = make_convertible<TRXREG>(m_nReg[GS_REG_TRXREG]);
+
+	CGsPixelFormats::CPixelIndexor<Storage> srcIndexor(m_pRAM, bltBuf.GetSrcPtr(), bltBuf.nSrcWidth);
+	CGsPixelFormats::CPixelIndexor<Storage> dstIndexor(m_pRAM, bltBuf.GetDstPtr(), bltBuf.nDstWidth);
+
+	auto unitMask = static_cast<typename Storage::Unit>(mask);
+	for(uint32 y = 0; y < trxReg.nRRH; y++)
+	{
+		for(uint32 x = 0; x < trxReg.nRRW; x++)
+		{
+			uint32 srcX = (trxPos.nSSAX + x) % 2048;
+			uint32 srcY = (trxPos.nSSAY + y) % 2048;
+			uint32 dstX = (trxPos.nDSAX + x) % 2048;
+			uint32 dstY = (trxPos.nDSAY + y) % 2048;
+			auto srcPixel = srcIndexor.GetPixel(srcX, srcY);
+			auto dstPixel = dstIndexor.GetPixel(dstX, dstY);
+			dstIndexor.SetPixel(dstX, dstY, static_cast<typename Storage::Unit>((dstPixel & ~unitMask) | (srcPixel & unitMask)));
+		}
+	}
+}
+
+void CGSH_Software::ProcessClutTransfer(uint32, uint32)
+{
+	//Contexts created from now on need to pick up the new CLUT
+	m_clutVersion++;
+}
+
+unsigned int CGSH_Software::GetCurrentReadCircuit()
+{
+	uint32 rcMode = m_nPMODE & 0x03;
+	switch(rcMode)
+	{
+	default:
+	case 0:
+	case 1:
+		return 0;
+	case 2:
+		return 1;
+	case 3:
+	{
+		std::lock_guard<std::recursive_mutex> registerMutexLock(m_registerMutex);
+		bool fb1Null = (m_nDISPFB1.value.q == 0);
+		bool fb2Null = (m_nDISPFB2.value.q == 0);
+		return (fb1Null && !fb2Null) ? 1 : 0;
+	}
+	}
+}
+
+void CGSH_Software::UpdatePresentBuffer()
+{
+	DISPLAY d;
+	DISPFB fb;
+	{
+		std::lock_guard<std::recursive_mutex> registerMutexLock(m_registerMutex);
+		if(GetCurrentReadCircuit() == 0)
+		{
+			d <<= m_nDISPLAY1.value.q;
+			fb <<= m_nDISPFB1.value.q;
+		}
+		else
+		{
+			d <<= m_nDISPLAY2.value.q;
+			fb <<= m_nDISPFB2.value.q;
+		}
+	}
+
+	uint32 width = std::min<uint32>((d.nW + 1) / (d.nMagX + 1), 2048);
+	uint32 height = std::min<uint32>(d.nH + 1, 2048);
+	if(GetCrtIsInterlaced() && GetCrtIsFrameMode()) height /= 2;
+	if(fb.nBufWidth == 0) return;
+
+	auto surface = MakeSurface(IsPsm16(fb.nPSM) ? fb.nPSM : PSMCT32, fb.GetBufPtr(), fb.nBufWidth);
+	std::vector<uint32> presentBuffer(width * height);
+	for(uint32 y = 0; y < height; y++)
+	{
+		for(uint32 x = 0; x < width; x++)
+		{
+			uint32 srcX = (fb.nX + x) % 2048;
+			uint32 srcY = (fb.nY + y) % 2048;
+			uint32 color = 0;
+			if(IsPsm16(fb.nPSM))
+			{
+				color = ExpandColor16(*GetSurfacePixelAddress<uint16>(surface, srcX, srcY), make_convertible<TEXA>(0x80ULL << 32));
+			}
+			else
+			{
+				color = *GetSurfacePixelAddress<uint32>(surface, srcX, srcY);
+			}
+			presentBuffer[x + (y * width)] = color | 0xFF000000;
+		}
+	}
+
+	std::lock_guard<std::mutex> presentLock(m_presentMutex);
+	m_presentBuffer = std::move(presentBuffer);
+	m_presentWidth = width;
+	m_presentHeight = height;
+}
+
+void CGSH_Software::ReadFramebuffer(uint32 width, uint32 height, void* buffer)
+{
+	//Same layout as what the other handlers return: bottom-up rows of BGR pixels
+	std::lock_guard<std::mutex> presentLock(m_presentMutex);
+	auto output = reinterpret_cast<uint8*>(buffer);
+	for(uint32 y = 0; y < height; y++)
+	{
+		uint32 srcY = height - y - 1;
+		for(uint32 x = 0; x < width; x++)
+		{
+			uint32 color = 0;
+			if((x < m_presentWidth) && (srcY < m_presentHeight))
+			{
+				color = m_presentBuffer[x + (srcY * m_presentWidth)];
+			}
+			output[0] = static_cast<uint8>(color >> 16);
+			output[1] = static_cast<uint8>(color >> 8);
+			output[2] = static_cast<uint8>(color >> 0);
+			output += 3;
+		}
+	}
+}
+
+Framework::CBitmap CGSH_Software::GetScreenshot()
+{
+	std::lock_guard<std::mutex> presentLock(m_presentMutex);
+	if(m_presentBuffer.empty())
+	{
+		throw std::runtime_error("No frame has been presented yet.");
+	}
+	auto bitmap = Framework::CBitmap(m_presentWidth, m_presentHeight, 32);
+	memcpy(bitmap.GetPixels(), m_presentBuffer.data(), m_presentBuffer.size() * sizeof(uint32));
+	return bitmap;
+}
+
+CGSHandler::FactoryFunction CGSH_Software::GetFactoryFunction()
+{
+	return std::bind(&CGSH_Software::GSHandlerFactory);
+}
+
+CGSHandler* CGSH_Software::GSHandlerFactory()
+{
+	return new CGSH_Software();
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "GSHandler.h"
+
+//Renders directly in GS local memory without any GPU involvement. Primitives are accumulated
+//in a batch and rasterized per screen bin, bins being shared among a pool of worker threads.
+class CGSH_Software : public CGSHandler
+{
+public:
+	CGSH_Software();
+	virtual ~CGSH_Software();
+
+	virtual void SaveState(Framework::CZipArchiveWriter&) override;
+
+	virtual void ProcessHostToLocalTransfer() override;
+	virtual void ProcessLocalToHostTransfer() override;
+	virtual void ProcessLocalToLocalTransfer() override;
+	virtual void ProcessClutTransfer(uint32, uint32) override;
+	virtual void ReadFramebuffer(uint32, uint32, void*) override;
+
+	virtual Framework::CBitmap GetScreenshot() override;
+
+	static FactoryFunction GetFactoryFunction();
+
+private:
+	enum
+	{
+		BIN_SIZE = 64,
+		BIN_COUNT = 2048 / BIN_SIZE,
+		MAX_BATCH_PRIMITIVES = 4096,
+		MAX_WORKER_COUNT = 8,
+		SPAN_WIDTH = 4,
+		INVALID_CONTEXT_INDEX = ~0U,
+	};
+
+	struct VERTEX
+	{
+		uint64 nPosition;
+		uint64 nRGBAQ;
+		uint64 nUV;
+		uint64 nST;
+		uint8 nFog;
+	};
+
+	//Vertex in window coordinates (12.4 fixed point) with its attributes ready for interpolation
+	struct RASTER_VERTEX
+	{
+		int32 x;
+		int32 y;
+		double z;
+		float color[4];
+		float s;
+		float t;
+		float q;
+		float fog;
+	};
+
+	//Where pixels of a buffer are in memory, resolved once instead of for every pixel
+	struct SURFACE
+	{
+		uint32 pointer = 0;
+		uint32 width = 0;
+		uint32 pageWidthShift = 0;
+		uint32 pageHeightShift = 0;
+		const uint32* pageOffsets = nullptr;
+	};
+
+	//Snapshot of all the state needed to draw pixels, shared by consecutive primitives
+	struct DRAW_CONTEXT
+	{
+		uint64 frameReg;
+		uint64 zbufReg;
+		uint64 testReg;
+		uint64 alphaReg;
+		uint64 tex0Reg;
+		uint64 clampReg;
+		uint64 scissorReg;
+		uint64 texAReg;
+		uint64 fogColReg;
+		uint64 pabeReg;
+		uint64 fbaReg;
+		uint64 colClampReg;
+		uint32 clutVersion;
+		std::array<uint32, 256> clut;
+
+		//Derived from the registers above
+		SURFACE frameSurface;
+		SURFACE depthSurface;
+		SURFACE textureSurface;
+	};
+
+	struct PRIMITIVE
+	{
+		unsigned int type;
+		uint32 contextIndex;
+		bool gouraud;
+		bool textured;
+		bool useUV;
+		bool fog;
+		bool alphaBlend;
+		RASTER_VERTEX vertices[3];
+		int32 minX;
+		int32 minY;
+		int32 maxX;
+		int32 maxY;
+	};
+
+	struct PIXEL
+	{
+		float color[4];
+		double z;
+		float s;
+		float t;
+		float q;
+		float fog;
+	};
+
+	struct BIN_RECT
+	{
+		int32 minX;
+		int32 minY;
+		int32 maxX;
+		int32 maxY;
+	};
+
+	typedef std::vector<uint32> PrimitiveIndexArray;
+
+	virtual void InitializeImpl() override;
+	virtual void ReleaseImpl() override;
+	virtual void ResetImpl() override;
+	virtual void FlipImpl() override;
+	virtual void WriteRegisterImpl(uint8, uint64) override;
+	virtual void ProcessVertexBatch(const RegisterWrite*, uint32) override;
+
+	void VertexKick(uint8, uint64);
+
+	void Prim_Point();
+	void Prim_Line();
+	void Prim_Triangle();
+	void Prim_Sprite();
+
+	void SetupPrimitive(PRIMITIVE&, unsigned int);
+	RASTER_VERTEX MakeRasterVertex(const VERTEX&, const XYOFFSET&, bool) const;
+	uint32 GetDrawContextIndex(unsigned int);
+	void SubmitPrimitive(const PRIMITIVE&);
+
+	void FlushBatch();
+	void ProcessBins();
+	void WorkerThreadProc();
+
+	void RasterizeBin(uint32);
+	void RasterizePoint(const PRIMITIVE&, const BIN_RECT&);
+	void RasterizeLine(const PRIMITIVE&, const BIN_RECT&);
+	void RasterizeTriangle(const PRIMITIVE&, const BIN_RECT&);
+	void RasterizeSprite(const PRIMITIVE&, const BIN_RECT&);
+
+	void ShadePixel(const DRAW_CONTEXT&, const PRIMITIVE&, int32, int32, const PIXEL&);
+	uint32 SampleTexture(const DRAW_CONTEXT&, int32, int32);
+
+	template <typename Storage>
+	static SURFACE MakeSurface(uint32, uint32);
+	static SURFACE MakeSurface(unsigned int, uint32, uint32);
+	template <typename PixelType>
+	PixelType* GetSurfacePixelAddress(const SURFACE&, uint32, uint32) const;
+
+	void UpdatePresentBuffer();
+	unsigned int GetCurrentReadCircuit();
+
+	template <typename Storage>
+	void CopyLocalToLocal(uint32);
+
+	static CGSHandler* GSHandlerFactory();
+
+	//Drawing kick state
+	VERTEX m_vtxBuffer[3];
+	uint32 m_vtxCount = 0;
+	unsigned int m_primitiveType = PRIM_INVALID;
+	PRMODE m_primitiveMode;
+
+	//Current batch, only touched by workers while being flushed
+	std::vector<DRAW_CONTEXT> m_drawContexts;
+	std::vector<PRIMITIVE> m_primitives;
+	PrimitiveIndexArray m_binPrimitives[BIN_COUNT * BIN_COUNT];
+	std::vector<uint32> m_activeBins;
+	uint32 m_clutVersion = 0;
+
+	//Draw context of the vertex batch being processed, its state can't change
+	bool m_vertexBatchActive = false;
+	uint32 m_vertexBatchContextIndex = INVALID_CONTEXT_INDEX;
+
+	//Worker pool
+	std::vector<std::thread> m_workerThreads;
+	std::mutex m_workerMutex;
+	std::condition_variable m_workerCondition;
+	std::condition_variable m_workerDoneCondition;
+	uint32 m_workerGeneration = 0;
+	uint32 m_busyWorkerCount = 0;
+	bool m_workersDone = false;
+	std::atomic<uint32> m_nextBin = {0};
+
+	//Last displayed frame, used for screenshots
+	std::mutex m_presentMutex;
+	std::vector<uint32> m_presentBuffer;
+	uint32 m_presentWidth = 0;
+	uint32 m_presentHeight = 0;
+};
@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
+#include <chrono>
 #include <functional>
 #include "../AppConfig.h"
 #include "../Log.h"
@@ -54,13 +56,12 @@
 
 #define LOG_NAME ("gs")
 
-struct MASSIVEWRITE_INFO
-{
+//Packet metadata is stored in front of register writes in the command ring
 #ifdef DEBUGGER_INCLUDED
-	CGsPacketMetadata metadata;
+#define REGISTER_WRITES_METADATA_SIZE (sizeof(CGsPacketMetadata))
+#else
+#define REGISTER_WRITES_METADATA_SIZE (0)
 #endif
-	CGSHandler::RegisterWriteList writes;
-};
 
 CGSHandler::CGSHandler()
     : m_threadDone(false)
@@ -94,6 +95,7 @@ CGSHandler::CGSHandler()
 	m_transferWriteHandlers[PSMT8H] = &CGSHandler::TransferWriteHandlerPSMT8H;
 	m_transferWriteHandlers[PSMT4HL] = &CGSHandler::TransferWriteHandlerPSMT4H<24, 0x0F000000>;
 	m_transferWriteHandlers[PSMT4HH] = &CGSHandler::TransferWriteHandlerPSMT4H<28, 0xF0000000>;
+	m_transferWriteHandlers[PSMZ32] = &CGSHandler::TransferWriteHandlerGeneric<CGsPixelFormats::STORAGEPSMZ32>;
 
 	m_transferReadHandlers[PSMCT32] = &CGSHandler::TransferReadHandlerGeneric<CGsPixelFormats::STORAGEPSMCT32>;
 	m_transferReadHandlers[PSMT8] = &CGSHandler::TransferReadHandlerGeneric<CGsPixelFormats::STORAGEPSMT8>;
@@ -105,7 +107,7 @@ CGSHandler::CGSHandler()
 
 CGSHandler::~CGSHandler()
 {
-	m_mailBox.SendCall([this]() { m_threadDone = true; });
+	SendGSCall([this]() { m_threadDone = true; });
 	m_thread.join();
 	delete[] m_pRAM;
 	delete[] m_pCLUT;
@@ -118,7 +120,7 @@ void CGSHandler::RegisterPreferences()
 
 void CGSHandler::NotifyPreferencesChanged()
 {
-	m_mailBox.SendCall([this]() { NotifyPreferencesChangedImpl(); });
+	SendGSCall([this]() { NotifyPreferencesChangedImpl(); });
 }
 
 void CGSHandler::SetIntc(CINTC* intc)
@@ -129,7 +131,7 @@ void CGSHandler::SetIntc(CINTC* intc)
 void CGSHandler::Reset()
 {
 	ResetBase();
-	m_mailBox.SendCall(std::bind(&CGSHandler::ResetImpl, this), true);
+	SendGSCall(std::bind(&CGSHandler::ResetImpl, this), true);
 }
 
 void CGSHandler::ResetBase()
@@ -154,6 +156,7 @@ void CGSHandler::ResetBase()
 	m_nCrtMode = 2;
 	m_nCBP0 = 0;
 	m_nCBP1 = 0;
+	m_lastClutLoad = CLUTLOAD();
 	m_transferCount = 0;
 }
 
@@ -199,6 +202,7 @@ void CGSHandler::LoadState(Framework::CZipArchiveReader& archive)
 	archive.BeginReadFile(STATE_RAM)->Read(m_pRAM, RAMSIZE);
 	archive.BeginReadFile(STATE_REGS)->Read(m_nReg, sizeof(uint64) * CGSHandler::REGISTER_MAX);
 	archive.BeginReadFile(STATE_TRXCTX)->Read(&m_trxCtx, sizeof(TRXCONTEXT));
+	m_lastClutLoad = CLUTLOAD();
 
 	{
 		CRegisterStateFile registerFile(*archive.BeginReadFile(STATE_PRIVREGS));
@@ -374,22 +378,22 @@ void CGSHandler::WritePrivRegister(uint32 nAddress, uint32 nData)
 
 void CGSHandler::Initialize()
 {
-	m_mailBox.SendCall(std::bind(&CGSHandler::InitializeImpl, this), true);
+	SendGSCall(std::bind(&CGSHandler::InitializeImpl, this), true);
 }
 
 void CGSHandler::Release()
 {
-	m_mailBox.SendCall(std::bind(&CGSHandler::ReleaseImpl, this), true);
+	SendGSCall(std::bind(&CGSHandler::ReleaseImpl, this), true);
 }
 
 void CGSHandler::Flip(bool showOnly)
 {
 	if(!showOnly)
 	{
-		m_mailBox.FlushCalls();
-		m_mailBox.SendCall(std::bind(&CGSHandler::MarkNewFrame, this));
+		SendGSCall([]() {}, true);
+		SendGSCall(std::bind(&CGSHandler::MarkNewFrame, this));
 	}
-	m_mailBox.SendCall(std::bind(&CGSHandler::FlipImpl, this), true);
+	SendGSCall(std::bind(&CGSHandler::FlipImpl, this), true);
 }
 
 void CGSHandler::FlipImpl()
@@ -428,33 +432,159 @@ void CGSHandler::SetSMODE2(uint64 value)
 
 void CGSHandler::WriteRegister(uint8 registerId, uint64 value)
 {
-	m_mailBox.SendCall(std::bind(&CGSHandler::WriteRegisterImpl, this, registerId, value));
+	if((registerId == GS_REG_TRXDIR) && ((value & 0x03) == 1))
+	{
+		m_readbackRequestId++;
+	}
+	SendGSCall(std::bind(&CGSHandler::WriteRegisterImpl, this, registerId, value));
 }
 
 void CGSHandler::FeedImageData(const void* data, uint32 length)
 {
-	m_transferCount++;
-
 	//Allocate 0x10 more bytes to allow transfer handlers
 	//to read beyond the actual length of the buffer (ie.: PSMCT24)
-
-	std::vector<uint8> imageData(length + 0x10);
-	memcpy(imageData.data(), data, length);
-	m_mailBox.SendCall(
-	    [this, imageData = std::move(imageData), length]() {
-		    FeedImageDataImpl(imageData.data(), length);
-	    });
+	uint32 maxChunkSize = (m_commandRing.GetMaxPayloadSize() - 0x10) & ~0x0F;
+	auto source = reinterpret_cast<const uint8*>(data);
+	while(length != 0)
+	{
+		uint32 chunkSize = std::min(length, maxChunkSize);
+		m_transferCount++;
+		auto imageData = m_commandRing.BeginCommand(CGsCommandRing::COMMAND_IMAGE_DATA, chunkSize + 0x10, chunkSize);
+		memcpy(imageData, source, chunkSize);
+		memset(imageData + chunkSize, 0, 0x10);
+		CommitCommand();
+		source += chunkSize;
+		length -= chunkSize;
+	}
 }
 
 void CGSHandler::ReadImageData(void* data, uint32 length)
 {
-	m_mailBox.SendCall([this, data, length]() { ReadImageDataImpl(data, length); }, true);
+	uint32 requestId = m_readbackRequestId;
+	if(requestId == 0)
+	{
+		//No local to host transfer was started yet, let the GS thread handle this
+		SendGSCall([this, data, length]() { ReadImageDataImpl(data, length); }, true);
+		return;
+	}
+
+	if(m_readbackReadId != requestId)
+	{
+		m_readbackReadId = requestId;
+		m_readbackOffset = 0;
+	}
+
+	std::unique_lock<std::mutex> readbackLock(m_readbackMutex);
+	//Another thread might have started a newer transfer in the meantime
+	const auto isReadbackCompleted = [&]() { return static_cast<int32>(m_readbackCompletedId - requestId) >= 0; };
+	if(!isReadbackCompleted())
+	{
+		auto stallStartTime = std::chrono::steady_clock::now();
+		m_readbackCondition.wait(readbackLock, isReadbackCompleted);
+		auto stallTime = std::chrono::steady_clock::now() - stallStartTime;
+		m_readbackStats.stallCount++;
+		m_readbackStats.stallTime += std::chrono::duration_cast<std::chrono::microseconds>(stallTime).count();
+	}
+	m_readbackStats.readCount++;
+
+	DiscardReadbacksBefore(requestId);
+
+	uint32 copySize = 0;
+	if(!m_readbacks.empty() && (m_readbacks.front().id == requestId))
+	{
+		auto& readback = m_readbacks.front();
+		uint32 readbackSize = static_cast<uint32>(readback.data.size());
+		uint32 availableSize = readbackSize - std::min(m_readbackOffset, readbackSize);
+		copySize = std::min(length, availableSize);
+		memcpy(data, readback.data.data() + m_readbackOffset, copySize);
+		m_readbackOffset += copySize;
+		if(m_readbackOffset >= readbackSize)
+		{
+			m_readbackStagingBuffer = std::move(readback.data);
+			m_readbacks.pop_front();
+		}
+	}
+
+	//Reads going past the end of the transfer get zeros
+	memset(reinterpret_cast<uint8*>(data) + copySize, 0, length - copySize);
 }
 
-void CGSHandler::WriteRegisterMassively(RegisterWriteList registerWrites, const CGsPacketMetadata* metadata)
+CGSHandler::READBACK_STATS CGSHandler::GetReadbackStats() const
 {
-	for(const auto& write : registerWrites)
+	std::lock_guard<std::mutex> readbackLock(m_readbackMutex);
+	return m_readbackStats;
+}
+
+void CGSHandler::ResetReadbackStats()
+{
+	std::lock_guard<std::mutex> readbackLock(m_readbackMutex);
+	m_readbackStats = READBACK_STATS();
+}
+
+void CGSHandler::WriteRegisterMassively(const RegisterWriteList& registerWrites, const CGsPacketMetadata* metadata)
+{
+	uint32 maxChunkCount = GetMaxRegisterWriteCount();
+	auto writes = registerWrites.data();
+	uint32 writeCount = static_cast<uint32>(registerWrites.size());
+	while(writeCount != 0)
+	{
+		uint32 chunkCount = std::min(writeCount, maxChunkCount);
+		auto chunk = BeginRegisterWrites(chunkCount, metadata);
+		memcpy(chunk, writes, chunkCount * sizeof(RegisterWrite));
+		EndRegisterWrites(chunkCount);
+		writes += chunkCount;
+		writeCount -= chunkCount;
+	}
+}
+
+uint32 CGSHandler::GetMaxRegisterWriteCount() const
+{
+	return (m_commandRing.GetMaxPayloadSize() - REGISTER_WRITES_METADATA_SIZE) / sizeof(RegisterWrite);
+}
+
+CGSHandler::RegisterWrite* CGSHandler::BeginRegisterWrites(uint32 capacity, const CGsPacketMetadata* metadata)
+{
+	assert(m_pendingRegisterWrites == nullptr);
+	assert((capacity != 0) && (capacity <= GetMaxRegisterWriteCount()));
+	auto payload = m_commandRing.BeginCommand(CGsCommandRing::COMMAND_REGISTER_WRITES,
+	                                          REGISTER_WRITES_METADATA_SIZE + (capacity * sizeof(RegisterWrite)), capacity);
+#ifdef DEBUGGER_INCLUDED
+	if(metadata != nullptr)
+	{
+		memcpy(payload, metadata, sizeof(CGsPacketMetadata));
+	}
+	else
 	{
+		new(payload) CGsPacketMetadata();
+	}
+#endif
+	m_pendingRegisterWrites = reinterpret_cast<RegisterWrite*>(payload + REGISTER_WRITES_METADATA_SIZE);
+	return m_pendingRegisterWrites;
+}
+
+void CGSHandler::EndRegisterWrites(uint32 writeCount)
+{
+	assert(m_pendingRegisterWrites != nullptr);
+	auto writes = m_pendingRegisterWrites;
+	m_pendingRegisterWrites = nullptr;
+	if(writeCount == 0)
+	{
+		m_commandRing.CancelCommand();
+		return;
+	}
+	UpdatePrivRegisters(writes, writeCount);
+	m_commandRing.ShrinkCommand(REGISTER_WRITES_METADATA_SIZE + (writeCount * sizeof(RegisterWrite)), writeCount);
+	m_transferCount++;
+	CommitCommand();
+}
+
+//Registers that affect privileged registers are handled when writes are queued
+//for the EE to see their effects right away
+void CGSHandler::UpdatePrivRegisters(const RegisterWrite* writes, uint32 writeCount)
+{
+	for(uint32 i = 0; i < writeCount; i++)
+	{
+		const auto& write = writes[i];
 		switch(write.first)
 		{
 		case GS_REG_SIGNAL:
@@ -482,28 +612,14 @@ void CGSHandler::WriteRegisterMassively(RegisterWriteList registerWrites, const
 			m_nSIGLBLID = siglblid;
 		}
 		break;
+		case GS_REG_TRXDIR:
+			if((write.second & 0x03) == 1)
+			{
+				m_readbackRequestId++;
+			}
+			break;
 		}
 	}
-
-	m_transferCount++;
-
-	MASSIVEWRITE_INFO massiveWrite;
-	massiveWrite.writes = std::move(registerWrites);
-#ifdef DEBUGGER_INCLUDED
-	if(metadata != nullptr)
-	{
-		memcpy(&massiveWrite.metadata, metadata, sizeof(CGsPacketMetadata));
-	}
-	else
-	{
-		massiveWrite.metadata = CGsPacketMetadata();
-	}
-#endif
-
-	m_mailBox.SendCall(
-	    [this, massiveWrite = std::move(massiveWrite)]() {
-		    WriteRegisterMassivelyImpl(massiveWrite);
-	    });
 }
 
 void CGSHandler::WriteRegisterImpl(uint8 nRegister, uint64 nData)
@@ -586,6 +702,11 @@ void CGSHandler::FeedImageDataImpl(const uint8* imageData, uint32 length)
 		{
 			auto trxReg = make_convertible<TRXREG>(m_nReg[GS_REG_TRXREG]);
 			//assert(m_trxCtx.nRRY == trxReg.nRRH);
+			if(m_trxCtx.nDirty)
+			{
+				auto trxPos = make_convertible<TRXPOS>(m_nReg[GS_REG_TRXPOS]);
+				InvalidateClutSourceArea(bltBuf.nDstPsm, bltBuf.GetDstPtr(), bltBuf.GetDstWidth(), trxPos.nDSAY, trxReg.nRRH);
+			}
 			ProcessHostToLocalTransfer();
 
 #ifdef _DEBUG
@@ -609,24 +730,137 @@ void CGSHandler::ReadImageDataImpl(void* ptr, uint32 size)
 	((this)->*(m_transferReadHandlers[bltBuf.nSrcPsm]))(ptr, size);
 }
 
-void CGSHandler::WriteRegisterMassivelyImpl(const MASSIVEWRITE_INFO& massiveWrite)
+void CGSHandler::StartReadback()
+{
+	//Read the whole transfer right away, reusing the buffer of a consumed readback if there is one
+	READBACK readback;
+	{
+		std::lock_guard<std::mutex> readbackLock(m_readbackMutex);
+		readback.data = std::move(m_readbackStagingBuffer);
+	}
+	readback.id = m_readbackStartedId + 1;
+
+	uint32 size = m_trxCtx.nSize;
+	readback.data.resize(size);
+	if(size != 0)
+	{
+		ReadImageDataImpl(readback.data.data(), size);
+	}
+
+	{
+		std::lock_guard<std::mutex> readbackLock(m_readbackMutex);
+		//The EE only ever reads its latest request, older readbacks are dead
+		DiscardReadbacksBefore(m_readbackRequestId);
+		m_readbacks.push_back(std::move(readback));
+		m_readbackCompletedId = ++m_readbackStartedId;
+	}
+	m_readbackCondition.notify_all();
+}
+
+void CGSHandler::DiscardReadbacksBefore(uint32 id)
+{
+	//Must be called with m_readbackMutex held
+	while(!m_readbacks.empty() && (static_cast<int32>(m_readbacks.front().id - id) < 0))
+	{
+		m_readbackStagingBuffer = std::move(m_readbacks.front().data);
+		m_readbacks.pop_front();
+	}
+}
+
+void CGSHandler::WriteRegisterMassivelyImpl(const RegisterWrite* writes, uint32 writeCount, const CGsPacketMetadata* metadata)
 {
 #ifdef DEBUGGER_INCLUDED
 	if(m_frameDump)
 	{
-		m_frameDump->AddRegisterPacket(massiveWrite.writes.data(), massiveWrite.writes.size(), &massiveWrite.metadata);
+		m_frameDump->AddRegisterPacket(writes, writeCount, metadata);
 	}
 #endif
 
-	for(const auto& write : massiveWrite.writes)
+	//Group runs of vertex writes that don't change the drawing state in batches
+	uint32 batchStart = 0;
+	for(uint32 i = 0; i < writeCount; i++)
 	{
+		const auto& write = writes[i];
+		if(IsVertexBatchRegister(write.first)) continue;
+		if(IsDrawingStateRegister(write.first) && (m_nReg[write.first] == write.second)) continue;
+		if(i != batchStart)
+		{
+			ProcessVertexBatch(writes + batchStart, i - batchStart);
+		}
 		WriteRegisterImpl(write.first, write.second);
+		batchStart = i + 1;
+	}
+	if(writeCount != batchStart)
+	{
+		ProcessVertexBatch(writes + batchStart, writeCount - batchStart);
 	}
 
 	assert(m_transferCount != 0);
 	m_transferCount--;
 }
 
+void CGSHandler::ProcessVertexBatch(const RegisterWrite* writes, uint32 writeCount)
+{
+	for(uint32 i = 0; i < writeCount; i++)
+	{
+		WriteRegisterImpl(writes[i].first, writes[i].second);
+	}
+}
+
+bool CGSHandler::IsVertexBatchRegister(uint8 registerId)
+{
+	switch(registerId)
+	{
+	case GS_REG_RGBAQ:
+	case GS_REG_ST:
+	case GS_REG_UV:
+	case GS_REG_FOG:
+	case GS_REG_XYZ2:
+	case GS_REG_XYZ3:
+	case GS_REG_XYZF2:
+	case GS_REG_XYZF3:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool CGSHandler::IsDrawingStateRegister(uint8 registerId)
+{
+	//Registers that have no side effect other than changing the drawing state,
+	//writing the value they already hold doesn't need to end a batch
+	switch(registerId)
+	{
+	case GS_REG_CLAMP_1:
+	case GS_REG_CLAMP_2:
+	case GS_REG_TEX1_1:
+	case GS_REG_TEX1_2:
+	case GS_REG_XYOFFSET_1:
+	case GS_REG_XYOFFSET_2:
+	case GS_REG_PRMODECONT:
+	case GS_REG_PRMODE:
+	case GS_REG_TEXA:
+	case GS_REG_FOGCOL:
+	case GS_REG_SCISSOR_1:
+	case GS_REG_SCISSOR_2:
+	case GS_REG_ALPHA_1:
+	case GS_REG_ALPHA_2:
+	case GS_REG_COLCLAMP:
+	case GS_REG_TEST_1:
+	case GS_REG_TEST_2:
+	case GS_REG_PABE:
+	case GS_REG_FBA_1:
+	case GS_REG_FBA_2:
+	case GS_REG_FRAME_1:
+	case GS_REG_FRAME_2:
+	case GS_REG_ZBUF_1:
+	case GS_REG_ZBUF_2:
+		return true;
+	default:
+		return false;
+	}
+}
+
 void CGSHandler::BeginTransfer()
 {
 	uint32 trxDir = m_nReg[GS_REG_TRXDIR] & 0x03;
@@ -683,14 +917,22 @@ void CGSHandler::BeginTransfer()
 		}
 		else if(trxDir == 1)
 		{
+			//Some handlers write their framebuffer contents back to local memory
+			auto trxPos = make_convertible<TRXPOS>(m_nReg[GS_REG_TRXPOS]);
+			InvalidateClutSourceArea(bltBuf.nSrcPsm, bltBuf.GetSrcPtr(), bltBuf.GetSrcWidth(), trxPos.nSSAY, trxReg.nRRH);
 			ProcessLocalToHostTransfer();
 			CLog::GetInstance().Print(LOG_NAME, "Starting transfer from 0x%08X, buffer size %d, psm: %d, size (%dx%d)\r\n",
 			                          bltBuf.GetSrcPtr(), bltBuf.GetSrcWidth(), bltBuf.nSrcPsm, trxReg.nRRW, trxReg.nRRH);
+			StartReadback();
 		}
 	}
 	else if(trxDir == 2)
 	{
 		//Local to Local
+		auto bltBuf = make_convertible<BITBLTBUF>(m_nReg[GS_REG_BITBLTBUF]);
+		auto trxPos = make_convertible<TRXPOS>(m_nReg[GS_REG_TRXPOS]);
+		auto trxReg = make_convertible<TRXREG>(m_nReg[GS_REG_TRXREG]);
+		InvalidateClutSourceArea(bltBuf.nDstPsm, bltBuf.GetDstPtr(), bltBuf.GetDstWidth(), trxPos.nDSAY, trxReg.nRRH);
 		ProcessLocalToLocalTransfer();
 	}
 }
@@ -715,8 +957,16 @@ bool CGSHandler::TransferWriteHandlerGeneric(const void* pData, uint32 nLength)
 
 	auto pSrc = reinterpret_cast<const typename Storage::Unit*>(pData);
 
-	for(unsigned int i = 0; i < nLength; i++)
+	for(unsigned int i = 0; i < nLength;)
 	{
+		if((m_trxCtx.nRRX == 0) && CanTransferWriteBlockRow<Storage>(nLength - i))
+		{
+			nDirty |= TransferWriteBlockRow<Storage>(reinterpret_cast<const uint8*>(pSrc + i));
+			i += trxReg.nRRW * Storage::BLOCKHEIGHT;
+			m_trxCtx.nRRY += Storage::BLOCKHEIGHT;
+			continue;
+		}
+
 		uint32 nX = (m_trxCtx.nRRX + trxPos.nDSAX) % 2048;
 		uint32 nY = (m_trxCtx.nRRY + trxPos.nDSAY) % 2048;
 
@@ -734,11 +984,81 @@ bool CGSHandler::TransferWriteHandlerGeneric(const void* pData, uint32 nLength)
 			m_trxCtx.nRRX = 0;
 			m_trxCtx.nRRY++;
 		}
+		i++;
 	}
 
 	return nDirty;
 }
 
+template <typename Storage>
+bool CGSHandler::CanTransferWriteBlockRow(uint32 remainingPixels)
+{
+	//Needs to be at the start of a row of blocks with enough data to fill it
+	typedef CGsPixelFormats::CBlockSwizzler<Storage> Swizzler;
+	auto trxPos = make_convertible<TRXPOS>(m_nReg[GS_REG_TRXPOS]);
+	auto trxReg = make_convertible<TRXREG>(m_nReg[GS_REG_TRXREG]);
+
+	uint32 nY = (m_trxCtx.nRRY + trxPos.nDSAY) % 2048;
+	if((nY % Storage::BLOCKHEIGHT) != 0) return false;
+	if(remainingPixels < (trxReg.nRRW * Storage::BLOCKHEIGHT)) return false;
+
+	uint32 alignedStart = ((trxPos.nDSAX + Storage::BLOCKWIDTH - 1) & ~(Storage::BLOCKWIDTH - 1)) - trxPos.nDSAX;
+	if((alignedStart + Storage::BLOCKWIDTH) > trxReg.nRRW) return false;
+
+	//Rows and blocks need to start on a byte boundary in the source
+	if(((trxReg.nRRW * Swizzler::PIXELBITS) % 8) != 0) return false;
+	if(((alignedStart * Swizzler::PIXELBITS) % 8) != 0) return false;
+
+	return true;
+}
+
+template <typename Storage>
+bool CGSHandler::TransferWriteBlockRow(const uint8* source)
+{
+	typedef CGsPixelFormats::CBlockSwizzler<Storage> Swizzler;
+	auto trxPos = make_convertible<TRXPOS>(m_nReg[GS_REG_TRXPOS]);
+	auto trxReg = make_convertible<TRXREG>(m_nReg[GS_REG_TRXREG]);
+	auto trxBuf = make_convertible<BITBLTBUF>(m_nReg[GS_REG_BITBLTBUF]);
+
+	CGsPixelFormats::CPixelIndexor<Storage> indexor(m_pRAM, trxBuf.GetDstPtr(), trxBuf.nDstWidth);
+
+	bool dirty = false;
+	uint32 sourcePitch = (trxReg.nRRW * Swizzler::PIXELBITS) / 8;
+	uint32 baseY = (m_trxCtx.nRRY + trxPos.nDSAY) % 2048;
+	uint32 alignedStart = ((trxPos.nDSAX + Storage::BLOCKWIDTH - 1) & ~(Storage::BLOCKWIDTH - 1)) - trxPos.nDSAX;
+	uint32 alignedEnd = alignedStart + ((trxReg.nRRW - alignedStart) & ~(Storage::BLOCKWIDTH - 1));
+
+	for(uint32 x = alignedStart; x < alignedEnd; x += Storage::BLOCKWIDTH)
+	{
+		uint32 nX = (trxPos.nDSAX + x) % 2048;
+		auto block = indexor.GetBlockAddress(nX, baseY);
+		dirty |= Swizzler::WriteBlock(block, source + ((x * Swizzler::PIXELBITS) / 8), sourcePitch);
+	}
+
+	//Ragged edges go through the regular path
+	auto writeEdge =
+	    [&](uint32 startX, uint32 endX) {
+		    for(uint32 y = 0; y < Storage::BLOCKHEIGHT; y++)
+		    {
+			    for(uint32 x = startX; x < endX; x++)
+			    {
+				    uint32 nX = (trxPos.nDSAX + x) % 2048;
+				    uint32 nY = baseY + y;
+				    auto pixel = Swizzler::GetSourcePixel(source, sourcePitch, x, y);
+				    if(indexor.GetPixel(nX, nY) != pixel)
+				    {
+					    indexor.SetPixel(nX, nY, pixel);
+					    dirty = true;
+				    }
+			    }
+		    }
+	    };
+	writeEdge(0, alignedStart);
+	writeEdge(alignedEnd, trxReg.nRRW);
+
+	return dirty;
+}
+
 bool CGSHandler::TransferWriteHandlerPSMCT24(const void* pData, uint32 nLength)
 {
 	auto trxPos = make_convertible<TRXPOS>(m_nReg[GS_REG_TRXPOS]);
@@ -783,6 +1103,15 @@ bool CGSHandler::TransferWriteHandlerPSMT4(const void* pData, uint32 nLength)
 
 	for(unsigned int i = 0; i < nLength; i++)
 	{
+		//Two pixels per byte, remaining length is in pixels
+		while((m_trxCtx.nRRX == 0) && (i < nLength) && CanTransferWriteBlockRow<CGsPixelFormats::STORAGEPSMT4>((nLength - i) * 2))
+		{
+			dirty |= TransferWriteBlockRow<CGsPixelFormats::STORAGEPSMT4>(pSrc + i);
+			i += (trxReg.nRRW * CGsPixelFormats::STORAGEPSMT4::BLOCKHEIGHT) / 2;
+			m_trxCtx.nRRY += CGsPixelFormats::STORAGEPSMT4::BLOCKHEIGHT;
+		}
+		if(i == nLength) break;
+
 		uint8 nPixel[2];
 
 		nPixel[0] = (pSrc[i] >> 0) & 0x0F;
@@ -1008,6 +1337,64 @@ void CGSHandler::SyncCLUT(const TEX0& tex0)
 	}
 }
 
+//Returns true if the CLUT buffer already holds the contents of this load's source,
+//which happens when the previous load was identical and its source wasn't written to
+bool CGSHandler::IsClutLoadCached(const TEX0& tex0)
+{
+	static const uint64 clutInfoMask = 0x1FFFFFE000000000ULL; //CBP, CPSM, CSM, CSA
+
+	CLUTLOAD clutLoad;
+	clutLoad.valid = true;
+	clutLoad.isIDTEX4 = CGsPixelFormats::IsPsmIDTEX4(tex0.nPsm);
+	clutLoad.clutInfo = static_cast<uint64>(tex0) & clutInfoMask;
+	clutLoad.sourceStart = tex0.GetCLUTPtr();
+	if(tex0.nCSM == 0)
+	{
+		//CSM1 CLUTs always fit in the first page
+		clutLoad.sourceEnd = clutLoad.sourceStart + CGsPixelFormats::PAGESIZE;
+	}
+	else
+	{
+		auto texClut = make_convertible<TEXCLUT>(m_nReg[GS_REG_TEXCLUT]);
+		auto pageSize = CGsPixelFormats::GetPsmPageSize(PSMCT16);
+		uint32 pageCountX = std::max<uint32>(texClut.nCBW, 1);
+		uint32 pageCountY = (texClut.GetOffsetV() / pageSize.second) + 1;
+		clutLoad.texClut = texClut;
+		clutLoad.sourceEnd = clutLoad.sourceStart + (pageCountX * pageCountY * CGsPixelFormats::PAGESIZE);
+	}
+
+	bool cached = m_lastClutLoad.valid &&
+	              (m_lastClutLoad.isIDTEX4 == clutLoad.isIDTEX4) &&
+	              (m_lastClutLoad.clutInfo == clutLoad.clutInfo) &&
+	              (m_lastClutLoad.texClut == clutLoad.texClut);
+	m_lastClutLoad = clutLoad;
+	return cached;
+}
+
+void CGSHandler::InvalidateClutSource(uint32 start, uint32 size)
+{
+	if(!m_lastClutLoad.valid) return;
+	if((start + size) > RAMSIZE)
+	{
+		//Addresses wrap around at the end of local memory
+		InvalidateClutSource(0, (start + size) - RAMSIZE);
+	}
+	if((start + size) <= m_lastClutLoad.sourceStart) return;
+	if(start >= m_lastClutLoad.sourceEnd) return;
+	m_lastClutLoad.valid = false;
+}
+
+void CGSHandler::InvalidateClutSourceArea(unsigned int psm, uint32 bufPtr, uint32 bufWidth, uint32 y, uint32 height)
+{
+	if(!m_lastClutLoad.valid) return;
+	auto pageSize = CGsPixelFormats::GetPsmPageSize(psm);
+	uint32 pageCountX = std::max<uint32>((bufWidth + pageSize.first - 1) / pageSize.first, 1);
+	uint32 startPageY = y / pageSize.second;
+	uint32 endPageY = (y + height + pageSize.second - 1) / pageSize.second;
+	uint32 rowSize = pageCountX * CGsPixelFormats::PAGESIZE;
+	InvalidateClutSource(bufPtr + (startPageY * rowSize), (endPageY - startPageY) * rowSize);
+}
+
 template <typename Indexor>
 bool CGSHandler::ReadCLUT4_16(const TEX0& tex0)
 {
@@ -1098,7 +1485,7 @@ void CGSHandler::ReadCLUT4(const TEX0& tex0)
 		assert(0);
 	}
 
-	if(updateNeeded)
+	if(updateNeeded && !IsClutLoadCached(tex0))
 	{
 		bool changed = false;
 
@@ -1215,7 +1602,7 @@ void CGSHandler::ReadCLUT8(const TEX0& tex0)
 		assert(0);
 	}
 
-	if(updateNeeded)
+	if(updateNeeded && !IsClutLoadCached(tex0))
 	{
 		bool changed = false;
 
@@ -1716,15 +2103,77 @@ void CGSHandler::WriteToDelayedRegister(uint32 address, uint32 value, DELAYED_RE
 	}
 }
 
+void CGSHandler::SendGSCall(const CMailBox::FunctionType& function, bool waitForCompletion)
+{
+	//Commands queued before this call need to be processed before it
+	uint64 commandPosition = m_commandRing.GetWritePosition();
+	m_mailBox.SendCall(
+	    [this, commandPosition, function]() {
+		    ProcessCommands(commandPosition);
+		    function();
+	    },
+	    waitForCompletion);
+}
+
+void CGSHandler::CommitCommand()
+{
+	if(m_commandRing.EndCommand())
+	{
+		//GS thread went to sleep, wake it up
+		m_mailBox.SendCall([]() {});
+	}
+}
+
+void CGSHandler::ProcessCommands(uint64 limit)
+{
+	while(auto command = m_commandRing.PeekCommand(limit))
+	{
+		auto payload = CGsCommandRing::GetPayload(command);
+		switch(command->type)
+		{
+		case CGsCommandRing::COMMAND_REGISTER_WRITES:
+#ifdef DEBUGGER_INCLUDED
+			WriteRegisterMassivelyImpl(reinterpret_cast<const RegisterWrite*>(payload + sizeof(CGsPacketMetadata)), command->count,
+			                           reinterpret_cast<const CGsPacketMetadata*>(payload));
+#else
+			WriteRegisterMassivelyImpl(reinterpret_cast<const RegisterWrite*>(payload), command->count, nullptr);
+#endif
+			break;
+		case CGsCommandRing::COMMAND_IMAGE_DATA:
+			FeedImageDataImpl(payload, command->count);
+			break;
+		default:
+			assert(false);
+			break;
+		}
+		m_commandRing.PopCommand();
+	}
+}
+
 void CGSHandler::ThreadProc()
 {
 	while(!m_threadDone)
 	{
-		m_mailBox.WaitForCall();
-		while(m_mailBox.IsPending())
+		if(!m_mailBox.IsPending() && !m_commandRing.IsPending())
+		{
+			//Producer checks this flag after publishing a command and
+			//will send a wake up call if we get to sleep
+			m_commandRing.SetConsumerWaiting(true);
+			if(!m_commandRing.IsPending())
+			{
+				m_mailBox.WaitForCall();
+			}
+			m_commandRing.SetConsumerWaiting(false);
+		}
+		uint64 commandPosition = m_commandRing.GetWritePosition();
+		if(m_mailBox.IsPending())
 		{
 			m_mailBox.ReceiveCall();
 		}
+		else
+		{
+			ProcessCommands(commandPosition);
+		}
 	}
 }
 
@@ -2,15 +2,19 @@
 
 #include <thread>
 #include <vector>
+#include <deque>
 #include <functional>
 #include <atomic>
 #include <array>
+#include <mutex>
+#include <condition_variable>
 #include "signal/Signal.h"
 
 #include "bitmap/Bitmap.h"
 #include "Types.h"
 #include "Convertible.h"
 #include "../MailBox.h"
+#include "GsCommandRing.h"
 #include "../Integer64.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
@@ -18,7 +22,6 @@
 class CFrameDump;
 class CGsPacketMetadata;
 class CINTC;
-struct MASSIVEWRITE_INFO;
 
 #define PREF_CGSHANDLER_PRESENTATION_MODE "renderer.presentationmode"
 
@@ -701,6 +704,13 @@ public:
 	typedef std::vector<RegisterWrite> RegisterWriteList;
 	typedef std::function<CGSHandler*(void)> FactoryFunction;
 
+	struct READBACK_STATS
+	{
+		uint32 readCount = 0;
+		uint32 stallCount = 0;
+		uint64 stallTime = 0; //In microseconds
+	};
+
 	typedef Framework::CSignal<void()> FlipCompleteEvent;
 	typedef Framework::CSignal<void(uint32)> NewFrameEvent;
 
@@ -734,7 +744,13 @@ public:
 	void WriteRegister(uint8, uint64);
 	void FeedImageData(const void*, uint32);
 	void ReadImageData(void*, uint32);
-	void WriteRegisterMassively(RegisterWriteList, const CGsPacketMetadata*);
+	void WriteRegisterMassively(const RegisterWriteList&, const CGsPacketMetadata*);
+
+	//Register writes stored straight in the command ring, they need to be
+	//ended before anything else is sent to the GS
+	RegisterWrite* BeginRegisterWrites(uint32, const CGsPacketMetadata*);
+	void EndRegisterWrites(uint32);
+	uint32 GetMaxRegisterWriteCount() const;
 
 	virtual void SetCrt(bool, unsigned int, bool);
 	void Initialize();
@@ -755,6 +771,9 @@ public:
 	void SetSMODE2(uint64);
 
 	int GetPendingTransferCount() const;
+
+	READBACK_STATS GetReadbackStats() const;
+	void ResetReadbackStats();
 	void NotifyEvent(uint32);
 
 	unsigned int GetCrtWidth() const;
@@ -913,6 +932,9 @@ protected:
 	void WriteToDelayedRegister(uint32, uint32, DELAYED_REGISTER&);
 
 	void ThreadProc();
+	void SendGSCall(const CMailBox::FunctionType&, bool = false);
+	void ProcessCommands(uint64);
+	void CommitCommand();
 	virtual void InitializeImpl() = 0;
 	virtual void ReleaseImpl() = 0;
 	void ResetBase();
@@ -923,7 +945,16 @@ protected:
 	virtual void WriteRegisterImpl(uint8, uint64);
 	void FeedImageDataImpl(const uint8*, uint32);
 	void ReadImageDataImpl(void*, uint32);
-	void WriteRegisterMassivelyImpl(const MASSIVEWRITE_INFO&);
+	void StartReadback();
+	void DiscardReadbacksBefore(uint32);
+	void WriteRegisterMassivelyImpl(const RegisterWrite*, uint32, const CGsPacketMetadata*);
+	void UpdatePrivRegisters(const RegisterWrite*, uint32);
+
+	//Receives consecutive vertex attribute writes and vertex kicks, drawing state
+	//registers can only be written with the value they already hold within a batch
+	virtual void ProcessVertexBatch(const RegisterWrite*, uint32);
+	static bool IsVertexBatchRegister(uint8);
+	static bool IsDrawingStateRegister(uint8);
 
 	void BeginTransfer();
 
@@ -939,11 +970,30 @@ protected:
 	template <uint32, uint32>
 	bool TransferWriteHandlerPSMT4H(const void*, uint32);
 
+	template <typename Storage>
+	bool CanTransferWriteBlockRow(uint32);
+	template <typename Storage>
+	bool TransferWriteBlockRow(const uint8*);
+
 	void TransferReadHandlerInvalid(void*, uint32);
 	template <typename Storage>
 	void TransferReadHandlerGeneric(void*, uint32);
 
+	//Last CLUT load, used to skip loads from the same unmodified source
+	struct CLUTLOAD
+	{
+		bool valid = false;
+		bool isIDTEX4 = false;
+		uint64 clutInfo = 0;
+		uint64 texClut = 0;
+		uint32 sourceStart = 0;
+		uint32 sourceEnd = 0;
+	};
+
 	void SyncCLUT(const TEX0&);
+	bool IsClutLoadCached(const TEX0&);
+	void InvalidateClutSource(uint32, uint32);
+	void InvalidateClutSourceArea(unsigned int, uint32, uint32, uint32, uint32);
 	template <typename Indexor>
 	bool ReadCLUT4_16(const TEX0&);
 	template <typename Indexor>
@@ -976,6 +1026,7 @@ protected:
 	uint16* m_pCLUT;
 	uint32 m_nCBP0;
 	uint32 m_nCBP1;
+	CLUTLOAD m_lastClutLoad;
 
 	uint32 m_drawCallCount;
 
@@ -984,7 +1035,29 @@ protected:
 	std::recursive_mutex m_registerMutex;
 	std::atomic<int> m_transferCount;
 	CMailBox m_mailBox;
+	CGsCommandRing m_commandRing;
+	RegisterWrite* m_pendingRegisterWrites = nullptr;
 	bool m_threadDone;
+
+	//Local to host transfers are read as soon as TRXDIR is written, the EE only waits
+	//for the data when it actually reads it. Ids count TRXDIR writes on both threads.
+	//Each readback keeps its own buffer until the EE consumed it or moved past it.
+	struct READBACK
+	{
+		uint32 id = 0;
+		std::vector<uint8> data;
+	};
+
+	mutable std::mutex m_readbackMutex;
+	std::condition_variable m_readbackCondition;
+	std::deque<READBACK> m_readbacks;
+	std::vector<uint8> m_readbackStagingBuffer;
+	uint32 m_readbackCompletedId = 0;
+	uint32 m_readbackStartedId = 0;
+	std::atomic<uint32> m_readbackRequestId = {0};
+	uint32 m_readbackReadId = 0;
+	uint32 m_readbackOffset = 0;
+	READBACK_STATS m_readbackStats;
 	CFrameDump* m_frameDump;
 	bool m_drawEnabled = true;
 	CINTC* m_intc = nullptr;
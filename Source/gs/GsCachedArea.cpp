@@ -1,8 +1,12 @@
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include "GsCachedArea.h"
 #include "GsPixelFormats.h"
 
+static_assert(CGsCachedArea::BLOCKS_PER_PAGE * CGsPixelFormats::BLOCKSIZE == CGsPixelFormats::PAGESIZE,
+              "Dirty block holder must have a bit per block in a page.");
+
 static bool DoMemoryRangesOverlap(uint32 start1, uint32 size1, uint32 start2, uint32 size2)
 {
 	uint32 min1 = start1;
@@ -28,6 +32,62 @@ void CGsCachedArea::SetArea(uint32 psm, uint32 bufPtr, uint32 bufWidth, uint32 h
 	m_bufPtr = bufPtr;
 	m_bufWidth = bufWidth;
 	m_height = height;
+	m_blockLayout = GetBlockLayout(psm);
+}
+
+template <typename Storage>
+CGsCachedArea::BLOCKLAYOUT CGsCachedArea::MakeBlockLayout()
+{
+	BLOCKLAYOUT layout = {};
+	layout.blockWidth = Storage::BLOCKWIDTH;
+	layout.blockHeight = Storage::BLOCKHEIGHT;
+	for(uint32 y = 0; y < (Storage::PAGEHEIGHT / Storage::BLOCKHEIGHT); y++)
+	{
+		for(uint32 x = 0; x < (Storage::PAGEWIDTH / Storage::BLOCKWIDTH); x++)
+		{
+			uint32 blockNum = Storage::m_nBlockSwizzleTable[y][x];
+			assert(blockNum < BLOCKS_PER_PAGE);
+			layout.blockX[blockNum] = static_cast<uint8>(x);
+			layout.blockY[blockNum] = static_cast<uint8>(y);
+		}
+	}
+	return layout;
+}
+
+const CGsCachedArea::BLOCKLAYOUT* CGsCachedArea::GetBlockLayout(uint32 psm)
+{
+	static const BLOCKLAYOUT layoutPSMCT32 = MakeBlockLayout<CGsPixelFormats::STORAGEPSMCT32>();
+	static const BLOCKLAYOUT layoutPSMZ32 = MakeBlockLayout<CGsPixelFormats::STORAGEPSMZ32>();
+	static const BLOCKLAYOUT layoutPSMCT16 = MakeBlockLayout<CGsPixelFormats::STORAGEPSMCT16>();
+	static const BLOCKLAYOUT layoutPSMCT16S = MakeBlockLayout<CGsPixelFormats::STORAGEPSMCT16S>();
+	static const BLOCKLAYOUT layoutPSMT8 = MakeBlockLayout<CGsPixelFormats::STORAGEPSMT8>();
+	static const BLOCKLAYOUT layoutPSMT4 = MakeBlockLayout<CGsPixelFormats::STORAGEPSMT4>();
+
+	switch(psm)
+	{
+	case CGSHandler::PSMCT32:
+	case CGSHandler::PSMCT24:
+	case CGSHandler::PSMCT32_UNK:
+	case CGSHandler::PSMCT24_UNK:
+	case CGSHandler::PSMT8H:
+	case CGSHandler::PSMT4HH:
+	case CGSHandler::PSMT4HL:
+		return &layoutPSMCT32;
+	case CGSHandler::PSMZ32:
+	case CGSHandler::PSMZ24:
+		return &layoutPSMZ32;
+	case CGSHandler::PSMCT16:
+		return &layoutPSMCT16;
+	case CGSHandler::PSMCT16S:
+		return &layoutPSMCT16S;
+	case CGSHandler::PSMT8:
+		return &layoutPSMT8;
+	case CGSHandler::PSMT4:
+		return &layoutPSMT4;
+	default:
+		//No storage description for this format (ie.: PSMZ16), only track whole pages
+		return nullptr;
+	}
 }
 
 CGsCachedArea::PageRect CGsCachedArea::GetAreaPageRect() const
@@ -89,6 +149,59 @@ CGsCachedArea::PageRect CGsCachedArea::GetDirtyPageRect() const
 	return PageRect{startX, startY, spanX, spanY};
 }
 
+CGsCachedArea::PixelRect CGsCachedArea::GetDirtyPixelRect(const PageRect& pageRect) const
+{
+	auto areaRect = GetAreaPageRect();
+	auto texturePageSize = CGsPixelFormats::GetPsmPageSize(m_psm);
+
+	uint32 minX = ~0U, minY = ~0U;
+	uint32 maxX = 0, maxY = 0;
+	for(uint32 y = pageRect.y; y < (pageRect.y + pageRect.height); y++)
+	{
+		for(uint32 x = pageRect.x; x < (pageRect.x + pageRect.width); x++)
+		{
+			uint32 pageIndex = x + (y * areaRect.width);
+			assert(pageIndex < MAX_DIRTYPAGES);
+			auto dirtyBlocks = m_dirtyBlocks[pageIndex];
+			if(dirtyBlocks == 0) continue;
+
+			uint32 pageX = x * texturePageSize.first;
+			uint32 pageY = y * texturePageSize.second;
+			if(!m_blockLayout || (dirtyBlocks == ~0U))
+			{
+				minX = std::min(minX, pageX);
+				minY = std::min(minY, pageY);
+				maxX = std::max(maxX, pageX + texturePageSize.first);
+				maxY = std::max(maxY, pageY + texturePageSize.second);
+				continue;
+			}
+
+			for(uint32 blockNum = 0; blockNum < BLOCKS_PER_PAGE; blockNum++)
+			{
+				if((dirtyBlocks & (1U << blockNum)) == 0) continue;
+				uint32 blockX = pageX + (m_blockLayout->blockX[blockNum] * m_blockLayout->blockWidth);
+				uint32 blockY = pageY + (m_blockLayout->blockY[blockNum] * m_blockLayout->blockHeight);
+				minX = std::min(minX, blockX);
+				minY = std::min(minY, blockY);
+				maxX = std::max(maxX, blockX + m_blockLayout->blockWidth);
+				maxY = std::max(maxY, blockY + m_blockLayout->blockHeight);
+			}
+		}
+	}
+
+	if((minX >= maxX) || (minY >= maxY))
+	{
+		return PixelRect{0, 0, 0, 0};
+	}
+
+	return PixelRect{minX, minY, maxX - minX, maxY - minY};
+}
+
+uint32 CGsCachedArea::GetBufPtr() const
+{
+	return m_bufPtr;
+}
+
 uint32 CGsCachedArea::GetPageCount() const
 {
 	auto areaRect = GetAreaPageRect();
@@ -106,16 +219,24 @@ void CGsCachedArea::Invalidate(uint32 memoryStart, uint32 memorySize)
 
 	if(DoMemoryRangesOverlap(memoryStart, memorySize, m_bufPtr, areaSize))
 	{
-		//Find the pages that are touched by this transfer
-		uint32 pageStart = (memoryStart < m_bufPtr) ? 0 : ((memoryStart - m_bufPtr) / CGsPixelFormats::PAGESIZE);
-		uint32 pageCount = (memorySize + CGsPixelFormats::PAGESIZE - 1) / CGsPixelFormats::PAGESIZE;
-		uint32 areaPageCount = GetPageCount();
+		//Find the blocks that are touched by this transfer
+		uint32 rangeStart = std::max(memoryStart, m_bufPtr) - m_bufPtr;
+		uint32 rangeEnd = std::min(memoryStart + memorySize, m_bufPtr + areaSize) - m_bufPtr;
+		uint32 blockStart = rangeStart / CGsPixelFormats::BLOCKSIZE;
+		uint32 blockEnd = (rangeEnd + CGsPixelFormats::BLOCKSIZE - 1) / CGsPixelFormats::BLOCKSIZE;
 
-		for(unsigned int i = 0; i < pageCount; i++)
+		for(uint32 blockIndex = blockStart; blockIndex < blockEnd;)
 		{
-			uint32 pageIndex = pageStart + i;
-			if(pageIndex >= areaPageCount) break;
-			SetPageDirty(pageIndex);
+			uint32 pageIndex = blockIndex / BLOCKS_PER_PAGE;
+			uint32 firstBlock = blockIndex % BLOCKS_PER_PAGE;
+			uint32 blockCount = std::min(BLOCKS_PER_PAGE - firstBlock, blockEnd - blockIndex);
+			DirtyBlockHolder blockMask = ~0U;
+			if(m_blockLayout && (blockCount != BLOCKS_PER_PAGE))
+			{
+				blockMask = ((1U << blockCount) - 1) << firstBlock;
+			}
+			SetBlocksDirty(pageIndex, blockMask);
+			blockIndex += blockCount;
 		}
 
 		//Wouldn't make sense to go through here and not have at least a dirty page
@@ -132,11 +253,17 @@ bool CGsCachedArea::IsPageDirty(uint32 pageIndex) const
 }
 
 void CGsCachedArea::SetPageDirty(uint32 pageIndex)
+{
+	SetBlocksDirty(pageIndex, ~0U);
+}
+
+void CGsCachedArea::SetBlocksDirty(uint32 pageIndex, DirtyBlockHolder blockMask)
 {
 	assert(pageIndex < sizeof(m_dirtyPages) * 8);
 	unsigned int dirtyPageSection = pageIndex / (sizeof(m_dirtyPages[0]) * 8);
 	unsigned int dirtyPageIndex = pageIndex % (sizeof(m_dirtyPages[0]) * 8);
 	m_dirtyPages[dirtyPageSection] |= (1ULL << dirtyPageIndex);
+	m_dirtyBlocks[pageIndex] |= blockMask;
 }
 
 bool CGsCachedArea::HasDirtyPages() const
@@ -149,9 +276,23 @@ bool CGsCachedArea::HasDirtyPages() const
 	return (dirtyStatus != 0);
 }
 
+uint32 CGsCachedArea::GetDirtyBlockCount() const
+{
+	uint32 count = 0;
+	for(unsigned int pageIndex = 0; pageIndex < MAX_DIRTYPAGES; pageIndex++)
+	{
+		for(auto dirtyBlocks = m_dirtyBlocks[pageIndex]; dirtyBlocks != 0; dirtyBlocks &= (dirtyBlocks - 1))
+		{
+			count++;
+		}
+	}
+	return count;
+}
+
 void CGsCachedArea::ClearDirtyPages()
 {
 	memset(m_dirtyPages, 0, sizeof(m_dirtyPages));
+	memset(m_dirtyBlocks, 0, sizeof(m_dirtyBlocks));
 }
 
 void CGsCachedArea::ClearDirtyPages(const PageRect& rect)
@@ -170,6 +311,7 @@ void CGsCachedArea::ClearDirtyPages(const PageRect& rect)
 			unsigned int dirtyPageSection = pageIndex / (sizeof(m_dirtyPages[0]) * 8);
 			unsigned int dirtyPageIndex = pageIndex % (sizeof(m_dirtyPages[0]) * 8);
 			m_dirtyPages[dirtyPageSection] &= ~(1ULL << dirtyPageIndex);
+			m_dirtyBlocks[pageIndex] = 0;
 		}
 	}
 }
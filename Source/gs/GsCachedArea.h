@@ -8,6 +8,8 @@ class CGsCachedArea
 public:
 	typedef uint64 DirtyPageHolder;
 
+	typedef uint32 DirtyBlockHolder;
+
 	struct PageRect
 	{
 		uint32 x;
@@ -16,10 +18,20 @@ public:
 		uint32 height;
 	};
 
+	//In pixels
+	struct PixelRect
+	{
+		uint32 x;
+		uint32 y;
+		uint32 width;
+		uint32 height;
+	};
+
 	enum
 	{
 		MAX_DIRTYPAGES_SECTIONS = 8,
-		MAX_DIRTYPAGES = sizeof(DirtyPageHolder) * 8 * MAX_DIRTYPAGES_SECTIONS
+		MAX_DIRTYPAGES = sizeof(DirtyPageHolder) * 8 * MAX_DIRTYPAGES_SECTIONS,
+		BLOCKS_PER_PAGE = sizeof(DirtyBlockHolder) * 8,
 	};
 
 	CGsCachedArea();
@@ -28,7 +40,9 @@ public:
 
 	PageRect GetAreaPageRect() const;
 	PageRect GetDirtyPageRect() const;
+	PixelRect GetDirtyPixelRect(const PageRect&) const;
 
+	uint32 GetBufPtr() const;
 	uint32 GetPageCount() const;
 	uint32 GetSize() const;
 
@@ -36,14 +50,32 @@ public:
 	bool IsPageDirty(uint32) const;
 	void SetPageDirty(uint32);
 	bool HasDirtyPages() const;
+	uint32 GetDirtyBlockCount() const;
 	void ClearDirtyPages();
 	void ClearDirtyPages(const PageRect&);
 
 private:
+	//Position of each block inside a page, follows block swizzling
+	struct BLOCKLAYOUT
+	{
+		uint32 blockWidth;
+		uint32 blockHeight;
+		uint8 blockX[BLOCKS_PER_PAGE];
+		uint8 blockY[BLOCKS_PER_PAGE];
+	};
+
+	template <typename>
+	static BLOCKLAYOUT MakeBlockLayout();
+	static const BLOCKLAYOUT* GetBlockLayout(uint32);
+
+	void SetBlocksDirty(uint32, DirtyBlockHolder);
+
 	uint32 m_psm = 0;
 	uint32 m_bufPtr = 0;
 	uint32 m_bufWidth = 0;
 	uint32 m_height = 0;
+	const BLOCKLAYOUT* m_blockLayout = nullptr;
 
 	DirtyPageHolder m_dirtyPages[MAX_DIRTYPAGES_SECTIONS];
+	DirtyBlockHolder m_dirtyBlocks[MAX_DIRTYPAGES];
 };
@@ -9,6 +9,7 @@ void CGsCachedAreaTest::Execute()
 	CheckDirtyRect();
 	CheckClearDirtyPages();
 	CheckInvalidate();
+	CheckInvalidateBlocks();
 }
 
 void CGsCachedAreaTest::CheckEmptyArea()
@@ -154,3 +155,103 @@ void CGsCachedAreaTest::CheckInvalidate()
 		assert(dirtyRect.height == 2);
 	}
 }
+
+void CGsCachedAreaTest::CheckInvalidateBlocks()
+{
+	auto pixelFormat = CGSHandler::PSMCT32;
+	auto pageSize = CGsPixelFormats::GetPsmPageSize(pixelFormat);
+
+	//Invalidate first block
+	{
+		CGsCachedArea area;
+		area.SetArea(pixelFormat, 0, 512, 512);
+
+		area.Invalidate(0, CGsPixelFormats::BLOCKSIZE);
+		assert(area.GetDirtyBlockCount() == 1);
+
+		auto dirtyRect = area.GetDirtyPageRect();
+		auto pixelRect = area.GetDirtyPixelRect(dirtyRect);
+		assert(pixelRect.x == 0);
+		assert(pixelRect.y == 0);
+		assert(pixelRect.width == 8);
+		assert(pixelRect.height == 8);
+	}
+
+	//Invalidate two blocks, second one is swizzled under the first one
+	{
+		CGsCachedArea area;
+		area.SetArea(pixelFormat, 0, 512, 512);
+
+		area.Invalidate(CGsPixelFormats::BLOCKSIZE, CGsPixelFormats::BLOCKSIZE * 2);
+		assert(area.GetDirtyBlockCount() == 2);
+
+		auto dirtyRect = area.GetDirtyPageRect();
+		auto pixelRect = area.GetDirtyPixelRect(dirtyRect);
+		assert(pixelRect.x == 0);
+		assert(pixelRect.y == 0);
+		assert(pixelRect.width == 16);
+		assert(pixelRect.height == 16);
+	}
+
+	//Invalidate a block in the second page, area doesn't start on a page boundary
+	{
+		uint32 bufPtr = CGsPixelFormats::BLOCKSIZE * 4;
+		CGsCachedArea area;
+		area.SetArea(pixelFormat, bufPtr, 512, 512);
+
+		area.Invalidate(bufPtr + CGsPixelFormats::PAGESIZE, 4);
+		assert(area.GetDirtyBlockCount() == 1);
+
+		auto dirtyRect = area.GetDirtyPageRect();
+		assert(dirtyRect.x == 1);
+		assert(dirtyRect.y == 0);
+
+		auto pixelRect = area.GetDirtyPixelRect(dirtyRect);
+		assert(pixelRect.x == pageSize.first);
+		assert(pixelRect.y == 0);
+		assert(pixelRect.width == 8);
+		assert(pixelRect.height == 8);
+	}
+
+	//Range starting before the area only dirties the overlapping blocks
+	{
+		uint32 bufPtr = CGsPixelFormats::PAGESIZE;
+		CGsCachedArea area;
+		area.SetArea(pixelFormat, bufPtr, 512, 512);
+
+		area.Invalidate(0, CGsPixelFormats::PAGESIZE + CGsPixelFormats::BLOCKSIZE);
+		assert(area.GetDirtyBlockCount() == 1);
+	}
+
+	//Dirty page covers the whole page
+	{
+		CGsCachedArea area;
+		area.SetArea(pixelFormat, 0, 512, 512);
+
+		area.SetPageDirty(0);
+		assert(area.GetDirtyBlockCount() == CGsCachedArea::BLOCKS_PER_PAGE);
+
+		auto dirtyRect = area.GetDirtyPageRect();
+		auto pixelRect = area.GetDirtyPixelRect(dirtyRect);
+		assert(pixelRect.width == pageSize.first);
+		assert(pixelRect.height == pageSize.second);
+
+		area.ClearDirtyPages(dirtyRect);
+		assert(!area.HasDirtyPages());
+		assert(area.GetDirtyBlockCount() == 0);
+	}
+
+	//Formats without a known block layout are tracked by page
+	{
+		auto depthPageSize = CGsPixelFormats::GetPsmPageSize(CGSHandler::PSMZ16);
+		CGsCachedArea area;
+		area.SetArea(CGSHandler::PSMZ16, 0, 512, 512);
+
+		area.Invalidate(0, CGsPixelFormats::BLOCKSIZE);
+
+		auto dirtyRect = area.GetDirtyPageRect();
+		auto pixelRect = area.GetDirtyPixelRect(dirtyRect);
+		assert(pixelRect.width == depthPageSize.first);
+		assert(pixelRect.height == depthPageSize.second);
+	}
+}
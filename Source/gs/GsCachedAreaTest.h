@@ -10,4 +10,5 @@ private:
 	void CheckDirtyRect();
 	void CheckClearDirtyPages();
 	void CheckInvalidate();
+	void CheckInvalidateBlocks();
 };
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <thread>
+#include "GsCommandRing.h"
+
+CGsCommandRing::CGsCommandRing(uint32 capacity)
+    : m_buffer(new uint8[capacity])
+    , m_capacity(capacity)
+{
+	assert((capacity & (capacity - 1)) == 0);
+	assert(capacity >= (ALIGNMENT * 4));
+}
+
+uint32 CGsCommandRing::GetMaxPayloadSize() const
+{
+	//Keeps enough room for a wrap marker in front of the largest command
+	return (m_capacity / 2) - sizeof(COMMAND_HEADER);
+}
+
+uint64 CGsCommandRing::GetWritePosition() const
+{
+	return m_writePosition.load(std::memory_order_acquire);
+}
+
+uint8* CGsCommandRing::BeginCommand(uint32 type, uint32 size, uint32 count)
+{
+	assert(type != COMMAND_WRAP);
+	assert(size <= GetMaxPayloadSize());
+
+	uint64 position = m_writePosition.load(std::memory_order_relaxed);
+	uint32 recordSize = GetRecordSize(size);
+	uint32 offset = static_cast<uint32>(position & (m_capacity - 1));
+	uint32 tailSize = m_capacity - offset;
+	bool needsWrap = recordSize > tailSize;
+	uint32 requiredSize = needsWrap ? (tailSize + recordSize) : recordSize;
+
+	if((m_capacity - (position - m_readPosition.load(std::memory_order_acquire))) < requiredSize)
+	{
+		m_stats.producerStalls++;
+		while((m_capacity - (position - m_readPosition.load(std::memory_order_acquire))) < requiredSize)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	if(needsWrap)
+	{
+		//Records are aligned, there's always enough room left for the marker
+		auto wrapHeader = reinterpret_cast<COMMAND_HEADER*>(m_buffer.get() + offset);
+		wrapHeader->type = COMMAND_WRAP;
+		wrapHeader->size = tailSize - sizeof(COMMAND_HEADER);
+		wrapHeader->count = 0;
+		position += tailSize;
+		offset = 0;
+	}
+
+	auto header = reinterpret_cast<COMMAND_HEADER*>(m_buffer.get() + offset);
+	header->type = type;
+	header->size = size;
+	header->count = count;
+	m_pendingPosition = position + recordSize;
+	m_pendingHeader = header;
+
+	m_stats.commands++;
+	m_stats.bytes += size;
+
+	return m_buffer.get() + offset + sizeof(COMMAND_HEADER);
+}
+
+//Lets producers reserve room for the largest payload they could write and only
+//publish what they actually wrote
+void CGsCommandRing::ShrinkCommand(uint32 size, uint32 count)
+{
+	assert(m_pendingPosition != 0);
+	assert(size <= m_pendingHeader->size);
+	uint32 reservedRecordSize = GetRecordSize(m_pendingHeader->size);
+	m_stats.bytes -= (m_pendingHeader->size - size);
+	m_pendingPosition -= (reservedRecordSize - GetRecordSize(size));
+	m_pendingHeader->size = size;
+	m_pendingHeader->count = count;
+}
+
+void CGsCommandRing::CancelCommand()
+{
+	assert(m_pendingPosition != 0);
+	m_stats.commands--;
+	m_stats.bytes -= m_pendingHeader->size;
+	m_pendingPosition = 0;
+	m_pendingHeader = nullptr;
+}
+
+bool CGsCommandRing::EndCommand()
+{
+	assert(m_pendingPosition != 0);
+	m_writePosition.store(m_pendingPosition, std::memory_order_seq_cst);
+	m_pendingPosition = 0;
+	m_pendingHeader = nullptr;
+	//Tell caller if the consumer needs to be woken up
+	if(!m_consumerWaiting.load(std::memory_order_seq_cst)) return false;
+	return m_consumerWaiting.exchange(false);
+}
+
+bool CGsCommandRing::IsPending() const
+{
+	return m_readPosition.load(std::memory_order_relaxed) != m_writePosition.load(std::memory_order_seq_cst);
+}
+
+const CGsCommandRing::COMMAND_HEADER* CGsCommandRing::PeekCommand(uint64 limit)
+{
+	while(1)
+	{
+		uint64 position = m_readPosition.load(std::memory_order_relaxed);
+		uint64 writePosition = m_writePosition.load(std::memory_order_acquire);
+		if(position >= std::min(limit, writePosition)) return nullptr;
+
+		auto header = reinterpret_cast<const COMMAND_HEADER*>(m_buffer.get() + (position & (m_capacity - 1)));
+		if(header->type != COMMAND_WRAP)
+		{
+			return header;
+		}
+		m_readPosition.store(position + sizeof(COMMAND_HEADER) + header->size, std::memory_order_release);
+	}
+}
+
+void CGsCommandRing::PopCommand()
+{
+	uint64 position = m_readPosition.load(std::memory_order_relaxed);
+	auto header = reinterpret_cast<const COMMAND_HEADER*>(m_buffer.get() + (position & (m_capacity - 1)));
+	assert(header->type != COMMAND_WRAP);
+	m_readPosition.store(position + GetRecordSize(header->size), std::memory_order_release);
+}
+
+void CGsCommandRing::SetConsumerWaiting(bool waiting)
+{
+	m_consumerWaiting.store(waiting, std::memory_order_seq_cst);
+}
+
+CGsCommandRing::STATS CGsCommandRing::GetStats() const
+{
+	return m_stats;
+}
+
+void CGsCommandRing::ResetStats()
+{
+	m_stats = STATS();
+}
+
+const uint8* CGsCommandRing::GetPayload(const COMMAND_HEADER* header)
+{
+	return reinterpret_cast<const uint8*>(header) + sizeof(COMMAND_HEADER);
+}
+
+uint32 CGsCommandRing::GetRecordSize(uint32 size)
+{
+	return sizeof(COMMAND_HEADER) + ((size + ALIGNMENT - 1) & ~(ALIGNMENT - 1));
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include "Types.h"
+
+//Single producer, single consumer queue of variable sized commands stored in a circular byte buffer.
+//Producer never locks nor allocates, it only waits for the consumer when the buffer is full.
+class CGsCommandRing
+{
+public:
+	enum COMMAND_TYPE
+	{
+		COMMAND_WRAP,
+		COMMAND_REGISTER_WRITES,
+		COMMAND_IMAGE_DATA,
+	};
+
+	struct COMMAND_HEADER
+	{
+		uint32 type;
+		uint32 size;
+		uint32 count;
+		uint32 reserved;
+	};
+	static_assert(sizeof(COMMAND_HEADER) == 0x10, "Command header must be 16 bytes long.");
+
+	struct STATS
+	{
+		uint64 commands = 0;
+		uint64 bytes = 0;
+		uint64 producerStalls = 0;
+	};
+
+	enum
+	{
+		DEFAULT_CAPACITY = 8 * 1024 * 1024,
+		ALIGNMENT = 0x10,
+	};
+
+	CGsCommandRing(uint32 capacity = DEFAULT_CAPACITY);
+	CGsCommandRing(const CGsCommandRing&) = delete;
+	CGsCommandRing& operator=(const CGsCommandRing&) = delete;
+
+	uint32 GetMaxPayloadSize() const;
+	uint64 GetWritePosition() const;
+
+	//Producer side
+	uint8* BeginCommand(uint32 type, uint32 size, uint32 count);
+	void ShrinkCommand(uint32 size, uint32 count);
+	void CancelCommand();
+	bool EndCommand();
+
+	//Consumer side
+	bool IsPending() const;
+	const COMMAND_HEADER* PeekCommand(uint64 limit);
+	void PopCommand();
+	void SetConsumerWaiting(bool);
+
+	STATS GetStats() const;
+	void ResetStats();
+
+	static const uint8* GetPayload(const COMMAND_HEADER*);
+
+private:
+	static uint32 GetRecordSize(uint32);
+
+	std::unique_ptr<uint8[]> m_buffer;
+	uint32 m_capacity = 0;
+
+	std::atomic<uint64> m_writePosition = {0};
+	std::atomic<uint64> m_readPosition = {0};
+	std::atomic<bool> m_consumerWaiting = {false};
+
+	//Only touched by the producer
+	uint64 m_pendingPosition = 0;
+	COMMAND_HEADER* m_pendingHeader = nullptr;
+	STATS m_stats;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <cstring>
 #include "Types.h"
 #include "GSHandler.h"
 
@@ -158,6 +159,72 @@ public:
 		typedef uint16 Unit;
 	};
 
+	struct STORAGEPSMZ16
+	{
+		enum PAGEWIDTH
+		{
+			PAGEWIDTH = 64
+		};
+		enum PAGEHEIGHT
+		{
+			PAGEHEIGHT = 64
+		};
+		enum BLOCKWIDTH
+		{
+			BLOCKWIDTH = 16
+		};
+		enum BLOCKHEIGHT
+		{
+			BLOCKHEIGHT = 8
+		};
+		enum COLUMNWIDTH
+		{
+			COLUMNWIDTH = 16
+		};
+		enum COLUMNHEIGHT
+		{
+			COLUMNHEIGHT = 2
+		};
+
+		static const int m_nBlockSwizzleTable[8][4];
+		static const int m_nColumnSwizzleTable[2][16];
+
+		typedef uint16 Unit;
+	};
+
+	struct STORAGEPSMZ16S
+	{
+		enum PAGEWIDTH
+		{
+			PAGEWIDTH = 64
+		};
+		enum PAGEHEIGHT
+		{
+			PAGEHEIGHT = 64
+		};
+		enum BLOCKWIDTH
+		{
+			BLOCKWIDTH = 16
+		};
+		enum BLOCKHEIGHT
+		{
+			BLOCKHEIGHT = 8
+		};
+		enum COLUMNWIDTH
+		{
+			COLUMNWIDTH = 16
+		};
+		enum COLUMNHEIGHT
+		{
+			COLUMNHEIGHT = 2
+		};
+
+		static const int m_nBlockSwizzleTable[8][4];
+		static const int m_nColumnSwizzleTable[2][16];
+
+		typedef uint16 Unit;
+	};
+
 	struct STORAGEPSMT8
 	{
 		enum PAGEWIDTH
@@ -241,6 +308,12 @@ public:
 			m_pMemory = pMemory;
 
 			//This might not be thread safe (?)
+			InitializePageOffsetTable();
+		}
+
+		//Call before indexing from multiple threads, the table is otherwise built on first use
+		static void InitializePageOffsetTable()
+		{
 			if(!m_pageOffsetsInitialized)
 			{
 				BuildPageOffsetTable();
@@ -270,8 +343,33 @@ public:
 			return reinterpret_cast<typename Storage::Unit*>(pixelAddr);
 		}
 
+		//Coordinates need to be aligned on a block boundary
+		uint8* GetBlockAddress(unsigned int nX, unsigned int nY)
+		{
+			uint32 pageNum = (nX / Storage::PAGEWIDTH) + (nY / Storage::PAGEHEIGHT) * (m_nWidth * 64) / Storage::PAGEWIDTH;
+
+			nX %= Storage::PAGEWIDTH;
+			nY %= Storage::PAGEHEIGHT;
+
+			uint32 blockNum = Storage::m_nBlockSwizzleTable[nY / Storage::BLOCKHEIGHT][nX / Storage::BLOCKWIDTH];
+			return m_pMemory + ((m_nPointer + (pageNum * PAGESIZE) + (blockNum * BLOCKSIZE)) & (CGSHandler::RAMSIZE - 1));
+		}
+
+		static uint32 GetPageOffset(unsigned int nX, unsigned int nY)
+		{
+			InitializePageOffsetTable();
+			return m_pageOffsets[nY][nX];
+		}
+
+		//Rows of PAGEWIDTH offsets, PAGEHEIGHT rows
+		static const uint32* GetPageOffsetTable()
+		{
+			InitializePageOffsetTable();
+			return &m_pageOffsets[0][0];
+		}
+
 	private:
-		void BuildPageOffsetTable()
+		static void BuildPageOffsetTable()
 		{
 			for(uint32 y = 0; y < Storage::PAGEHEIGHT; y++)
 			{
@@ -324,8 +422,74 @@ public:
 	typedef CPixelIndexor<STORAGEPSMCT32> CPixelIndexorPSMCT32;
 	typedef CPixelIndexor<STORAGEPSMCT16> CPixelIndexorPSMCT16;
 	typedef CPixelIndexor<STORAGEPSMCT16S> CPixelIndexorPSMCT16S;
+	typedef CPixelIndexor<STORAGEPSMZ32> CPixelIndexorPSMZ32;
+	typedef CPixelIndexor<STORAGEPSMZ16> CPixelIndexorPSMZ16;
+	typedef CPixelIndexor<STORAGEPSMZ16S> CPixelIndexorPSMZ16S;
 	typedef CPixelIndexor<STORAGEPSMT8> CPixelIndexorPSMT8;
 	typedef CPixelIndexor<STORAGEPSMT4> CPixelIndexorPSMT4;
+
+	//Moves a whole block of linear pixel data in place at once instead of going through
+	//page offsets for every pixel. Source rows are sourcePitch bytes apart.
+	template <typename Storage>
+	class CBlockSwizzler
+	{
+	public:
+		enum PIXELBITS
+		{
+			PIXELBITS = sizeof(typename Storage::Unit) * 8
+		};
+
+		//Returns true if the block's contents changed
+		static bool WriteBlock(uint8* block, const uint8* source, uint32 sourcePitch)
+		{
+			typedef typename Storage::Unit Unit;
+			const auto& offsets = GetOffsets();
+			Unit blockData[BLOCKSIZE / sizeof(Unit)];
+			for(uint32 y = 0; y < Storage::BLOCKHEIGHT; y++)
+			{
+				auto sourceRow = reinterpret_cast<const Unit*>(source + (y * sourcePitch));
+				for(uint32 x = 0; x < Storage::BLOCKWIDTH; x++)
+				{
+					blockData[offsets.values[y][x]] = sourceRow[x];
+				}
+			}
+			if(memcmp(block, blockData, BLOCKSIZE) == 0) return false;
+			memcpy(block, blockData, BLOCKSIZE);
+			return true;
+		}
+
+		static typename Storage::Unit GetSourcePixel(const uint8* source, uint32 sourcePitch, uint32 x, uint32 y)
+		{
+			return reinterpret_cast<const typename Storage::Unit*>(source + (y * sourcePitch))[x];
+		}
+
+	private:
+		struct OFFSETS
+		{
+			uint8 values[Storage::BLOCKHEIGHT][Storage::BLOCKWIDTH];
+		};
+
+		static const OFFSETS& GetOffsets()
+		{
+			static const OFFSETS offsets = BuildOffsets();
+			return offsets;
+		}
+
+		static OFFSETS BuildOffsets()
+		{
+			//Blocks are contiguous, only the position within the block matters
+			OFFSETS offsets;
+			for(uint32 y = 0; y < Storage::BLOCKHEIGHT; y++)
+			{
+				for(uint32 x = 0; x < Storage::BLOCKWIDTH; x++)
+				{
+					uint32 offset = CPixelIndexor<Storage>::GetPageOffset(x, y) % BLOCKSIZE;
+					offsets.values[y][x] = static_cast<uint8>(offset / sizeof(typename Storage::Unit));
+				}
+			}
+			return offsets;
+		}
+	};
 };
 
 //////////////////////////////////////////////
@@ -423,3 +587,72 @@ inline void CGsPixelFormats::CPixelIndexor<CGsPixelFormats::STORAGEPSMT8>::Build
 		}
 	}
 }
+
+//PSMT4 pixels are nibbles, offsets are expressed in nibbles within the block
+template <>
+class CGsPixelFormats::CBlockSwizzler<CGsPixelFormats::STORAGEPSMT4>
+{
+public:
+	typedef CGsPixelFormats::STORAGEPSMT4 Storage;
+
+	enum PIXELBITS
+	{
+		PIXELBITS = 4
+	};
+
+	static bool WriteBlock(uint8* block, const uint8* source, uint32 sourcePitch)
+	{
+		const auto& offsets = GetOffsets();
+		uint8 blockData[BLOCKSIZE] = {};
+		for(uint32 y = 0; y < Storage::BLOCKHEIGHT; y++)
+		{
+			auto sourceRow = source + (y * sourcePitch);
+			for(uint32 x = 0; x < Storage::BLOCKWIDTH; x += 2)
+			{
+				uint8 sourcePixels = sourceRow[x / 2];
+				uint32 offset0 = offsets.values[y][x + 0];
+				uint32 offset1 = offsets.values[y][x + 1];
+				blockData[offset0 / 2] |= (sourcePixels & 0x0F) << ((offset0 & 1) * 4);
+				blockData[offset1 / 2] |= (sourcePixels >> 4) << ((offset1 & 1) * 4);
+			}
+		}
+		if(memcmp(block, blockData, BLOCKSIZE) == 0) return false;
+		memcpy(block, blockData, BLOCKSIZE);
+		return true;
+	}
+
+	static uint8 GetSourcePixel(const uint8* source, uint32 sourcePitch, uint32 x, uint32 y)
+	{
+		return (source[(y * sourcePitch) + (x / 2)] >> ((x & 1) * 4)) & 0x0F;
+	}
+
+private:
+	struct OFFSETS
+	{
+		uint16 values[Storage::BLOCKHEIGHT][Storage::BLOCKWIDTH];
+	};
+
+	static const OFFSETS& GetOffsets()
+	{
+		static const OFFSETS offsets = BuildOffsets();
+		return offsets;
+	}
+
+	static OFFSETS BuildOffsets()
+	{
+		//Same layout as what CPixelIndexor<STORAGEPSMT4>::SetPixel uses
+		OFFSETS offsets;
+		for(uint32 y = 0; y < Storage::BLOCKHEIGHT; y++)
+		{
+			for(uint32 x = 0; x < Storage::BLOCKWIDTH; x++)
+			{
+				uint32 columnNum = y / Storage::COLUMNHEIGHT;
+				uint32 shiftAmount = (x & 0x18) + ((y & 0x02) << 1);
+				uint32 subTable = ((y & 0x02) >> 1) ^ (columnNum & 0x01);
+				uint32 word = (columnNum * (COLUMNSIZE / 4)) + Storage::m_nColumnWordTable[subTable][y & 0x01][x & 0x07];
+				offsets.values[y][x] = static_cast<uint16>((word * 8) + (shiftAmount / 4));
+			}
+		}
+		return offsets;
+	}
+};
@@ -1,8 +1,13 @@
 #pragma once
 
-#include <list>
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 #include "GSHandler.h"
 #include "GsCachedArea.h"
+#include "GsPixelFormats.h"
 
 #define TEX0_CLUTINFO_MASK (~0xFFFFFFE000000000ULL)
 
@@ -13,82 +18,197 @@ public:
 	class CTexture
 	{
 	public:
-		void Reset()
-		{
-			m_live = false;
-			m_textureHandle = TextureHandleType();
-			m_cachedArea.ClearDirtyPages();
-		}
-
 		uint64 m_tex0 = 0;
-		bool m_live = false;
+		uint32 m_size = 0;
 		CGsCachedArea m_cachedArea;
 
 		//Platform specific
 		TextureHandleType m_textureHandle;
+
+	private:
+		friend class CGsTextureCache;
+
+		//Intrusive LRU list, most recently used first
+		CTexture* m_prev = nullptr;
+		CTexture* m_next = nullptr;
+
+		uint32 m_invalidateId = 0;
 	};
 
 	enum
 	{
-		MAX_TEXTURE_CACHE = 256,
+		CAPACITY = 64 * 1024 * 1024,
 	};
 
-	CGsTextureCache()
-	{
-		for(unsigned int i = 0; i < MAX_TEXTURE_CACHE; i++)
-		{
-			m_textureCache.push_back(std::make_shared<CTexture>());
-		}
-	}
+	CGsTextureCache() = default;
+
+	CGsTextureCache(const CGsTextureCache&) = delete;
+	CGsTextureCache& operator=(const CGsTextureCache&) = delete;
 
 	CTexture* Search(const CGSHandler::TEX0& tex0)
 	{
 		uint64 maskedTex0 = static_cast<uint64>(tex0) & TEX0_CLUTINFO_MASK;
 
-		for(auto textureIterator(m_textureCache.begin());
-		    textureIterator != m_textureCache.end(); textureIterator++)
+		auto textureIterator = m_textures.find(maskedTex0);
+		if(textureIterator == std::end(m_textures))
 		{
-			auto texture = *textureIterator;
-			if(!texture->m_live) continue;
-			if(maskedTex0 != texture->m_tex0) continue;
-			m_textureCache.erase(textureIterator);
-			m_textureCache.push_front(texture);
-			return texture.get();
+			return nullptr;
 		}
 
-		return nullptr;
+		auto texture = textureIterator->second.get();
+		LruRemove(texture);
+		LruPushFront(texture);
+		return texture;
 	}
 
-	void Insert(const CGSHandler::TEX0& tex0, TextureHandleType textureHandle)
+	CTexture* Insert(const CGSHandler::TEX0& tex0, TextureHandleType textureHandle)
 	{
-		auto texture = *m_textureCache.rbegin();
-		texture->Reset();
+		uint64 maskedTex0 = static_cast<uint64>(tex0) & TEX0_CLUTINFO_MASK;
 
-		texture->m_cachedArea.SetArea(tex0.nPsm, tex0.GetBufPtr(), tex0.GetBufWidth(), tex0.GetHeight());
+		auto textureIterator = m_textures.find(maskedTex0);
+		if(textureIterator != std::end(m_textures))
+		{
+			Remove(textureIterator->second.get());
+		}
 
-		texture->m_tex0 = static_cast<uint64>(tex0) & TEX0_CLUTINFO_MASK;
+		auto texture = std::make_unique<CTexture>();
+		texture->m_cachedArea.SetArea(tex0.nPsm, tex0.GetBufPtr(), tex0.GetBufWidth(), tex0.GetHeight());
+		texture->m_tex0 = maskedTex0;
+		texture->m_size = GetTextureSize(tex0);
 		texture->m_textureHandle = std::move(textureHandle);
-		texture->m_live = true;
 
-		m_textureCache.pop_back();
-		m_textureCache.push_front(texture);
+		//Always keep room for the new texture, even if it's bigger than the capacity
+		EvictUntil(CAPACITY - std::min<uint32>(CAPACITY, texture->m_size));
+
+		auto texturePtr = texture.get();
+		m_textures.emplace(maskedTex0, std::move(texture));
+		m_totalSize += texturePtr->m_size;
+		LruPushFront(texturePtr);
+		IndexPages(texturePtr, true);
+		return texturePtr;
 	}
 
 	void InvalidateRange(uint32 start, uint32 size)
 	{
-		std::for_each(std::begin(m_textureCache), std::end(m_textureCache),
-		              [start, size](TexturePtr& texture) { if(texture->m_live) { texture->m_cachedArea.Invalidate(start, size); } });
+		if(size == 0) return;
+		uint32 startPage = std::min<uint32>(start, CGSHandler::RAMSIZE) / CGsPixelFormats::PAGESIZE;
+		uint32 endPage = (std::min<uint32>(start + size, CGSHandler::RAMSIZE) + CGsPixelFormats::PAGESIZE - 1) / CGsPixelFormats::PAGESIZE;
+
+		//Textures spanning multiple pages only need to be invalidated once
+		m_invalidateId++;
+		for(uint32 page = startPage; page < endPage; page++)
+		{
+			for(auto texture : m_pageTextures[page])
+			{
+				if(texture->m_invalidateId == m_invalidateId) continue;
+				texture->m_invalidateId = m_invalidateId;
+				texture->m_cachedArea.Invalidate(start, size);
+			}
+		}
 	}
 
 	void Flush()
 	{
-		std::for_each(std::begin(m_textureCache), std::end(m_textureCache),
-		              [](TexturePtr& texture) { texture->Reset(); });
+		for(auto& pageTextures : m_pageTextures)
+		{
+			pageTextures.clear();
+		}
+		m_textures.clear();
+		m_lruHead = nullptr;
+		m_lruTail = nullptr;
+		m_totalSize = 0;
 	}
 
 private:
-	typedef std::shared_ptr<CTexture> TexturePtr;
-	typedef std::list<TexturePtr> TextureList;
+	typedef std::unique_ptr<CTexture> TexturePtr;
+	typedef std::unordered_map<uint64, TexturePtr> TextureMap;
+	typedef std::vector<CTexture*> TextureArray;
+
+	enum
+	{
+		RAM_PAGE_COUNT = CGSHandler::RAMSIZE / CGsPixelFormats::PAGESIZE,
+	};
+
+	//Approximation of the host memory used, indexed textures are expanded to 8-bit
+	static uint32 GetTextureSize(const CGSHandler::TEX0& tex0)
+	{
+		uint32 pixelSize = 4;
+		if(CGsPixelFormats::IsPsmIDTEX(tex0.nPsm))
+		{
+			pixelSize = 1;
+		}
+		else if((tex0.nPsm == CGSHandler::PSMCT16) || (tex0.nPsm == CGSHandler::PSMCT16S) ||
+		        (tex0.nPsm == CGSHandler::PSMZ16) || (tex0.nPsm == CGSHandler::PSMZ16S))
+		{
+			pixelSize = 2;
+		}
+		return tex0.GetWidth() * tex0.GetHeight() * pixelSize;
+	}
+
+	void EvictUntil(uint32 size)
+	{
+		while((m_totalSize > size) && m_lruTail)
+		{
+			Remove(m_lruTail);
+		}
+	}
+
+	void Remove(CTexture* texture)
+	{
+		IndexPages(texture, false);
+		LruRemove(texture);
+		m_totalSize -= texture->m_size;
+		uint64 tex0 = texture->m_tex0;
+		m_textures.erase(tex0);
+	}
+
+	void IndexPages(CTexture* texture, bool insert)
+	{
+		//Areas don't need to start on a page boundary
+		uint32 bufPtr = texture->m_cachedArea.GetBufPtr();
+		uint32 bufEnd = bufPtr + texture->m_cachedArea.GetSize();
+		uint32 startPage = bufPtr / CGsPixelFormats::PAGESIZE;
+		uint32 endPage = std::min<uint32>((bufEnd + CGsPixelFormats::PAGESIZE - 1) / CGsPixelFormats::PAGESIZE, RAM_PAGE_COUNT);
+		for(uint32 page = startPage; page < endPage; page++)
+		{
+			auto& pageTextures = m_pageTextures[page];
+			if(insert)
+			{
+				pageTextures.push_back(texture);
+			}
+			else
+			{
+				auto textureIterator = std::find(std::begin(pageTextures), std::end(pageTextures), texture);
+				assert(textureIterator != std::end(pageTextures));
+				*textureIterator = pageTextures.back();
+				pageTextures.pop_back();
+			}
+		}
+	}
+
+	void LruPushFront(CTexture* texture)
+	{
+		texture->m_prev = nullptr;
+		texture->m_next = m_lruHead;
+		if(m_lruHead) m_lruHead->m_prev = texture;
+		m_lruHead = texture;
+		if(!m_lruTail) m_lruTail = texture;
+	}
+
+	void LruRemove(CTexture* texture)
+	{
+		if(texture->m_prev) texture->m_prev->m_next = texture->m_next;
+		if(texture->m_next) texture->m_next->m_prev = texture->m_prev;
+		if(m_lruHead == texture) m_lruHead = texture->m_next;
+		if(m_lruTail == texture) m_lruTail = texture->m_prev;
+		texture->m_prev = nullptr;
+		texture->m_next = nullptr;
+	}
 
-	TextureList m_textureCache;
+	TextureMap m_textures;
+	TextureArray m_pageTextures[RAM_PAGE_COUNT];
+	CTexture* m_lruHead = nullptr;
+	CTexture* m_lruTail = nullptr;
+	uint32 m_totalSize = 0;
+	uint32 m_invalidateId = 0;
 };
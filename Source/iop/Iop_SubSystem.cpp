@@ -155,6 +155,7 @@ void CSubSystem::Reset()
 	m_cpu.m_Functions.RemoveTags();
 
 	m_dmaUpdateTicks = 0;
+	m_isIdle = false;
 }
 
 void CSubSystem::SetupPageTable()
@@ -285,7 +286,7 @@ void CSubSystem::CheckPendingInterrupts()
 
 bool CSubSystem::IsCpuIdle()
 {
-	return m_bios->IsIdle();
+	return m_bios->IsIdle() || m_isIdle;
 }
 
 void CSubSystem::CountTicks(int ticks)
@@ -317,6 +318,7 @@ void CSubSystem::CountTicks(int ticks)
 
 int CSubSystem::ExecuteCpu(int quota)
 {
+	m_isIdle = false;
 	int executed = 0;
 	CheckPendingInterrupts();
 	if(!m_cpu.m_State.nHasException)
@@ -339,6 +341,12 @@ int CSubSystem::ExecuteCpu(int quota)
 			m_cpu.m_State.nHasException = MIPS_EXCEPTION_NONE;
 		}
 		break;
+		case MIPS_EXCEPTION_IDLE:
+		{
+			m_isIdle = true;
+			m_cpu.m_State.nHasException = MIPS_EXCEPTION_NONE;
+		}
+		break;
 		}
 		assert(m_cpu.m_State.nHasException == MIPS_EXCEPTION_NONE);
 	}
@@ -66,5 +66,6 @@ namespace Iop
 		void CheckPendingInterrupts();
 
 		int m_dmaUpdateTicks;
+		bool m_isIdle = false;
 	};
 }
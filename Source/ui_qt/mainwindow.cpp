@@ -122,6 +122,7 @@ MainWindow::MainWindow(QWidget* parent)
 	connect(debugMenuUi->actionShowFrameDebugger, &QAction::triggered, this, std::bind(&MainWindow::ShowFrameDebugger, this));
 	connect(debugMenuUi->actionDumpNextFrame, &QAction::triggered, this, std::bind(&MainWindow::DumpNextFrame, this));
 	connect(debugMenuUi->actionGsDrawEnabled, &QAction::triggered, this, std::bind(&MainWindow::ToggleGsDraw, this));
+	connect(debugMenuUi->actionDumpHotBlocks, &QAction::triggered, this, std::bind(&MainWindow::DumpHotBlocks, this));
 #endif
 }
 
@@ -731,6 +732,28 @@ void MainWindow::ToggleGsDraw()
 	m_msgLabel->setText(newState ? QString("GS Draw Enabled") : QString("GS Draw Disabled"));
 }
 
+void MainWindow::DumpHotBlocks()
+{
+	static const size_t hotBlockCount = 50;
+	auto hotBlocks = m_virtualMachine->DumpHotBlocks(hotBlockCount);
+	if(hotBlocks.empty())
+	{
+		m_msgLabel->setText(QString("Block profiler is not enabled."));
+		return;
+	}
+	try
+	{
+		auto hotBlocksPath = CAppConfig::GetBasePath() / fs::path("hotblocks.txt");
+		auto hotBlocksStream = Framework::CreateOutputStdStream(hotBlocksPath.native());
+		hotBlocksStream.Write(hotBlocks.c_str(), hotBlocks.size());
+		m_msgLabel->setText(QString("Dumped hot blocks to '%1'.").arg(hotBlocksPath.string().c_str()));
+	}
+	catch(...)
+	{
+		m_msgLabel->setText(QString("Failed to dump hot blocks."));
+	}
+}
+
 #endif
 
 void MainWindow::on_actionPause_when_focus_is_lost_triggered(bool checked)
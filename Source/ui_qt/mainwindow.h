@@ -53,6 +53,7 @@ public:
 	fs::path GetFrameDumpDirectoryPath();
 	void DumpNextFrame();
 	void ToggleGsDraw();
+	void DumpHotBlocks();
 #endif
 
 private:
@@ -71,6 +71,11 @@ std::string CStatsManager::GetProfilingInfo()
 		result += string_format("IOP Usage: %6.2f%%\r\n", (1.f - iopIdleRatio) * 100.f);
 	}
 
+	{
+		float stallMsSpent = static_cast<double>(m_gsReadback.stallTime) / 1000.0;
+		result += string_format("GS Reads:  %d (%d stalled, %6.2fms)\r\n", m_gsReadback.readCount, m_gsReadback.stallCount, stallMsSpent);
+	}
+
 	return result;
 }
 
@@ -87,6 +92,7 @@ void CStatsManager::ClearStats()
 		zonePair.second.currentValue = 0;
 	}
 	m_cpuUtilisation = CPS2VM::CPU_UTILISATION_INFO();
+	m_gsReadback = CGSHandler::READBACK_STATS();
 #endif
 }
 
@@ -112,6 +118,11 @@ void CStatsManager::OnProfileFrameDone(CPS2VM* virtualMachine, const CProfiler::
 	m_cpuUtilisation.eeIdleTicks += cpuUtilisation.eeIdleTicks;
 	m_cpuUtilisation.iopTotalTicks += cpuUtilisation.iopTotalTicks;
 	m_cpuUtilisation.iopIdleTicks += cpuUtilisation.iopIdleTicks;
+
+	auto gsReadback = virtualMachine->GetGsReadbackStats();
+	m_gsReadback.readCount += gsReadback.readCount;
+	m_gsReadback.stallCount += gsReadback.stallCount;
+	m_gsReadback.stallTime += gsReadback.stallTime;
 }
 
 #endif
@@ -41,6 +41,7 @@ private:
 	typedef std::map<std::string, ZONEINFO> ZoneMap;
 
 	CPS2VM::CPU_UTILISATION_INFO m_cpuUtilisation;
+	CGSHandler::READBACK_STATS m_gsReadback;
 
 	std::mutex m_profilerZonesMutex;
 	ZoneMap m_profilerZones;
@@ -5,12 +5,15 @@
 #include "iop/IopBios.h"
 #include "JUnitTestReportWriter.h"
 #include "gs/GSH_Null.h"
+#include "gs/GSH_Software.h"
+#include "bitmap/BMP.h"
 #ifdef _WIN32
 #include "gs/GSH_OpenGLWin32/GSH_OpenGLWin32.h"
 #include "gs/GSH_Direct3D9/GSH_Direct3D9.h"
 #endif
 
 #define GS_HANDLER_NAME_NULL "null"
+#define GS_HANDLER_NAME_SOFTWARE "software"
 #define GS_HANDLER_NAME_OGL "ogl"
 #define GS_HANDLER_NAME_D3D9 "d3d9"
 
@@ -19,6 +22,7 @@
 static std::set<std::string> g_validGsHandlersNames =
     {
         GS_HANDLER_NAME_NULL,
+        GS_HANDLER_NAME_SOFTWARE,
 #ifdef _WIN32
         GS_HANDLER_NAME_OGL,
         GS_HANDLER_NAME_D3D9,
@@ -45,6 +49,10 @@ CGSHandler::FactoryFunction GetGsHandlerFactoryFunction(const std::string& gsHan
 	{
 		return CGSH_Null::GetFactoryFunction();
 	}
+	else if(gsHandlerName == GS_HANDLER_NAME_SOFTWARE)
+	{
+		return CGSH_Software::GetFactoryFunction();
+	}
 #ifdef _WIN32
 	else if(gsHandlerName == GS_HANDLER_NAME_OGL)
 	{
@@ -140,6 +148,26 @@ void ExecuteEeTest(const fs::path& testFilePath, const std::string& gsHandlerNam
 	}
 
 	virtualMachine.Pause();
+
+	if(gsHandlerName == GS_HANDLER_NAME_SOFTWARE)
+	{
+		//Save what the test left on screen next to its result
+		auto screenshotFilePath = testFilePath;
+		screenshotFilePath.replace_extension(".bmp");
+		try
+		{
+			auto gs = virtualMachine.m_ee->m_gs;
+			gs->Flip(true);
+			auto screenshot = gs->GetScreenshot();
+			auto screenshotStream = Framework::CreateOutputStdStream(screenshotFilePath.string());
+			Framework::CBMP::WriteBitmap(screenshot, screenshotStream);
+		}
+		catch(const std::exception& exception)
+		{
+			printf("Failed to save screenshot for '%s': %s\r\n", testFilePath.string().c_str(), exception.what());
+		}
+	}
+
 	virtualMachine.DestroyGSHandler();
 	virtualMachine.Destroy();
 }
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <chrono>
+
+class CBenchmark
+{
+public:
+	typedef std::chrono::high_resolution_clock Clock;
+
+	virtual ~CBenchmark()
+	{
+	}
+	virtual void Execute() = 0;
+
+protected:
+	template <typename DurationType>
+	static double ToMicroseconds(const DurationType& duration)
+	{
+		return std::chrono::duration<double, std::micro>(duration).count();
+	}
+};
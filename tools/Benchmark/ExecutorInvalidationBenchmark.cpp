@@ -0,0 +1,85 @@
+#include <cstdio>
+#include <cassert>
+#include "ExecutorInvalidationBenchmark.h"
+#include "MIPS.h"
+#include "MA_MIPSIV.h"
+#include "GenericMipsExecutor.h"
+
+#define RAM_SIZE (0x00200000)
+#define PAGE_SIZE (0x1000)
+#define ITERATION_COUNT (256)
+
+//Each block is ADDIU, BEQ and delay slot, branching to the following block
+#define BLOCK_SIZE (0x0C)
+#define OPCODE_ADDIU_T0 (0x25080001)
+#define OPCODE_BEQ_NEXT (0x10000001)
+#define OPCODE_NOP (0x00000000)
+
+class CBenchmarkExecutor : public CGenericMipsExecutor<BlockLookupTwoWay>
+{
+public:
+	CBenchmarkExecutor(CMIPS& context, uint32 maxAddress)
+	    : CGenericMipsExecutor(context, maxAddress)
+	{
+	}
+
+	using CGenericMipsExecutor::PartitionFunction;
+};
+
+static void CreateBlocks(CBenchmarkExecutor& executor, uint32 begin, uint32 end)
+{
+	uint32 firstBlock = begin / BLOCK_SIZE;
+	for(uint32 address = firstBlock * BLOCK_SIZE; address < end; address += BLOCK_SIZE)
+	{
+		if(!executor.FindBlockStartingAt(address)->IsEmpty()) continue;
+		executor.PartitionFunction(address);
+	}
+}
+
+void CExecutorInvalidationBenchmark::Execute()
+{
+	static const uint32 blockCounts[] = {0x400, 0x2000, 0x10000, 0x20000};
+
+	auto ram = new uint8[RAM_SIZE];
+	auto instructions = reinterpret_cast<uint32*>(ram);
+	for(uint32 i = 0; i < (RAM_SIZE / BLOCK_SIZE); i++)
+	{
+		instructions[(i * 3) + 0] = OPCODE_ADDIU_T0;
+		instructions[(i * 3) + 1] = OPCODE_BEQ_NEXT;
+		instructions[(i * 3) + 2] = OPCODE_NOP;
+	}
+
+	CMIPS cpu(MEMORYMAP_ENDIAN_LSBF);
+	CMA_MIPSIV arch(MIPS_REGSIZE_64);
+	cpu.m_pMemoryMap->InsertReadMap(0, RAM_SIZE - 1, ram, 0x00);
+	cpu.m_pMemoryMap->InsertInstructionMap(0, RAM_SIZE - 1, ram, 0x01);
+	cpu.m_pArch = &arch;
+	cpu.m_pAddrTranslator = &CMIPS::TranslateAddress64;
+
+	CBenchmarkExecutor executor(cpu, RAM_SIZE);
+
+	printf("Executor invalidation:\r\n");
+	for(auto blockCount : blockCounts)
+	{
+		uint32 codeSize = blockCount * BLOCK_SIZE;
+		assert(codeSize <= RAM_SIZE);
+
+		executor.Reset();
+		CreateBlocks(executor, 0, codeSize);
+
+		Clock::duration totalTime = Clock::duration::zero();
+		uint32 pageCount = codeSize / PAGE_SIZE;
+		for(uint32 i = 0; i < ITERATION_COUNT; i++)
+		{
+			uint32 pageAddress = ((i * 7919) % pageCount) * PAGE_SIZE;
+			auto startTime = Clock::now();
+			executor.ClearActiveBlocksInRange(pageAddress, pageAddress + PAGE_SIZE, false);
+			totalTime += Clock::now() - startTime;
+			CreateBlocks(executor, pageAddress, pageAddress + PAGE_SIZE + BLOCK_SIZE);
+		}
+
+		printf("  %6d blocks: %8.2f us/page\r\n", blockCount, ToMicroseconds(totalTime) / ITERATION_COUNT);
+	}
+
+	delete[] ram;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "Benchmark.h"
+
+//Measures how long it takes to invalidate a single page of code depending on the
+//total amount of blocks known by the executor
+class CExecutorInvalidationBenchmark : public CBenchmark
+{
+public:
+	void Execute() override;
+};
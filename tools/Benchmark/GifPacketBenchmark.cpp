@@ -0,0 +1,344 @@
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include "GifPacketBenchmark.h"
+#include "ee/GIF.h"
+#include "gs/GSH_Null.h"
+#include "StdStreamUtils.h"
+#include "uint128.h"
+
+#define ITERATION_COUNT (10)
+#define MAX_TAG_LOOPS (0x7FFF)
+#define QTEMP_INIT (0x3F800000)
+
+enum PACKED_DESC : uint8
+{
+	PACKED_PRIM = 0x00,
+	PACKED_RGBAQ = 0x01,
+	PACKED_ST = 0x02,
+	PACKED_UV = 0x03,
+	PACKED_XYZF2 = 0x04,
+	PACKED_XYZ2 = 0x05,
+	PACKED_AD = 0x0E,
+};
+
+//XYZF3/XYZ3 are sent as XYZF2/XYZ2 with the ADC bit set in PACKED mode
+static uint8 GetPackedRegister(uint8 reg)
+{
+	switch(reg)
+	{
+	case GS_REG_XYZF3:
+		return GS_REG_XYZF2;
+	case GS_REG_XYZ3:
+		return GS_REG_XYZ2;
+	default:
+		return reg;
+	}
+}
+
+static uint8 GetPackedDescriptor(uint8 packedRegister)
+{
+	switch(packedRegister)
+	{
+	case GS_REG_PRIM:
+		return PACKED_PRIM;
+	case GS_REG_RGBAQ:
+		return PACKED_RGBAQ;
+	case GS_REG_ST:
+		return PACKED_ST;
+	case GS_REG_UV:
+		return PACKED_UV;
+	case GS_REG_XYZF2:
+		return PACKED_XYZF2;
+	case GS_REG_XYZ2:
+		return PACKED_XYZ2;
+	default:
+		return PACKED_AD;
+	}
+}
+
+//Checks that the GIF will produce the exact same register value, RGBAQ takes Q from the last ST
+static bool IsPackedEncodable(uint8 desc, uint64 value, uint32 qtemp)
+{
+	switch(desc)
+	{
+	case PACKED_PRIM:
+		return (value >> 32) == 0;
+	case PACKED_RGBAQ:
+		return static_cast<uint32>(value >> 32) == qtemp;
+	case PACKED_UV:
+		return (value & ~0x7FFF7FFFULL) == 0;
+	default:
+		return true;
+	}
+}
+
+static uint128 EncodePacked(uint8 desc, const CGSHandler::RegisterWrite& write, uint32 q)
+{
+	uint128 qword;
+	memset(&qword, 0, sizeof(qword));
+	uint64 value = write.second;
+	bool adc = (write.first == GS_REG_XYZF3) || (write.first == GS_REG_XYZ3);
+	switch(desc)
+	{
+	case PACKED_PRIM:
+		qword.nV0 = static_cast<uint32>(value);
+		break;
+	case PACKED_RGBAQ:
+		qword.nV0 = static_cast<uint32>(value >> 0) & 0xFF;
+		qword.nV1 = static_cast<uint32>(value >> 8) & 0xFF;
+		qword.nV2 = static_cast<uint32>(value >> 16) & 0xFF;
+		qword.nV3 = static_cast<uint32>(value >> 24) & 0xFF;
+		break;
+	case PACKED_ST:
+		qword.nD0 = value;
+		qword.nV2 = q;
+		break;
+	case PACKED_UV:
+		qword.nV0 = static_cast<uint32>(value >> 0) & 0x7FFF;
+		qword.nV1 = static_cast<uint32>(value >> 16) & 0x7FFF;
+		break;
+	case PACKED_XYZF2:
+		qword.nV0 = static_cast<uint32>(value >> 0) & 0xFFFF;
+		qword.nV1 = static_cast<uint32>(value >> 16) & 0xFFFF;
+		qword.nV2 = static_cast<uint32>(value >> 28) & 0x0FFFFFF0;
+		qword.nV3 = (static_cast<uint32>(value >> 52) & 0x00000FF0) | (adc ? 0x8000 : 0);
+		break;
+	case PACKED_XYZ2:
+		qword.nV0 = static_cast<uint32>(value >> 0) & 0xFFFF;
+		qword.nV1 = static_cast<uint32>(value >> 16) & 0xFFFF;
+		qword.nV2 = static_cast<uint32>(value >> 32);
+		qword.nV3 = adc ? 0x8000 : 0;
+		break;
+	case PACKED_AD:
+		qword.nD0 = value;
+		qword.nD1 = write.first;
+		break;
+	}
+	return qword;
+}
+
+static size_t AppendTag(std::vector<uint8>& packet, const CGIF::TAG& tag)
+{
+	size_t tagOffset = packet.size();
+	packet.resize(tagOffset + sizeof(CGIF::TAG));
+	memcpy(packet.data() + tagOffset, &tag, sizeof(CGIF::TAG));
+	return tagOffset;
+}
+
+CGifPacketBenchmark::CGifPacketBenchmark(const fs::path& frameDumpPath)
+    : m_frameDumpPath(frameDumpPath)
+{
+}
+
+//Loops are made of registers up to the first one that comes back, like what games send.
+//Loops that can't be expressed with vertex descriptors use A+D for those registers.
+void CGifPacketBenchmark::AppendRegisterWrites(std::vector<uint8>& packet, const CGsPacket::RegisterWriteArray& packetWrites, uint32& vertexWriteCount)
+{
+	//SIGNAL writes would wait for the EE to acknowledge them, leave them out
+	CGsPacket::RegisterWriteArray writes;
+	std::copy_if(packetWrites.begin(), packetWrites.end(), std::back_inserter(writes),
+	             [](const CGSHandler::RegisterWrite& write) { return write.first != GS_REG_SIGNAL; });
+
+	//Q of the next RGBAQ write, given to ST writes coming before it
+	std::vector<uint32> nextQ(writes.size());
+	{
+		uint32 q = QTEMP_INIT;
+		for(size_t i = writes.size(); i-- > 0;)
+		{
+			nextQ[i] = q;
+			if(writes[i].first == GS_REG_RGBAQ)
+			{
+				q = static_cast<uint32>(writes[i].second >> 32);
+			}
+		}
+	}
+
+	size_t index = 0;
+	while(index < writes.size())
+	{
+		uint8 regs[0x10];
+		uint8 descs[0x10];
+		uint32 regCount = 0;
+		uint32 qtemp = QTEMP_INIT;
+		while((regCount < 0x10) && ((index + regCount) < writes.size()))
+		{
+			const auto& write = writes[index + regCount];
+			uint8 reg = GetPackedRegister(write.first);
+			if(std::find(regs, regs + regCount, reg) != (regs + regCount)) break;
+			uint8 desc = GetPackedDescriptor(reg);
+			if(!IsPackedEncodable(desc, write.second, qtemp))
+			{
+				desc = PACKED_AD;
+			}
+			if(desc == PACKED_ST)
+			{
+				qtemp = nextQ[index + regCount];
+			}
+			regs[regCount] = reg;
+			descs[regCount] = desc;
+			regCount++;
+		}
+
+		CGIF::TAG tag;
+		memset(&tag, 0, sizeof(tag));
+		tag.cmd = 0;
+		tag.nreg = regCount & 0x0F;
+		for(uint32 i = 0; i < regCount; i++)
+		{
+			tag.regs |= static_cast<uint64>(descs[i]) << (i * 4);
+		}
+		size_t tagOffset = AppendTag(packet, tag);
+
+		//First loop always matches, following ones need the same registers
+		qtemp = QTEMP_INIT;
+		uint32 loops = 0;
+		while((loops < MAX_TAG_LOOPS) && ((index + regCount) <= writes.size()))
+		{
+			uint32 loopQ = qtemp;
+			bool matches = true;
+			for(uint32 i = 0; matches && (i < regCount); i++)
+			{
+				const auto& write = writes[index + i];
+				matches = (GetPackedRegister(write.first) == regs[i]) && IsPackedEncodable(descs[i], write.second, loopQ);
+				if(descs[i] == PACKED_ST)
+				{
+					loopQ = nextQ[index + i];
+				}
+			}
+			if(!matches) break;
+
+			for(uint32 i = 0; i < regCount; i++)
+			{
+				auto qword = EncodePacked(descs[i], writes[index + i], nextQ[index + i]);
+				auto qwordBytes = reinterpret_cast<const uint8*>(&qword);
+				packet.insert(packet.end(), qwordBytes, qwordBytes + sizeof(uint128));
+				if(descs[i] != PACKED_AD)
+				{
+					vertexWriteCount++;
+				}
+			}
+			qtemp = loopQ;
+			index += regCount;
+			loops++;
+		}
+		assert(loops != 0);
+
+		tag.loops = loops;
+		memcpy(packet.data() + tagOffset, &tag, sizeof(CGIF::TAG));
+	}
+}
+
+void CGifPacketBenchmark::AppendImageData(std::vector<uint8>& packet, const CGsPacket::ImageDataArray& imageData)
+{
+	size_t offset = 0;
+	while(offset < imageData.size())
+	{
+		uint32 qwordCount = static_cast<uint32>(std::min<size_t>((imageData.size() - offset + 0x0F) / 0x10, MAX_TAG_LOOPS));
+		size_t copySize = std::min<size_t>(qwordCount * 0x10, imageData.size() - offset);
+
+		CGIF::TAG tag;
+		memset(&tag, 0, sizeof(tag));
+		tag.loops = qwordCount;
+		tag.cmd = 2;
+		AppendTag(packet, tag);
+
+		size_t dataOffset = packet.size();
+		packet.resize(dataOffset + (qwordCount * 0x10), 0);
+		memcpy(packet.data() + dataOffset, imageData.data() + offset, copySize);
+		offset += copySize;
+	}
+}
+
+void CGifPacketBenchmark::Execute()
+{
+	if(m_frameDumpPath.empty())
+	{
+		printf("GIF packet replay: skipped, no frame dump given (usage: Benchmark frameDumpPath).\r\n");
+		return;
+	}
+
+	CFrameDump frameDump;
+	try
+	{
+		auto inputStream = Framework::CreateInputStdStream(m_frameDumpPath.native());
+		frameDump.Read(inputStream);
+	}
+	catch(const std::exception& exception)
+	{
+		printf("GIF packet replay: failed to read frame dump '%s': %s\r\n", m_frameDumpPath.string().c_str(), exception.what());
+		return;
+	}
+
+	GifPacketArray gifPackets;
+	uint32 registerWriteCount = 0;
+	uint32 vertexWriteCount = 0;
+	uint32 imageDataSize = 0;
+	for(const auto& dumpPacket : frameDump.GetPackets())
+	{
+		GIF_PACKET gifPacket;
+		gifPacket.metadata = &dumpPacket.metadata;
+		AppendRegisterWrites(gifPacket.data, dumpPacket.registerWrites, vertexWriteCount);
+		AppendImageData(gifPacket.data, dumpPacket.imageData);
+		if(gifPacket.data.empty()) continue;
+
+		//Register writes and image data are sent as a single GIF packet, ended by an empty tag
+		CGIF::TAG endTag;
+		memset(&endTag, 0, sizeof(endTag));
+		endTag.eop = 1;
+		AppendTag(gifPacket.data, endTag);
+
+		registerWriteCount += static_cast<uint32>(dumpPacket.registerWrites.size());
+		imageDataSize += static_cast<uint32>(dumpPacket.imageData.size());
+		gifPackets.push_back(std::move(gifPacket));
+	}
+
+	size_t gifDataSize = 0;
+	for(const auto& gifPacket : gifPackets)
+	{
+		gifDataSize += gifPacket.data.size();
+	}
+
+	CGSHandler* gs = new CGSH_Null();
+	gs->Initialize();
+
+	CGIF gif(gs, nullptr, nullptr);
+
+	Clock::duration submitTime(0);
+	Clock::duration totalTime(0);
+	for(uint32 iteration = 0; iteration < ITERATION_COUNT; iteration++)
+	{
+		gs->Reset();
+		memcpy(gs->GetRam(), frameDump.GetInitialGsRam(), CGSHandler::RAMSIZE);
+		memcpy(gs->GetRegisters(), frameDump.GetInitialGsRegisters(), CGSHandler::REGISTER_MAX * sizeof(uint64));
+		gs->SetSMODE2(frameDump.GetInitialSMODE2());
+		gif.Reset();
+
+		auto startTime = Clock::now();
+		for(const auto& gifPacket : gifPackets)
+		{
+			gif.ProcessSinglePacket(gifPacket.data.data(), 0, static_cast<uint32>(gifPacket.data.size()), *gifPacket.metadata);
+		}
+		submitTime += Clock::now() - startTime;
+		//Waits for all queued commands to be processed
+		gs->Flip(true);
+		totalTime += Clock::now() - startTime;
+	}
+
+	printf("GIF packet replay (%s, %d iterations):\r\n", m_frameDumpPath.filename().string().c_str(), ITERATION_COUNT);
+	printf("  %d packets, %d register writes (%d%% through vertex descriptors), %d bytes of image data\r\n",
+	       static_cast<int>(gifPackets.size()), registerWriteCount,
+	       registerWriteCount ? static_cast<int>((static_cast<uint64>(vertexWriteCount) * 100) / registerWriteCount) : 0, imageDataSize);
+
+	double megabytes = static_cast<double>(gifDataSize) * ITERATION_COUNT / (1024.0 * 1024.0);
+	double writes = static_cast<double>(registerWriteCount) * ITERATION_COUNT;
+	double submitSeconds = ToMicroseconds(submitTime) / 1000000.0;
+	double totalSeconds = ToMicroseconds(totalTime) / 1000000.0;
+	printf("  submit: %8.1f MB/s (%6.1f Mwrites/s), processed: %8.1f MB/s\r\n",
+	       megabytes / submitSeconds, writes / (submitSeconds * 1000000.0), megabytes / totalSeconds);
+
+	gs->Release();
+	delete gs;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+#include "Types.h"
+#include "Benchmark.h"
+#include "filesystem_def.h"
+#include "FrameDump.h"
+
+//Replays a frame dump (same format as FrameReplay) through the GIF. Register writes of every
+//packet are turned back into PACKED GIF tags and reports how fast they get converted to GS
+//register writes again
+class CGifPacketBenchmark : public CBenchmark
+{
+public:
+	CGifPacketBenchmark(const fs::path&);
+
+	void Execute() override;
+
+private:
+	struct GIF_PACKET
+	{
+		const CGsPacketMetadata* metadata = nullptr;
+		std::vector<uint8> data;
+	};
+	typedef std::vector<GIF_PACKET> GifPacketArray;
+
+	static void AppendRegisterWrites(std::vector<uint8>&, const CGsPacket::RegisterWriteArray&, uint32&);
+	static void AppendImageData(std::vector<uint8>&, const CGsPacket::ImageDataArray&);
+
+	fs::path m_frameDumpPath;
+};
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include "GsCachedAreaBenchmark.h"
+#include "gs/GsCachedArea.h"
+#include "gs/GsPixelFormats.h"
+
+#define FRAME_COUNT (256)
+#define UPLOADS_PER_FRAME (32)
+
+struct CACHED_TEXTURE
+{
+	unsigned int psm;
+	uint32 width;
+	uint32 height;
+	uint32 bytesPerPixel;
+};
+
+struct UPLOAD
+{
+	const char* description;
+	uint32 size;
+};
+
+//Host side pixel size matches what the OpenGL texture updaters produce
+static const CACHED_TEXTURE g_textures[] =
+    {
+        {CGSHandler::PSMCT32, 256, 256, 4},
+        {CGSHandler::PSMCT32, 512, 256, 4},
+        {CGSHandler::PSMCT16, 256, 256, 2},
+        {CGSHandler::PSMT8, 512, 512, 1},
+        {CGSHandler::PSMT8, 256, 256, 1},
+        {CGSHandler::PSMT4, 512, 512, 1},
+};
+
+static const UPLOAD g_uploads[] =
+    {
+        {"CLUT (16 colors)", 16 * 4},
+        {"CLUT (256 colors)", 256 * 4},
+        {"Sprite (32x32)", 32 * 32 * 4},
+        {"Sprite (64x64)", 64 * 64 * 4},
+};
+
+static uint64 GetRectBytes(const CACHED_TEXTURE& texture, uint32 x, uint32 y, uint32 width, uint32 height)
+{
+	if((x >= texture.width) || (y >= texture.height)) return 0;
+	width = std::min(width, texture.width - x);
+	height = std::min(height, texture.height - y);
+	return static_cast<uint64>(width) * height * texture.bytesPerPixel;
+}
+
+//Previous behavior, whole dirty pages are converted
+static uint64 UpdatePages(CGsCachedArea& area, const CACHED_TEXTURE& texture)
+{
+	auto pageSize = CGsPixelFormats::GetPsmPageSize(texture.psm);
+	uint64 bytes = 0;
+	while(area.HasDirtyPages())
+	{
+		auto dirtyRect = area.GetDirtyPageRect();
+		area.ClearDirtyPages(dirtyRect);
+		bytes += GetRectBytes(texture, dirtyRect.x * pageSize.first, dirtyRect.y * pageSize.second,
+		                      dirtyRect.width * pageSize.first, dirtyRect.height * pageSize.second);
+	}
+	return bytes;
+}
+
+static uint64 UpdateBlocks(CGsCachedArea& area, const CACHED_TEXTURE& texture)
+{
+	uint64 bytes = 0;
+	while(area.HasDirtyPages())
+	{
+		auto dirtyRect = area.GetDirtyPageRect();
+		auto pixelRect = area.GetDirtyPixelRect(dirtyRect);
+		area.ClearDirtyPages(dirtyRect);
+		bytes += GetRectBytes(texture, pixelRect.x, pixelRect.y, pixelRect.width, pixelRect.height);
+	}
+	return bytes;
+}
+
+void CGsCachedAreaBenchmark::Execute()
+{
+	static const unsigned int textureCount = sizeof(g_textures) / sizeof(g_textures[0]);
+
+	printf("GS cached area bytes re-uploaded per frame:\r\n");
+
+	for(const auto& upload : g_uploads)
+	{
+		std::vector<CGsCachedArea> pageAreas(textureCount);
+		std::vector<CGsCachedArea> blockAreas(textureCount);
+		uint32 bufPtr = 0;
+		for(unsigned int i = 0; i < textureCount; i++)
+		{
+			const auto& texture = g_textures[i];
+			uint32 bufWidth = std::max<uint32>(texture.width, 64);
+			pageAreas[i].SetArea(texture.psm, bufPtr, bufWidth, texture.height);
+			blockAreas[i].SetArea(texture.psm, bufPtr, bufWidth, texture.height);
+			bufPtr += pageAreas[i].GetSize();
+		}
+		uint32 totalSize = bufPtr;
+
+		uint64 pageBytes = 0;
+		uint64 blockBytes = 0;
+		uint32 seed = 0x12345678;
+		auto startTime = Clock::now();
+		for(uint32 frame = 0; frame < FRAME_COUNT; frame++)
+		{
+			for(uint32 i = 0; i < UPLOADS_PER_FRAME; i++)
+			{
+				//Uploads are block aligned, like most transfers issued by games
+				seed = (seed * 1103515245) + 12345;
+				uint32 address = ((seed >> 8) % (totalSize / CGsPixelFormats::BLOCKSIZE)) * CGsPixelFormats::BLOCKSIZE;
+				for(unsigned int t = 0; t < textureCount; t++)
+				{
+					pageAreas[t].Invalidate(address, upload.size);
+					blockAreas[t].Invalidate(address, upload.size);
+				}
+			}
+			for(unsigned int t = 0; t < textureCount; t++)
+			{
+				pageBytes += UpdatePages(pageAreas[t], g_textures[t]);
+				blockBytes += UpdateBlocks(blockAreas[t], g_textures[t]);
+			}
+		}
+		auto totalTime = Clock::now() - startTime;
+
+		double pageKbPerFrame = static_cast<double>(pageBytes) / (1024.0 * FRAME_COUNT);
+		double blockKbPerFrame = static_cast<double>(blockBytes) / (1024.0 * FRAME_COUNT);
+		printf("  %-20s pages: %10.2f KB, blocks: %10.2f KB (%5.1f%%), %8.2f us/frame\r\n",
+		       upload.description, pageKbPerFrame, blockKbPerFrame,
+		       (pageBytes != 0) ? (100.0 * blockBytes / pageBytes) : 0.0,
+		       ToMicroseconds(totalTime) / FRAME_COUNT);
+	}
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "Benchmark.h"
+
+//Replays small uploads (CLUTs, sprites) over a set of cached textures and reports how many
+//bytes need to be converted and uploaded again each frame with page and block granularity
+class CGsCachedAreaBenchmark : public CBenchmark
+{
+public:
+	void Execute() override;
+};
@@ -0,0 +1,92 @@
+#include <cstdio>
+#include <vector>
+#include "GsPacketReplayBenchmark.h"
+#include "gs/GSH_Null.h"
+#include "FrameDump.h"
+
+#define PACKET_COUNT (0x40000)
+#define SPRITES_PER_PACKET (4)
+#define IMAGE_PACKET_SIZE (0x200)
+
+void CGsPacketReplayBenchmark::ReplayRegisterPackets(CGSHandler& gs)
+{
+	//Packets similar to what a PACKED GIF tag drawing a few sprites produces
+	CGSHandler::RegisterWriteList packet;
+	for(uint32 i = 0; i < SPRITES_PER_PACKET; i++)
+	{
+		packet.push_back(CGSHandler::RegisterWrite(GS_REG_PRIM, CGSHandler::PRIM_SPRITE));
+		packet.push_back(CGSHandler::RegisterWrite(GS_REG_RGBAQ, 0x3F80000080808080ULL));
+		packet.push_back(CGSHandler::RegisterWrite(GS_REG_XYZ2, 0));
+		packet.push_back(CGSHandler::RegisterWrite(GS_REG_XYZ2, (i << 4) | (0x100ULL << 16)));
+	}
+
+	CGsPacketMetadata metadata(1);
+	auto startTime = Clock::now();
+	for(uint32 i = 0; i < PACKET_COUNT; i++)
+	{
+		gs.WriteRegisterMassively(packet, &metadata);
+	}
+	auto submitTime = Clock::now() - startTime;
+	//Waits for all queued commands to be processed
+	gs.Flip(true);
+	auto totalTime = Clock::now() - startTime;
+
+	PrintResults("Register writes:", PACKET_COUNT, submitTime, totalTime);
+}
+
+void CGsPacketReplayBenchmark::ReplayImagePackets(CGSHandler& gs)
+{
+	uint32 width = 512;
+	uint32 height = (PACKET_COUNT * IMAGE_PACKET_SIZE) / (width * 4);
+
+	auto bltBuf = make_convertible<CGSHandler::BITBLTBUF>(0);
+	bltBuf.nDstPtr = 0;
+	bltBuf.nDstWidth = width / 64;
+	bltBuf.nDstPsm = CGSHandler::PSMCT32;
+
+	auto trxReg = make_convertible<CGSHandler::TRXREG>(0);
+	trxReg.nRRW = width;
+	trxReg.nRRH = height;
+
+	gs.WriteRegister(GS_REG_BITBLTBUF, bltBuf);
+	gs.WriteRegister(GS_REG_TRXPOS, 0);
+	gs.WriteRegister(GS_REG_TRXREG, trxReg);
+	gs.WriteRegister(GS_REG_TRXDIR, 0);
+
+	std::vector<uint8> packet(IMAGE_PACKET_SIZE);
+	for(uint32 i = 0; i < IMAGE_PACKET_SIZE; i++)
+	{
+		packet[i] = static_cast<uint8>(i);
+	}
+
+	auto startTime = Clock::now();
+	for(uint32 i = 0; i < PACKET_COUNT; i++)
+	{
+		gs.FeedImageData(packet.data(), IMAGE_PACKET_SIZE);
+	}
+	auto submitTime = Clock::now() - startTime;
+	gs.Flip(true);
+	auto totalTime = Clock::now() - startTime;
+
+	PrintResults("Image data:", PACKET_COUNT, submitTime, totalTime);
+}
+
+void CGsPacketReplayBenchmark::PrintResults(const char* description, uint32 packetCount, Clock::duration submitTime, Clock::duration totalTime)
+{
+	double submitRate = static_cast<double>(packetCount) / (ToMicroseconds(submitTime) / 1000000.0);
+	double totalRate = static_cast<double>(packetCount) / (ToMicroseconds(totalTime) / 1000000.0);
+	printf("  %-18s submit: %12.0f packets/s, processed: %12.0f packets/s\r\n", description, submitRate, totalRate);
+}
+
+void CGsPacketReplayBenchmark::Execute()
+{
+	CGSH_Null gs;
+	gs.Initialize();
+
+	printf("GS packet replay:\r\n");
+
+	ReplayRegisterPackets(gs);
+	ReplayImagePackets(gs);
+
+	gs.Release();
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Types.h"
+#include "Benchmark.h"
+
+class CGSHandler;
+
+//Replays small GIF packets (register write runs and image chunks) to the GS handler and reports
+//how fast the emulator thread can submit them and how fast the GS thread gets through them
+class CGsPacketReplayBenchmark : public CBenchmark
+{
+public:
+	void Execute() override;
+
+private:
+	static void ReplayRegisterPackets(CGSHandler&);
+	static void ReplayImagePackets(CGSHandler&);
+	static void PrintResults(const char*, uint32, Clock::duration, Clock::duration);
+};
@@ -0,0 +1,107 @@
+#include <cstdio>
+#include <vector>
+#include "GsTransferBenchmark.h"
+#include "gs/GSH_Null.h"
+#include "gs/GsPixelFormats.h"
+
+#define ITERATION_COUNT (64)
+
+struct TRANSFER_AREA
+{
+	const char* description;
+	uint32 x;
+	uint32 y;
+	uint32 width;
+	uint32 height;
+};
+
+static const TRANSFER_AREA g_areas[] =
+    {
+        {"Aligned:", 0, 0, 512, 512},
+        {"Ragged:", 3, 5, 501, 499},
+};
+
+template <typename Storage>
+static bool CheckTransfer(CGSHandler& gs, const TRANSFER_AREA& area, const std::vector<uint8>& data, uint32 bufWidth)
+{
+	typedef CGsPixelFormats::CBlockSwizzler<Storage> Swizzler;
+	CGsPixelFormats::CPixelIndexor<Storage> indexor(gs.GetRam(), 0, bufWidth);
+	for(uint32 y = 0; y < area.height; y++)
+	{
+		for(uint32 x = 0; x < area.width; x++)
+		{
+			//Rows can start in the middle of a byte, treat the data as a single row
+			uint32 pixelIndex = x + (y * area.width);
+			auto pixel = Swizzler::GetSourcePixel(data.data(), 0, pixelIndex, 0);
+			if(indexor.GetPixel(area.x + x, area.y + y) != pixel) return false;
+		}
+	}
+	return true;
+}
+
+template <typename Storage>
+void CGsTransferBenchmark::RunTransfers(CGSHandler& gs, const char* psmName, unsigned int psm)
+{
+	typedef CGsPixelFormats::CBlockSwizzler<Storage> Swizzler;
+	const uint32 bufWidth = 1024 / 64;
+
+	printf("  %s\r\n", psmName);
+	for(const auto& area : g_areas)
+	{
+		uint32 dataSize = (area.width * area.height * Swizzler::PIXELBITS) / 8;
+		std::vector<uint8> data(dataSize);
+		for(uint32 i = 0; i < dataSize; i++)
+		{
+			data[i] = static_cast<uint8>((i * 0x9E3779B1) >> 13);
+		}
+
+		auto bltBuf = make_convertible<CGSHandler::BITBLTBUF>(0);
+		bltBuf.nDstPtr = 0;
+		bltBuf.nDstWidth = bufWidth;
+		bltBuf.nDstPsm = psm;
+
+		auto trxPos = make_convertible<CGSHandler::TRXPOS>(0);
+		trxPos.nDSAX = area.x;
+		trxPos.nDSAY = area.y;
+
+		auto trxReg = make_convertible<CGSHandler::TRXREG>(0);
+		trxReg.nRRW = area.width;
+		trxReg.nRRH = area.height;
+
+		auto startTime = Clock::now();
+		for(uint32 i = 0; i < ITERATION_COUNT; i++)
+		{
+			//Change contents to make sure every transfer actually writes to memory
+			data[0] ^= 0xFF;
+			gs.WriteRegister(GS_REG_BITBLTBUF, bltBuf);
+			gs.WriteRegister(GS_REG_TRXPOS, trxPos);
+			gs.WriteRegister(GS_REG_TRXREG, trxReg);
+			gs.WriteRegister(GS_REG_TRXDIR, 0);
+			gs.FeedImageData(data.data(), dataSize);
+		}
+		//Waits for all queued commands to be processed
+		gs.Flip(true);
+		auto totalTime = Clock::now() - startTime;
+
+		double megabytes = static_cast<double>(dataSize) * ITERATION_COUNT / (1024.0 * 1024.0);
+		double seconds = ToMicroseconds(totalTime) / 1000000.0;
+		bool valid = CheckTransfer<Storage>(gs, area, data, bufWidth);
+		printf("    %-10s %10.2f MB/s%s\r\n", area.description, megabytes / seconds, valid ? "" : " (MISMATCH)");
+	}
+}
+
+void CGsTransferBenchmark::Execute()
+{
+	CGSH_Null gs;
+	gs.Initialize();
+
+	printf("GS host to local transfer throughput:\r\n");
+
+	RunTransfers<CGsPixelFormats::STORAGEPSMCT32>(gs, "PSMCT32", CGSHandler::PSMCT32);
+	RunTransfers<CGsPixelFormats::STORAGEPSMZ32>(gs, "PSMZ32", CGSHandler::PSMZ32);
+	RunTransfers<CGsPixelFormats::STORAGEPSMCT16>(gs, "PSMCT16", CGSHandler::PSMCT16);
+	RunTransfers<CGsPixelFormats::STORAGEPSMT8>(gs, "PSMT8", CGSHandler::PSMT8);
+	RunTransfers<CGsPixelFormats::STORAGEPSMT4>(gs, "PSMT4", CGSHandler::PSMT4);
+
+	gs.Release();
+}
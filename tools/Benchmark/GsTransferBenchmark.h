@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Benchmark.h"
+
+class CGSHandler;
+
+//Uploads images through host to local transfers and reports the throughput for each
+//pixel storage format, with block aligned areas and with areas that have ragged edges
+class CGsTransferBenchmark : public CBenchmark
+{
+public:
+	void Execute() override;
+
+private:
+	template <typename Storage>
+	static void RunTransfers(CGSHandler&, const char*, unsigned int);
+};
@@ -0,0 +1,101 @@
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "IpuIdctBenchmark.h"
+#include "ee/IPU_Idct.h"
+#include "idct/IEEE1180.h"
+
+#define BLOCK_COUNT (10000)
+#define ITERATION_COUNT (16)
+
+struct COEFFICIENT_RANGE
+{
+	const char* description;
+	int low;
+	int high;
+	//Odds for a coefficient to be non zero (out of 64), decoded blocks are usually sparse
+	unsigned int density;
+};
+
+static const COEFFICIENT_RANGE g_ranges[] =
+    {
+        {"[-256, 255]", -256, 255, 64},
+        {"[-5, 5]", -5, 5, 64},
+        {"[-300, 300]", -300, 300, 64},
+        {"Sparse", -300, 300, 6},
+        {"DC only", -2048, 2047, 0},
+};
+
+typedef std::vector<int16> BlockArray;
+
+static BlockArray GenerateBlocks(const COEFFICIENT_RANGE& range)
+{
+	std::mt19937 generator(1180);
+	std::uniform_int_distribution<int> valueDistribution(range.low, range.high);
+	std::uniform_int_distribution<unsigned int> densityDistribution(0, 63);
+	BlockArray blocks(BLOCK_COUNT * 64);
+	for(uint32 i = 0; i < blocks.size(); i++)
+	{
+		bool isDc = (i % 64) == 0;
+		bool isSet = isDc || (densityDistribution(generator) < range.density);
+		blocks[i] = isSet ? static_cast<int16>(valueDistribution(generator)) : 0;
+	}
+	return blocks;
+}
+
+void CIpuIdctBenchmark::Execute()
+{
+	printf("IPU IDCT throughput:\r\n");
+
+	auto reference = IDCT::CIEEE1180::GetInstance();
+	for(const auto& range : g_ranges)
+	{
+		auto sourceBlocks = GenerateBlocks(range);
+
+		auto referenceBlocks = sourceBlocks;
+		auto referenceStartTime = Clock::now();
+		for(uint32 iteration = 0; iteration < ITERATION_COUNT; iteration++)
+		{
+			memcpy(referenceBlocks.data(), sourceBlocks.data(), sourceBlocks.size() * sizeof(int16));
+			for(uint32 i = 0; i < BLOCK_COUNT; i++)
+			{
+				int16 blockTemp[64];
+				int16* block = referenceBlocks.data() + (i * 64);
+				memcpy(blockTemp, block, sizeof(blockTemp));
+				reference->Transform(blockTemp, block);
+			}
+		}
+		auto referenceTime = Clock::now() - referenceStartTime;
+
+		auto blocks = sourceBlocks;
+		auto startTime = Clock::now();
+		for(uint32 iteration = 0; iteration < ITERATION_COUNT; iteration++)
+		{
+			memcpy(blocks.data(), sourceBlocks.data(), sourceBlocks.size() * sizeof(int16));
+			for(uint32 i = 0; i < BLOCK_COUNT; i++)
+			{
+				IPU::CIdct::Transform(blocks.data() + (i * 64));
+			}
+		}
+		auto time = Clock::now() - startTime;
+
+		uint32 mismatchCount = 0;
+		for(uint32 i = 0; i < BLOCK_COUNT; i++)
+		{
+			if(memcmp(blocks.data() + (i * 64), referenceBlocks.data() + (i * 64), 64 * sizeof(int16)))
+			{
+				mismatchCount++;
+			}
+		}
+
+		double blockCount = static_cast<double>(BLOCK_COUNT) * ITERATION_COUNT;
+		printf("  %-12s %8.2f Mblocks/s (reference: %8.2f Mblocks/s)", range.description,
+		       blockCount / ToMicroseconds(time), blockCount / ToMicroseconds(referenceTime));
+		if(mismatchCount != 0)
+		{
+			printf(" (%d MISMATCHES)", mismatchCount);
+		}
+		printf("\r\n");
+	}
+}
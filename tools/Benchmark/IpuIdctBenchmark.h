@@ -0,0 +1,11 @@
+#pragma once
+
+#include "Benchmark.h"
+
+//Compares the IPU's IDCT against the IEEE 1180 reference implementation on random blocks
+//generated with the ranges used by the standard's accuracy test and reports both throughputs
+class CIpuIdctBenchmark : public CBenchmark
+{
+public:
+	void Execute() override;
+};
@@ -0,0 +1,41 @@
+#include <functional>
+#include "ExecutorInvalidationBenchmark.h"
+#include "GifPacketBenchmark.h"
+#include "GsCachedAreaBenchmark.h"
+#include "GsPacketReplayBenchmark.h"
+#include "GsTransferBenchmark.h"
+#include "IpuIdctBenchmark.h"
+#include "MemoryAccessBenchmark.h"
+#include "filesystem_def.h"
+
+typedef std::function<CBenchmark*()> BenchmarkFactoryFunction;
+
+//Frame dump used by benchmarks that replay captured data
+static fs::path g_frameDumpPath;
+
+static const BenchmarkFactoryFunction s_factories[] =
+    {
+        []() { return new CExecutorInvalidationBenchmark(); },
+        []() { return new CMemoryAccessBenchmark(); },
+        []() { return new CGsTransferBenchmark(); },
+        []() { return new CGsPacketReplayBenchmark(); },
+        []() { return new CGsCachedAreaBenchmark(); },
+        []() { return new CGifPacketBenchmark(g_frameDumpPath); },
+        []() { return new CIpuIdctBenchmark(); },
+};
+
+int main(int argc, const char** argv)
+{
+	if(argc >= 2)
+	{
+		g_frameDumpPath = argv[1];
+	}
+
+	for(const auto& factory : s_factories)
+	{
+		auto benchmark = factory();
+		benchmark->Execute();
+		delete benchmark;
+	}
+	return 0;
+}
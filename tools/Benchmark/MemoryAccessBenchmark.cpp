@@ -0,0 +1,92 @@
+#include <cstdio>
+#include <cstring>
+#include "MemoryAccessBenchmark.h"
+#include "MIPS.h"
+#include "MA_MIPSIV.h"
+#include "GenericMipsExecutor.h"
+
+#define RAM_SIZE (0x00200000)
+#define DATA_ADDRESS (0x00010000)
+#define ITERATION_COUNT (256)
+#define CYCLES_PER_ITERATION (0x10000)
+
+// clang-format off
+static const uint32 g_program[] =
+{
+	0x3C080001, //LUI    T0, 0x0001
+	0x24090100, //ADDIU  T1, R0, 0x100
+	//Loop:
+	0x8D0A0000, //LW     T2, 0x00(T0)
+	0xAD0A0004, //SW     T2, 0x04(T0)
+	0x9D0B0008, //LWU    T3, 0x08(T0)
+	0x890C000F, //LWL    T4, 0x0F(T0)
+	0x990C000C, //LWR    T4, 0x0C(T0)
+	0xA90C0013, //SWL    T4, 0x13(T0)
+	0xB90C0010, //SWR    T4, 0x10(T0)
+	0xDD0D0018, //LD     T5, 0x18(T0)
+	0xFD0D0020, //SD     T5, 0x20(T0)
+	0x2529FFFF, //ADDIU  T1, T1, -1
+	0x1520FFF5, //BNE    T1, R0, Loop
+	0x00000000, //NOP
+	0x1000FFF1, //BEQ    R0, R0, 0
+	0x00000000, //NOP
+};
+// clang-format on
+
+void CMemoryAccessBenchmark::RunProgram(CMIPS& cpu, CMipsExecutor& executor, const char* description)
+{
+	executor.Reset();
+	cpu.Reset();
+	cpu.m_State.nPC = 0;
+#ifdef PROFILE
+	cpu.m_memoryProxyStats = MIPS_MEMORY_PROXY_STATS();
+#endif
+
+	auto startTime = Clock::now();
+	for(uint32 i = 0; i < ITERATION_COUNT; i++)
+	{
+		executor.Execute(CYCLES_PER_ITERATION);
+	}
+	auto totalTime = Clock::now() - startTime;
+
+#ifdef PROFILE
+	printf("  %-12s %10.2f us (%d proxy reads, %d proxy writes)\r\n", description, ToMicroseconds(totalTime),
+	       cpu.m_memoryProxyStats.reads, cpu.m_memoryProxyStats.writes);
+#else
+	printf("  %-12s %10.2f us\r\n", description, ToMicroseconds(totalTime));
+#endif
+}
+
+void CMemoryAccessBenchmark::Execute()
+{
+	auto ram = new uint8[RAM_SIZE];
+	memset(ram, 0, RAM_SIZE);
+	memcpy(ram, g_program, sizeof(g_program));
+	for(uint32 i = 0; i < 0x40; i++)
+	{
+		ram[DATA_ADDRESS + i] = static_cast<uint8>(i * 0x11);
+	}
+
+	CMIPS cpu(MEMORYMAP_ENDIAN_LSBF, true);
+	CMA_MIPSIV arch(MIPS_REGSIZE_64);
+	cpu.m_pMemoryMap->InsertReadMap(0, RAM_SIZE - 1, ram, 0x00);
+	cpu.m_pMemoryMap->InsertWriteMap(0, RAM_SIZE - 1, ram, 0x00);
+	cpu.m_pMemoryMap->InsertInstructionMap(0, RAM_SIZE - 1, ram, 0x01);
+	cpu.m_pArch = &arch;
+	cpu.m_pAddrTranslator = &CMIPS::TranslateAddress64;
+
+	cpu.MapPages(0, RAM_SIZE, ram);
+
+	CGenericMipsExecutor<BlockLookupTwoWay> executor(cpu, RAM_SIZE);
+
+	printf("Memory access (LWU, LWL/LWR, SWL/SWR):\r\n");
+
+	//Previous code generation, LWU and unaligned accesses always call the proxies
+	arch.SetInlineUnalignedAccesses(false);
+	RunProgram(cpu, executor, "Proxy:");
+
+	arch.SetInlineUnalignedAccesses(true);
+	RunProgram(cpu, executor, "Inline:");
+
+	delete[] ram;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Benchmark.h"
+
+class CMIPS;
+class CMipsExecutor;
+
+//Runs a fixed loop of loads and stores on RAM mapped in the page table and compares
+//LWU and unaligned accesses going through the memory proxies against inline accesses
+class CMemoryAccessBenchmark : public CBenchmark
+{
+public:
+	void Execute() override;
+
+private:
+	static void RunProgram(CMIPS&, CMipsExecutor&, const char*);
+};
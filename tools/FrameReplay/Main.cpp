@@ -0,0 +1,299 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FrameDump.h"
+#include "filesystem_def.h"
+#include "StdStreamUtils.h"
+#include "gs/GSH_Null.h"
+#include "gs/GSH_Software.h"
+#ifdef _WIN32
+#include "gs/GSH_OpenGLWin32/GSH_OpenGLWin32.h"
+#include "gs/GSH_Direct3D9/GSH_Direct3D9.h"
+#include "win32/DefaultWndClass.h"
+#include "Singleton.h"
+#endif
+
+#define GS_HANDLER_NAME_NULL "null"
+#define GS_HANDLER_NAME_SOFTWARE "software"
+#define GS_HANDLER_NAME_OGL "ogl"
+#define GS_HANDLER_NAME_D3D9 "d3d9"
+
+#define DEFAULT_GS_HANDLER_NAME GS_HANDLER_NAME_NULL
+#define DEFAULT_ITERATION_COUNT (10)
+#define SLOWEST_PACKET_COUNT (10)
+
+typedef std::chrono::high_resolution_clock Clock;
+
+struct FRAME_RESULT
+{
+	double milliseconds = 0;
+	uint32 drawCallCount = 0;
+};
+
+typedef std::vector<FRAME_RESULT> FrameResultArray;
+typedef std::vector<double> PacketTimeArray;
+
+static std::set<std::string> g_validGsHandlersNames =
+    {
+        GS_HANDLER_NAME_NULL,
+        GS_HANDLER_NAME_SOFTWARE,
+#ifdef _WIN32
+        GS_HANDLER_NAME_OGL,
+        GS_HANDLER_NAME_D3D9,
+#endif
+};
+
+#ifdef _WIN32
+
+//Never shown, only used to get a rendering context
+class CReplayWindow : public Framework::Win32::CWindow, public CSingleton<CReplayWindow>
+{
+public:
+	CReplayWindow()
+	{
+		Create(0, Framework::Win32::CDefaultWndClass::GetName(), _T(""), WS_OVERLAPPED, Framework::Win32::CRect(0, 0, 640, 448), NULL, NULL);
+		SetClassPtr();
+	}
+};
+
+#endif
+
+static CGSHandler::FactoryFunction GetGsHandlerFactoryFunction(const std::string& gsHandlerName)
+{
+	if(gsHandlerName == GS_HANDLER_NAME_NULL)
+	{
+		return CGSH_Null::GetFactoryFunction();
+	}
+	else if(gsHandlerName == GS_HANDLER_NAME_SOFTWARE)
+	{
+		return CGSH_Software::GetFactoryFunction();
+	}
+#ifdef _WIN32
+	else if(gsHandlerName == GS_HANDLER_NAME_OGL)
+	{
+		return CGSH_OpenGLWin32::GetFactoryFunction(&CReplayWindow::GetInstance());
+	}
+	else if(gsHandlerName == GS_HANDLER_NAME_D3D9)
+	{
+		return CGSH_Direct3D9::GetFactoryFunction(&CReplayWindow::GetInstance());
+	}
+#endif
+	else
+	{
+		throw std::runtime_error("Unknown GS handler name.");
+	}
+}
+
+static double ToMilliseconds(const Clock::duration& duration)
+{
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+static void ReplayFrame(CGSHandler& gs, CFrameDump& frameDump, FRAME_RESULT& frameResult, PacketTimeArray* packetTimes)
+{
+	gs.Reset();
+	memcpy(gs.GetRam(), frameDump.GetInitialGsRam(), CGSHandler::RAMSIZE);
+	memcpy(gs.GetRegisters(), frameDump.GetInitialGsRegisters(), CGSHandler::REGISTER_MAX * sizeof(uint64));
+	gs.SetSMODE2(frameDump.GetInitialSMODE2());
+
+	auto frameStartTime = Clock::now();
+	const auto& packets = frameDump.GetPackets();
+	for(size_t packetIndex = 0; packetIndex < packets.size(); packetIndex++)
+	{
+		const auto& packet = packets[packetIndex];
+		auto packetStartTime = Clock::now();
+		if(!packet.registerWrites.empty())
+		{
+			gs.WriteRegisterMassively(packet.registerWrites, &packet.metadata);
+		}
+		if(!packet.imageData.empty())
+		{
+			gs.FeedImageData(packet.imageData.data(), static_cast<uint32>(packet.imageData.size()));
+		}
+		if(packetTimes)
+		{
+			//Wait for the GS thread to be done with this packet to time it individually
+			while(gs.GetPendingTransferCount() != 0)
+			{
+				std::this_thread::yield();
+			}
+			(*packetTimes)[packetIndex] += ToMilliseconds(Clock::now() - packetStartTime);
+		}
+	}
+
+	//Waits for all packets to be processed and reports the draw call count
+	gs.Flip();
+	frameResult.milliseconds = ToMilliseconds(Clock::now() - frameStartTime);
+}
+
+static void PrintSlowestPackets(const CFrameDump& frameDump, const PacketTimeArray& packetTimes, uint32 iterationCount)
+{
+	const auto& packets = frameDump.GetPackets();
+	std::vector<size_t> packetIndices(packets.size());
+	for(size_t i = 0; i < packetIndices.size(); i++)
+	{
+		packetIndices[i] = i;
+	}
+	size_t printCount = std::min<size_t>(SLOWEST_PACKET_COUNT, packetIndices.size());
+	std::partial_sort(packetIndices.begin(), packetIndices.begin() + printCount, packetIndices.end(),
+	                  [&](size_t left, size_t right) { return packetTimes[left] > packetTimes[right]; });
+
+	printf("Slowest packets:\r\n");
+	for(size_t i = 0; i < printCount; i++)
+	{
+		size_t packetIndex = packetIndices[i];
+		const auto& packet = packets[packetIndex];
+		printf("  Packet %6d (path %d): %10.3f us, %6d register writes, %8d image bytes\r\n",
+		       static_cast<int>(packetIndex), packet.metadata.pathIndex, (packetTimes[packetIndex] * 1000.0) / iterationCount,
+		       static_cast<int>(packet.registerWrites.size()), static_cast<int>(packet.imageData.size()));
+	}
+}
+
+static void PrintSummary(const CFrameDump& frameDump, const FrameResultArray& frameResults)
+{
+	//First frame includes warm up costs (shader compilation, texture uploads, etc.)
+	size_t firstFrame = (frameResults.size() > 1) ? 1 : 0;
+	double minTime = frameResults[firstFrame].milliseconds;
+	double maxTime = frameResults[firstFrame].milliseconds;
+	double totalTime = 0;
+	for(size_t i = firstFrame; i < frameResults.size(); i++)
+	{
+		minTime = std::min(minTime, frameResults[i].milliseconds);
+		maxTime = std::max(maxTime, frameResults[i].milliseconds);
+		totalTime += frameResults[i].milliseconds;
+	}
+	size_t frameCount = frameResults.size() - firstFrame;
+	double averageTime = totalTime / frameCount;
+	size_t packetCount = std::max<size_t>(frameDump.GetPackets().size(), 1);
+
+	printf("Summary (%d frames%s):\r\n", static_cast<int>(frameCount), firstFrame ? ", first frame excluded" : "");
+	printf("  Frame time: min %.3f ms, avg %.3f ms, max %.3f ms (%.1f fps)\r\n", minTime, averageTime, maxTime, 1000.0 / averageTime);
+	printf("  Average packet time: %.3f us\r\n", (averageTime * 1000.0) / packetCount);
+	printf("  Draw calls per frame: %d\r\n", static_cast<int>(frameResults.back().drawCallCount));
+}
+
+int main(int argc, const char** argv)
+{
+	if(argc < 2)
+	{
+		printf("Usage: FrameReplay [options] frameDumpPath\r\n");
+		printf("Options: \r\n");
+		printf("\t --gshandler <name>\t Selects which GS handler to instantiate (default is '%s').\r\n", DEFAULT_GS_HANDLER_NAME);
+		printf("\t --iterations <count>\t Number of times the frame is replayed (default is %d).\r\n", DEFAULT_ITERATION_COUNT);
+		printf("\t --packettimings\t Waits for each packet to complete and reports the slowest ones.\r\n");
+		return -1;
+	}
+
+	fs::path frameDumpPath;
+	std::string gsHandlerName = DEFAULT_GS_HANDLER_NAME;
+	uint32 iterationCount = DEFAULT_ITERATION_COUNT;
+	bool packetTimingsEnabled = false;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--gshandler"))
+		{
+			if((i + 1) >= argc)
+			{
+				printf("Error: GS handler name must be specified for --gshandler option.\r\n");
+				return -1;
+			}
+			gsHandlerName = argv[i + 1];
+			if(g_validGsHandlersNames.find(gsHandlerName) == std::end(g_validGsHandlersNames))
+			{
+				printf("Error: Invalid GS handler name '%s'.\r\n", gsHandlerName.c_str());
+				return -1;
+			}
+			i++;
+		}
+		else if(!strcmp(argv[i], "--iterations"))
+		{
+			if((i + 1) >= argc)
+			{
+				printf("Error: Count must be specified for --iterations option.\r\n");
+				return -1;
+			}
+			iterationCount = std::max(atoi(argv[i + 1]), 1);
+			i++;
+		}
+		else if(!strcmp(argv[i], "--packettimings"))
+		{
+			packetTimingsEnabled = true;
+		}
+		else
+		{
+			frameDumpPath = argv[i];
+			break;
+		}
+	}
+
+	if(frameDumpPath.empty())
+	{
+		printf("Error: No frame dump specified.\r\n");
+		return -1;
+	}
+
+	try
+	{
+		CFrameDump frameDump;
+		{
+			auto inputStream = Framework::CreateInputStdStream(frameDumpPath.native());
+			frameDump.Read(inputStream);
+		}
+
+		uint32 registerWriteCount = 0;
+		uint32 imageDataSize = 0;
+		for(const auto& packet : frameDump.GetPackets())
+		{
+			registerWriteCount += static_cast<uint32>(packet.registerWrites.size());
+			imageDataSize += static_cast<uint32>(packet.imageData.size());
+		}
+
+		printf("Frame dump: %s\r\n", frameDumpPath.string().c_str());
+		printf("  %d packets, %d register writes, %d bytes of image data\r\n",
+		       static_cast<int>(frameDump.GetPackets().size()), registerWriteCount, imageDataSize);
+		printf("GS handler: %s\r\n", gsHandlerName.c_str());
+
+		std::unique_ptr<CGSHandler> gs(GetGsHandlerFactoryFunction(gsHandlerName)());
+		gs->Initialize();
+
+		FrameResultArray frameResults(iterationCount);
+		PacketTimeArray packetTimes(frameDump.GetPackets().size());
+
+		uint32 currentFrame = 0;
+		auto newFrameConnection = gs->OnNewFrame.Connect(
+		    [&](uint32 drawCallCount) {
+			    frameResults[currentFrame].drawCallCount = drawCallCount;
+		    });
+
+		for(currentFrame = 0; currentFrame < iterationCount; currentFrame++)
+		{
+			auto& frameResult = frameResults[currentFrame];
+			ReplayFrame(*gs, frameDump, frameResult, packetTimingsEnabled ? &packetTimes : nullptr);
+			printf("Frame %4d: %10.3f ms, %6d draw calls\r\n", currentFrame + 1, frameResult.milliseconds, frameResult.drawCallCount);
+		}
+
+		newFrameConnection.reset();
+		gs->Release();
+
+		PrintSummary(frameDump, frameResults);
+		if(packetTimingsEnabled)
+		{
+			PrintSlowestPackets(frameDump, packetTimes, iterationCount);
+		}
+	}
+	catch(const std::exception& exception)
+	{
+		printf("Error: Failed to replay frame dump: %s\r\n", exception.what());
+		return -1;
+	}
+
+	return 0;
+}
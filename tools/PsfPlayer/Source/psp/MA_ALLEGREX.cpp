@@ -38,6 +38,13 @@ CMA_ALLEGREX::~CMA_ALLEGREX()
 {
 }
 
+std::unique_ptr<CMIPSArchitecture> CMA_ALLEGREX::Clone() const
+{
+	auto result = std::make_unique<CMA_ALLEGREX>();
+	result->SetInlineUnalignedAccesses(m_inlineUnalignedAccesses);
+	return result;
+}
+
 void CMA_ALLEGREX::SPECIAL3()
 {
 	m_pOpSpecial3[m_nImmediate & 0x3F]();
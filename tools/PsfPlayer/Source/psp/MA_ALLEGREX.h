@@ -11,6 +11,8 @@ public:
 	CMA_ALLEGREX();
 	virtual ~CMA_ALLEGREX();
 
+	std::unique_ptr<CMIPSArchitecture> Clone() const override;
+
 protected:
 	enum
 	{
@@ -0,0 +1,86 @@
+#include <chrono>
+#include <cstdio>
+#include "FlagsBenchmark.h"
+#include "VuAssembler.h"
+
+#define TRANSFORM_COUNT (64)
+#define ITERATION_COUNT (20000)
+
+typedef std::chrono::high_resolution_clock Clock;
+
+void CFlagsBenchmark::Execute(CTestVm& virtualMachine)
+{
+	//Compares a vertex transform loop that never looks at MAC flags with the same loop reading
+	//them after every instruction. MAC flag updates can be skipped entirely in the first case.
+
+	double unobservedSeconds = RunProgram(virtualMachine, false);
+	auto unobservedResult = virtualMachine.m_cpu.m_State.nCOP2[6];
+
+	double observedSeconds = RunProgram(virtualMachine, true);
+	auto observedResult = virtualMachine.m_cpu.m_State.nCOP2[6];
+
+	TEST_VERIFY(unobservedResult.nV0 == observedResult.nV0);
+	TEST_VERIFY(unobservedResult.nV1 == observedResult.nV1);
+	TEST_VERIFY(unobservedResult.nV2 == observedResult.nV2);
+	TEST_VERIFY(unobservedResult.nV3 == observedResult.nV3);
+
+	//All results are zero, Z flags must be set for every lane
+	TEST_VERIFY(virtualMachine.m_cpu.m_State.nCOP2VI[1] == 0xF);
+
+	double instructionCount = static_cast<double>(ITERATION_COUNT) * TRANSFORM_COUNT * 4;
+	printf("VU MAC flags (%d x %d transforms):\r\n", ITERATION_COUNT, TRANSFORM_COUNT);
+	printf("  Flags unobserved: %8.1f Minstr/s\r\n", instructionCount / (unobservedSeconds * 1000000.0));
+	printf("  Flags observed:   %8.1f Minstr/s (%.2fx slower)\r\n", instructionCount / (observedSeconds * 1000000.0),
+	       observedSeconds / unobservedSeconds);
+}
+
+double CFlagsBenchmark::RunProgram(CTestVm& virtualMachine, bool readFlags)
+{
+	virtualMachine.Reset();
+
+	auto microMem = reinterpret_cast<uint32*>(virtualMachine.m_microMem);
+
+	CVuAssembler assembler(microMem);
+
+	auto lowerOp = readFlags ? CVuAssembler::Lower::FMAND(CVuAssembler::VI1, CVuAssembler::VI2) : CVuAssembler::Lower::NOP();
+
+	for(uint32 i = 0; i < TRANSFORM_COUNT; i++)
+	{
+		assembler.Write(
+		    CVuAssembler::Upper::MULAbc(CVuAssembler::DEST_XYZW, CVuAssembler::VF1, CVuAssembler::VF5, CVuAssembler::BC_X),
+		    lowerOp);
+
+		assembler.Write(
+		    CVuAssembler::Upper::MADDAbc(CVuAssembler::DEST_XYZW, CVuAssembler::VF2, CVuAssembler::VF5, CVuAssembler::BC_Y),
+		    lowerOp);
+
+		assembler.Write(
+		    CVuAssembler::Upper::MADDAbc(CVuAssembler::DEST_XYZW, CVuAssembler::VF3, CVuAssembler::VF5, CVuAssembler::BC_Z),
+		    lowerOp);
+
+		assembler.Write(
+		    CVuAssembler::Upper::MADDbc(CVuAssembler::DEST_XYZW, CVuAssembler::VF6, CVuAssembler::VF4, CVuAssembler::VF5, CVuAssembler::BC_W),
+		    lowerOp);
+	}
+
+	assembler.Write(
+	    CVuAssembler::Upper::NOP() | CVuAssembler::Upper::E_BIT,
+	    CVuAssembler::Lower::NOP());
+
+	assembler.Write(
+	    CVuAssembler::Upper::NOP(),
+	    CVuAssembler::Lower::NOP());
+
+	virtualMachine.m_cpu.m_State.nCOP2VI[2] = 0xFFFF;
+
+	//First run compiles the program
+	virtualMachine.ExecuteTest(0);
+
+	auto startTime = Clock::now();
+	for(uint32 i = 0; i < ITERATION_COUNT; i++)
+	{
+		virtualMachine.m_cpu.m_State.nHasException = MIPS_EXCEPTION_NONE;
+		virtualMachine.ExecuteTest(0);
+	}
+	return std::chrono::duration<double>(Clock::now() - startTime).count();
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "Test.h"
+
+class CFlagsBenchmark : public CTest
+{
+public:
+	void Execute(CTestVm&) override;
+
+private:
+	double RunProgram(CTestVm&, bool);
+};
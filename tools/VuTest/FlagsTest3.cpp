@@ -0,0 +1,75 @@
+#include "FlagsTest3.h"
+#include "VuAssembler.h"
+
+void CFlagsTest3::Execute(CTestVm& virtualMachine)
+{
+	virtualMachine.Reset();
+
+	auto microMem = reinterpret_cast<uint32*>(virtualMachine.m_microMem);
+
+	//OPMULA doesn't update MAC flags, MULi result must still be visible to FMAND after it
+
+	CVuAssembler assembler(microMem);
+
+	//pipe = 0		//macTime = 0 + 4 = 4
+	assembler.Write(
+	    CVuAssembler::Upper::MULi(CVuAssembler::DEST_XYZW, CVuAssembler::VF1, CVuAssembler::VF2),
+	    CVuAssembler::Lower::NOP());
+
+	//pipe = 1
+	assembler.Write(
+	    CVuAssembler::Upper::OPMULA(CVuAssembler::VF3, CVuAssembler::VF4),
+	    CVuAssembler::Lower::NOP());
+
+	//pipe = 2
+	assembler.Write(
+	    CVuAssembler::Upper::NOP(),
+	    CVuAssembler::Lower::NOP());
+
+	//pipe = 3
+	assembler.Write(
+	    CVuAssembler::Upper::NOP(),
+	    CVuAssembler::Lower::NOP());
+
+	//pipe = 4
+	assembler.Write(
+	    CVuAssembler::Upper::NOP(),
+	    CVuAssembler::Lower::NOP());
+
+	//pipe = 5		//check result from MULi operation
+	assembler.Write(
+	    CVuAssembler::Upper::NOP(),
+	    CVuAssembler::Lower::FMAND(CVuAssembler::VI2, CVuAssembler::VI1));
+
+	assembler.Write(
+	    CVuAssembler::Upper::NOP() | CVuAssembler::Upper::E_BIT,
+	    CVuAssembler::Lower::NOP());
+
+	assembler.Write(
+	    CVuAssembler::Upper::NOP(),
+	    CVuAssembler::Lower::NOP());
+
+	virtualMachine.m_cpu.m_State.nCOP2I = 0; //I = 0
+
+	virtualMachine.m_cpu.m_State.nCOP2[2].nV0 = 0x3F800000; //VF2 = (1, 1, 1, 1)
+	virtualMachine.m_cpu.m_State.nCOP2[2].nV1 = 0x3F800000;
+	virtualMachine.m_cpu.m_State.nCOP2[2].nV2 = 0x3F800000;
+	virtualMachine.m_cpu.m_State.nCOP2[2].nV3 = 0x3F800000;
+
+	virtualMachine.m_cpu.m_State.nCOP2[3].nV0 = 0xBF800000; //VF3 = (-1, -1, -1, -1)
+	virtualMachine.m_cpu.m_State.nCOP2[3].nV1 = 0xBF800000;
+	virtualMachine.m_cpu.m_State.nCOP2[3].nV2 = 0xBF800000;
+	virtualMachine.m_cpu.m_State.nCOP2[3].nV3 = 0xBF800000;
+
+	virtualMachine.m_cpu.m_State.nCOP2[4].nV0 = 0x3F800000; //VF4 = (1, 1, 1, 1)
+	virtualMachine.m_cpu.m_State.nCOP2[4].nV1 = 0x3F800000;
+	virtualMachine.m_cpu.m_State.nCOP2[4].nV2 = 0x3F800000;
+	virtualMachine.m_cpu.m_State.nCOP2[4].nV3 = 0x3F800000;
+
+	virtualMachine.m_cpu.m_State.nCOP2VI[1] = 0xFFFF;
+
+	virtualMachine.ExecuteTest(0);
+
+	//Check if Z flags are set and S flags cleared
+	TEST_VERIFY(virtualMachine.m_cpu.m_State.nCOP2VI[2] == 0xF);
+}
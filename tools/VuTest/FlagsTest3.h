@@ -0,0 +1,9 @@
+#pragma once
+
+#include "Test.h"
+
+class CFlagsTest3 : public CTest
+{
+public:
+	void Execute(CTestVm&) override;
+};
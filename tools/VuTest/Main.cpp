@@ -2,9 +2,13 @@
 #include <assert.h>
 #include <fenv.h>
 #include "AddTest.h"
+#include "FlagsBenchmark.h"
 #include "FlagsTest.h"
 #include "FlagsTest2.h"
+#include "FlagsTest3.h"
+#include "ProgramCacheTest.h"
 #include "TriAceTest.h"
+#include "VifUnpackBenchmark.h"
 
 typedef std::function<CTest*()> TestFactoryFunction;
 
@@ -13,7 +17,11 @@ static const TestFactoryFunction s_factories[] =
         []() { return new CAddTest(); },
         []() { return new CFlagsTest(); },
         []() { return new CFlagsTest2(); },
+        []() { return new CFlagsTest3(); },
+        []() { return new CFlagsBenchmark(); },
+        []() { return new CProgramCacheTest(); },
         []() { return new CTriAceTest(); },
+        []() { return new CVifUnpackBenchmark(); },
 };
 
 int main(int argc, const char** argv)
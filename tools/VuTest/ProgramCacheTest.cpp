@@ -0,0 +1,119 @@
+#include "ProgramCacheTest.h"
+#include "VuAssembler.h"
+#include "Ps2Const.h"
+
+static uint32 FloatToInt(float value)
+{
+	return *reinterpret_cast<uint32*>(&value);
+}
+
+void CProgramCacheTest::Execute(CTestVm& virtualMachine)
+{
+	//Switches back and forth between two micro programs, like a game uploading
+	//a different renderer for every pass. Coming back to a program must restore
+	//its blocks and links as they were before it was replaced.
+
+	virtualMachine.Reset();
+
+	WriteProgram(virtualMachine, 1.0f, 4);
+	RunProgram(virtualMachine, 4.0f);
+
+	WriteProgram(virtualMachine, 2.0f, 3);
+	RunProgram(virtualMachine, 6.0f);
+
+	WriteProgram(virtualMachine, 1.0f, 4);
+	RunProgram(virtualMachine, 4.0f);
+
+	WriteProgram(virtualMachine, 2.0f, 3);
+	RunProgram(virtualMachine, 6.0f);
+
+	//Only the increment changes, blocks covering it must be dropped while the others are kept
+	WriteIncrement(virtualMachine, 3.0f);
+	RunProgram(virtualMachine, 9.0f);
+
+	//Program that was partially replaced comes back
+	WriteProgram(virtualMachine, 2.0f, 3);
+	RunProgram(virtualMachine, 6.0f);
+
+	//Micro memory doesn't change, this isn't a program switch
+	WriteProgram(virtualMachine, 2.0f, 3);
+	RunProgram(virtualMachine, 6.0f);
+
+	auto stats = virtualMachine.m_executor.GetProgramCacheStats();
+	TEST_VERIFY(stats.programSwitches == 6);
+	TEST_VERIFY(stats.cacheHits == 3);
+}
+
+void CProgramCacheTest::WriteIncrement(CTestVm& virtualMachine, float increment)
+{
+	//Same range CVpu would invalidate, extended to cover the lookahead of blocks ending before it
+	virtualMachine.m_executor.ClearActiveBlocksInRange(0, 0x10, false);
+
+	auto microMem = reinterpret_cast<uint32*>(virtualMachine.m_microMem);
+	microMem[0x08 / 4] = FloatToInt(increment);
+}
+
+void CProgramCacheTest::WriteProgram(CTestVm& virtualMachine, float increment, uint16 iterationCount)
+{
+	//Micro memory is about to change, same as what VIF's MPG does
+	virtualMachine.m_executor.ClearActiveBlocksInRange(0, PS2::MICROMEM1SIZE, false);
+
+	auto microMem = reinterpret_cast<uint32*>(virtualMachine.m_microMem);
+
+	CVuAssembler assembler(microMem);
+
+	//0x00
+	assembler.Write(
+	    CVuAssembler::Upper::NOP(),
+	    CVuAssembler::Lower::IADDIU(CVuAssembler::VI1, CVuAssembler::VI0, iterationCount));
+
+	//0x08 - Loop
+	assembler.Write(
+	    CVuAssembler::Upper::NOP() | CVuAssembler::Upper::I_BIT,
+	    FloatToInt(increment));
+
+	//0x10
+	assembler.Write(
+	    CVuAssembler::Upper::ADDi(CVuAssembler::DEST_XYZW, CVuAssembler::VF2, CVuAssembler::VF2),
+	    CVuAssembler::Lower::ISUBIU(CVuAssembler::VI1, CVuAssembler::VI1, 1));
+
+	//0x18
+	assembler.Write(
+	    CVuAssembler::Upper::NOP(),
+	    CVuAssembler::Lower::NOP());
+
+	//0x20
+	assembler.Write(
+	    CVuAssembler::Upper::NOP(),
+	    CVuAssembler::Lower::IBNE(CVuAssembler::VI1, CVuAssembler::VI0, -4));
+
+	//0x28
+	assembler.Write(
+	    CVuAssembler::Upper::NOP(),
+	    CVuAssembler::Lower::NOP());
+
+	//0x30
+	assembler.Write(
+	    CVuAssembler::Upper::NOP() | CVuAssembler::Upper::E_BIT,
+	    CVuAssembler::Lower::NOP());
+
+	assembler.Write(
+	    CVuAssembler::Upper::NOP(),
+	    CVuAssembler::Lower::NOP());
+}
+
+void CProgramCacheTest::RunProgram(CTestVm& virtualMachine, float expectedResult)
+{
+	virtualMachine.m_cpu.m_State.nHasException = MIPS_EXCEPTION_NONE;
+	virtualMachine.m_cpu.m_State.nCOP2[2].nV0 = 0;
+	virtualMachine.m_cpu.m_State.nCOP2[2].nV1 = 0;
+	virtualMachine.m_cpu.m_State.nCOP2[2].nV2 = 0;
+	virtualMachine.m_cpu.m_State.nCOP2[2].nV3 = 0;
+
+	virtualMachine.ExecuteTest(0);
+
+	TEST_VERIFY(virtualMachine.m_cpu.m_State.nCOP2[2].nV0 == FloatToInt(expectedResult));
+	TEST_VERIFY(virtualMachine.m_cpu.m_State.nCOP2[2].nV1 == FloatToInt(expectedResult));
+	TEST_VERIFY(virtualMachine.m_cpu.m_State.nCOP2[2].nV2 == FloatToInt(expectedResult));
+	TEST_VERIFY(virtualMachine.m_cpu.m_State.nCOP2[2].nV3 == FloatToInt(expectedResult));
+}
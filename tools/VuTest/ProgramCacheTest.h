@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Test.h"
+
+class CProgramCacheTest : public CTest
+{
+public:
+	void Execute(CTestVm&) override;
+
+private:
+	void WriteProgram(CTestVm&, float, uint16);
+	void WriteIncrement(CTestVm&, float);
+	void RunProgram(CTestVm&, float);
+};
@@ -0,0 +1,257 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include "VifUnpackBenchmark.h"
+#include "ee/VifUnpack.h"
+
+#define VUMEM_SIZE (0x4000)
+#define ITERATION_COUNT (2000)
+
+typedef std::chrono::high_resolution_clock Clock;
+
+struct CYCLE_SETTING
+{
+	uint32 cl;
+	uint32 wl;
+};
+
+static const uint32 g_formats[] =
+    {
+        VifUnpack::FORMAT_S32,
+        VifUnpack::FORMAT_S16,
+        VifUnpack::FORMAT_S8,
+        VifUnpack::FORMAT_V2_32,
+        VifUnpack::FORMAT_V2_16,
+        VifUnpack::FORMAT_V2_8,
+        VifUnpack::FORMAT_V3_32,
+        VifUnpack::FORMAT_V3_16,
+        VifUnpack::FORMAT_V3_8,
+        VifUnpack::FORMAT_V4_32,
+        VifUnpack::FORMAT_V4_16,
+        VifUnpack::FORMAT_V4_8,
+        VifUnpack::FORMAT_V4_5,
+};
+
+static const char* g_formatNames[VifUnpack::FORMAT_COUNT] =
+    {
+        "S-32", "S-16", "S-8", nullptr,
+        "V2-32", "V2-16", "V2-8", nullptr,
+        "V3-32", "V3-16", "V3-8", nullptr,
+        "V4-32", "V4-16", "V4-8", "V4-5",
+};
+
+//WL = 0 is handled by the VIF as CL = 0 and WL = infinite
+static const CYCLE_SETTING g_cycles[] =
+    {
+        {1, 1},
+        {4, 4},
+        {4, 2},
+        {2, 4},
+        {0, ~0U},
+};
+
+static uint32 Random(uint32& seed)
+{
+	seed = (seed * 1103515245) + 12345;
+	return seed >> 8;
+}
+
+//Element per element implementation, matches what the VIF used to do before kernels were specialized
+static uint32 UnpackReference(VifUnpack::STATE& state, uint32 format, bool useMask, uint32 mode, bool usn,
+                              const uint8* src, uint32 srcCount, uint8* dst, uint32 dstAddr, uint32 num)
+{
+	uint32 fieldCount = (format >> 2) + 1;
+	uint32 fieldSize = 4 >> (format & 3);
+	while(num != 0)
+	{
+		bool mustRead = (state.cl >= state.wl) ? (state.readTick < state.wl) : (state.writeTick < state.cl);
+		bool mustWrite = (state.cl >= state.wl) ? mustRead : true;
+		uint32 value[4] = {0, 0, 0, 0};
+		if(mustRead)
+		{
+			if(srcCount == 0) break;
+			if(format == VifUnpack::FORMAT_V4_5)
+			{
+				uint16 color = src[0] | (src[1] << 8);
+				value[0] = ((color >> 0) & 0x1F) << 3;
+				value[1] = ((color >> 5) & 0x1F) << 3;
+				value[2] = ((color >> 10) & 0x1F) << 3;
+				value[3] = ((color >> 15) & 0x01) << 7;
+			}
+			else
+			{
+				for(uint32 i = 0; i < fieldCount; i++)
+				{
+					uint32 field = 0;
+					memcpy(&field, src + (i * fieldSize), fieldSize);
+					if(!usn && (fieldSize == 2)) field = static_cast<int16>(field);
+					if(!usn && (fieldSize == 1)) field = static_cast<int8>(field);
+					value[i] = field;
+				}
+				if(fieldCount == 1)
+				{
+					value[1] = value[2] = value[3] = value[0];
+				}
+			}
+			src += VifUnpack::GetElementSize(format);
+			srcCount--;
+		}
+		if(mustWrite)
+		{
+			auto dstVector = reinterpret_cast<uint32*>(dst + dstAddr);
+			uint32 column = std::min<uint32>(state.writeTick, 3);
+			for(uint32 i = 0; i < 4; i++)
+			{
+				uint32 maskOp = useMask ? ((state.mask >> (((column * 4) + i) * 2)) & 3) : VifUnpack::MASK_DATA;
+				if(maskOp == VifUnpack::MASK_DATA)
+				{
+					if(mode == VifUnpack::MODE_OFFSET)
+					{
+						value[i] += state.row[i];
+					}
+					else if(mode == VifUnpack::MODE_DIFFERENCE)
+					{
+						value[i] += state.row[i];
+						state.row[i] = value[i];
+					}
+					dstVector[i] = value[i];
+				}
+				else if(maskOp == VifUnpack::MASK_ROW)
+				{
+					dstVector[i] = state.row[i];
+				}
+				else if(maskOp == VifUnpack::MASK_COL)
+				{
+					dstVector[i] = state.col[column];
+				}
+			}
+			num--;
+		}
+		state.writeTick = std::min<uint32>(state.writeTick + 1, state.wl);
+		state.readTick = std::min<uint32>(state.readTick + 1, state.cl);
+		bool cycleDone = (state.cl >= state.wl) ? (state.readTick == state.cl) : (state.writeTick == state.wl);
+		if(cycleDone)
+		{
+			state.writeTick = 0;
+			state.readTick = 0;
+		}
+		dstAddr = (dstAddr + 0x10) & (VUMEM_SIZE - 1);
+	}
+	return num;
+}
+
+void CVifUnpackBenchmark::Execute(CTestVm&)
+{
+	CheckKernels();
+	MeasureThroughput();
+}
+
+void CVifUnpackBenchmark::CheckKernels()
+{
+	uint32 seed = 0x12345678;
+	std::vector<uint8> src(VifUnpack::MAX_READ_SIZE);
+	std::vector<uint8> expectedMem(VUMEM_SIZE);
+	std::vector<uint8> kernelMem(VUMEM_SIZE);
+
+	for(auto format : g_formats)
+	{
+		for(const auto& cycle : g_cycles)
+		{
+			for(uint32 variant = 0; variant < (2 * VifUnpack::MODE_COUNT * 2); variant++)
+			{
+				bool useMask = (variant & 1) != 0;
+				bool usn = (variant & 2) != 0;
+				uint32 mode = variant / 4;
+
+				for(auto& value : src)
+				{
+					value = static_cast<uint8>(Random(seed));
+				}
+				for(auto& value : expectedMem)
+				{
+					value = static_cast<uint8>(Random(seed));
+				}
+				kernelMem = expectedMem;
+
+				VifUnpack::STATE state;
+				state.cl = cycle.cl;
+				state.wl = cycle.wl;
+				state.mask = Random(seed) | (Random(seed) << 16);
+				for(uint32 i = 0; i < 4; i++)
+				{
+					state.row[i] = Random(seed);
+					state.col[i] = Random(seed);
+				}
+
+				//Splits the transfer to make sure state is carried properly between calls
+				uint32 num = 1 + (Random(seed) % VifUnpack::MAX_NUM);
+				uint32 dstAddr = (Random(seed) % (VUMEM_SIZE / 0x10)) * 0x10;
+				VifUnpack::STATE expectedState = state;
+				uint32 srcCount = VifUnpack::GetReadCount(state, num);
+				uint32 firstCount = srcCount / 2;
+				uint32 elementSize = VifUnpack::GetElementSize(format);
+
+				uint32 expectedNum = UnpackReference(expectedState, format, useMask, mode, usn, src.data(), srcCount, expectedMem.data(), dstAddr, num);
+
+				auto kernel = VifUnpack::GetKernel(format, useMask, mode, usn, state.cl, state.wl);
+				TEST_VERIFY(kernel != nullptr);
+				uint32 kernelNum = kernel(state, src.data(), firstCount, kernelMem.data(), dstAddr, VUMEM_SIZE - 1, num);
+				uint32 written = num - kernelNum;
+				uint32 skipped = (state.cl > state.wl) ? (state.cl * (written / state.wl) + (written % state.wl)) : written;
+				kernelNum = kernel(state, src.data() + (firstCount * elementSize), srcCount - firstCount, kernelMem.data(),
+				                   (dstAddr + (skipped * 0x10)) & (VUMEM_SIZE - 1), VUMEM_SIZE - 1, kernelNum);
+
+				TEST_VERIFY(kernelNum == expectedNum);
+				TEST_VERIFY(kernelMem == expectedMem);
+				TEST_VERIFY(!memcmp(state.row, expectedState.row, sizeof(state.row)));
+				TEST_VERIFY(state.readTick == expectedState.readTick);
+				TEST_VERIFY(state.writeTick == expectedState.writeTick);
+			}
+		}
+	}
+}
+
+void CVifUnpackBenchmark::MeasureThroughput()
+{
+	std::vector<uint8> src(VifUnpack::MAX_READ_SIZE);
+	std::vector<uint8> vuMem(VUMEM_SIZE);
+	uint32 seed = 0x87654321;
+	for(auto& value : src)
+	{
+		value = static_cast<uint8>(Random(seed));
+	}
+
+	printf("VIF UNPACK throughput (%d x %d quadwords):\r\n", ITERATION_COUNT, VifUnpack::MAX_NUM);
+	for(auto format : g_formats)
+	{
+		for(uint32 variant = 0; variant < 2; variant++)
+		{
+			bool useMask = (variant != 0);
+			VifUnpack::STATE state;
+			state.mask = 0xE4E4E4E4;
+			auto kernel = VifUnpack::GetKernel(format, useMask, VifUnpack::MODE_NORMAL, false, state.cl, state.wl);
+			TEST_VERIFY(kernel != nullptr);
+
+			auto startTime = Clock::now();
+			for(uint32 i = 0; i < ITERATION_COUNT; i++)
+			{
+				UnpackReference(state, format, useMask, VifUnpack::MODE_NORMAL, false, src.data(), VifUnpack::MAX_NUM, vuMem.data(), 0, VifUnpack::MAX_NUM);
+			}
+			double referenceSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+
+			startTime = Clock::now();
+			for(uint32 i = 0; i < ITERATION_COUNT; i++)
+			{
+				kernel(state, src.data(), VifUnpack::MAX_NUM, vuMem.data(), 0, VUMEM_SIZE - 1, VifUnpack::MAX_NUM);
+			}
+			double seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+
+			double quadwords = static_cast<double>(ITERATION_COUNT) * VifUnpack::MAX_NUM;
+			printf("  %-6s %-9s %8.1f Mqw/s, %8.1f MB/s read (%.1fx over element per element)\r\n", g_formatNames[format], useMask ? "(masked)" : "",
+			       quadwords / (seconds * 1000000.0), (quadwords * VifUnpack::GetElementSize(format)) / (seconds * 1000000.0),
+			       referenceSeconds / seconds);
+		}
+	}
+}
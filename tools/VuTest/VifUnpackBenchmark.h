@@ -0,0 +1,13 @@
+#pragma once
+
+#include "Test.h"
+
+class CVifUnpackBenchmark : public CTest
+{
+public:
+	void Execute(CTestVm&) override;
+
+private:
+	void CheckKernels();
+	void MeasureThroughput();
+};
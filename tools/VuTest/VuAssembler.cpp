@@ -133,6 +133,38 @@ uint32 CVuAssembler::Lower::FSAND(VI_REGISTER it, uint16 imm)
 	return result;
 }
 
+uint32 CVuAssembler::Lower::IADDIU(VI_REGISTER it, VI_REGISTER is, uint16 imm)
+{
+	imm &= 0x7FFF;
+	uint32 result = 0x10000000;
+	result |= (it << 16);
+	result |= (is << 11);
+	result |= (imm & 0x7FF);
+	result |= ((imm >> 11) << 21);
+	return result;
+}
+
+//Offset is in double words, relative to the instruction following the branch
+uint32 CVuAssembler::Lower::IBNE(VI_REGISTER it, VI_REGISTER is, int16 offset)
+{
+	uint32 result = 0x52000000;
+	result |= (it << 16);
+	result |= (is << 11);
+	result |= (offset & 0x7FF);
+	return result;
+}
+
+uint32 CVuAssembler::Lower::ISUBIU(VI_REGISTER it, VI_REGISTER is, uint16 imm)
+{
+	imm &= 0x7FFF;
+	uint32 result = 0x12000000;
+	result |= (it << 16);
+	result |= (is << 11);
+	result |= (imm & 0x7FF);
+	result |= ((imm >> 11) << 21);
+	return result;
+}
+
 uint32 CVuAssembler::Lower::NOP()
 {
 	return 0x8000033C;
@@ -120,6 +120,9 @@ public:
 	public:
 		static uint32 FMAND(VI_REGISTER, VI_REGISTER);
 		static uint32 FSAND(VI_REGISTER, uint16);
+		static uint32 IADDIU(VI_REGISTER, VI_REGISTER, uint16);
+		static uint32 IBNE(VI_REGISTER, VI_REGISTER, int16);
+		static uint32 ISUBIU(VI_REGISTER, VI_REGISTER, uint16);
 		static uint32 NOP();
 	};
 